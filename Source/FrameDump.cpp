@@ -1,5 +1,6 @@
 #include <cstring>
 #include "FrameDump.h"
+#include "FrameDumpStream.h"
 #include "states/MemoryStateFile.h"
 #include "states/RegisterStateFile.h"
 
@@ -78,6 +79,21 @@ void CFrameDump::Read(Framework::CStream& input)
 {
 	Reset();
 
+	if(CFrameDumpReader::IsFrameDumpStream(input))
+	{
+		CFrameDumpReader reader(input);
+		memcpy(m_initialGsRam, reader.GetInitialGsRam(), CGSHandler::RAMSIZE);
+		memcpy(m_initialGsRegisters, reader.GetInitialGsRegisters(), sizeof(uint64) * CGSHandler::REGISTER_MAX);
+		m_initialSMODE2 = reader.GetInitialSMODE2();
+		m_packets.reserve(reader.GetPacketCount());
+		for(uint32 packetIndex = 0; packetIndex < reader.GetPacketCount(); packetIndex++)
+		{
+			m_packets.push_back(reader.ReadPacket(packetIndex));
+		}
+		return;
+	}
+
+	//Legacy format, each packet is a file inside a zip archive
 	Framework::CZipArchiveReader archive(input);
 
 	archive.BeginReadFile(STATE_INITIAL_GSRAM)->Read(m_initialGsRam, CGSHandler::RAMSIZE);
@@ -134,36 +150,12 @@ void CFrameDump::Read(Framework::CStream& input)
 
 void CFrameDump::Write(Framework::CStream& output) const
 {
-	Framework::CZipArchiveWriter archive;
-
-	archive.InsertFile(std::make_unique<CMemoryStateFile>(STATE_INITIAL_GSRAM, m_initialGsRam, CGSHandler::RAMSIZE));
-	archive.InsertFile(std::make_unique<CMemoryStateFile>(STATE_INITIAL_GSREGS, m_initialGsRegisters, sizeof(uint64) * CGSHandler::REGISTER_MAX));
-
-	{
-		auto privRegsStateFile = std::make_unique<CRegisterStateFile>(STATE_INITIAL_GSPRIVREGS);
-		privRegsStateFile->SetRegister64(STATE_PRIVREG_SMODE2, m_initialSMODE2);
-		archive.InsertFile(std::move(privRegsStateFile));
-	}
-
-	unsigned int currentPacket = 0;
+	CFrameDumpWriter writer(output, m_initialGsRam, m_initialGsRegisters, m_initialSMODE2);
 	for(const auto& packet : m_packets)
 	{
-		auto packetMetadataFileName = STATE_PACKET_METADATA_PREFIX + std::to_string(currentPacket);
-		archive.InsertFile(std::make_unique<CMemoryStateFile>(packetMetadataFileName.c_str(), &packet.metadata, sizeof(CGsPacketMetadata)));
-		if(!packet.registerWrites.empty())
-		{
-			auto packetRegisterWritesFileName = STATE_PACKET_REGISTERWRITES_PREFIX + std::to_string(currentPacket);
-			archive.InsertFile(std::make_unique<CMemoryStateFile>(packetRegisterWritesFileName.c_str(), packet.registerWrites.data(), packet.registerWrites.size() * sizeof(CGSHandler::RegisterWrite)));
-		}
-		if(!packet.imageData.empty())
-		{
-			auto packetImageDataName = STATE_PACKET_IMAGEDATA_PREFIX + std::to_string(currentPacket);
-			archive.InsertFile(std::make_unique<CMemoryStateFile>(packetImageDataName.c_str(), packet.imageData.data(), packet.imageData.size()));
-		}
-		currentPacket++;
+		writer.WritePacket(packet);
 	}
-
-	archive.Write(output);
+	writer.Finish();
 }
 
 void CFrameDump::IdentifyDrawingKicks()
@@ -0,0 +1,167 @@
+#include <stdexcept>
+#include <algorithm>
+#include "FrameDumpRing.h"
+#include "PtrStream.h"
+
+//Number of segments the ring is split into, a segment is dropped as a whole
+#define SEGMENTS_PER_RING 4
+
+CFrameDumpRing::CFrameDumpRing(uint32 maxFrameCount, uint64 maxMemorySize)
+    : m_maxFrameCount(maxFrameCount)
+    , m_maxMemorySize(maxMemorySize)
+{
+	assert(maxFrameCount != 0);
+	m_segmentFrameCount = std::max<uint32>(1, maxFrameCount / SEGMENTS_PER_RING);
+	m_segmentMemorySize = std::max<uint64>(1, maxMemorySize / SEGMENTS_PER_RING);
+}
+
+bool CFrameDumpRing::NextFrame(bool endSegment)
+{
+	if(m_segments.empty()) return true;
+
+	auto& segment = *m_segments.back();
+	if(!segment.writer) return true;
+
+	segment.frameCount++;
+	if(endSegment || (segment.frameCount >= m_segmentFrameCount) || (segment.stream.GetSize() >= m_segmentMemorySize))
+	{
+		CloseCurrentSegment();
+		return true;
+	}
+
+	segment.writer->MarkFrame();
+	TrimSegments();
+	return false;
+}
+
+void CFrameDumpRing::BeginSegment(const uint8* gsRam, const uint64* gsRegisters, uint64 smode2)
+{
+	assert(m_segments.empty() || !m_segments.back()->writer);
+	auto segment = std::make_unique<SEGMENT>();
+	segment->writer = std::make_unique<CFrameDumpWriter>(segment->stream, gsRam, gsRegisters, smode2);
+	m_segments.push_back(std::move(segment));
+	TrimSegments();
+}
+
+void CFrameDumpRing::AddRegisterPacket(const CGSHandler::RegisterWrite* registerWrites, uint32 count, const CGsPacketMetadata* metadata)
+{
+	//Packets are dropped until a segment is started at the next frame
+	if(m_segments.empty() || !m_segments.back()->writer) return;
+	m_segments.back()->writer->AddRegisterPacket(registerWrites, count, metadata);
+	TrimCurrentSegment();
+}
+
+void CFrameDumpRing::AddImagePacket(const uint8* imageData, uint32 size)
+{
+	if(m_segments.empty() || !m_segments.back()->writer) return;
+	m_segments.back()->writer->AddImagePacket(imageData, size);
+	TrimCurrentSegment();
+}
+
+uint32 CFrameDumpRing::GetMaxFrameCount() const
+{
+	return m_maxFrameCount;
+}
+
+uint32 CFrameDumpRing::GetFrameCount() const
+{
+	uint32 frameCount = 0;
+	for(const auto& segment : m_segments)
+	{
+		frameCount += segment->frameCount;
+	}
+	return frameCount;
+}
+
+uint64 CFrameDumpRing::GetMemorySize() const
+{
+	uint64 memorySize = 0;
+	for(const auto& segment : m_segments)
+	{
+		memorySize += segment->stream.GetSize();
+	}
+	return memorySize;
+}
+
+std::unique_ptr<CFrameDumpRing> CFrameDumpRing::CreateSnapshot()
+{
+	assert(m_segments.empty() || !m_segments.back()->writer);
+
+	auto snapshot = std::make_unique<CFrameDumpRing>(m_maxFrameCount, m_maxMemorySize);
+	snapshot->m_segments = m_segments;
+	return snapshot;
+}
+
+void CFrameDumpRing::Write(Framework::CStream& output)
+{
+	CloseCurrentSegment();
+
+	if(m_segments.empty())
+	{
+		throw std::runtime_error("No frames have been recorded.");
+	}
+
+	//Only the initial state of the oldest segment is needed, other segments simply continue it
+	std::unique_ptr<CFrameDumpWriter> writer;
+	for(auto& segment : m_segments)
+	{
+		//Segments can be shared with snapshots written on other threads, read them through their own stream
+		Framework::CPtrStream segmentStream(segment->stream.GetBuffer(), segment->stream.GetSize());
+		CFrameDumpReader reader(segmentStream);
+		if(writer)
+		{
+			writer->MarkFrame();
+		}
+		else
+		{
+			writer = std::make_unique<CFrameDumpWriter>(output, reader.GetInitialGsRam(), reader.GetInitialGsRegisters(), reader.GetInitialSMODE2());
+		}
+
+		uint32 nextFrameIndex = 1;
+		for(uint32 packetIndex = 0; packetIndex < reader.GetPacketCount(); packetIndex++)
+		{
+			if((nextFrameIndex < reader.GetFrameCount()) && (reader.GetFrameFirstPacket(nextFrameIndex) == packetIndex))
+			{
+				writer->MarkFrame();
+				nextFrameIndex++;
+			}
+			writer->WritePacket(reader.ReadPacket(packetIndex));
+		}
+	}
+	writer->Finish();
+}
+
+void CFrameDumpRing::CloseCurrentSegment()
+{
+	if(m_segments.empty()) return;
+
+	auto& segment = *m_segments.back();
+	if(!segment.writer) return;
+
+	segment.writer->Finish();
+	segment.writer.reset();
+}
+
+void CFrameDumpRing::TrimSegments()
+{
+	//Drop the oldest segment if the others are enough to cover the requested frame count
+	while(m_segments.size() > 1)
+	{
+		uint32 remainingFrameCount = GetFrameCount() - m_segments.front()->frameCount;
+		bool overBudget = GetMemorySize() > m_maxMemorySize;
+		if((remainingFrameCount < m_maxFrameCount) && !overBudget) break;
+		m_segments.pop_front();
+	}
+}
+
+void CFrameDumpRing::TrimCurrentSegment()
+{
+	if(GetMemorySize() <= m_maxMemorySize) return;
+	TrimSegments();
+	if((m_segments.size() != 1) || (GetMemorySize() <= m_maxMemorySize)) return;
+
+	//The current segment alone exceeds the budget, drop it. Packets are dropped
+	//until a new segment is started at the next frame.
+	assert(m_segments.back()->writer);
+	m_segments.pop_back();
+}
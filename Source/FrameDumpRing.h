@@ -0,0 +1,59 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include "MemStream.h"
+#include "FrameDumpStream.h"
+
+//Keeps the GS traffic of the last frames in memory, encoded in the streaming frame dump format.
+//Frames are grouped in segments that start with a snapshot of GS RAM and registers. The oldest
+//segments are dropped when enough frames are available or when the memory budget is exceeded.
+//A segment is closed early when it grows past its share of the budget, if a single segment
+//exceeds the whole budget, it is dropped and capture resumes with a new segment.
+class CFrameDumpRing
+{
+public:
+	CFrameDumpRing(uint32, uint64);
+	virtual ~CFrameDumpRing() = default;
+
+	//Returns true if a new segment needs to be started with BeginSegment. When endSegment
+	//is set, the current segment ends with this frame, which allows a snapshot to be taken.
+	bool NextFrame(bool endSegment = false);
+	void BeginSegment(const uint8*, const uint64*, uint64);
+
+	void AddRegisterPacket(const CGSHandler::RegisterWrite*, uint32, const CGsPacketMetadata*);
+	void AddImagePacket(const uint8*, uint32);
+
+	uint32 GetMaxFrameCount() const;
+	uint32 GetFrameCount() const;
+	uint64 GetMemorySize() const;
+
+	//Returns a ring holding the captured frames that can be written on another thread
+	//while capture goes on. Closed segments are shared, not copied. This needs to be called
+	//between a NextFrame that ended the current segment and BeginSegment, a segment closed
+	//in the middle of a frame would leave a gap in the recording.
+	std::unique_ptr<CFrameDumpRing> CreateSnapshot();
+
+	//Writes captured frames as a single frame dump. This closes the current
+	//segment, BeginSegment needs to be called before capturing again.
+	void Write(Framework::CStream&);
+
+private:
+	struct SEGMENT
+	{
+		Framework::CMemStream stream;
+		std::unique_ptr<CFrameDumpWriter> writer;
+		uint32 frameCount = 0;
+	};
+	typedef std::shared_ptr<SEGMENT> SegmentPtr;
+
+	void CloseCurrentSegment();
+	void TrimSegments();
+	void TrimCurrentSegment();
+
+	uint32 m_maxFrameCount = 0;
+	uint64 m_maxMemorySize = 0;
+	uint32 m_segmentFrameCount = 0;
+	uint64 m_segmentMemorySize = 0;
+	std::deque<SegmentPtr> m_segments;
+};
@@ -0,0 +1,450 @@
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+#include "FrameDumpStream.h"
+#include "zstd_zlibwrapper.h"
+
+#define FRAMEDUMP_MAGIC 0x53444650        //'PFDS'
+#define FRAMEDUMP_FOOTER_MAGIC 0x58444650 //'PFDX'
+#define FRAMEDUMP_VERSION 1
+
+//indexOffset (64 bits), chunkCount, frameCount, packetCount, magic
+#define FRAMEDUMP_FOOTER_SIZE 24
+
+//Runs of changed metadata words are merged if they are separated by less than this
+#define METADATA_RUN_MERGE_GAP 4
+
+static void AppendData(std::vector<uint8>& buffer, const void* data, size_t size)
+{
+	auto bytes = reinterpret_cast<const uint8*>(data);
+	buffer.insert(buffer.end(), bytes, bytes + size);
+}
+
+static void Append32(std::vector<uint8>& buffer, uint32 value)
+{
+	AppendData(buffer, &value, sizeof(uint32));
+}
+
+static void CompressBlock(const uint8* input, uint32 inputSize, std::vector<uint8>& output)
+{
+	uLongf compressedSize = compressBound(inputSize);
+	output.resize(compressedSize);
+	if(compress2(output.data(), &compressedSize, input, inputSize, Z_BEST_SPEED) != Z_OK)
+	{
+		throw std::runtime_error("Failed to compress frame dump block.");
+	}
+	output.resize(compressedSize);
+}
+
+static void WriteBlock(Framework::CStream& stream, const uint8* data, uint32 size, std::vector<uint8>& compressBuffer)
+{
+	CompressBlock(data, size, compressBuffer);
+	stream.Write32(size);
+	stream.Write32(static_cast<uint32>(compressBuffer.size()));
+	stream.Write(compressBuffer.data(), compressBuffer.size());
+}
+
+static std::vector<uint8> ReadBlock(Framework::CStream& stream, uint32 uncompressedSize, uint32 compressedSize)
+{
+	std::vector<uint8> compressedData(compressedSize);
+	if(stream.Read(compressedData.data(), compressedSize) != compressedSize)
+	{
+		throw std::runtime_error("Frame dump stream is truncated.");
+	}
+	std::vector<uint8> data(uncompressedSize);
+	uLongf destLength = uncompressedSize;
+	if((uncompress(data.data(), &destLength, compressedData.data(), compressedSize) != Z_OK) || (destLength != uncompressedSize))
+	{
+		throw std::runtime_error("Failed to decompress frame dump block.");
+	}
+	return data;
+}
+
+//Reads data from a decompressed chunk, checking bounds
+class CChunkCursor
+{
+public:
+	CChunkCursor(const std::vector<uint8>& data)
+	    : m_data(data)
+	{
+	}
+
+	const uint8* Read(size_t size)
+	{
+		if((m_data.size() - m_position) < size)
+		{
+			throw std::runtime_error("Frame dump chunk is corrupted.");
+		}
+		auto result = m_data.data() + m_position;
+		m_position += size;
+		return result;
+	}
+
+	uint32 Read32()
+	{
+		uint32 value = 0;
+		memcpy(&value, Read(sizeof(uint32)), sizeof(uint32));
+		return value;
+	}
+
+private:
+	const std::vector<uint8>& m_data;
+	size_t m_position = 0;
+};
+
+///////////////////////////////////////////////////////////
+// Writer
+///////////////////////////////////////////////////////////
+
+CFrameDumpWriter::CFrameDumpWriter(Framework::CStream& stream, const uint8* gsRam, const uint64* gsRegisters, uint64 smode2)
+    : m_stream(stream)
+    , m_prevMetadata(sizeof(CGsPacketMetadata), 0)
+{
+	static_assert((sizeof(CGsPacketMetadata) % sizeof(uint32)) == 0, "Packet metadata size must be a multiple of 4.");
+
+	m_stream.Write32(FRAMEDUMP_MAGIC);
+	m_stream.Write32(FRAMEDUMP_VERSION);
+	m_stream.Write32(sizeof(CGsPacketMetadata));
+	m_stream.Write32(CGSHandler::REGISTER_MAX);
+	m_stream.Write64(smode2);
+	m_stream.Write(gsRegisters, sizeof(uint64) * CGSHandler::REGISTER_MAX);
+	WriteBlock(m_stream, gsRam, CGSHandler::RAMSIZE, m_compressBuffer);
+
+	m_frameStarts.push_back(0);
+}
+
+void CFrameDumpWriter::AddRegisterPacket(const CGSHandler::RegisterWrite* registerWrites, uint32 count, const CGsPacketMetadata* metadata)
+{
+	if(metadata)
+	{
+		AppendPacket(*metadata, registerWrites, count, nullptr, 0);
+	}
+	else
+	{
+		AppendPacket(CGsPacketMetadata(), registerWrites, count, nullptr, 0);
+	}
+}
+
+void CFrameDumpWriter::AddImagePacket(const uint8* imageData, uint32 size)
+{
+	AppendPacket(CGsPacketMetadata(), nullptr, 0, imageData, size);
+}
+
+void CFrameDumpWriter::WritePacket(const CGsPacket& packet)
+{
+	AppendPacket(packet.metadata, packet.registerWrites.data(), static_cast<uint32>(packet.registerWrites.size()),
+	             packet.imageData.data(), static_cast<uint32>(packet.imageData.size()));
+}
+
+void CFrameDumpWriter::MarkFrame()
+{
+	assert(!m_finished);
+	//Don't create empty frames
+	if(m_frameStarts.back() == m_packetCount) return;
+	m_frameStarts.push_back(m_packetCount);
+}
+
+uint32 CFrameDumpWriter::GetPacketCount() const
+{
+	return m_packetCount;
+}
+
+void CFrameDumpWriter::Finish()
+{
+	assert(!m_finished);
+	FlushChunk();
+
+	if((m_frameStarts.size() > 1) && (m_frameStarts.back() == m_packetCount))
+	{
+		m_frameStarts.pop_back();
+	}
+
+	uint64 indexOffset = m_stream.Tell();
+	for(const auto& chunk : m_chunks)
+	{
+		m_stream.Write64(chunk.offset);
+		m_stream.Write32(chunk.firstPacket);
+		m_stream.Write32(chunk.packetCount);
+	}
+	for(const auto& frameStart : m_frameStarts)
+	{
+		m_stream.Write32(frameStart);
+	}
+
+	m_stream.Write64(indexOffset);
+	m_stream.Write32(static_cast<uint32>(m_chunks.size()));
+	m_stream.Write32(static_cast<uint32>(m_frameStarts.size()));
+	m_stream.Write32(m_packetCount);
+	m_stream.Write32(FRAMEDUMP_FOOTER_MAGIC);
+	m_stream.Flush();
+
+	m_finished = true;
+}
+
+void CFrameDumpWriter::AppendPacket(const CGsPacketMetadata& metadata, const CGSHandler::RegisterWrite* registerWrites, uint32 registerWriteCount,
+                                    const uint8* imageData, uint32 imageDataSize)
+{
+	assert(!m_finished);
+
+	Append32(m_chunkBuffer, registerWriteCount);
+	Append32(m_chunkBuffer, imageDataSize);
+
+	//Metadata is encoded as runs of words that differ from the previous packet's metadata
+	{
+		auto prevBytes = m_prevMetadata.data();
+		auto currBytes = reinterpret_cast<const uint8*>(&metadata);
+		auto wordDiffers = [&](uint32 wordIndex) { return memcmp(prevBytes + (wordIndex * 4), currBytes + (wordIndex * 4), 4) != 0; };
+
+		size_t runCountPosition = m_chunkBuffer.size();
+		Append32(m_chunkBuffer, 0);
+
+		uint32 runCount = 0;
+		uint32 wordCount = sizeof(CGsPacketMetadata) / 4;
+		uint32 wordIndex = 0;
+		while(wordIndex < wordCount)
+		{
+			if(!wordDiffers(wordIndex))
+			{
+				wordIndex++;
+				continue;
+			}
+			uint32 runStart = wordIndex;
+			uint32 runEnd = wordIndex + 1;
+			for(uint32 nextIndex = runEnd; nextIndex < wordCount; nextIndex++)
+			{
+				if(wordDiffers(nextIndex))
+				{
+					runEnd = nextIndex + 1;
+				}
+				else if((nextIndex - runEnd) >= METADATA_RUN_MERGE_GAP)
+				{
+					break;
+				}
+			}
+			Append32(m_chunkBuffer, runStart * 4);
+			Append32(m_chunkBuffer, (runEnd - runStart) * 4);
+			AppendData(m_chunkBuffer, currBytes + (runStart * 4), (runEnd - runStart) * 4);
+			runCount++;
+			wordIndex = runEnd;
+		}
+
+		memcpy(m_chunkBuffer.data() + runCountPosition, &runCount, sizeof(uint32));
+		memcpy(m_prevMetadata.data(), currBytes, sizeof(CGsPacketMetadata));
+	}
+
+	//Register writes are stored packed to avoid writing padding
+	for(uint32 i = 0; i < registerWriteCount; i++)
+	{
+		const auto& registerWrite = registerWrites[i];
+		m_chunkBuffer.push_back(registerWrite.first);
+		AppendData(m_chunkBuffer, &registerWrite.second, sizeof(uint64));
+	}
+
+	AppendData(m_chunkBuffer, imageData, imageDataSize);
+
+	m_packetCount++;
+	m_chunkPacketCount++;
+
+	if((m_chunkBuffer.size() >= CHUNK_SIZE_THRESHOLD) || (m_chunkPacketCount >= CHUNK_PACKET_THRESHOLD))
+	{
+		FlushChunk();
+	}
+}
+
+void CFrameDumpWriter::FlushChunk()
+{
+	if(m_chunkPacketCount == 0) return;
+
+	FRAMEDUMP_CHUNK_INFO chunk;
+	chunk.offset = m_stream.Tell();
+	chunk.firstPacket = m_packetCount - m_chunkPacketCount;
+	chunk.packetCount = m_chunkPacketCount;
+	m_chunks.push_back(chunk);
+
+	m_stream.Write32(m_chunkPacketCount);
+	WriteBlock(m_stream, m_chunkBuffer.data(), static_cast<uint32>(m_chunkBuffer.size()), m_compressBuffer);
+
+	//Chunks are decoded independently, reset the metadata delta reference
+	m_chunkBuffer.clear();
+	m_chunkPacketCount = 0;
+	std::fill(m_prevMetadata.begin(), m_prevMetadata.end(), 0);
+}
+
+///////////////////////////////////////////////////////////
+// Reader
+///////////////////////////////////////////////////////////
+
+CFrameDumpReader::CFrameDumpReader(Framework::CStream& stream)
+    : m_stream(stream)
+{
+	m_stream.Seek(0, Framework::STREAM_SEEK_SET);
+	if(m_stream.Read32() != FRAMEDUMP_MAGIC)
+	{
+		throw std::runtime_error("Not a frame dump stream.");
+	}
+	if(m_stream.Read32() != FRAMEDUMP_VERSION)
+	{
+		throw std::runtime_error("Unsupported frame dump stream version.");
+	}
+	m_metadataSize = m_stream.Read32();
+	if((m_metadataSize % 4) != 0)
+	{
+		throw std::runtime_error("Invalid frame dump packet metadata size.");
+	}
+	if(m_stream.Read32() != CGSHandler::REGISTER_MAX)
+	{
+		throw std::runtime_error("Frame dump register count mismatch.");
+	}
+	m_initialSMODE2 = m_stream.Read64();
+	m_stream.Read(m_initialGsRegisters, sizeof(uint64) * CGSHandler::REGISTER_MAX);
+	{
+		uint32 ramSize = m_stream.Read32();
+		uint32 compressedSize = m_stream.Read32();
+		if(ramSize != CGSHandler::RAMSIZE)
+		{
+			throw std::runtime_error("Frame dump GS RAM size mismatch.");
+		}
+		m_initialGsRam = ReadBlock(m_stream, ramSize, compressedSize);
+	}
+
+	m_stream.Seek(-FRAMEDUMP_FOOTER_SIZE, Framework::STREAM_SEEK_END);
+	uint64 indexOffset = m_stream.Read64();
+	uint32 chunkCount = m_stream.Read32();
+	uint32 frameCount = m_stream.Read32();
+	m_packetCount = m_stream.Read32();
+	if(m_stream.Read32() != FRAMEDUMP_FOOTER_MAGIC)
+	{
+		throw std::runtime_error("Frame dump stream is incomplete.");
+	}
+
+	m_stream.Seek(indexOffset, Framework::STREAM_SEEK_SET);
+	m_chunks.resize(chunkCount);
+	for(auto& chunk : m_chunks)
+	{
+		chunk.offset = m_stream.Read64();
+		chunk.firstPacket = m_stream.Read32();
+		chunk.packetCount = m_stream.Read32();
+	}
+	m_frameStarts.resize(frameCount);
+	for(auto& frameStart : m_frameStarts)
+	{
+		frameStart = m_stream.Read32();
+	}
+}
+
+bool CFrameDumpReader::IsFrameDumpStream(Framework::CStream& stream)
+{
+	auto position = stream.Tell();
+	uint32 magic = stream.Read32();
+	stream.Seek(position, Framework::STREAM_SEEK_SET);
+	return (magic == FRAMEDUMP_MAGIC);
+}
+
+const uint8* CFrameDumpReader::GetInitialGsRam() const
+{
+	return m_initialGsRam.data();
+}
+
+const uint64* CFrameDumpReader::GetInitialGsRegisters() const
+{
+	return m_initialGsRegisters;
+}
+
+uint64 CFrameDumpReader::GetInitialSMODE2() const
+{
+	return m_initialSMODE2;
+}
+
+uint32 CFrameDumpReader::GetPacketCount() const
+{
+	return m_packetCount;
+}
+
+uint32 CFrameDumpReader::GetFrameCount() const
+{
+	return static_cast<uint32>(m_frameStarts.size());
+}
+
+uint32 CFrameDumpReader::GetFrameFirstPacket(uint32 frameIndex) const
+{
+	assert(frameIndex < m_frameStarts.size());
+	return m_frameStarts[frameIndex];
+}
+
+const CGsPacket& CFrameDumpReader::ReadPacket(uint32 packetIndex)
+{
+	if(packetIndex >= m_packetCount)
+	{
+		throw std::runtime_error("Frame dump packet index out of range.");
+	}
+
+	auto chunkIterator = std::upper_bound(m_chunks.begin(), m_chunks.end(), packetIndex,
+	                                      [](uint32 packetIndex, const FRAMEDUMP_CHUNK_INFO& chunk) { return packetIndex < chunk.firstPacket; });
+	assert(chunkIterator != m_chunks.begin());
+	uint32 chunkIndex = static_cast<uint32>(std::distance(m_chunks.begin(), chunkIterator) - 1);
+	if(chunkIndex != m_chunkIndex)
+	{
+		LoadChunk(chunkIndex);
+	}
+
+	const auto& chunk = m_chunks[chunkIndex];
+	assert(packetIndex >= chunk.firstPacket);
+	return m_chunkPackets[packetIndex - chunk.firstPacket];
+}
+
+void CFrameDumpReader::LoadChunk(uint32 chunkIndex)
+{
+	const auto& chunk = m_chunks[chunkIndex];
+
+	m_chunkIndex = ~0U;
+	m_chunkPackets.clear();
+
+	m_stream.Seek(chunk.offset, Framework::STREAM_SEEK_SET);
+	uint32 packetCount = m_stream.Read32();
+	uint32 uncompressedSize = m_stream.Read32();
+	uint32 compressedSize = m_stream.Read32();
+	if(packetCount != chunk.packetCount)
+	{
+		throw std::runtime_error("Frame dump chunk doesn't match index.");
+	}
+
+	auto chunkData = ReadBlock(m_stream, uncompressedSize, compressedSize);
+	CChunkCursor cursor(chunkData);
+
+	//Metadata from dumps made by a build with a different metadata layout is truncated or zero extended
+	std::vector<uint8> metadata(m_metadataSize, 0);
+	size_t metadataCopySize = std::min<size_t>(m_metadataSize, sizeof(CGsPacketMetadata));
+
+	m_chunkPackets.resize(packetCount);
+	for(auto& packet : m_chunkPackets)
+	{
+		uint32 registerWriteCount = cursor.Read32();
+		uint32 imageDataSize = cursor.Read32();
+
+		uint32 runCount = cursor.Read32();
+		for(uint32 i = 0; i < runCount; i++)
+		{
+			uint32 runOffset = cursor.Read32();
+			uint32 runSize = cursor.Read32();
+			if((runOffset > m_metadataSize) || (runSize > (m_metadataSize - runOffset)))
+			{
+				throw std::runtime_error("Frame dump packet metadata is corrupted.");
+			}
+			memcpy(metadata.data() + runOffset, cursor.Read(runSize), runSize);
+		}
+		memcpy(&packet.metadata, metadata.data(), metadataCopySize);
+
+		packet.registerWrites.resize(registerWriteCount);
+		for(auto& registerWrite : packet.registerWrites)
+		{
+			auto registerWriteData = cursor.Read(1 + sizeof(uint64));
+			registerWrite.first = registerWriteData[0];
+			memcpy(&registerWrite.second, registerWriteData + 1, sizeof(uint64));
+		}
+
+		auto imageData = cursor.Read(imageDataSize);
+		packet.imageData.assign(imageData, imageData + imageDataSize);
+	}
+
+	m_chunkIndex = chunkIndex;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <vector>
+#include "FrameDump.h"
+
+//Chunked frame dump format
+//-------------------------
+//Packets are appended to the stream as they are produced and grouped in chunks that are
+//compressed individually. Packet metadata is stored as a delta against the previous packet
+//of the same chunk, which keeps VU memory snapshots small. An index written at the end of the
+//stream allows random access to any packet without decoding the whole stream.
+
+struct FRAMEDUMP_CHUNK_INFO
+{
+	uint64 offset = 0;
+	uint32 firstPacket = 0;
+	uint32 packetCount = 0;
+};
+
+class CFrameDumpWriter
+{
+public:
+	CFrameDumpWriter(Framework::CStream&, const uint8*, const uint64*, uint64);
+	virtual ~CFrameDumpWriter() = default;
+
+	void AddRegisterPacket(const CGSHandler::RegisterWrite*, uint32, const CGsPacketMetadata*);
+	void AddImagePacket(const uint8*, uint32);
+	void WritePacket(const CGsPacket&);
+
+	//Following packets belong to a new frame
+	void MarkFrame();
+
+	uint32 GetPacketCount() const;
+
+	//Writes pending packets and the index, no packets can be added afterwards
+	void Finish();
+
+private:
+	enum
+	{
+		CHUNK_SIZE_THRESHOLD = 0x100000,
+		CHUNK_PACKET_THRESHOLD = 256,
+	};
+
+	void AppendPacket(const CGsPacketMetadata&, const CGSHandler::RegisterWrite*, uint32, const uint8*, uint32);
+	void FlushChunk();
+
+	Framework::CStream& m_stream;
+	std::vector<uint8> m_chunkBuffer;
+	std::vector<uint8> m_compressBuffer;
+	std::vector<uint8> m_prevMetadata;
+	std::vector<FRAMEDUMP_CHUNK_INFO> m_chunks;
+	std::vector<uint32> m_frameStarts;
+	uint32 m_packetCount = 0;
+	uint32 m_chunkPacketCount = 0;
+	bool m_finished = false;
+};
+
+class CFrameDumpReader
+{
+public:
+	CFrameDumpReader(Framework::CStream&);
+	virtual ~CFrameDumpReader() = default;
+
+	static bool IsFrameDumpStream(Framework::CStream&);
+
+	const uint8* GetInitialGsRam() const;
+	const uint64* GetInitialGsRegisters() const;
+	uint64 GetInitialSMODE2() const;
+
+	uint32 GetPacketCount() const;
+	uint32 GetFrameCount() const;
+	uint32 GetFrameFirstPacket(uint32) const;
+
+	//Returned packet is valid until the next call
+	const CGsPacket& ReadPacket(uint32);
+
+private:
+	void LoadChunk(uint32);
+
+	Framework::CStream& m_stream;
+	std::vector<uint8> m_initialGsRam;
+	uint64 m_initialGsRegisters[CGSHandler::REGISTER_MAX];
+	uint64 m_initialSMODE2 = 0;
+	uint32 m_metadataSize = 0;
+	std::vector<FRAMEDUMP_CHUNK_INFO> m_chunks;
+	std::vector<uint32> m_frameStarts;
+	uint32 m_packetCount = 0;
+
+	//Cached decoded chunk
+	uint32 m_chunkIndex = ~0U;
+	std::vector<CGsPacket> m_chunkPackets;
+};
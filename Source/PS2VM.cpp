@@ -97,6 +97,9 @@ CPS2VM::CPS2VM()
 	CAppConfig::GetInstance().RegisterPreferenceInteger(PREF_AUDIO_SPUBLOCKCOUNT, 100);
 	ReloadSpuBlockCountImpl();
 
+	CAppConfig::GetInstance().RegisterPreferenceBoolean(PREF_PS2_IPU_REFERENCE_IDCT, false);
+	CAppConfig::GetInstance().RegisterPreferenceBoolean(PREF_PS2_IPU_ASYNC_DECODE, true);
+
 	CAppConfig::GetInstance().RegisterPreferenceBoolean(PREF_PS2_ARCADE_IO_SERVER_ENABLED, false);
 	CAppConfig::GetInstance().RegisterPreferenceInteger(PREF_PS2_ARCADE_IO_SERVER_PORT, 9876);
 }
@@ -213,6 +216,11 @@ void CPS2VM::ReloadSpuBlockCount()
 	m_mailBox.SendCall([this]() { ReloadSpuBlockCountImpl(); });
 }
 
+void CPS2VM::ReloadIpuSettings()
+{
+	m_mailBox.SendCall([this]() { ReloadIpuSettingsImpl(); });
+}
+
 void CPS2VM::DestroySoundHandler()
 {
 	if(m_soundHandler == nullptr) return;
@@ -476,6 +484,7 @@ void CPS2VM::CreateVM()
 	m_OnRequestLoadExecutableConnection = m_ee->m_os->OnRequestLoadExecutable.Connect(std::bind(&CPS2VM::ReloadExecutable, this, std::placeholders::_1, std::placeholders::_2));
 	m_OnCrtModeChangeConnection = m_ee->m_os->OnCrtModeChange.Connect(std::bind(&CPS2VM::OnCrtModeChange, this));
 
+	ReloadIpuSettingsImpl();
 	ResetVM();
 }
 
@@ -704,6 +713,14 @@ void CPS2VM::ReloadSpuBlockCountImpl()
 	m_spuBlockCount = spuBlockCount;
 }
 
+void CPS2VM::ReloadIpuSettingsImpl()
+{
+	ValidateThreadContext();
+	bool useReferenceIdct = CAppConfig::GetInstance().GetPreferenceBoolean(PREF_PS2_IPU_REFERENCE_IDCT);
+	m_ee->m_ipu.SetIdctMode(useReferenceIdct ? CIPU::IDCT_MODE_REFERENCE : CIPU::IDCT_MODE_FAST);
+	m_ee->m_ipu.SetAsyncDecodeEnabled(CAppConfig::GetInstance().GetPreferenceBoolean(PREF_PS2_IPU_ASYNC_DECODE));
+}
+
 void CPS2VM::DestroySoundHandlerImpl()
 {
 	if(m_soundHandler == nullptr) return;
@@ -70,6 +70,7 @@ public:
 
 	void SetEeFrequencyScale(uint32, uint32);
 	void ReloadFrameRateLimit();
+	void ReloadIpuSettings();
 
 	static fs::path GetStateDirectoryPath();
 	fs::path GenerateStatePath(unsigned int) const;
@@ -138,6 +139,7 @@ private:
 	void DestroySoundHandlerImpl();
 
 	void ReloadSpuBlockCountImpl();
+	void ReloadIpuSettingsImpl();
 
 	void UpdateEe();
 	void UpdateIop();
@@ -14,6 +14,9 @@
 
 #define PREF_PS2_LIMIT_FRAMERATE ("ps2.limitframerate")
 
+#define PREF_PS2_IPU_REFERENCE_IDCT ("ps2.ipu.referenceidct")
+#define PREF_PS2_IPU_ASYNC_DECODE ("ps2.ipu.asyncdecode")
+
 #define PREF_AUDIO_SPUBLOCKCOUNT ("audio.spublockcount")
 
 #define PREF_SYSTEM_LANGUAGE ("system.language")
@@ -244,6 +244,11 @@ bool CDMAC::IsDMA4Started() const
 	return (m_D4.m_CHCR.nSTR != 0) && ((m_D_ENABLE & CDMAC::ENABLE_CPND) == 0);
 }
 
+uint32 CDMAC::GetActiveChannels() const
+{
+	return m_activeChannels;
+}
+
 uint64 CDMAC::FetchDMATag(uint32 address)
 {
 	if(address & 0x80000000)
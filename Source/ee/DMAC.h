@@ -131,6 +131,8 @@ public:
 	void ResumeDMA4();
 	void ResumeDMA8();
 	bool IsDMA4Started() const;
+	//Returns a mask of channels (1 << CHANNEL_ID) that have a transfer in progress
+	uint32 GetActiveChannels() const;
 	static bool IsEndSrcTagId(uint32);
 	static bool IsEndDstTagId(uint32);
 
@@ -226,6 +228,8 @@ private:
 	Dmac::CChannel m_D9;
 	uint32 m_D9_SADR;
 
+	uint32 m_activeChannels = 0;
+
 	Dmac::DmaReceiveHandler m_receiveDma5;
 	Dmac::DmaReceiveHandler m_receiveDma6;
 };
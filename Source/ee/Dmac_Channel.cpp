@@ -38,6 +38,7 @@ void CChannel::Reset()
 	m_nSCCTRL = 0;
 	m_nASR[0] = 0;
 	m_nASR[1] = 0;
+	UpdateActiveState();
 }
 
 void CChannel::SaveState(Framework::CZipArchiveWriter& archive)
@@ -65,6 +66,7 @@ void CChannel::LoadState(Framework::CZipArchiveReader& archive)
 	m_nSCCTRL = registerFile.GetRegister32(STATE_REGS_SCCTRL);
 	m_nASR[0] = registerFile.GetRegister32(STATE_REGS_ASR0);
 	m_nASR[1] = registerFile.GetRegister32(STATE_REGS_ASR1);
+	UpdateActiveState();
 }
 
 uint32 CChannel::ReadCHCR()
@@ -90,6 +92,7 @@ void CChannel::WriteCHCR(uint32 nValue)
 	{
 		m_CHCR = *(CHCR*)&nValue;
 	}
+	UpdateActiveState();
 
 	if(m_CHCR.nSTR != 0)
 	{
@@ -376,6 +379,14 @@ void CChannel::ExecuteSourceChain()
 			continue;
 		}
 
+		if(!isMfifo && !isStallDrainChannel && (m_CHCR.nTTE == 0))
+		{
+			if(ExecuteSourceChainBatch())
+			{
+				continue;
+			}
+		}
+
 		uint64 nTag = m_dmac.FetchDMATag(m_nTADR);
 
 		//Save higher 16 bits of tag into CHCR
@@ -561,12 +572,125 @@ void CChannel::ExecuteSourceChainTransfer(bool isMfifo)
 	}
 }
 
+bool CChannel::ExecuteSourceChainBatch()
+{
+	//Resolves a run of tags that only point to data (REFE, CNT, NEXT, REF) and hands spans
+	//of contiguous data to the receiver in a single call. Returns false if the current tag
+	//needs to be handled by the regular path.
+
+	struct SPAN
+	{
+		uint64 tag;
+		uint32 madr;
+		uint32 qwc;
+		uint32 nextTadr;
+	};
+
+	SPAN spans[MAX_BATCH_TAGS];
+	uint32 spanCount = 0;
+	uint32 tadr = m_nTADR;
+	while((spanCount < MAX_BATCH_TAGS) && (tadr != 0))
+	{
+		uint64 tag = m_dmac.FetchDMATag(tadr);
+		uint32 id = static_cast<uint32>((tag >> 28) & 0x07);
+		uint32 addr = static_cast<uint32>((tag >> 32) & DMATAG_ADDR_MASK);
+
+		auto& span = spans[spanCount];
+		span.tag = tag;
+		span.qwc = static_cast<uint32>(tag & 0xFFFF);
+
+		bool resolved = true;
+		switch(id)
+		{
+		case DMATAG_SRC_REFE:
+		case DMATAG_SRC_REF:
+			span.madr = addr;
+			span.nextTadr = tadr + 0x10;
+			break;
+		case DMATAG_SRC_CNT:
+			span.madr = tadr + 0x10;
+			span.nextTadr = span.madr + (span.qwc * 0x10);
+			break;
+		case DMATAG_SRC_NEXT:
+			span.madr = tadr + 0x10;
+			span.nextTadr = addr;
+			break;
+		default:
+			resolved = false;
+			break;
+		}
+		if(!resolved) break;
+
+		spanCount++;
+		tadr = span.nextTadr;
+
+		//Transfer needs to stop after this tag
+		bool interrupt = (m_CHCR.nTIE != 0) && (((tag >> 16) & DMATAG_IRQ) != 0);
+		if((id == DMATAG_SRC_REFE) || interrupt) break;
+	}
+
+	if(spanCount == 0)
+	{
+		return false;
+	}
+
+	uint32 spanIndex = 0;
+	while(spanIndex < spanCount)
+	{
+		uint32 groupMadr = spans[spanIndex].madr;
+		uint32 groupQwc = 0;
+		uint32 groupEnd = spanIndex;
+		while((groupEnd < spanCount) && (spans[groupEnd].madr == (groupMadr + (groupQwc * 0x10))))
+		{
+			groupQwc += spans[groupEnd].qwc;
+			groupEnd++;
+		}
+
+		uint32 recv = (groupQwc != 0) ? m_receive(groupMadr, groupQwc, CHCR_DIR_FROM, false) : 0;
+		assert(recv <= groupQwc);
+
+		for(; spanIndex < groupEnd; spanIndex++)
+		{
+			const auto& span = spans[spanIndex];
+			uint32 spanRecv = std::min<uint32>(recv, span.qwc);
+			recv -= spanRecv;
+
+			m_CHCR.nTAG = static_cast<uint16>(span.tag >> 16);
+			m_nMADR = span.madr + (spanRecv * 0x10);
+			m_nQWC = span.qwc - spanRecv;
+			m_nTADR = span.nextTadr;
+
+			if(m_nQWC != 0)
+			{
+				//Receiver didn't take everything, transfer will be suspended
+				return true;
+			}
+		}
+	}
+
+	return true;
+}
+
 void CChannel::ClearSTR()
 {
 	m_CHCR.nSTR = ~m_CHCR.nSTR;
+	UpdateActiveState();
 
 	//Set interrupt
 	m_dmac.m_D_STAT |= (1 << m_number);
 
 	m_dmac.UpdateCpCond();
 }
+
+void CChannel::UpdateActiveState()
+{
+	uint32 channelBit = (1 << m_number);
+	if(m_CHCR.nSTR != 0)
+	{
+		m_dmac.m_activeChannels |= channelBit;
+	}
+	else
+	{
+		m_dmac.m_activeChannels &= ~channelBit;
+	}
+}
@@ -93,8 +93,15 @@ namespace Dmac
 			SCCTRL_INITXFER = 0x200,
 		};
 
+		enum
+		{
+			MAX_BATCH_TAGS = 64,
+		};
+
 		void ExecuteSourceChainTransfer(bool);
+		bool ExecuteSourceChainBatch();
 		void ClearSTR();
+		void UpdateActiveState();
 
 		CDMAC& m_dmac;
 		unsigned int m_number = 0;
@@ -306,16 +306,26 @@ bool CSubSystem::IsCpuIdle() const
 
 void CSubSystem::CountTicks(int ticks)
 {
-	if(m_vpu0->IsVuReady() || (m_vpu0->IsVuRunning() && !m_vpu0->GetVif().IsWaitingForProgramEnd()))
+	//Only resume channels that have a transfer in progress
+	uint32 activeChannels = m_dmac.GetActiveChannels();
+	if((activeChannels & (1 << CDMAC::CHANNEL_ID_VIF0)) &&
+	   (m_vpu0->IsVuReady() || (m_vpu0->IsVuRunning() && !m_vpu0->GetVif().IsWaitingForProgramEnd())))
 	{
 		m_dmac.ResumeDMA0();
 	}
-	if(m_vpu1->IsVuReady() || (m_vpu1->IsVuRunning() && !m_vpu1->GetVif().IsWaitingForProgramEnd()))
+	if((activeChannels & (1 << CDMAC::CHANNEL_ID_VIF1)) &&
+	   (m_vpu1->IsVuReady() || (m_vpu1->IsVuRunning() && !m_vpu1->GetVif().IsWaitingForProgramEnd())))
 	{
 		m_dmac.ResumeDMA1();
 	}
-	m_dmac.ResumeDMA2();
-	m_dmac.ResumeDMA8();
+	if(activeChannels & (1 << CDMAC::CHANNEL_ID_GIF))
+	{
+		m_dmac.ResumeDMA2();
+	}
+	if(activeChannels & (1 << CDMAC::CHANNEL_ID_FROM_SPR))
+	{
+		m_dmac.ResumeDMA8();
+	}
 	m_gif.CountTicks(ticks);
 	m_ipu.CountTicks(ticks);
 	m_vpu0->GetVif().CountTicks(ticks);
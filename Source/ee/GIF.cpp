@@ -9,6 +9,13 @@
 #include "../states/MemoryStateFile.h"
 #include "GIF.h"
 #include "DMAC.h"
+#include "SimdDefs.h"
+
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+#include <emmintrin.h>
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+#include <arm_neon.h>
+#endif
 
 #define QTEMP_INIT (0x3F800000)
 
@@ -102,15 +109,199 @@ void CGIF::SaveState(Framework::CZipArchiveWriter& archive)
 	archive.InsertFile(std::make_unique<CMemoryStateFile>(STATE_FIFO_BUFFER, m_fifoBuffer, FIFO_SIZE));
 }
 
+//Packs the low 8 bits of every 32-bit lane (RGBA)
+static inline uint32 PackPackedRgba(const uint128& packet)
+{
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+	__m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&packet));
+	value = _mm_and_si128(value, _mm_set1_epi32(0xFF));
+	value = _mm_packs_epi32(value, value);
+	value = _mm_packus_epi16(value, value);
+	return _mm_cvtsi128_si32(value);
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+	uint16x4_t value = vmovn_u32(vld1q_u32(packet.nV));
+	return vget_lane_u32(vreinterpret_u32_u8(vmovn_u16(vcombine_u16(value, value))), 0);
+#else
+	return (packet.nV[0] & 0xFF) | ((packet.nV[1] & 0xFF) << 8) | ((packet.nV[2] & 0xFF) << 16) | ((packet.nV[3] & 0xFF) << 24);
+#endif
+}
+
+//Packs the low 16 bits of the first two 32-bit lanes (XY, UV)
+static inline uint32 PackPackedXy(const uint128& packet)
+{
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+	__m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&packet));
+	value = _mm_shufflelo_epi16(value, _MM_SHUFFLE(3, 3, 2, 0));
+	return _mm_cvtsi128_si32(value);
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+	uint16x4_t value = vmovn_u32(vld1q_u32(packet.nV));
+	return vget_lane_u32(vreinterpret_u32_u16(value), 0);
+#else
+	return (packet.nV[0] & 0xFFFF) | ((packet.nV[1] & 0xFFFF) << 16);
+#endif
+}
+
+static inline uint64 DecodePackedRgbaq(const uint128& packet, uint32 qtemp)
+{
+	return static_cast<uint64>(PackPackedRgba(packet)) | (static_cast<uint64>(qtemp) << 32);
+}
+
+static inline uint64 DecodePackedUv(const uint128& packet)
+{
+	return PackPackedXy(packet) & 0x7FFF7FFF;
+}
+
+static inline CGSHandler::RegisterWrite DecodePackedXyzf(const uint128& packet)
+{
+	uint64 temp = PackPackedXy(packet);
+	temp |= static_cast<uint64>(packet.nV[2] & 0x0FFFFFF0) << 28;
+	temp |= static_cast<uint64>(packet.nV[3] & 0x00000FF0) << 52;
+	uint8 reg = (packet.nV[3] & 0x8000) ? GS_REG_XYZF3 : GS_REG_XYZF2;
+	return CGSHandler::RegisterWrite(reg, temp);
+}
+
+static inline CGSHandler::RegisterWrite DecodePackedXyz(const uint128& packet)
+{
+	uint64 temp = PackPackedXy(packet);
+	temp |= static_cast<uint64>(packet.nV[2]) << 32;
+	uint8 reg = (packet.nV[3] & 0x8000) ? GS_REG_XYZ3 : GS_REG_XYZ2;
+	return CGSHandler::RegisterWrite(reg, temp);
+}
+
+static inline uint64 DecodePackedFog(const uint128& packet)
+{
+	return (packet.nD1 >> 36) << 56;
+}
+
+const CGIF::PACKED_DECODER& CGIF::GetPackedDecoder()
+{
+	for(const auto& decoder : m_packedDecoders)
+	{
+		if(decoder.isValid && (decoder.regList == m_regList) && (decoder.regs == m_regs))
+		{
+			return decoder;
+		}
+	}
+
+	auto& decoder = m_packedDecoders[m_nextPackedDecoderIndex++];
+	m_nextPackedDecoderIndex %= PACKED_DECODER_CACHE_SIZE;
+
+	decoder.isValid = true;
+	decoder.regList = m_regList;
+	decoder.regs = m_regs;
+	decoder.writeCount = 0;
+	decoder.canProcessLoops = true;
+	for(uint32 i = 0; i < m_regs; i++)
+	{
+		uint32 regDesc = static_cast<uint32>((m_regList >> (i * 4)) & 0x0F);
+		switch(regDesc)
+		{
+		case 0x0B:
+		case 0x0C:
+		case 0x0E:
+			//A+D can have side effects (SIGNAL) that need to stop processing, let the generic path handle it
+			decoder.canProcessLoops = false;
+			break;
+		case 0x0F:
+			break;
+		default:
+			decoder.writeCount++;
+			break;
+		}
+	}
+
+	return decoder;
+}
+
+uint32 CGIF::ProcessPackedLoops(const uint8* memory, uint32 address, uint32 end, const PACKED_DECODER& decoder)
+{
+	//Process as many complete loops as possible with a single bounds check
+	assert(m_regsTemp == m_regs);
+
+	uint32 loopSize = m_regs * 0x10;
+	uint32 loopCount = std::min<uint32>(m_loops, (end - address) / loopSize);
+	if(loopCount == 0) return 0;
+
+	auto writes = m_gs->ReserveRegisterWrites(loopCount * decoder.writeCount);
+	if(!writes) return 0;
+
+	auto packet = reinterpret_cast<const uint128*>(memory + address);
+	for(uint32 loop = 0; loop < loopCount; loop++)
+	{
+		uint64 regList = m_regList;
+		for(uint32 i = 0; i < m_regs; i++, packet++, regList >>= 4)
+		{
+			switch(regList & 0x0F)
+			{
+			case 0x00:
+				*writes++ = CGSHandler::RegisterWrite(GS_REG_PRIM, packet->nV0);
+				break;
+			case 0x01:
+				*writes++ = CGSHandler::RegisterWrite(GS_REG_RGBAQ, DecodePackedRgbaq(*packet, m_qtemp));
+				break;
+			case 0x02:
+				m_qtemp = packet->nV2;
+				*writes++ = CGSHandler::RegisterWrite(GS_REG_ST, packet->nD0);
+				break;
+			case 0x03:
+				*writes++ = CGSHandler::RegisterWrite(GS_REG_UV, DecodePackedUv(*packet));
+				break;
+			case 0x04:
+				*writes++ = DecodePackedXyzf(*packet);
+				break;
+			case 0x05:
+				*writes++ = DecodePackedXyz(*packet);
+				break;
+			case 0x06:
+				*writes++ = CGSHandler::RegisterWrite(GS_REG_TEX0_1, packet->nD0);
+				break;
+			case 0x07:
+				*writes++ = CGSHandler::RegisterWrite(GS_REG_TEX0_2, packet->nD0);
+				break;
+			case 0x08:
+				*writes++ = CGSHandler::RegisterWrite(GS_REG_CLAMP_1, packet->nD0);
+				break;
+			case 0x09:
+				*writes++ = CGSHandler::RegisterWrite(GS_REG_CLAMP_2, packet->nD0);
+				break;
+			case 0x0A:
+				*writes++ = CGSHandler::RegisterWrite(GS_REG_FOG, DecodePackedFog(*packet));
+				break;
+			case 0x0D:
+				*writes++ = CGSHandler::RegisterWrite(GS_REG_XYZ3, packet->nD0);
+				break;
+			case 0x0F:
+				//NOP
+				break;
+			default:
+				assert(false);
+				break;
+			}
+		}
+	}
+
+	m_loops -= loopCount;
+
+	return loopCount * loopSize;
+}
+
 uint32 CGIF::ProcessPacked(const uint8* memory, uint32 address, uint32 end)
 {
 	uint32 start = address;
 
+	if((m_loops != 0) && (m_regsTemp == m_regs))
+	{
+		const auto& decoder = GetPackedDecoder();
+		if(decoder.canProcessLoops)
+		{
+			address += ProcessPackedLoops(memory, address, end, decoder);
+		}
+	}
+
 	while((m_loops != 0) && (address < end))
 	{
 		while((m_regsTemp != 0) && (address < end))
 		{
-			uint64 temp = 0;
 			uint32 regDesc = (uint32)((m_regList >> ((m_regs - m_regsTemp) * 4)) & 0x0F);
 
 			uint128 packet = *reinterpret_cast<const uint128*>(memory + address);
@@ -123,12 +314,7 @@ uint32 CGIF::ProcessPacked(const uint8* memory, uint32 address, uint32 end)
 				break;
 			case 0x01:
 				//RGBA
-				temp = (packet.nV[0] & 0xFF);
-				temp |= (packet.nV[1] & 0xFF) << 8;
-				temp |= (packet.nV[2] & 0xFF) << 16;
-				temp |= (packet.nV[3] & 0xFF) << 24;
-				temp |= ((uint64)m_qtemp << 32);
-				m_gs->WriteRegister(CGSHandler::RegisterWrite(GS_REG_RGBAQ, temp));
+				m_gs->WriteRegister(CGSHandler::RegisterWrite(GS_REG_RGBAQ, DecodePackedRgbaq(packet, m_qtemp)));
 				break;
 			case 0x02:
 				//ST
@@ -137,38 +323,15 @@ uint32 CGIF::ProcessPacked(const uint8* memory, uint32 address, uint32 end)
 				break;
 			case 0x03:
 				//UV
-				temp = (packet.nV[0] & 0x7FFF);
-				temp |= (packet.nV[1] & 0x7FFF) << 16;
-				m_gs->WriteRegister(CGSHandler::RegisterWrite(GS_REG_UV, temp));
+				m_gs->WriteRegister(CGSHandler::RegisterWrite(GS_REG_UV, DecodePackedUv(packet)));
 				break;
 			case 0x04:
 				//XYZF2
-				temp = (packet.nV[0] & 0xFFFF);
-				temp |= (packet.nV[1] & 0xFFFF) << 16;
-				temp |= (uint64)(packet.nV[2] & 0x0FFFFFF0) << 28;
-				temp |= (uint64)(packet.nV[3] & 0x00000FF0) << 52;
-				if(packet.nV[3] & 0x8000)
-				{
-					m_gs->WriteRegister(CGSHandler::RegisterWrite(GS_REG_XYZF3, temp));
-				}
-				else
-				{
-					m_gs->WriteRegister(CGSHandler::RegisterWrite(GS_REG_XYZF2, temp));
-				}
+				m_gs->WriteRegister(DecodePackedXyzf(packet));
 				break;
 			case 0x05:
 				//XYZ2
-				temp = (packet.nV[0] & 0xFFFF);
-				temp |= (packet.nV[1] & 0xFFFF) << 16;
-				temp |= (uint64)(packet.nV[2] & 0xFFFFFFFF) << 32;
-				if(packet.nV[3] & 0x8000)
-				{
-					m_gs->WriteRegister(CGSHandler::RegisterWrite(GS_REG_XYZ3, temp));
-				}
-				else
-				{
-					m_gs->WriteRegister(CGSHandler::RegisterWrite(GS_REG_XYZ2, temp));
-				}
+				m_gs->WriteRegister(DecodePackedXyz(packet));
 				break;
 			case 0x06:
 				//TEX0_1
@@ -188,7 +351,7 @@ uint32 CGIF::ProcessPacked(const uint8* memory, uint32 address, uint32 end)
 				break;
 			case 0x0A:
 				//FOG
-				m_gs->WriteRegister(CGSHandler::RegisterWrite(GS_REG_FOG, (packet.nD1 >> 36) << 56));
+				m_gs->WriteRegister(CGSHandler::RegisterWrite(GS_REG_FOG, DecodePackedFog(packet)));
 				break;
 			case 0x0D:
 				//XYZ3
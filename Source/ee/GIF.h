@@ -76,6 +76,20 @@ private:
 		FIFO_SIZE = FIFO_QWC * 0x10,
 	};
 
+	enum
+	{
+		PACKED_DECODER_CACHE_SIZE = 8,
+	};
+
+	struct PACKED_DECODER
+	{
+		bool isValid = false;
+		uint64 regList = 0;
+		uint8 regs = 0;
+		uint8 writeCount = 0;
+		bool canProcessLoops = false;
+	};
+
 	enum SIGNAL_STATE
 	{
 		SIGNAL_STATE_NONE,
@@ -91,6 +105,8 @@ private:
 	};
 
 	uint32 ProcessPacked(const uint8*, uint32, uint32);
+	uint32 ProcessPackedLoops(const uint8*, uint32, uint32, const PACKED_DECODER&);
+	const PACKED_DECODER& GetPackedDecoder();
 	uint32 ProcessRegList(const uint8*, uint32, uint32);
 	uint32 ProcessImage(const uint8*, uint32, uint32, uint32);
 
@@ -118,6 +134,8 @@ private:
 	uint32 m_fifoIndex = 0;
 	uint8* m_ram;
 	uint8* m_spr;
+	PACKED_DECODER m_packedDecoders[PACKED_DECODER_CACHE_SIZE];
+	uint32 m_nextPackedDecoderIndex = 0;
 	CGSHandler*& m_gs;
 	CDMAC& m_dmac;
 
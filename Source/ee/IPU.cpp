@@ -12,6 +12,8 @@
 #include "IPU_MacroblockTypeBTable.h"
 #include "IPU_MotionCodeTable.h"
 #include "IPU_DmVectorTable.h"
+#include "IPU_Csc.h"
+#include "IPU_Idct.h"
 #include "mpeg2/DcSizeLuminanceTable.h"
 #include "mpeg2/DcSizeChrominanceTable.h"
 #include "mpeg2/DctCoefficientTable0.h"
@@ -135,6 +137,11 @@ void CIPU::Reset()
 
 	m_isBusy = false;
 
+	if(m_IDECRunAhead)
+	{
+		m_IDECRunAhead->Cancel();
+	}
+
 	m_IN_FIFO.Reset();
 	m_OUT_FIFO.Reset();
 }
@@ -265,6 +272,10 @@ void CIPU::SetRegister(uint32 nAddress, uint32 nValue)
 	case IPU_CTRL + 0x0:
 		if(nValue & IPU_CTRL_RST)
 		{
+			if(m_IDECRunAhead)
+			{
+				m_IDECRunAhead->Cancel();
+			}
 			m_isBusy = false;
 			m_currentCmdId = IPU_INVALID_CMDID;
 			m_lastCmdId = IPU_INVALID_CMDID;
@@ -341,6 +352,11 @@ void CIPU::LoadState(Framework::CZipArchiveReader& archive)
 
 	m_IN_FIFO.LoadState(STATE_INFIFO_REGS_XML, archive);
 
+	if(m_IDECRunAhead)
+	{
+		m_IDECRunAhead->Cancel();
+	}
+
 	archive.BeginReadFile(STATE_INTRAIQ)->Read(m_nIntraIQ, sizeof(m_nIntraIQ));
 	archive.BeginReadFile(STATE_NONINTRAIQ)->Read(m_nNonIntraIQ, sizeof(m_nNonIntraIQ));
 	archive.BeginReadFile(STATE_VQCLUT)->Read(m_nVQCLUT, sizeof(m_nVQCLUT));
@@ -374,6 +390,11 @@ void CIPU::ExecuteCommand()
 		bool result = m_commands[m_currentCmdId]->Execute();
 		if(!result)
 		{
+			if(m_currentCmdId == IPU_CMD_IDEC)
+			{
+				//Command is waiting on something, try decoding what's left in the IN FIFO in the meantime
+				m_IDECCommand.StartRunAhead();
+			}
 			return;
 		}
 		m_currentCmdId = IPU_INVALID_CMDID;
@@ -418,6 +439,12 @@ void CIPU::FlushOUTFIFOData()
 
 void CIPU::InitializeCommand(uint32 value)
 {
+	if(m_IDECRunAhead)
+	{
+		//Macroblocks decoded ahead belong to the previous command
+		m_IDECRunAhead->Cancel();
+	}
+
 	unsigned int cmd = (value >> 28);
 	switch(cmd)
 	{
@@ -458,6 +485,34 @@ void CIPU::InitializeCommand(uint32 value)
 	}
 }
 
+CIPU::IDCT_MODE CIPU::GetIdctMode() const
+{
+	return m_idctMode;
+}
+
+void CIPU::SetIdctMode(IDCT_MODE idctMode)
+{
+	//Takes effect on the next decoding command
+	m_idctMode = idctMode;
+}
+
+bool CIPU::GetAsyncDecodeEnabled() const
+{
+	return m_IDECRunAhead != nullptr;
+}
+
+void CIPU::SetAsyncDecodeEnabled(bool enabled)
+{
+	if(enabled == GetAsyncDecodeEnabled()) return;
+	m_IDECCommand.SetRunAhead(nullptr);
+	m_IDECRunAhead.reset();
+	if(enabled)
+	{
+		m_IDECRunAhead = std::make_unique<CIDECRunAhead>();
+		m_IDECCommand.SetRunAhead(m_IDECRunAhead.get());
+	}
+}
+
 void CIPU::SetDMA3ReceiveHandler(const Dma3ReceiveHandler& receiveHandler)
 {
 	m_OUT_FIFO.SetReceiveHandler(receiveHandler);
@@ -503,6 +558,7 @@ CIPU::DECODER_CONTEXT CIPU::GetDecoderContext()
 	context.intraIq = m_nIntraIQ;
 	context.nonIntraIq = m_nNonIntraIQ;
 	context.dcPredictor = m_nDcPredictor;
+	context.idctMode = m_idctMode;
 	return context;
 }
 
@@ -888,9 +944,15 @@ bool CIPU::CINFIFO::TryPeekBits_LSBF(uint8 nBits, uint32& result)
 
 bool CIPU::CINFIFO::TryPeekBits_MSBF(uint8 size, uint32& result)
 {
-	assert(size != 0);
 	assert(size <= 32);
 
+	//Shifting by 64 below is undefined, reading no bits always succeeds
+	if(size == 0)
+	{
+		result = 0;
+		return true;
+	}
+
 	int bitsAvailable = (m_size * 8) - m_bitPosition;
 	int bitsNeeded = size;
 	assert(bitsAvailable >= 0);
@@ -905,9 +967,7 @@ bool CIPU::CINFIFO::TryPeekBits_MSBF(uint8 size, uint32& result)
 		m_lookupBitsDirty = false;
 	}
 
-	uint8 shift = 64 - (m_bitPosition % 32) - size;
-	uint64 mask = ~0ULL >> (64 - size);
-	result = static_cast<uint32>((m_lookupBits >> shift) & mask);
+	result = static_cast<uint32>((m_lookupBits << (m_bitPosition % 32)) >> (64 - size));
 
 	return true;
 }
@@ -926,6 +986,7 @@ void CIPU::CINFIFO::Advance(uint8 bits)
 	m_lookupBitsDirty |= (wordsBefore != wordsAfter);
 
 	m_bitPosition += bits;
+	m_readPosition += bits;
 
 	while(m_bitPosition >= 128)
 	{
@@ -959,6 +1020,25 @@ void CIPU::CINFIFO::SetBitPosition(unsigned int position)
 	m_bitPosition = position;
 }
 
+uint32 CIPU::CINFIFO::ReadBytes(uint8* data, uint32 size)
+{
+	assert((m_bitPosition & 7) == 0);
+
+	uint32 readSize = std::min<uint32>(size, GetAvailableBits() / 8);
+	memcpy(data, m_buffer + (m_bitPosition / 8), readSize);
+	m_bitPosition += readSize * 8;
+	m_readPosition += readSize * 8;
+	m_lookupBitsDirty = true;
+
+	//Discard the read qwords
+	uint32 discardSize = (m_bitPosition / 128) * 16;
+	memmove(m_buffer, m_buffer + discardSize, m_size - discardSize);
+	m_size -= discardSize;
+	m_bitPosition -= discardSize * 8;
+
+	return readSize;
+}
+
 unsigned int CIPU::CINFIFO::GetSize() const
 {
 	return m_size;
@@ -969,9 +1049,15 @@ unsigned int CIPU::CINFIFO::GetAvailableBits() const
 	return std::max<int32>((m_size * 8) - m_bitPosition, 0);
 }
 
+uint64 CIPU::CINFIFO::GetReadPosition() const
+{
+	return m_readPosition;
+}
+
 void CIPU::CINFIFO::Reset()
 {
 	m_bitPosition = 0;
+	m_readPosition = 0;
 	m_size = 0;
 	m_lookupBits = 0;
 	m_lookupBitsDirty = false;
@@ -997,13 +1083,14 @@ void CIPU::CINFIFO::LoadState(const char* regsFileName, Framework::CZipArchiveRe
 
 void CIPU::CINFIFO::SyncLookupBits()
 {
+	//Big endian load, compilers turn this into a single load and byte swap
 	unsigned int lookupPosition = (m_bitPosition & ~0x1F) / 8;
-	uint8 lookupBytes[8];
+	uint64 lookupBits = 0;
 	for(unsigned int i = 0; i < 8; i++)
 	{
-		lookupBytes[7 - i] = m_buffer[lookupPosition + i];
+		lookupBits = (lookupBits << 8) | m_buffer[lookupPosition + i];
 	}
-	m_lookupBits = *reinterpret_cast<uint64*>(lookupBytes);
+	m_lookupBits = lookupBits;
 }
 
 /////////////////////////////////////////////
@@ -1083,13 +1170,17 @@ bool CIPU::CIDECCommand::Execute()
 		break;
 		case STATE_ADVANCE:
 		{
+			if(TryCommitRunAheadMacroblock())
+			{
+				break;
+			}
 			m_IN_FIFO->Advance(m_command.fb);
 			m_state = STATE_READMBTYPE;
 		}
 		break;
 		case STATE_READMBTYPE:
 		{
-			if(FilterSymbolError(CMacroblockTypeITable::GetInstance()->TryGetSymbol(m_IN_FIFO, m_mbType)) != CVLCTable::DECODE_STATUS_SUCCESS)
+			if(FilterSymbolError(CVlcLookupTable::GetInstance<CMacroblockTypeITable>().TryGetSymbol(m_IN_FIFO, m_mbType)) != CVLCTable::DECODE_STATUS_SUCCESS)
 			{
 				return false;
 			}
@@ -1184,9 +1275,25 @@ bool CIPU::CIDECCommand::Execute()
 					return false;
 				}
 			}
+			if(m_stopAfterMacroblock)
+			{
+				return false;
+			}
+			break;
+		case STATE_FLUSHMACROBLOCK:
+			m_OUT_FIFO->Flush();
+			if(m_OUT_FIFO->GetSize() != 0)
+			{
+				return false;
+			}
+			m_state = STATE_CHECKSTARTCODE;
 			break;
 		case STATE_CHECKSTARTCODE:
 		{
+			if(TryCommitRunAheadMacroblock())
+			{
+				break;
+			}
 			uint32 nextBits = 0;
 			if(!m_IN_FIFO->TryPeekBits_MSBF(8, nextBits))
 			{
@@ -1231,7 +1338,7 @@ bool CIPU::CIDECCommand::Execute()
 		case STATE_READMBINCREMENT:
 		{
 			uint32 mbIncrement = 0;
-			if(CMacroblockAddressIncrementTable::GetInstance()->TryGetSymbol(m_IN_FIFO, mbIncrement) != CVLCTable::DECODE_STATUS_SUCCESS)
+			if(CVlcLookupTable::GetInstance<CMacroblockAddressIncrementTable>().TryGetSymbol(m_IN_FIFO, mbIncrement) != CVLCTable::DECODE_STATUS_SUCCESS)
 			{
 				return false;
 			}
@@ -1260,6 +1367,101 @@ bool CIPU::CIDECCommand::IsDelayed() const
 	return (m_state == STATE_DELAY);
 }
 
+void CIPU::CIDECCommand::SetRunAhead(CIDECRunAhead* runAhead)
+{
+	m_runAhead = runAhead;
+}
+
+void CIPU::CIDECCommand::StartRunAhead()
+{
+	if(m_runAhead == nullptr) return;
+	//Reference IDCT isn't safe to use from another thread
+	if(m_context.idctMode != IDCT_MODE_FAST) return;
+	switch(m_state)
+	{
+	case STATE_DELAY:
+	case STATE_ADVANCE:
+	case STATE_CSCINIT:
+	case STATE_CSC:
+	case STATE_FLUSHMACROBLOCK:
+	case STATE_CHECKSTARTCODE:
+		//Between macroblocks, nothing in the IN FIFO belongs to the current macroblock
+		m_runAhead->Start(*this, *m_IN_FIFO);
+		break;
+	default:
+		break;
+	}
+}
+
+void CIPU::CIDECCommand::InitializeRunAhead(const CIDECCommand& src, CBDECCommand* BDECCommand, CCSCCommand* CSCCommand, CINFIFO* inFifo, COUTFIFO* outFifo,
+                                            uint8* intraIq, uint8* nonIntraIq, int16* dcPredictor)
+{
+	m_IN_FIFO = inFifo;
+	m_OUT_FIFO = outFifo;
+	m_BDECCommand = BDECCommand;
+	m_CSCCommand = CSCCommand;
+
+	m_command = src.m_command;
+	m_dt = src.m_dt;
+	m_mbType = src.m_mbType;
+	m_qsc = src.m_qsc;
+	m_TH0 = src.m_TH0;
+	m_TH1 = src.m_TH1;
+	m_mbCount = src.m_mbCount;
+	m_delayTicks = 0;
+
+	//Work on copies of the tables and predictors, the originals belong to the EE thread
+	m_context = src.m_context;
+	memcpy(intraIq, src.m_context.intraIq, 0x40);
+	memcpy(nonIntraIq, src.m_context.nonIntraIq, 0x40);
+	memcpy(dcPredictor, src.m_context.dcPredictor, sizeof(int16) * 3);
+	m_context.intraIq = intraIq;
+	m_context.nonIntraIq = nonIntraIq;
+	m_context.dcPredictor = dcPredictor;
+
+	bool isFirstMacroblock = (src.m_state == STATE_DELAY) || (src.m_state == STATE_ADVANCE);
+	m_state = isFirstMacroblock ? STATE_ADVANCE : STATE_CHECKSTARTCODE;
+	m_runAhead = nullptr;
+	m_stopAfterMacroblock = true;
+}
+
+void CIPU::CIDECCommand::SaveRunAheadState(RUNAHEAD_MACROBLOCK& macroblock) const
+{
+	macroblock.mbType = m_mbType;
+	macroblock.dt = m_dt;
+	macroblock.qsc = m_qsc;
+	memcpy(macroblock.dcPredictor, m_context.dcPredictor, sizeof(macroblock.dcPredictor));
+}
+
+bool CIPU::CIDECCommand::TryCommitRunAheadMacroblock()
+{
+	if(m_runAhead == nullptr) return false;
+
+	RUNAHEAD_MACROBLOCK macroblock;
+	if(!m_runAhead->TryGetMacroblock(m_IN_FIFO->GetReadPosition(), m_IN_FIFO->GetAvailableBits(), macroblock))
+	{
+		return false;
+	}
+
+	uint64 bitCount = macroblock.endPosition - macroblock.startPosition;
+	while(bitCount != 0)
+	{
+		uint8 advanceBits = static_cast<uint8>(std::min<uint64>(bitCount, 32));
+		m_IN_FIFO->Advance(advanceBits);
+		bitCount -= advanceBits;
+	}
+
+	m_mbType = macroblock.mbType;
+	m_dt = macroblock.dt;
+	m_qsc = macroblock.qsc;
+	memcpy(m_context.dcPredictor, macroblock.dcPredictor, sizeof(macroblock.dcPredictor));
+	m_mbCount++;
+
+	m_OUT_FIFO->Write(macroblock.pixels.data(), static_cast<unsigned int>(macroblock.pixels.size()));
+	m_state = STATE_FLUSHMACROBLOCK;
+	return true;
+}
+
 void CIPU::CIDECCommand::ConvertRawBlock()
 {
 	//Convert block from RAW16 to RAW8
@@ -1330,7 +1532,7 @@ bool CIPU::CBDECCommand::Execute()
 			if(!m_command.mbi)
 			{
 				//Not an Intra Macroblock, so we need to fetch the pattern code
-				m_codedBlockPattern = static_cast<uint8>(CCodedBlockPatternTable::GetInstance()->GetSymbol(m_IN_FIFO));
+				m_codedBlockPattern = static_cast<uint8>(CVlcLookupTable::GetInstance<CCodedBlockPatternTable>().GetSymbol(m_IN_FIFO));
 			}
 			else
 			{
@@ -1410,7 +1612,14 @@ bool CIPU::CBDECCommand::Execute()
 
 			memcpy(blockTemp, blockInfo.block, sizeof(int16) * 0x40);
 
-			IDCT::CIEEE1180::GetInstance()->Transform(blockTemp, blockInfo.block);
+			if(m_context.idctMode == IDCT_MODE_REFERENCE)
+			{
+				IDCT::CIEEE1180::GetInstance()->Transform(blockTemp, blockInfo.block);
+			}
+			else
+			{
+				IPU::Idct::Transform(blockTemp, blockInfo.block);
+			}
 
 			m_state = STATE_DECODEBLOCK_GOTONEXT;
 		}
@@ -1488,11 +1697,32 @@ void CIPU::CBDECCommand_ReadDct::Initialize(CINFIFO* fifo, int16* block, unsigne
 	if(m_mbi && !m_isMpeg1CoeffVLCTable)
 	{
 		m_coeffTable = &CDctCoefficientTable1::GetInstance();
+		m_coeffLookupTable = &CDctCoefficientLookupTable::GetInstance<CDctCoefficientTable1>();
 	}
 	else
 	{
 		m_coeffTable = &CDctCoefficientTable0::GetInstance();
+		m_coeffLookupTable = &CDctCoefficientLookupTable::GetInstance<CDctCoefficientTable0>();
+	}
+}
+
+void CIPU::CBDECCommand_ReadDct::StoreCoefficient(unsigned int run, int16 level)
+{
+	m_blockIndex += run;
+
+	if(m_blockIndex < 0x40)
+	{
+		m_block[m_blockIndex] = level;
+#ifdef _DECODE_LOGGING
+		CLog::GetInstance().Print(DECODE_LOG_NAME, "[%d]: %d ", m_blockIndex, level);
+#endif
+	}
+	else
+	{
+		throw CVLCTable::CVLCTableException();
 	}
+
+	m_blockIndex++;
 }
 
 bool CIPU::CBDECCommand_ReadDct::Execute()
@@ -1536,6 +1766,26 @@ bool CIPU::CBDECCommand_ReadDct::Execute()
 		break;
 		case STATE_CHECKEOB:
 		{
+			//Short codes are decoded in one go, EOB check included
+			uint32 lookupBits = 0;
+			if(m_IN_FIFO->TryPeekBits_MSBF(CDctCoefficientLookupTable::LOOKUP_BITS, lookupBits))
+			{
+				const auto& entry = m_coeffLookupTable->GetEntry(lookupBits, m_blockIndex == 0, m_isMpeg2);
+				if(entry.length != 0)
+				{
+					m_IN_FIFO->Advance(entry.length);
+					if(entry.isEob)
+					{
+#ifdef _DECODE_LOGGING
+						CLog::GetInstance().Print(DECODE_LOG_NAME, "\r\n");
+#endif
+						return true;
+					}
+					StoreCoefficient(entry.run, entry.level);
+					break;
+				}
+			}
+
 			bool isEob = false;
 			if(m_coeffTable->TryIsEndOfBlock(m_IN_FIFO, isEob) != CVLCTable::DECODE_STATUS_SUCCESS)
 			{
@@ -1568,21 +1818,7 @@ bool CIPU::CBDECCommand_ReadDct::Execute()
 					return false;
 				}
 			}
-			m_blockIndex += runLevelPair.run;
-
-			if(m_blockIndex < 0x40)
-			{
-				m_block[m_blockIndex] = static_cast<int16>(runLevelPair.level);
-#ifdef _DECODE_LOGGING
-				CLog::GetInstance().Print(DECODE_LOG_NAME, "[%d]: %d ", m_blockIndex, runLevelPair.level);
-#endif
-			}
-			else
-			{
-				throw CVLCTable::CVLCTableException();
-			}
-
-			m_blockIndex++;
+			StoreCoefficient(runLevelPair.run, static_cast<int16>(runLevelPair.level));
 			m_state = STATE_CHECKEOB;
 		}
 		break;
@@ -1625,14 +1861,14 @@ bool CIPU::CBDECCommand_ReadDcDiff::Execute()
 			switch(m_channelId)
 			{
 			case 0:
-				if(CDcSizeLuminanceTable::GetInstance()->TryGetSymbol(m_IN_FIFO, dcSize) != CVLCTable::DECODE_STATUS_SUCCESS)
+				if(CVlcLookupTable::GetInstance<CDcSizeLuminanceTable>().TryGetSymbol(m_IN_FIFO, dcSize) != CVLCTable::DECODE_STATUS_SUCCESS)
 				{
 					return false;
 				}
 				break;
 			case 1:
 			case 2:
-				if(CDcSizeChrominanceTable::GetInstance()->TryGetSymbol(m_IN_FIFO, dcSize) != CVLCTable::DECODE_STATUS_SUCCESS)
+				if(CVlcLookupTable::GetInstance<CDcSizeChrominanceTable>().TryGetSymbol(m_IN_FIFO, dcSize) != CVLCTable::DECODE_STATUS_SUCCESS)
 				{
 					return false;
 				}
@@ -1692,7 +1928,7 @@ void CIPU::CVDECCommand::Initialize(CINFIFO* fifo, uint32 commandCode, uint32 pi
 	{
 	case 0:
 		//Macroblock Address Increment
-		m_table = CMacroblockAddressIncrementTable::GetInstance();
+		m_table = &CVlcLookupTable::GetInstance<CMacroblockAddressIncrementTable>();
 		break;
 	case 1:
 		//Macroblock Type
@@ -1700,15 +1936,15 @@ void CIPU::CVDECCommand::Initialize(CINFIFO* fifo, uint32 commandCode, uint32 pi
 		{
 		case 1:
 			//I Picture
-			m_table = CMacroblockTypeITable::GetInstance();
+			m_table = &CVlcLookupTable::GetInstance<CMacroblockTypeITable>();
 			break;
 		case 2:
 			//P Picture
-			m_table = CMacroblockTypePTable::GetInstance();
+			m_table = &CVlcLookupTable::GetInstance<CMacroblockTypePTable>();
 			break;
 		case 3:
 			//B Picture
-			m_table = CMacroblockTypeBTable::GetInstance();
+			m_table = &CVlcLookupTable::GetInstance<CMacroblockTypeBTable>();
 			break;
 		default:
 			assert(0);
@@ -1717,10 +1953,10 @@ void CIPU::CVDECCommand::Initialize(CINFIFO* fifo, uint32 commandCode, uint32 pi
 		}
 		break;
 	case 2:
-		m_table = CMotionCodeTable::GetInstance();
+		m_table = &CVlcLookupTable::GetInstance<CMotionCodeTable>();
 		break;
 	case 3:
-		m_table = CDmVectorTable::GetInstance();
+		m_table = &CVlcLookupTable::GetInstance<CDmVectorTable>();
 		break;
 	default:
 		assert(0);
@@ -1750,22 +1986,22 @@ bool CIPU::CVDECCommand::Execute()
 		case STATE_DONE:
 #ifdef _DECODE_LOGGING
 			const char* tableName = "unknown";
-			if(m_table == CMacroblockAddressIncrementTable::GetInstance())
+			if(m_table == &CVlcLookupTable::GetInstance<CMacroblockAddressIncrementTable>())
 			{
 				tableName = "mb increment";
 			}
 			else if(
-			    (m_table == CMacroblockTypeITable::GetInstance()) ||
-			    (m_table == CMacroblockTypePTable::GetInstance()) ||
-			    (m_table == CMacroblockTypeBTable::GetInstance()))
+			    (m_table == &CVlcLookupTable::GetInstance<CMacroblockTypeITable>()) ||
+			    (m_table == &CVlcLookupTable::GetInstance<CMacroblockTypePTable>()) ||
+			    (m_table == &CVlcLookupTable::GetInstance<CMacroblockTypeBTable>()))
 			{
 				tableName = "mb type";
 			}
-			else if(m_table == CMotionCodeTable::GetInstance())
+			else if(m_table == &CVlcLookupTable::GetInstance<CMotionCodeTable>())
 			{
 				tableName = "motion code";
 			}
-			else if(m_table == CDmVectorTable::GetInstance())
+			else if(m_table == &CVlcLookupTable::GetInstance<CDmVectorTable>())
 			{
 				tableName = "dm vector";
 			}
@@ -1881,7 +2117,7 @@ bool CIPU::CSETVQCommand::Execute()
 
 CIPU::CCSCCommand::CCSCCommand()
 {
-	GenerateCbCrMap();
+	static_assert(static_cast<unsigned int>(BLOCK_SIZE) == Csc::BLOCK_SIZE);
 }
 
 void CIPU::CCSCCommand::Initialize(CINFIFO* input, COUTFIFO* output, uint32 commandCode, uint16 TH0, uint16 TH1)
@@ -1925,6 +2161,16 @@ bool CIPU::CCSCCommand::Execute()
 			{
 				m_state = STATE_CONVERTBLOCK;
 			}
+			else if((m_IN_FIFO->GetBitIndex() & 7) == 0)
+			{
+				//Copy whatever is available in the FIFO, the block might span multiple DMA transfers
+				uint32 readSize = m_IN_FIFO->ReadBytes(m_block + m_currentIndex, BLOCK_SIZE - m_currentIndex);
+				if(readSize == 0)
+				{
+					return false;
+				}
+				m_currentIndex += readSize;
+			}
 			else
 			{
 				uint32 blockValue = 0;
@@ -1939,80 +2185,22 @@ bool CIPU::CCSCCommand::Execute()
 		break;
 		case STATE_CONVERTBLOCK:
 		{
-			uint32 nPixel[0x100];
-
-			uint8* pY = m_block;
-			uint8* nBlockCb = m_block + 0x100;
-			uint8* nBlockCr = m_block + 0x140;
-
-			uint32* pPixel = nPixel;
-			unsigned int* pCbCrMap = m_nCbCrMap;
-
 			uint16 alphaTh0 = (m_TH0 & 0x1FF);
 			uint16 alphaTh1 = (m_TH1 & 0x1FF);
 
-			for(unsigned int i = 0; i < 16; i++)
-			{
-				for(unsigned int j = 0; j < 16; j++)
-				{
-					float nY = pY[j];
-					float nCb = nBlockCb[pCbCrMap[j]];
-					float nCr = nBlockCr[pCbCrMap[j]];
-
-					float nR = nY + 1.402f * (nCr - 128);
-					float nG = nY - 0.34414f * (nCb - 128) - 0.71414f * (nCr - 128);
-					float nB = nY + 1.772f * (nCb - 128);
-
-					nR = std::clamp(nR, 0.f, 255.f);
-					nG = std::clamp(nG, 0.f, 255.f);
-					nB = std::clamp(nB, 0.f, 255.f);
-
-					uint8 a = 0;
-					uint8 r = static_cast<uint8>(nR);
-					uint8 g = static_cast<uint8>(nG);
-					uint8 b = static_cast<uint8>(nB);
-
-					if(r < alphaTh0 && g < alphaTh0 && b < alphaTh0)
-					{
-						a = 0;
-					}
-					else if(r < alphaTh1 && g < alphaTh1 && b < alphaTh1)
-					{
-						a = 0x40;
-					}
-					else
-					{
-						a = 0x80;
-					}
-
-					pPixel[j] = (a << 24) | (b << 16) | (g << 8) | (r << 0);
-				}
-
-				pY += 0x10;
-				pCbCrMap += 0x10;
-				pPixel += 0x10;
-			}
-
 			if(m_command.ofm == 1)
 			{
 				//RGBA16 output
-				uint16 cvtPixels[0x100];
-				for(uint32 i = 0; i < 0x100; i++)
-				{
-					uint32 pixel = nPixel[i];
-					uint16 result = 0;
-					result |= ((pixel & 0x000000F8) >> (0 + 3)) << 0;
-					result |= ((pixel & 0x0000F800) >> (8 + 3)) << 5;
-					result |= ((pixel & 0x00F80000) >> (16 + 3)) << 10;
-					result |= ((pixel & 0x80000000) >> 31) << 15;
-					cvtPixels[i] = result;
-				}
-				m_OUT_FIFO->Write(cvtPixels, sizeof(uint16) * 0x100);
+				uint16 cvtPixels[Csc::PIXEL_COUNT];
+				Csc::ConvertRgba16(m_block, cvtPixels, alphaTh0, alphaTh1, (m_command.dte != 0));
+				m_OUT_FIFO->Write(cvtPixels, sizeof(cvtPixels));
 			}
 			else
 			{
 				//RGBA32 output
-				m_OUT_FIFO->Write(nPixel, sizeof(uint32) * 0x100);
+				uint32 pixels[Csc::PIXEL_COUNT];
+				Csc::ConvertRgba32(m_block, pixels, alphaTh0, alphaTh1);
+				m_OUT_FIFO->Write(pixels, sizeof(pixels));
 			}
 
 			m_mbCount--;
@@ -2036,24 +2224,6 @@ bool CIPU::CCSCCommand::Execute()
 	}
 }
 
-void CIPU::CCSCCommand::GenerateCbCrMap()
-{
-	unsigned int* pCbCrMap = m_nCbCrMap;
-	for(unsigned int i = 0; i < 0x40; i += 0x8)
-	{
-		for(unsigned int j = 0; j < 0x10; j += 2)
-		{
-			pCbCrMap[j + 0x00] = (j / 2) + i;
-			pCbCrMap[j + 0x01] = (j / 2) + i;
-
-			pCbCrMap[j + 0x10] = (j / 2) + i;
-			pCbCrMap[j + 0x11] = (j / 2) + i;
-		}
-
-		pCbCrMap += 0x20;
-	}
-}
-
 /////////////////////////////////////////////
 //SETTH command implementation
 /////////////////////////////////////////////
@@ -2078,3 +2248,162 @@ bool CIPU::CSETTHCommand::Execute()
 	(*m_TH1) = static_cast<uint16>((m_commandCode >> 16) & 0x1FF);
 	return true;
 }
+
+/////////////////////////////////////////////
+//IDEC run ahead implementation
+/////////////////////////////////////////////
+
+CIPU::CIDECRunAhead::CIDECRunAhead()
+{
+	m_OUT_FIFO.SetReceiveHandler(
+	    [&](const void* data, uint32 size) {
+		    auto bytes = reinterpret_cast<const uint8*>(data);
+		    m_pixels.insert(m_pixels.end(), bytes, bytes + (size * 0x10));
+		    return size;
+	    });
+	m_thread = std::thread([this]() { ThreadProc(); });
+}
+
+CIPU::CIDECRunAhead::~CIDECRunAhead()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_terminate = true;
+	}
+	m_condition.notify_all();
+	m_thread.join();
+}
+
+void CIPU::CIDECRunAhead::Start(const CIDECCommand& command, const CINFIFO& inFifo)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if(!m_macroblocks.empty() && (m_macroblocks.front().startPosition != inFifo.GetReadPosition()))
+		{
+			m_macroblocks.clear();
+		}
+		if(m_busy || m_jobPending || !m_macroblocks.empty())
+		{
+			return;
+		}
+		//Nothing new to decode since the last attempt
+		if((inFifo.GetReadPosition() == m_startPosition) && (inFifo.GetAvailableBits() == m_startAvailableBits))
+		{
+			return;
+		}
+		m_startPosition = inFifo.GetReadPosition();
+		m_startAvailableBits = inFifo.GetAvailableBits();
+		//Worker is idle, safe to set up its state
+		m_IN_FIFO = inFifo;
+		m_IDECCommand.InitializeRunAhead(command, &m_BDECCommand, &m_CSCCommand, &m_IN_FIFO, &m_OUT_FIFO,
+		                                 m_intraIq, m_nonIntraIq, m_dcPredictor);
+		m_nextPosition = inFifo.GetReadPosition();
+		m_jobPending = true;
+	}
+	m_condition.notify_all();
+}
+
+void CIPU::CIDECRunAhead::Cancel()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_generation++;
+	m_macroblocks.clear();
+	m_jobPending = false;
+	m_startAvailableBits = ~0U;
+}
+
+bool CIPU::CIDECRunAhead::TryGetMacroblock(uint64 position, unsigned int availableBits, RUNAHEAD_MACROBLOCK& macroblock)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while(1)
+	{
+		if(!m_macroblocks.empty())
+		{
+			auto& front = m_macroblocks.front();
+			if(front.startPosition != position)
+			{
+				//Command went another way, what we have is stale
+				m_generation++;
+				m_macroblocks.clear();
+				return false;
+			}
+			//Only use it if the command could have decoded it without waiting for more data
+			if((front.endPosition - front.startPosition) > availableBits)
+			{
+				return false;
+			}
+			macroblock = std::move(front);
+			m_macroblocks.pop_front();
+			return true;
+		}
+		if(!(m_busy || m_jobPending) || (m_nextPosition != position))
+		{
+			return false;
+		}
+		//Worker is decoding the macroblock we're looking for
+		m_condition.wait(lock);
+	}
+}
+
+void CIPU::CIDECRunAhead::ThreadProc()
+{
+	while(1)
+	{
+		uint32 generation = 0;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [this]() { return m_terminate || m_jobPending; });
+			if(m_terminate) break;
+			m_jobPending = false;
+			m_busy = true;
+			generation = m_generation;
+		}
+		DecodeMacroblocks(generation);
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_busy = false;
+		}
+		m_condition.notify_all();
+	}
+}
+
+void CIPU::CIDECRunAhead::DecodeMacroblocks(uint32 generation)
+{
+	while(1)
+	{
+		RUNAHEAD_MACROBLOCK macroblock;
+		macroblock.startPosition = m_IN_FIFO.GetReadPosition();
+		m_pixels.clear();
+		try
+		{
+			if(m_IDECCommand.Execute())
+			{
+				//Reached the end of the picture
+				return;
+			}
+		}
+		catch(...)
+		{
+			//Start codes, errors and running out of data are handled by the command itself
+			return;
+		}
+		if(m_pixels.empty())
+		{
+			//Not enough data for a full macroblock
+			return;
+		}
+		macroblock.endPosition = m_IN_FIFO.GetReadPosition();
+		macroblock.pixels = m_pixels;
+		m_IDECCommand.SaveRunAheadState(macroblock);
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if(generation != m_generation)
+			{
+				return;
+			}
+			m_nextPosition = macroblock.endPosition;
+			m_macroblocks.push_back(std::move(macroblock));
+		}
+		m_condition.notify_all();
+	}
+}
@@ -2,12 +2,19 @@
 
 #include <algorithm>
 #include <array>
+#include <condition_variable>
+#include <deque>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 #include "Types.h"
 #include "BitStream.h"
 #include "MemStream.h"
 #include "mpeg2/VLCTable.h"
 #include "mpeg2/DctCoefficientTable.h"
+#include "IPU_VlcLookupTable.h"
 #include "../MailBox.h"
 #include "Convertible.h"
 #include "zip/ZipArchiveWriter.h"
@@ -20,6 +27,12 @@ class CIPU
 public:
 	typedef std::function<uint32(const void*, uint32)> Dma3ReceiveHandler;
 
+	enum IDCT_MODE
+	{
+		IDCT_MODE_FAST,
+		IDCT_MODE_REFERENCE,
+	};
+
 	CIPU(CINTC&);
 	virtual ~CIPU() = default;
 
@@ -40,6 +53,12 @@ public:
 	void SaveState(Framework::CZipArchiveWriter&);
 	void LoadState(Framework::CZipArchiveReader&);
 
+	IDCT_MODE GetIdctMode() const;
+	void SetIdctMode(IDCT_MODE);
+
+	bool GetAsyncDecodeEnabled() const;
+	void SetAsyncDecodeEnabled(bool);
+
 	void SetDMA3ReceiveHandler(const Dma3ReceiveHandler&);
 	uint32 ReceiveDMA4(uint32, uint32, bool, uint8*, uint8*);
 
@@ -128,6 +147,18 @@ private:
 		uint8* nonIntraIq = nullptr;
 		int16* dcPredictor = nullptr;
 		uint32 dcPrecision = 0;
+		IDCT_MODE idctMode = IDCT_MODE_FAST;
+	};
+
+	struct RUNAHEAD_MACROBLOCK
+	{
+		uint64 startPosition = 0;
+		uint64 endPosition = 0;
+		uint32 mbType = 0;
+		uint32 dt = 0;
+		uint32 qsc = 0;
+		int16 dcPredictor[3] = {};
+		std::vector<uint8> pixels;
 	};
 
 	class COUTFIFO
@@ -156,7 +187,7 @@ private:
 		Dma3ReceiveHandler m_receiveHandler;
 	};
 
-	class CINFIFO : public Framework::CBitStream
+	class CINFIFO final : public Framework::CBitStream
 	{
 	public:
 		CINFIFO();
@@ -170,10 +201,16 @@ private:
 		bool TryPeekBits_LSBF(uint8, uint32&) override;
 		bool TryPeekBits_MSBF(uint8, uint32&) override;
 
+		//Reads whole bytes from a byte aligned position, returns the number of bytes read
+		uint32 ReadBytes(uint8*, uint32);
+
 		void SetBitPosition(unsigned int);
 		unsigned int GetSize() const;
 		unsigned int GetAvailableBits() const;
 
+		//Number of bits consumed since the last reset
+		uint64 GetReadPosition() const;
+
 		void Reset();
 		void SaveState(const char*, Framework::CZipArchiveWriter&);
 		void LoadState(const char*, Framework::CZipArchiveReader&);
@@ -191,6 +228,7 @@ private:
 		bool m_lookupBitsDirty;
 		unsigned int m_size;
 		unsigned int m_bitPosition;
+		uint64 m_readPosition = 0;
 	};
 
 	class CStartCodeException : public std::exception
@@ -229,6 +267,7 @@ private:
 	//0x01 ------------------------------------------------------------
 	class CBDECCommand;
 	class CCSCCommand;
+	class CIDECRunAhead;
 
 	class CIDECCommand : public CCommand
 	{
@@ -240,6 +279,11 @@ private:
 		void CountTicks(uint32) override;
 		bool IsDelayed() const override;
 
+		void SetRunAhead(CIDECRunAhead*);
+		void StartRunAhead();
+		void InitializeRunAhead(const CIDECCommand&, CBDECCommand*, CCSCCommand*, CINFIFO*, COUTFIFO*, uint8*, uint8*, int16*);
+		void SaveRunAheadState(RUNAHEAD_MACROBLOCK&) const;
+
 	private:
 		enum STATE
 		{
@@ -255,10 +299,12 @@ private:
 			STATE_READMBINCREMENT,
 			STATE_CSCINIT,
 			STATE_CSC,
+			STATE_FLUSHMACROBLOCK,
 			STATE_DONE
 		};
 
 		void ConvertRawBlock();
+		bool TryCommitRunAheadMacroblock();
 
 		CMD_IDEC m_command = make_convertible<CMD_IDEC>(0);
 		STATE m_state = STATE_DONE;
@@ -281,6 +327,9 @@ private:
 		uint32 m_qsc = 0;
 		uint32 m_mbCount = 0;
 		int32 m_delayTicks = 0;
+
+		CIDECRunAhead* m_runAhead = nullptr;
+		bool m_stopAfterMacroblock = false;
 	};
 
 	//0x02 ------------------------------------------------------------
@@ -312,6 +361,8 @@ private:
 		bool Execute() override;
 
 	private:
+		void StoreCoefficient(unsigned int, int16);
+
 		enum STATE
 		{
 			STATE_INIT,
@@ -330,6 +381,7 @@ private:
 		bool m_isMpeg2 = true;
 		unsigned int m_blockIndex = 0;
 		MPEG2::CDctCoefficientTable* m_coeffTable = nullptr;
+		IPU::CDctCoefficientLookupTable* m_coeffLookupTable = nullptr;
 		int16* m_dcPredictor = nullptr;
 		int16 m_dcDiff = 0;
 		CBDECCommand_ReadDcDiff m_readDcDiffCommand;
@@ -401,7 +453,7 @@ private:
 		uint32* m_result = nullptr;
 		CINFIFO* m_IN_FIFO = nullptr;
 		STATE m_state = STATE_ADVANCE;
-		MPEG2::CVLCTable* m_table = nullptr;
+		IPU::CVlcLookupTable* m_table = nullptr;
 	};
 
 	//0x04 ------------------------------------------------------------
@@ -479,8 +531,6 @@ private:
 			STATE_DONE,
 		};
 
-		void GenerateCbCrMap();
-
 		STATE m_state = STATE_DONE;
 		CMD_CSC m_command = make_convertible<CMD_CSC>(0);
 
@@ -492,8 +542,6 @@ private:
 		unsigned int m_currentIndex = 0;
 		unsigned int m_mbCount = 0;
 
-		unsigned int m_nCbCrMap[0x100];
-
 		uint8 m_block[BLOCK_SIZE];
 	};
 
@@ -512,6 +560,46 @@ private:
 		uint16* m_TH1;
 	};
 
+	//Decodes IDEC macroblocks ahead of the command on a worker thread, using a copy of the IN FIFO.
+	//The command only takes macroblocks that were decoded from its current stream position and
+	//that are fully available in the IN FIFO, so results and timing match inline decoding.
+	class CIDECRunAhead
+	{
+	public:
+		CIDECRunAhead();
+		~CIDECRunAhead();
+
+		void Start(const CIDECCommand&, const CINFIFO&);
+		void Cancel();
+		bool TryGetMacroblock(uint64, unsigned int, RUNAHEAD_MACROBLOCK&);
+
+	private:
+		void ThreadProc();
+		void DecodeMacroblocks(uint32);
+
+		CIDECCommand m_IDECCommand;
+		CBDECCommand m_BDECCommand;
+		CCSCCommand m_CSCCommand;
+		CINFIFO m_IN_FIFO;
+		COUTFIFO m_OUT_FIFO;
+		uint8 m_intraIq[0x40];
+		uint8 m_nonIntraIq[0x40];
+		int16 m_dcPredictor[3];
+		std::vector<uint8> m_pixels;
+
+		std::thread m_thread;
+		std::mutex m_mutex;
+		std::condition_variable m_condition;
+		std::deque<RUNAHEAD_MACROBLOCK> m_macroblocks;
+		uint64 m_nextPosition = 0;
+		uint64 m_startPosition = 0;
+		unsigned int m_startAvailableBits = ~0U;
+		uint32 m_generation = 0;
+		bool m_jobPending = false;
+		bool m_busy = false;
+		bool m_terminate = false;
+	};
+
 	void InitializeCommand(uint32);
 
 	DECODER_CONTEXT GetDecoderContext();
@@ -549,6 +637,8 @@ private:
 	uint32 m_currentCmdId;
 	uint32 m_lastCmdId;
 	bool m_isBusy;
+	IDCT_MODE m_idctMode = IDCT_MODE_FAST;
+	std::unique_ptr<CIDECRunAhead> m_IDECRunAhead;
 
 	CBCLRCommand m_BCLRCommand;
 	CIDECCommand m_IDECCommand;
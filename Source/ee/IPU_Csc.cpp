@@ -0,0 +1,360 @@
+#include <algorithm>
+#include <cstring>
+#include "IPU_Csc.h"
+#include "SimdDefs.h"
+
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+#include <emmintrin.h>
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+#include <arm_neon.h>
+#endif
+
+//R and B use 14 fractional bits and give the same results as the floating point
+//formulas. G uses 15 bits, the remaining differences come from float rounding.
+#define RB_SHIFT (14)
+#define G_SHIFT (15)
+#define G_BIAS (2)
+
+//1.402, 1.772, 0.34414 and 0.71414 in fixed-point
+#define COEF_CR_R (22970)
+#define COEF_CB_B (29032)
+#define COEF_CB_G (11277)
+#define COEF_CR_G (23401)
+
+#define CHROMA_OFFSET (0x80)
+#define CB_BLOCK_OFFSET (0x100)
+#define CR_BLOCK_OFFSET (0x140)
+
+#define ALPHA_TH0 (0x00)
+#define ALPHA_TH1 (0x40)
+#define ALPHA_OPAQUE (0x80)
+
+using namespace IPU;
+
+// clang-format off
+static const int16 g_ditherMatrix[4][4] =
+{
+	{ -4,  0, -3,  1 },
+	{  2, -2,  3, -1 },
+	{ -3,  1, -4,  0 },
+	{  3, -1,  2, -2 },
+};
+// clang-format on
+
+static unsigned int GetChromaIndex(unsigned int row, unsigned int column)
+{
+	return ((row / 2) * 8) + (column / 2);
+}
+
+static void ConvertPixelScalar(const uint8* block, unsigned int row, unsigned int column, uint16 th0, uint16 th1,
+                               int32& r, int32& g, int32& b, int32& a)
+{
+	unsigned int chromaIndex = GetChromaIndex(row, column);
+	int32 y = block[(row * 16) + column];
+	int32 cb = block[CB_BLOCK_OFFSET + chromaIndex] - CHROMA_OFFSET;
+	int32 cr = block[CR_BLOCK_OFFSET + chromaIndex] - CHROMA_OFFSET;
+
+	r = ((y << RB_SHIFT) + (COEF_CR_R * cr)) >> RB_SHIFT;
+	g = ((y << G_SHIFT) - (COEF_CB_G * cb) - (COEF_CR_G * cr) + G_BIAS) >> G_SHIFT;
+	b = ((y << RB_SHIFT) + (COEF_CB_B * cb)) >> RB_SHIFT;
+
+	r = std::clamp<int32>(r, 0, 255);
+	g = std::clamp<int32>(g, 0, 255);
+	b = std::clamp<int32>(b, 0, 255);
+
+	int32 maxComponent = std::max(r, std::max(g, b));
+	if(maxComponent < th0)
+	{
+		a = ALPHA_TH0;
+	}
+	else if(maxComponent < th1)
+	{
+		a = ALPHA_TH1;
+	}
+	else
+	{
+		a = ALPHA_OPAQUE;
+	}
+}
+
+void Csc::ConvertRgba32Scalar(const uint8* block, uint32* output, uint16 th0, uint16 th1)
+{
+	for(unsigned int row = 0; row < 16; row++)
+	{
+		for(unsigned int column = 0; column < 16; column++)
+		{
+			int32 r = 0, g = 0, b = 0, a = 0;
+			ConvertPixelScalar(block, row, column, th0, th1, r, g, b, a);
+			output[(row * 16) + column] = (a << 24) | (b << 16) | (g << 8) | (r << 0);
+		}
+	}
+}
+
+void Csc::ConvertRgba16Scalar(const uint8* block, uint16* output, uint16 th0, uint16 th1, bool dither)
+{
+	for(unsigned int row = 0; row < 16; row++)
+	{
+		for(unsigned int column = 0; column < 16; column++)
+		{
+			int32 r = 0, g = 0, b = 0, a = 0;
+			ConvertPixelScalar(block, row, column, th0, th1, r, g, b, a);
+			if(dither)
+			{
+				int32 offset = g_ditherMatrix[row & 3][column & 3];
+				r = std::clamp<int32>(r + offset, 0, 255);
+				g = std::clamp<int32>(g + offset, 0, 255);
+				b = std::clamp<int32>(b + offset, 0, 255);
+			}
+			uint16 result = 0;
+			result |= (r >> 3) << 0;
+			result |= (g >> 3) << 5;
+			result |= (b >> 3) << 10;
+			result |= (a >> 7) << 15;
+			output[(row * 16) + column] = result;
+		}
+	}
+}
+
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+
+struct PIXELS
+{
+	__m128i r;
+	__m128i g;
+	__m128i b;
+	__m128i a;
+};
+
+static inline __m128i MakeWeightPair(int16 w0, int16 w1)
+{
+	return _mm_set1_epi32(static_cast<uint16>(w0) | (static_cast<uint32>(static_cast<uint16>(w1)) << 16));
+}
+
+static inline __m128i LoadChroma(const uint8* chroma)
+{
+	//Each chroma sample covers 2 horizontal pixels
+	uint32 samples = 0;
+	memcpy(&samples, chroma, sizeof(uint32));
+	__m128i result = _mm_cvtsi32_si128(samples);
+	result = _mm_unpacklo_epi8(result, result);
+	result = _mm_unpacklo_epi8(result, _mm_setzero_si128());
+	return _mm_sub_epi16(result, _mm_set1_epi16(CHROMA_OFFSET));
+}
+
+//Converts 8 horizontal pixels, components end up in 16-bit lanes
+static inline PIXELS ConvertPixels(const uint8* block, unsigned int row, unsigned int column, __m128i th0, __m128i th1)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i maxComponent = _mm_set1_epi16(255);
+	const __m128i weightR = MakeWeightPair(1 << RB_SHIFT, COEF_CR_R);
+	const __m128i weightB = MakeWeightPair(1 << RB_SHIFT, COEF_CB_B);
+	const __m128i weightG = MakeWeightPair(-COEF_CB_G, -COEF_CR_G);
+	const __m128i biasG = _mm_set1_epi32(G_BIAS);
+
+	unsigned int chromaIndex = GetChromaIndex(row, column);
+	__m128i y = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(block + (row * 16) + column)), zero);
+	__m128i cb = LoadChroma(block + CB_BLOCK_OFFSET + chromaIndex);
+	__m128i cr = LoadChroma(block + CR_BLOCK_OFFSET + chromaIndex);
+
+	__m128i rLo = _mm_srai_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(y, cr), weightR), RB_SHIFT);
+	__m128i rHi = _mm_srai_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(y, cr), weightR), RB_SHIFT);
+	__m128i bLo = _mm_srai_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(y, cb), weightB), RB_SHIFT);
+	__m128i bHi = _mm_srai_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(y, cb), weightB), RB_SHIFT);
+
+	__m128i gLo = _mm_slli_epi32(_mm_unpacklo_epi16(y, zero), G_SHIFT);
+	__m128i gHi = _mm_slli_epi32(_mm_unpackhi_epi16(y, zero), G_SHIFT);
+	gLo = _mm_add_epi32(gLo, _mm_madd_epi16(_mm_unpacklo_epi16(cb, cr), weightG));
+	gHi = _mm_add_epi32(gHi, _mm_madd_epi16(_mm_unpackhi_epi16(cb, cr), weightG));
+	gLo = _mm_srai_epi32(_mm_add_epi32(gLo, biasG), G_SHIFT);
+	gHi = _mm_srai_epi32(_mm_add_epi32(gHi, biasG), G_SHIFT);
+
+	PIXELS pixels;
+	pixels.r = _mm_min_epi16(_mm_max_epi16(_mm_packs_epi32(rLo, rHi), zero), maxComponent);
+	pixels.g = _mm_min_epi16(_mm_max_epi16(_mm_packs_epi32(gLo, gHi), zero), maxComponent);
+	pixels.b = _mm_min_epi16(_mm_max_epi16(_mm_packs_epi32(bLo, bHi), zero), maxComponent);
+
+	__m128i maxRgb = _mm_max_epi16(pixels.r, _mm_max_epi16(pixels.g, pixels.b));
+	__m128i belowTh0 = _mm_cmplt_epi16(maxRgb, th0);
+	__m128i belowTh1 = _mm_cmplt_epi16(maxRgb, th1);
+	__m128i alpha = _mm_or_si128(
+	    _mm_and_si128(belowTh1, _mm_set1_epi16(ALPHA_TH1)),
+	    _mm_andnot_si128(belowTh1, _mm_set1_epi16(ALPHA_OPAQUE)));
+	pixels.a = _mm_andnot_si128(belowTh0, alpha);
+
+	return pixels;
+}
+
+void Csc::ConvertRgba32(const uint8* block, uint32* output, uint16 th0, uint16 th1)
+{
+	__m128i th0Vector = _mm_set1_epi16(th0);
+	__m128i th1Vector = _mm_set1_epi16(th1);
+	for(unsigned int row = 0; row < 16; row++)
+	{
+		for(unsigned int column = 0; column < 16; column += 8)
+		{
+			auto pixels = ConvertPixels(block, row, column, th0Vector, th1Vector);
+			__m128i rg = _mm_or_si128(pixels.r, _mm_slli_epi16(pixels.g, 8));
+			__m128i ba = _mm_or_si128(pixels.b, _mm_slli_epi16(pixels.a, 8));
+			auto pixelOutput = reinterpret_cast<__m128i*>(output + (row * 16) + column);
+			_mm_storeu_si128(pixelOutput + 0, _mm_unpacklo_epi16(rg, ba));
+			_mm_storeu_si128(pixelOutput + 1, _mm_unpackhi_epi16(rg, ba));
+		}
+	}
+}
+
+void Csc::ConvertRgba16(const uint8* block, uint16* output, uint16 th0, uint16 th1, bool dither)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i maxComponent = _mm_set1_epi16(255);
+	__m128i th0Vector = _mm_set1_epi16(th0);
+	__m128i th1Vector = _mm_set1_epi16(th1);
+	for(unsigned int row = 0; row < 16; row++)
+	{
+		//Dither pattern repeats every 4 pixels, it's the same for both halves of a row
+		const auto& ditherRow = g_ditherMatrix[row & 3];
+		__m128i offset = _mm_setr_epi16(
+		    ditherRow[0], ditherRow[1], ditherRow[2], ditherRow[3],
+		    ditherRow[0], ditherRow[1], ditherRow[2], ditherRow[3]);
+		for(unsigned int column = 0; column < 16; column += 8)
+		{
+			auto pixels = ConvertPixels(block, row, column, th0Vector, th1Vector);
+			if(dither)
+			{
+				pixels.r = _mm_min_epi16(_mm_max_epi16(_mm_add_epi16(pixels.r, offset), zero), maxComponent);
+				pixels.g = _mm_min_epi16(_mm_max_epi16(_mm_add_epi16(pixels.g, offset), zero), maxComponent);
+				pixels.b = _mm_min_epi16(_mm_max_epi16(_mm_add_epi16(pixels.b, offset), zero), maxComponent);
+			}
+			__m128i result = _mm_srli_epi16(pixels.r, 3);
+			result = _mm_or_si128(result, _mm_slli_epi16(_mm_srli_epi16(pixels.g, 3), 5));
+			result = _mm_or_si128(result, _mm_slli_epi16(_mm_srli_epi16(pixels.b, 3), 10));
+			result = _mm_or_si128(result, _mm_slli_epi16(_mm_srli_epi16(pixels.a, 7), 15));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(output + (row * 16) + column), result);
+		}
+	}
+}
+
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+
+struct PIXELS
+{
+	int16x8_t r;
+	int16x8_t g;
+	int16x8_t b;
+	int16x8_t a;
+};
+
+static inline int16x8_t LoadChroma(const uint8* chroma)
+{
+	//Each chroma sample covers 2 horizontal pixels
+	uint32 samples = 0;
+	memcpy(&samples, chroma, sizeof(uint32));
+	uint8x8_t result = vreinterpret_u8_u32(vdup_n_u32(samples));
+	result = vzip_u8(result, result).val[0];
+	return vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(result)), vdupq_n_s16(CHROMA_OFFSET));
+}
+
+static inline int16x8_t ClampComponent(int32x4_t lo, int32x4_t hi)
+{
+	int16x8_t result = vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi));
+	return vminq_s16(vmaxq_s16(result, vdupq_n_s16(0)), vdupq_n_s16(255));
+}
+
+//Converts 8 horizontal pixels, components end up in 16-bit lanes
+static inline PIXELS ConvertPixels(const uint8* block, unsigned int row, unsigned int column, int16x8_t th0, int16x8_t th1)
+{
+	unsigned int chromaIndex = GetChromaIndex(row, column);
+	int16x8_t y = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(block + (row * 16) + column)));
+	int16x8_t cb = LoadChroma(block + CB_BLOCK_OFFSET + chromaIndex);
+	int16x8_t cr = LoadChroma(block + CR_BLOCK_OFFSET + chromaIndex);
+
+	int16x4_t yLo = vget_low_s16(y), yHi = vget_high_s16(y);
+	int16x4_t cbLo = vget_low_s16(cb), cbHi = vget_high_s16(cb);
+	int16x4_t crLo = vget_low_s16(cr), crHi = vget_high_s16(cr);
+
+	int32x4_t rLo = vshrq_n_s32(vmlal_n_s16(vshll_n_s16(yLo, RB_SHIFT), crLo, COEF_CR_R), RB_SHIFT);
+	int32x4_t rHi = vshrq_n_s32(vmlal_n_s16(vshll_n_s16(yHi, RB_SHIFT), crHi, COEF_CR_R), RB_SHIFT);
+	int32x4_t bLo = vshrq_n_s32(vmlal_n_s16(vshll_n_s16(yLo, RB_SHIFT), cbLo, COEF_CB_B), RB_SHIFT);
+	int32x4_t bHi = vshrq_n_s32(vmlal_n_s16(vshll_n_s16(yHi, RB_SHIFT), cbHi, COEF_CB_B), RB_SHIFT);
+
+	int32x4_t gLo = vaddq_s32(vshll_n_s16(yLo, G_SHIFT), vdupq_n_s32(G_BIAS));
+	int32x4_t gHi = vaddq_s32(vshll_n_s16(yHi, G_SHIFT), vdupq_n_s32(G_BIAS));
+	gLo = vmlsl_n_s16(vmlsl_n_s16(gLo, cbLo, COEF_CB_G), crLo, COEF_CR_G);
+	gHi = vmlsl_n_s16(vmlsl_n_s16(gHi, cbHi, COEF_CB_G), crHi, COEF_CR_G);
+	gLo = vshrq_n_s32(gLo, G_SHIFT);
+	gHi = vshrq_n_s32(gHi, G_SHIFT);
+
+	PIXELS pixels;
+	pixels.r = ClampComponent(rLo, rHi);
+	pixels.g = ClampComponent(gLo, gHi);
+	pixels.b = ClampComponent(bLo, bHi);
+
+	int16x8_t maxRgb = vmaxq_s16(pixels.r, vmaxq_s16(pixels.g, pixels.b));
+	uint16x8_t belowTh0 = vcltq_s16(maxRgb, th0);
+	uint16x8_t belowTh1 = vcltq_s16(maxRgb, th1);
+	int16x8_t alpha = vbslq_s16(belowTh1, vdupq_n_s16(ALPHA_TH1), vdupq_n_s16(ALPHA_OPAQUE));
+	pixels.a = vbicq_s16(alpha, vreinterpretq_s16_u16(belowTh0));
+
+	return pixels;
+}
+
+void Csc::ConvertRgba32(const uint8* block, uint32* output, uint16 th0, uint16 th1)
+{
+	int16x8_t th0Vector = vdupq_n_s16(th0);
+	int16x8_t th1Vector = vdupq_n_s16(th1);
+	for(unsigned int row = 0; row < 16; row++)
+	{
+		for(unsigned int column = 0; column < 16; column += 8)
+		{
+			auto pixels = ConvertPixels(block, row, column, th0Vector, th1Vector);
+			int16x8_t rg = vorrq_s16(pixels.r, vshlq_n_s16(pixels.g, 8));
+			int16x8_t ba = vorrq_s16(pixels.b, vshlq_n_s16(pixels.a, 8));
+			int16x8x2_t result = vzipq_s16(rg, ba);
+			auto pixelOutput = output + (row * 16) + column;
+			vst1q_u32(pixelOutput + 0, vreinterpretq_u32_s16(result.val[0]));
+			vst1q_u32(pixelOutput + 4, vreinterpretq_u32_s16(result.val[1]));
+		}
+	}
+}
+
+void Csc::ConvertRgba16(const uint8* block, uint16* output, uint16 th0, uint16 th1, bool dither)
+{
+	const int16x8_t zero = vdupq_n_s16(0);
+	const int16x8_t maxComponent = vdupq_n_s16(255);
+	int16x8_t th0Vector = vdupq_n_s16(th0);
+	int16x8_t th1Vector = vdupq_n_s16(th1);
+	for(unsigned int row = 0; row < 16; row++)
+	{
+		//Dither pattern repeats every 4 pixels, it's the same for both halves of a row
+		int16x4_t ditherRow = vld1_s16(g_ditherMatrix[row & 3]);
+		int16x8_t offset = vcombine_s16(ditherRow, ditherRow);
+		for(unsigned int column = 0; column < 16; column += 8)
+		{
+			auto pixels = ConvertPixels(block, row, column, th0Vector, th1Vector);
+			if(dither)
+			{
+				pixels.r = vminq_s16(vmaxq_s16(vaddq_s16(pixels.r, offset), zero), maxComponent);
+				pixels.g = vminq_s16(vmaxq_s16(vaddq_s16(pixels.g, offset), zero), maxComponent);
+				pixels.b = vminq_s16(vmaxq_s16(vaddq_s16(pixels.b, offset), zero), maxComponent);
+			}
+			uint16x8_t result = vshrq_n_u16(vreinterpretq_u16_s16(pixels.r), 3);
+			result = vorrq_u16(result, vshlq_n_u16(vshrq_n_u16(vreinterpretq_u16_s16(pixels.g), 3), 5));
+			result = vorrq_u16(result, vshlq_n_u16(vshrq_n_u16(vreinterpretq_u16_s16(pixels.b), 3), 10));
+			result = vorrq_u16(result, vshlq_n_u16(vshrq_n_u16(vreinterpretq_u16_s16(pixels.a), 7), 15));
+			vst1q_u16(output + (row * 16) + column, result);
+		}
+	}
+}
+
+#else
+
+void Csc::ConvertRgba32(const uint8* block, uint32* output, uint16 th0, uint16 th1)
+{
+	ConvertRgba32Scalar(block, output, th0, th1);
+}
+
+void Csc::ConvertRgba16(const uint8* block, uint16* output, uint16 th0, uint16 th1, bool dither)
+{
+	ConvertRgba16Scalar(block, output, th0, th1, dither);
+}
+
+#endif
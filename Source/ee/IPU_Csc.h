@@ -0,0 +1,24 @@
+#pragma once
+
+#include "Types.h"
+
+namespace IPU
+{
+	//Converts a 4:2:0 YCbCr macroblock (256 bytes of Y followed by 64 bytes of Cb
+	//and 64 bytes of Cr) to 16x16 RGBA pixels using fixed-point arithmetic.
+	//Alpha is set to 0, 0x40 or 0x80 depending on the TH0/TH1 thresholds.
+	namespace Csc
+	{
+		enum
+		{
+			BLOCK_SIZE = 0x180,
+			PIXEL_COUNT = 0x100,
+		};
+
+		void ConvertRgba32(const uint8*, uint32*, uint16, uint16);
+		void ConvertRgba16(const uint8*, uint16*, uint16, uint16, bool);
+
+		void ConvertRgba32Scalar(const uint8*, uint32*, uint16, uint16);
+		void ConvertRgba16Scalar(const uint8*, uint16*, uint16, uint16, bool);
+	}
+}
@@ -0,0 +1,347 @@
+#include <algorithm>
+#include "IPU_Idct.h"
+#include "SimdDefs.h"
+
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+#include <emmintrin.h>
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+#include <arm_neon.h>
+#endif
+
+//Weights are cos(k * pi / 16) * sqrt(2) * (1 << 14)
+#define W1 (22725)
+#define W2 (21407)
+#define W3 (19266)
+#define W4 (16384)
+#define W5 (12873)
+#define W6 (8867)
+#define W7 (4520)
+
+#define ROW_SHIFT (11)
+#define COL_SHIFT (20)
+
+#define OUTPUT_MIN (-256)
+#define OUTPUT_MAX (255)
+
+using namespace IPU;
+
+//Sums are computed on 33 bits: both halves of a butterfly fit in 32 bits, but their sum
+//might not. SIMD versions use halving adds to get the same result without overflowing.
+
+static void Transform1DScalar(const int32* input, int32* output, unsigned int shift)
+{
+	int64 rounding = (1 << (shift - 1));
+
+	int64 a0 = (W4 * input[0]) + (W2 * input[2]) + (W4 * input[4]) + (W6 * input[6]) + rounding;
+	int64 a1 = (W4 * input[0]) + (W6 * input[2]) - (W4 * input[4]) - (W2 * input[6]) + rounding;
+	int64 a2 = (W4 * input[0]) - (W6 * input[2]) - (W4 * input[4]) + (W2 * input[6]) + rounding;
+	int64 a3 = (W4 * input[0]) - (W2 * input[2]) + (W4 * input[4]) - (W6 * input[6]) + rounding;
+
+	int64 b0 = (W1 * input[1]) + (W3 * input[3]) + (W5 * input[5]) + (W7 * input[7]);
+	int64 b1 = (W3 * input[1]) - (W7 * input[3]) - (W1 * input[5]) - (W5 * input[7]);
+	int64 b2 = (W5 * input[1]) - (W1 * input[3]) + (W7 * input[5]) + (W3 * input[7]);
+	int64 b3 = (W7 * input[1]) - (W5 * input[3]) + (W3 * input[5]) - (W1 * input[7]);
+
+	output[0] = static_cast<int32>((a0 + b0) >> shift);
+	output[1] = static_cast<int32>((a1 + b1) >> shift);
+	output[2] = static_cast<int32>((a2 + b2) >> shift);
+	output[3] = static_cast<int32>((a3 + b3) >> shift);
+	output[4] = static_cast<int32>((a3 - b3) >> shift);
+	output[5] = static_cast<int32>((a2 - b2) >> shift);
+	output[6] = static_cast<int32>((a1 - b1) >> shift);
+	output[7] = static_cast<int32>((a0 - b0) >> shift);
+}
+
+void Idct::TransformScalar(const int16* input, int16* output)
+{
+	int16 temp[0x40];
+
+	for(unsigned int y = 0; y < 8; y++)
+	{
+		int32 row[8];
+		int32 result[8];
+		for(unsigned int x = 0; x < 8; x++)
+		{
+			row[x] = input[(y * 8) + x];
+		}
+		Transform1DScalar(row, result, ROW_SHIFT);
+		for(unsigned int x = 0; x < 8; x++)
+		{
+			//Intermediate values are saturated to 16 bits like the SIMD versions do
+			temp[(y * 8) + x] = static_cast<int16>(std::clamp<int32>(result[x], INT16_MIN, INT16_MAX));
+		}
+	}
+
+	for(unsigned int x = 0; x < 8; x++)
+	{
+		int32 column[8];
+		int32 result[8];
+		for(unsigned int y = 0; y < 8; y++)
+		{
+			column[y] = temp[(y * 8) + x];
+		}
+		Transform1DScalar(column, result, COL_SHIFT);
+		for(unsigned int y = 0; y < 8; y++)
+		{
+			output[(y * 8) + x] = static_cast<int16>(std::clamp<int32>(result[y], OUTPUT_MIN, OUTPUT_MAX));
+		}
+	}
+}
+
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+
+static void Transpose8x8(__m128i* rows)
+{
+	__m128i a0 = _mm_unpacklo_epi16(rows[0], rows[1]);
+	__m128i a1 = _mm_unpackhi_epi16(rows[0], rows[1]);
+	__m128i a2 = _mm_unpacklo_epi16(rows[2], rows[3]);
+	__m128i a3 = _mm_unpackhi_epi16(rows[2], rows[3]);
+	__m128i a4 = _mm_unpacklo_epi16(rows[4], rows[5]);
+	__m128i a5 = _mm_unpackhi_epi16(rows[4], rows[5]);
+	__m128i a6 = _mm_unpacklo_epi16(rows[6], rows[7]);
+	__m128i a7 = _mm_unpackhi_epi16(rows[6], rows[7]);
+
+	__m128i b0 = _mm_unpacklo_epi32(a0, a2);
+	__m128i b1 = _mm_unpackhi_epi32(a0, a2);
+	__m128i b2 = _mm_unpacklo_epi32(a1, a3);
+	__m128i b3 = _mm_unpackhi_epi32(a1, a3);
+	__m128i b4 = _mm_unpacklo_epi32(a4, a6);
+	__m128i b5 = _mm_unpackhi_epi32(a4, a6);
+	__m128i b6 = _mm_unpacklo_epi32(a5, a7);
+	__m128i b7 = _mm_unpackhi_epi32(a5, a7);
+
+	rows[0] = _mm_unpacklo_epi64(b0, b4);
+	rows[1] = _mm_unpackhi_epi64(b0, b4);
+	rows[2] = _mm_unpacklo_epi64(b1, b5);
+	rows[3] = _mm_unpackhi_epi64(b1, b5);
+	rows[4] = _mm_unpacklo_epi64(b2, b6);
+	rows[5] = _mm_unpackhi_epi64(b2, b6);
+	rows[6] = _mm_unpacklo_epi64(b3, b7);
+	rows[7] = _mm_unpackhi_epi64(b3, b7);
+}
+
+//Computes (a + b) >> 1 without overflowing
+static inline __m128i HalvingAdd(__m128i a, __m128i b)
+{
+	__m128i carry = _mm_and_si128(_mm_and_si128(a, b), _mm_set1_epi32(1));
+	return _mm_add_epi32(_mm_add_epi32(_mm_srai_epi32(a, 1), _mm_srai_epi32(b, 1)), carry);
+}
+
+static inline __m128i MakeWeightPair(int16 w0, int16 w1)
+{
+	return _mm_set1_epi32(static_cast<uint16>(w0) | (static_cast<uint32>(static_cast<uint16>(w1)) << 16));
+}
+
+//Transforms 8 independent vectors at once, one per 16-bit lane. Products of interleaved
+//input pairs are summed in 32 bits with pmaddwd, then packed back to 16 bits with saturation.
+template <unsigned int shift>
+static void Transform1D(__m128i* values)
+{
+	const __m128i w4w4 = MakeWeightPair(W4, W4);
+	const __m128i w4nw4 = MakeWeightPair(W4, -W4);
+	const __m128i w2w6 = MakeWeightPair(W2, W6);
+	const __m128i w6nw2 = MakeWeightPair(W6, -W2);
+	const __m128i w1w3 = MakeWeightPair(W1, W3);
+	const __m128i w5w7 = MakeWeightPair(W5, W7);
+	const __m128i w3nw7 = MakeWeightPair(W3, -W7);
+	const __m128i nw1nw5 = MakeWeightPair(-W1, -W5);
+	const __m128i w5nw1 = MakeWeightPair(W5, -W1);
+	const __m128i w7w3 = MakeWeightPair(W7, W3);
+	const __m128i w7nw5 = MakeWeightPair(W7, -W5);
+	const __m128i w3nw1 = MakeWeightPair(W3, -W1);
+	const __m128i rounding = _mm_set1_epi32(1 << (shift - 1));
+
+	__m128i result[2][8];
+	for(unsigned int half = 0; half < 2; half++)
+	{
+		__m128i x04, x26, x13, x57;
+		if(half == 0)
+		{
+			x04 = _mm_unpacklo_epi16(values[0], values[4]);
+			x26 = _mm_unpacklo_epi16(values[2], values[6]);
+			x13 = _mm_unpacklo_epi16(values[1], values[3]);
+			x57 = _mm_unpacklo_epi16(values[5], values[7]);
+		}
+		else
+		{
+			x04 = _mm_unpackhi_epi16(values[0], values[4]);
+			x26 = _mm_unpackhi_epi16(values[2], values[6]);
+			x13 = _mm_unpackhi_epi16(values[1], values[3]);
+			x57 = _mm_unpackhi_epi16(values[5], values[7]);
+		}
+
+		__m128i e0 = _mm_add_epi32(_mm_madd_epi16(x04, w4w4), rounding);
+		__m128i e1 = _mm_add_epi32(_mm_madd_epi16(x04, w4nw4), rounding);
+		__m128i e2 = _mm_madd_epi16(x26, w2w6);
+		__m128i e3 = _mm_madd_epi16(x26, w6nw2);
+
+		__m128i a0 = _mm_add_epi32(e0, e2);
+		__m128i a1 = _mm_add_epi32(e1, e3);
+		__m128i a2 = _mm_sub_epi32(e1, e3);
+		__m128i a3 = _mm_sub_epi32(e0, e2);
+
+		__m128i b0 = _mm_add_epi32(_mm_madd_epi16(x13, w1w3), _mm_madd_epi16(x57, w5w7));
+		__m128i b1 = _mm_add_epi32(_mm_madd_epi16(x13, w3nw7), _mm_madd_epi16(x57, nw1nw5));
+		__m128i b2 = _mm_add_epi32(_mm_madd_epi16(x13, w5nw1), _mm_madd_epi16(x57, w7w3));
+		__m128i b3 = _mm_add_epi32(_mm_madd_epi16(x13, w7nw5), _mm_madd_epi16(x57, w3nw1));
+
+		__m128i nb0 = _mm_sub_epi32(_mm_setzero_si128(), b0);
+		__m128i nb1 = _mm_sub_epi32(_mm_setzero_si128(), b1);
+		__m128i nb2 = _mm_sub_epi32(_mm_setzero_si128(), b2);
+		__m128i nb3 = _mm_sub_epi32(_mm_setzero_si128(), b3);
+
+		result[half][0] = _mm_srai_epi32(HalvingAdd(a0, b0), shift - 1);
+		result[half][1] = _mm_srai_epi32(HalvingAdd(a1, b1), shift - 1);
+		result[half][2] = _mm_srai_epi32(HalvingAdd(a2, b2), shift - 1);
+		result[half][3] = _mm_srai_epi32(HalvingAdd(a3, b3), shift - 1);
+		result[half][4] = _mm_srai_epi32(HalvingAdd(a3, nb3), shift - 1);
+		result[half][5] = _mm_srai_epi32(HalvingAdd(a2, nb2), shift - 1);
+		result[half][6] = _mm_srai_epi32(HalvingAdd(a1, nb1), shift - 1);
+		result[half][7] = _mm_srai_epi32(HalvingAdd(a0, nb0), shift - 1);
+	}
+
+	for(unsigned int i = 0; i < 8; i++)
+	{
+		values[i] = _mm_packs_epi32(result[0][i], result[1][i]);
+	}
+}
+
+void Idct::Transform(const int16* input, int16* output)
+{
+	__m128i values[8];
+	for(unsigned int i = 0; i < 8; i++)
+	{
+		values[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + (i * 8)));
+	}
+
+	Transpose8x8(values);
+	Transform1D<ROW_SHIFT>(values);
+	Transpose8x8(values);
+	Transform1D<COL_SHIFT>(values);
+
+	const __m128i outputMin = _mm_set1_epi16(OUTPUT_MIN);
+	const __m128i outputMax = _mm_set1_epi16(OUTPUT_MAX);
+	for(unsigned int i = 0; i < 8; i++)
+	{
+		__m128i value = _mm_min_epi16(_mm_max_epi16(values[i], outputMin), outputMax);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output + (i * 8)), value);
+	}
+}
+
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+
+static void Transpose8x8(int16x8_t* rows)
+{
+	int16x8x2_t a0 = vtrnq_s16(rows[0], rows[1]);
+	int16x8x2_t a1 = vtrnq_s16(rows[2], rows[3]);
+	int16x8x2_t a2 = vtrnq_s16(rows[4], rows[5]);
+	int16x8x2_t a3 = vtrnq_s16(rows[6], rows[7]);
+
+	int32x4x2_t b0 = vtrnq_s32(vreinterpretq_s32_s16(a0.val[0]), vreinterpretq_s32_s16(a1.val[0]));
+	int32x4x2_t b1 = vtrnq_s32(vreinterpretq_s32_s16(a0.val[1]), vreinterpretq_s32_s16(a1.val[1]));
+	int32x4x2_t b2 = vtrnq_s32(vreinterpretq_s32_s16(a2.val[0]), vreinterpretq_s32_s16(a3.val[0]));
+	int32x4x2_t b3 = vtrnq_s32(vreinterpretq_s32_s16(a2.val[1]), vreinterpretq_s32_s16(a3.val[1]));
+
+	rows[0] = vreinterpretq_s16_s32(vcombine_s32(vget_low_s32(b0.val[0]), vget_low_s32(b2.val[0])));
+	rows[1] = vreinterpretq_s16_s32(vcombine_s32(vget_low_s32(b1.val[0]), vget_low_s32(b3.val[0])));
+	rows[2] = vreinterpretq_s16_s32(vcombine_s32(vget_low_s32(b0.val[1]), vget_low_s32(b2.val[1])));
+	rows[3] = vreinterpretq_s16_s32(vcombine_s32(vget_low_s32(b1.val[1]), vget_low_s32(b3.val[1])));
+	rows[4] = vreinterpretq_s16_s32(vcombine_s32(vget_high_s32(b0.val[0]), vget_high_s32(b2.val[0])));
+	rows[5] = vreinterpretq_s16_s32(vcombine_s32(vget_high_s32(b1.val[0]), vget_high_s32(b3.val[0])));
+	rows[6] = vreinterpretq_s16_s32(vcombine_s32(vget_high_s32(b0.val[1]), vget_high_s32(b2.val[1])));
+	rows[7] = vreinterpretq_s16_s32(vcombine_s32(vget_high_s32(b1.val[1]), vget_high_s32(b3.val[1])));
+}
+
+//Transforms 8 independent vectors at once, one per 16-bit lane. Products are
+//accumulated in 32 bits, then narrowed back to 16 bits with saturation.
+template <unsigned int shift>
+static void Transform1D(int16x8_t* values)
+{
+	const int32x4_t rounding = vdupq_n_s32(1 << (shift - 1));
+
+	int32x4_t result[2][8];
+	for(unsigned int half = 0; half < 2; half++)
+	{
+		int16x4_t x[8];
+		for(unsigned int i = 0; i < 8; i++)
+		{
+			x[i] = (half == 0) ? vget_low_s16(values[i]) : vget_high_s16(values[i]);
+		}
+
+		int32x4_t e0 = vmlal_n_s16(rounding, x[0], W4);
+		e0 = vmlal_n_s16(e0, x[4], W4);
+		int32x4_t e1 = vmlal_n_s16(rounding, x[0], W4);
+		e1 = vmlsl_n_s16(e1, x[4], W4);
+		int32x4_t e2 = vmlal_n_s16(vmull_n_s16(x[2], W2), x[6], W6);
+		int32x4_t e3 = vmlsl_n_s16(vmull_n_s16(x[2], W6), x[6], W2);
+
+		int32x4_t a0 = vaddq_s32(e0, e2);
+		int32x4_t a1 = vaddq_s32(e1, e3);
+		int32x4_t a2 = vsubq_s32(e1, e3);
+		int32x4_t a3 = vsubq_s32(e0, e2);
+
+		int32x4_t b0 = vmull_n_s16(x[1], W1);
+		b0 = vmlal_n_s16(b0, x[3], W3);
+		b0 = vmlal_n_s16(b0, x[5], W5);
+		b0 = vmlal_n_s16(b0, x[7], W7);
+
+		int32x4_t b1 = vmull_n_s16(x[1], W3);
+		b1 = vmlsl_n_s16(b1, x[3], W7);
+		b1 = vmlsl_n_s16(b1, x[5], W1);
+		b1 = vmlsl_n_s16(b1, x[7], W5);
+
+		int32x4_t b2 = vmull_n_s16(x[1], W5);
+		b2 = vmlsl_n_s16(b2, x[3], W1);
+		b2 = vmlal_n_s16(b2, x[5], W7);
+		b2 = vmlal_n_s16(b2, x[7], W3);
+
+		int32x4_t b3 = vmull_n_s16(x[1], W7);
+		b3 = vmlsl_n_s16(b3, x[3], W5);
+		b3 = vmlal_n_s16(b3, x[5], W3);
+		b3 = vmlsl_n_s16(b3, x[7], W1);
+
+		result[half][0] = vshrq_n_s32(vhaddq_s32(a0, b0), shift - 1);
+		result[half][1] = vshrq_n_s32(vhaddq_s32(a1, b1), shift - 1);
+		result[half][2] = vshrq_n_s32(vhaddq_s32(a2, b2), shift - 1);
+		result[half][3] = vshrq_n_s32(vhaddq_s32(a3, b3), shift - 1);
+		result[half][4] = vshrq_n_s32(vhsubq_s32(a3, b3), shift - 1);
+		result[half][5] = vshrq_n_s32(vhsubq_s32(a2, b2), shift - 1);
+		result[half][6] = vshrq_n_s32(vhsubq_s32(a1, b1), shift - 1);
+		result[half][7] = vshrq_n_s32(vhsubq_s32(a0, b0), shift - 1);
+	}
+
+	for(unsigned int i = 0; i < 8; i++)
+	{
+		values[i] = vcombine_s16(vqmovn_s32(result[0][i]), vqmovn_s32(result[1][i]));
+	}
+}
+
+void Idct::Transform(const int16* input, int16* output)
+{
+	int16x8_t values[8];
+	for(unsigned int i = 0; i < 8; i++)
+	{
+		values[i] = vld1q_s16(input + (i * 8));
+	}
+
+	Transpose8x8(values);
+	Transform1D<ROW_SHIFT>(values);
+	Transpose8x8(values);
+	Transform1D<COL_SHIFT>(values);
+
+	const int16x8_t outputMin = vdupq_n_s16(OUTPUT_MIN);
+	const int16x8_t outputMax = vdupq_n_s16(OUTPUT_MAX);
+	for(unsigned int i = 0; i < 8; i++)
+	{
+		vst1q_s16(output + (i * 8), vminq_s16(vmaxq_s16(values[i], outputMin), outputMax));
+	}
+}
+
+#else
+
+void Idct::Transform(const int16* input, int16* output)
+{
+	TransformScalar(input, output);
+}
+
+#endif
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "Types.h"
+
+namespace IPU
+{
+	//Fixed-point 8x8 inverse DCT. Rows are transformed first with 3 fractional bits kept
+	//for the column pass, which is enough to meet the IEEE 1180 accuracy requirements.
+	//Output is clamped to [-256, 255] like the reference transform.
+	namespace Idct
+	{
+		void Transform(const int16*, int16*);
+		void TransformScalar(const int16*, int16*);
+	}
+}
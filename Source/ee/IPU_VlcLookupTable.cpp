@@ -0,0 +1,175 @@
+#include "IPU_VlcLookupTable.h"
+
+using namespace IPU;
+using namespace MPEG2;
+
+//Bit stream only exposing a fixed number of bits, decoders fail if they need more than that
+class CProbeBitStream : public Framework::CBitStream
+{
+public:
+	CProbeBitStream(uint32 bits, uint8 bitCount)
+	    : m_bits(bits)
+	    , m_bitCount(bitCount)
+	{
+	}
+
+	void Advance(uint8 bits) override
+	{
+		if((m_position + bits) > m_bitCount)
+		{
+			m_overrun = true;
+			return;
+		}
+		m_position += bits;
+	}
+
+	uint8 GetBitIndex() const override
+	{
+		return m_position;
+	}
+
+	bool TryPeekBits_LSBF(uint8, uint32&) override
+	{
+		return false;
+	}
+
+	bool TryPeekBits_MSBF(uint8 size, uint32& result) override
+	{
+		if((m_position + size) > m_bitCount)
+		{
+			return false;
+		}
+		uint64 mask = (1ULL << size) - 1;
+		result = static_cast<uint32>((static_cast<uint64>(m_bits) >> (m_bitCount - m_position - size)) & mask);
+		return true;
+	}
+
+	//Number of bits consumed, 0 if the decoder tried to go past the available bits
+	uint8 GetConsumedBits() const
+	{
+		return m_overrun ? 0 : m_position;
+	}
+
+private:
+	uint32 m_bits = 0;
+	uint8 m_bitCount = 0;
+	uint8 m_position = 0;
+	bool m_overrun = false;
+};
+
+/////////////////////////////////////////////
+//VLC lookup table
+/////////////////////////////////////////////
+
+CVlcLookupTable::CVlcLookupTable(CVLCTable* table)
+    : m_table(table)
+    , m_entries(1 << LOOKUP_BITS)
+{
+	for(uint32 bits = 0; bits < m_entries.size(); bits++)
+	{
+		try
+		{
+			CProbeBitStream stream(bits, LOOKUP_BITS);
+			uint32 value = 0;
+			if(m_table->TryGetSymbol(&stream, value) != CVLCTable::DECODE_STATUS_SUCCESS) continue;
+
+			auto& entry = m_entries[bits];
+			entry.value = value;
+			entry.length = stream.GetConsumedBits();
+		}
+		catch(...)
+		{
+			//Leave it to the original table
+		}
+	}
+}
+
+CVLCTable::DECODE_STATUS CVlcLookupTable::TryGetSymbol(Framework::CBitStream* stream, uint32& result) const
+{
+	uint32 bits = 0;
+	if(stream->TryPeekBits_MSBF(LOOKUP_BITS, bits))
+	{
+		const auto& entry = m_entries[bits];
+		if(entry.length != 0)
+		{
+			stream->Advance(entry.length);
+			result = entry.value;
+			return CVLCTable::DECODE_STATUS_SUCCESS;
+		}
+	}
+	return m_table->TryGetSymbol(stream, result);
+}
+
+uint32 CVlcLookupTable::GetSymbol(Framework::CBitStream* stream) const
+{
+	uint32 bits = 0;
+	if(stream->TryPeekBits_MSBF(LOOKUP_BITS, bits))
+	{
+		const auto& entry = m_entries[bits];
+		if(entry.length != 0)
+		{
+			stream->Advance(entry.length);
+			return entry.value;
+		}
+	}
+	return m_table->GetSymbol(stream);
+}
+
+/////////////////////////////////////////////
+//DCT coefficient lookup table
+/////////////////////////////////////////////
+
+CDctCoefficientLookupTable::CDctCoefficientLookupTable(CDctCoefficientTable& table)
+{
+	for(unsigned int variant = 0; variant < VARIANT_MAX; variant++)
+	{
+		bool isFirst = (variant == VARIANT_FIRST) || (variant == VARIANT_FIRST_MPEG2);
+		bool isMpeg2 = (variant == VARIANT_FIRST_MPEG2) || (variant == VARIANT_NEXT_MPEG2);
+
+		auto& entries = m_entries[variant];
+		entries.resize(1 << LOOKUP_BITS);
+		for(uint32 bits = 0; bits < entries.size(); bits++)
+		{
+			auto& entry = entries[bits];
+			try
+			{
+				//End of block can't happen on the first coefficient
+				if(!isFirst)
+				{
+					CProbeBitStream stream(bits, LOOKUP_BITS);
+					bool isEob = false;
+					if(table.TryIsEndOfBlock(&stream, isEob) != CVLCTable::DECODE_STATUS_SUCCESS) continue;
+					if(isEob)
+					{
+						CProbeBitStream skipStream(bits, LOOKUP_BITS);
+						if(table.TrySkipEndOfBlock(&skipStream) != CVLCTable::DECODE_STATUS_SUCCESS) continue;
+						entry.isEob = true;
+						entry.length = skipStream.GetConsumedBits();
+						continue;
+					}
+				}
+
+				CProbeBitStream stream(bits, LOOKUP_BITS);
+				RUNLEVELPAIR runLevelPair;
+				auto result = isFirst ? table.TryGetRunLevelPairDc(&stream, &runLevelPair, isMpeg2) : table.TryGetRunLevelPair(&stream, &runLevelPair, isMpeg2);
+				if(result != CVLCTable::DECODE_STATUS_SUCCESS) continue;
+
+				//Codes this short are never escapes, runs always fit in the entry
+				if(runLevelPair.run > 0xFF) continue;
+				entry.run = static_cast<uint8>(runLevelPair.run);
+				entry.level = static_cast<int16>(runLevelPair.level);
+				entry.length = stream.GetConsumedBits();
+			}
+			catch(...)
+			{
+				entry = ENTRY();
+			}
+		}
+	}
+}
+
+const CDctCoefficientLookupTable::ENTRY& CDctCoefficientLookupTable::GetEntry(uint32 bits, bool isFirst, bool isMpeg2) const
+{
+	unsigned int variant = isFirst ? (isMpeg2 ? VARIANT_FIRST_MPEG2 : VARIANT_FIRST) : (isMpeg2 ? VARIANT_NEXT_MPEG2 : VARIANT_NEXT);
+	return m_entries[variant][bits];
+}
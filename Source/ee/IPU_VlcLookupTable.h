@@ -0,0 +1,85 @@
+#pragma once
+
+#include <vector>
+#include "BitStream.h"
+#include "mpeg2/VLCTable.h"
+#include "mpeg2/DctCoefficientTable.h"
+
+namespace IPU
+{
+	//Single lookup decoders built on top of the bit-by-bit VLC tables. Every possible
+	//LOOKUP_BITS prefix is run once through the original table when the lookup table
+	//is built; codes that can't be resolved from the prefix alone (long codes, escapes
+	//and invalid codes) are left to the original table at decode time.
+	class CVlcLookupTable
+	{
+	public:
+		enum
+		{
+			LOOKUP_BITS = 10,
+		};
+
+		CVlcLookupTable(MPEG2::CVLCTable*);
+
+		template <typename TableType>
+		static CVlcLookupTable& GetInstance()
+		{
+			static CVlcLookupTable instance(TableType::GetInstance());
+			return instance;
+		}
+
+		MPEG2::CVLCTable::DECODE_STATUS TryGetSymbol(Framework::CBitStream*, uint32&) const;
+		uint32 GetSymbol(Framework::CBitStream*) const;
+
+	private:
+		struct ENTRY
+		{
+			uint32 value = 0;
+			uint8 length = 0;
+		};
+
+		MPEG2::CVLCTable* m_table = nullptr;
+		std::vector<ENTRY> m_entries;
+	};
+
+	class CDctCoefficientLookupTable
+	{
+	public:
+		enum
+		{
+			LOOKUP_BITS = 10,
+		};
+
+		struct ENTRY
+		{
+			int16 level = 0;
+			uint8 run = 0;
+			uint8 length = 0;
+			bool isEob = false;
+		};
+
+		CDctCoefficientLookupTable(MPEG2::CDctCoefficientTable&);
+
+		template <typename TableType>
+		static CDctCoefficientLookupTable& GetInstance()
+		{
+			static CDctCoefficientLookupTable instance(TableType::GetInstance());
+			return instance;
+		}
+
+		//An entry with a length of 0 needs to be decoded with the original table
+		const ENTRY& GetEntry(uint32, bool, bool) const;
+
+	private:
+		enum VARIANT
+		{
+			VARIANT_FIRST,
+			VARIANT_FIRST_MPEG2,
+			VARIANT_NEXT,
+			VARIANT_NEXT_MPEG2,
+			VARIANT_MAX,
+		};
+
+		std::vector<ENTRY> m_entries[VARIANT_MAX];
+	};
+}
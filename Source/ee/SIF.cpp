@@ -14,6 +14,7 @@
 #define SIF_RESETADDR 0 //Only works if equals to 0
 
 #define SIF_BIND_TIMEOUT_TICKS 0x10000
+#define PACKETQUEUE_COMPACT_SIZE 0x10000
 
 #define LOG_NAME ("sif")
 
@@ -81,6 +82,7 @@ void CSIF::Reset()
 	m_cmdBufferSize = 0;
 
 	m_packetQueue.clear();
+	m_packetQueueHead = 0;
 	m_packetProcessed = true;
 
 	m_callReplies.clear();
@@ -249,28 +251,39 @@ void CSIF::SendPacket(const void* packet, uint32 size)
 
 void CSIF::SendPacketToAddress(const void* packet, uint32 size, uint32 dstAddr)
 {
-	m_packetQueue.insert(m_packetQueue.end(),
-	                     reinterpret_cast<const uint8*>(&size),
-	                     reinterpret_cast<const uint8*>(&size) + 4);
-	m_packetQueue.insert(m_packetQueue.end(),
-	                     reinterpret_cast<const uint8*>(&dstAddr),
-	                     reinterpret_cast<const uint8*>(&dstAddr) + 4);
-	m_packetQueue.insert(m_packetQueue.end(),
-	                     reinterpret_cast<const uint8*>(packet),
-	                     reinterpret_cast<const uint8*>(packet) + size);
+	//Reclaim the space used by packets already sent if the queue never got a chance to drain
+	if(m_packetQueueHead >= PACKETQUEUE_COMPACT_SIZE)
+	{
+		m_packetQueue.erase(m_packetQueue.begin(), m_packetQueue.begin() + m_packetQueueHead);
+		m_packetQueueHead = 0;
+	}
+
+	size_t offset = m_packetQueue.size();
+	m_packetQueue.resize(offset + 8 + size);
+	auto entry = m_packetQueue.data() + offset;
+	memcpy(entry + 0, &size, 4);
+	memcpy(entry + 4, &dstAddr, 4);
+	memcpy(entry + 8, packet, size);
 }
 
 void CSIF::CountTicks(uint32 ticks)
 {
 	CheckPendingBindRequests(ticks);
 
-	if(m_packetProcessed && !m_packetQueue.empty())
+	if(m_packetProcessed && (m_packetQueueHead != m_packetQueue.size()))
 	{
-		assert(m_packetQueue.size() > 8);
-		uint32 size = *reinterpret_cast<uint32*>(&m_packetQueue[0]);
-		uint32 dstAddr = *reinterpret_cast<uint32*>(&m_packetQueue[4]);
-		SendDMA(&m_packetQueue[8], dstAddr, size);
-		m_packetQueue.erase(m_packetQueue.begin(), m_packetQueue.begin() + 8 + size);
+		assert((m_packetQueue.size() - m_packetQueueHead) > 8);
+		auto entry = m_packetQueue.data() + m_packetQueueHead;
+		uint32 size = *reinterpret_cast<const uint32*>(entry + 0);
+		uint32 dstAddr = *reinterpret_cast<const uint32*>(entry + 4);
+		SendDMA(entry + 8, dstAddr, size);
+		m_packetQueueHead += 8 + size;
+		if(m_packetQueueHead == m_packetQueue.size())
+		{
+			//Everything was sent, rewind while keeping the storage around for the next replies
+			m_packetQueue.clear();
+			m_packetQueueHead = 0;
+		}
 		m_packetProcessed = false;
 	}
 }
@@ -305,6 +318,7 @@ void CSIF::LoadState(Framework::CZipArchiveReader& archive)
 	}
 
 	m_packetQueue = LoadPacketQueue(archive);
+	m_packetQueueHead = 0;
 
 	m_callReplies = LoadCallReplies(archive);
 	m_bindReplies = LoadBindReplies(archive);
@@ -324,7 +338,8 @@ void CSIF::SaveState(Framework::CZipArchiveWriter& archive)
 		archive.InsertFile(std::move(registerFile));
 	}
 
-	archive.InsertFile(std::make_unique<CMemoryStateFile>(STATE_PACKETQUEUE, m_packetQueue.data(), m_packetQueue.size()));
+	archive.InsertFile(std::make_unique<CMemoryStateFile>(STATE_PACKETQUEUE,
+	                                                     m_packetQueue.data() + m_packetQueueHead, m_packetQueue.size() - m_packetQueueHead));
 
 	SaveCallReplies(archive);
 	SaveBindReplies(archive);
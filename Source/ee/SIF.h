@@ -108,6 +108,7 @@ private:
 	ModuleMap m_modules;
 
 	PacketQueue m_packetQueue;
+	uint32 m_packetQueueHead = 0;
 	bool m_packetProcessed;
 
 	CallReplyMap m_callReplies;
@@ -717,6 +717,24 @@ uint32 CVif::GetColMaskOp(unsigned int col) const
 	return (m_MASK >> (col * 8)) & 0xFF;
 }
 
+void CVif::UpdateUnpackMaskOps()
+{
+	for(unsigned int col = 0; col < 4; col++)
+	{
+		uint32 colMask = GetColMaskOp(col);
+		for(unsigned int i = 0; i < 4; i++)
+		{
+			uint32 maskOp = (colMask >> (i * 2)) & 0x3;
+			for(unsigned int op = 0; op < 4; op++)
+			{
+				m_unpackMaskOps.lanes[col][op][i] = (maskOp == op) ? ~0U : 0;
+			}
+		}
+	}
+	m_unpackMaskOpsKey = m_MASK;
+	m_unpackMaskOpsValid = true;
+}
+
 void CVif::PrepareMicroProgram()
 {
 	m_ITOP = m_ITOPS;
@@ -1051,6 +1069,27 @@ void CVif::CFifoStream::Advance(uint32 size)
 	}
 }
 
+void CVif::CFifoStream::Skip(uint32 size)
+{
+	assert(size <= GetDirectReadableBytes());
+	uint32 position = (m_bufferPosition == BUFFERSIZE) ? m_nextAddress : (m_nextAddress - BUFFERSIZE + m_bufferPosition);
+	position += size;
+	uint32 qwordAddress = position & ~(BUFFERSIZE - 1);
+	m_bufferPosition = position - qwordAddress;
+	if(m_bufferPosition == 0)
+	{
+		m_nextAddress = qwordAddress;
+		m_bufferPosition = BUFFERSIZE;
+	}
+	else
+	{
+		//Keep the rest of the qword in the buffer, as if it was read normally
+		assert(qwordAddress < m_endAddress);
+		m_buffer = *reinterpret_cast<uint128*>(&m_source[qwordAddress]);
+		m_nextAddress = qwordAddress + BUFFERSIZE;
+	}
+}
+
 uint128 CVif::CFifoStream::GetBuffer() const
 {
 	return m_buffer;
@@ -11,8 +11,10 @@
 #include "zip/ZipArchiveReader.h"
 #include "SimdDefs.h"
 
-#ifdef FRAMEWORK_SIMD_USE_SSE
+#if defined(FRAMEWORK_SIMD_USE_SSE)
 #include <emmintrin.h>
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+#include <arm_neon.h>
 #endif
 
 #ifdef _MSC_VER
@@ -211,6 +213,19 @@ protected:
 		uint8* GetDirectPointer() const;
 		void Advance(uint32);
 
+		//Returns the amount of bytes that can be read in place from GetDirectPointer
+		inline uint32 GetDirectReadableBytes() const
+		{
+			if(m_tagIncluded) return 0;
+			if(m_bufferPosition == BUFFERSIZE) return GetRemainingDmaTransferSize();
+			//Buffer might still contain data from a previous transfer
+			if((m_nextAddress - m_startAddress) < BUFFERSIZE) return 0;
+			return GetAvailableReadBytes();
+		}
+
+		//Skips bytes that were read in place, size doesn't need to be a multiple of a qword
+		void Skip(uint32);
+
 		uint128 GetBuffer() const;
 		void SetBuffer(uint128);
 
@@ -330,6 +345,23 @@ protected:
 
 	inline uint32 GetColMaskOp(unsigned int) const;
 
+	//Lane selection masks derived from MASK, indexed by column, MASKOP and lane
+	struct UNPACK_MASKOPS
+	{
+		alignas(16) uint32 lanes[4][4][4];
+	};
+
+	void UpdateUnpackMaskOps();
+
+	inline const UNPACK_MASKOPS& GetUnpackMaskOps()
+	{
+		if(!m_unpackMaskOpsValid || (m_unpackMaskOpsKey != m_MASK))
+		{
+			UpdateUnpackMaskOps();
+		}
+		return m_unpackMaskOps;
+	}
+
 	inline bool Unpack_S32(StreamType& stream, uint128& result)
 	{
 		if(stream.GetAvailableReadBytes() < 4) return false;
@@ -456,6 +488,290 @@ protected:
 		return true;
 	}
 
+	static constexpr uint32 Unpack_GetElementSize(uint8 dataType)
+	{
+		//V4-5 is the only format that doesn't follow the VN/VL encoding, other formats with VL = 3 are invalid
+		if(dataType == 0x0F) return 2;
+		if((dataType & 0x03) == 0x03) return 0;
+		return (4 >> (dataType & 0x03)) * (((dataType >> 2) & 0x03) + 1);
+	}
+
+	//Converts a single element read in place from memory, result is the same as Unpack_ReadValue
+	template <uint8 dataType, bool usn>
+	static inline void Unpack_ConvertElement(const uint8* src, uint128& result)
+	{
+		constexpr uint32 vn = (dataType >> 2) & 0x03;
+		constexpr uint32 vl = dataType & 0x03;
+		constexpr uint32 fields = vn + 1;
+		if(dataType == 0x0F)
+		{
+			uint16 value = 0;
+			memcpy(&value, src, 2);
+			result.nV0 = ((value >> 0) & 0x1F) << 3;
+			result.nV1 = ((value >> 5) & 0x1F) << 3;
+			result.nV2 = ((value >> 10) & 0x1F) << 3;
+			result.nV3 = ((value >> 15) & 0x01) << 7;
+		}
+		else if(vn == 0)
+		{
+			//S-32, S-16, S-8: broadcast a single value
+			uint32 value = 0;
+			if(vl == 0)
+			{
+				memcpy(&value, src, 4);
+			}
+			else if(vl == 1)
+			{
+				uint16 temp = 0;
+				memcpy(&temp, src, 2);
+				value = usn ? temp : static_cast<int16>(temp);
+			}
+			else
+			{
+				value = usn ? src[0] : static_cast<int8>(src[0]);
+			}
+			for(unsigned int i = 0; i < 4; i++)
+			{
+				result.nV[i] = value;
+			}
+		}
+		else if(vl == 0)
+		{
+			//Vn-32, missing fields are cleared
+			memset(&result, 0, sizeof(uint128));
+			memcpy(&result, src, fields * 4);
+		}
+		else if(vl == 1)
+		{
+			//Vn-16
+			uint64 values = 0;
+			memcpy(&values, src, fields * 2);
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+			__m128i value = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(&values));
+			value = usn ? _mm_unpacklo_epi16(value, _mm_setzero_si128()) : _mm_srai_epi32(_mm_unpacklo_epi16(value, value), 16);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&result), value);
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+			uint16x4_t value = vcreate_u16(values);
+			uint32x4_t widened = usn ? vmovl_u16(value) : vreinterpretq_u32_s32(vmovl_s16(vreinterpret_s16_u16(value)));
+			vst1q_u32(result.nV, widened);
+#else
+			for(unsigned int i = 0; i < 4; i++)
+			{
+				uint16 temp = static_cast<uint16>(values >> (i * 16));
+				result.nV[i] = usn ? temp : static_cast<int16>(temp);
+			}
+#endif
+		}
+		else
+		{
+			//Vn-8
+			uint32 values = 0;
+			memcpy(&values, src, fields);
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+			__m128i value = _mm_cvtsi32_si128(values);
+			if(usn)
+			{
+				value = _mm_unpacklo_epi8(value, _mm_setzero_si128());
+				value = _mm_unpacklo_epi16(value, _mm_setzero_si128());
+			}
+			else
+			{
+				value = _mm_unpacklo_epi8(value, value);
+				value = _mm_srai_epi32(_mm_unpacklo_epi16(value, value), 24);
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&result), value);
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+			uint8x8_t value = vcreate_u8(values);
+			uint32x4_t widened = usn ? vmovl_u16(vget_low_u16(vmovl_u8(value)))
+			                         : vreinterpretq_u32_s32(vmovl_s16(vget_low_s16(vmovl_s8(vreinterpret_s8_u8(value)))));
+			vst1q_u32(result.nV, widened);
+#else
+			for(unsigned int i = 0; i < 4; i++)
+			{
+				uint8 temp = static_cast<uint8>(values >> (i * 8));
+				result.nV[i] = usn ? temp : static_cast<int8>(temp);
+			}
+#endif
+		}
+	}
+
+	//Unpacks a run of elements stored contiguously in memory to consecutive VU memory locations.
+	//Only valid when no mask is used and every element is written (CL == WL).
+	template <uint8 dataType, uint8 mode, bool usn>
+	inline void Unpack_Bulk(const uint8* src, uint128* dst, uint32 count)
+	{
+		constexpr uint32 elementSize = Unpack_GetElementSize(dataType);
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+		__m128i row = _mm_load_si128(reinterpret_cast<const __m128i*>(m_R));
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+		uint32x4_t row = vld1q_u32(m_R);
+#endif
+		for(uint32 i = 0; i < count; i++, src += elementSize, dst++)
+		{
+			if(dataType == 0x0C)
+			{
+				//V4-32: nothing to convert
+				memcpy(dst, src, sizeof(uint128));
+			}
+			else
+			{
+				Unpack_ConvertElement<dataType, usn>(src, *dst);
+			}
+			if(mode == MODE_NORMAL) continue;
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+			__m128i value = _mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(dst)), row);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), value);
+			if(mode == MODE_DIFFERENCE) row = value;
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+			uint32x4_t value = vaddq_u32(vld1q_u32(dst->nV), row);
+			vst1q_u32(dst->nV, value);
+			if(mode == MODE_DIFFERENCE) row = value;
+#else
+			for(unsigned int j = 0; j < 4; j++)
+			{
+				dst->nV[j] += m_R[j];
+				if(mode == MODE_DIFFERENCE) m_R[j] = dst->nV[j];
+			}
+#endif
+		}
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+		if(mode == MODE_DIFFERENCE) _mm_store_si128(reinterpret_cast<__m128i*>(m_R), row);
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+		if(mode == MODE_DIFFERENCE) vst1q_u32(m_R, row);
+#endif
+	}
+
+	//Applies mode and mask to an unpacked value and writes it to VU memory, same as the generic path
+	template <bool useMask, uint8 mode>
+	inline void Unpack_WriteElement(uint128& dst, const uint128& value, uint32 col, const UNPACK_MASKOPS& maskOps)
+	{
+		const auto& colMaskOps = maskOps.lanes[col];
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+		__m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&value));
+		__m128i row = _mm_load_si128(reinterpret_cast<const __m128i*>(m_R));
+		if(mode != MODE_NORMAL)
+		{
+			data = _mm_add_epi32(data, row);
+		}
+		if(!useMask)
+		{
+			if(mode == MODE_DIFFERENCE) _mm_store_si128(reinterpret_cast<__m128i*>(m_R), data);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&dst), data);
+			return;
+		}
+		__m128i dataMask = _mm_load_si128(reinterpret_cast<const __m128i*>(colMaskOps[MASK_DATA]));
+		if(mode == MODE_DIFFERENCE)
+		{
+			//Only lanes that receive data update the row
+			row = _mm_or_si128(_mm_and_si128(data, dataMask), _mm_andnot_si128(dataMask, row));
+			_mm_store_si128(reinterpret_cast<__m128i*>(m_R), row);
+		}
+		__m128i result = _mm_and_si128(data, dataMask);
+		result = _mm_or_si128(result, _mm_and_si128(row, _mm_load_si128(reinterpret_cast<const __m128i*>(colMaskOps[MASK_ROW]))));
+		result = _mm_or_si128(result, _mm_and_si128(_mm_set1_epi32(m_C[col]), _mm_load_si128(reinterpret_cast<const __m128i*>(colMaskOps[MASK_COL]))));
+		result = _mm_or_si128(result, _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&dst)), _mm_load_si128(reinterpret_cast<const __m128i*>(colMaskOps[MASK_MASK]))));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&dst), result);
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+		uint32x4_t data = vld1q_u32(value.nV);
+		uint32x4_t row = vld1q_u32(m_R);
+		if(mode != MODE_NORMAL)
+		{
+			data = vaddq_u32(data, row);
+		}
+		if(!useMask)
+		{
+			if(mode == MODE_DIFFERENCE) vst1q_u32(m_R, data);
+			vst1q_u32(dst.nV, data);
+			return;
+		}
+		uint32x4_t dataMask = vld1q_u32(colMaskOps[MASK_DATA]);
+		if(mode == MODE_DIFFERENCE)
+		{
+			//Only lanes that receive data update the row
+			row = vbslq_u32(dataMask, data, row);
+			vst1q_u32(m_R, row);
+		}
+		uint32x4_t result = vandq_u32(data, dataMask);
+		result = vorrq_u32(result, vandq_u32(row, vld1q_u32(colMaskOps[MASK_ROW])));
+		result = vorrq_u32(result, vandq_u32(vdupq_n_u32(m_C[col]), vld1q_u32(colMaskOps[MASK_COL])));
+		result = vorrq_u32(result, vandq_u32(vld1q_u32(dst.nV), vld1q_u32(colMaskOps[MASK_MASK])));
+		vst1q_u32(dst.nV, result);
+#else
+		for(unsigned int i = 0; i < 4; i++)
+		{
+			uint32 data = value.nV[i];
+			if(mode != MODE_NORMAL)
+			{
+				data += m_R[i];
+			}
+			if(!useMask)
+			{
+				if(mode == MODE_DIFFERENCE) m_R[i] = data;
+				dst.nV[i] = data;
+				continue;
+			}
+			uint32 dataMask = colMaskOps[MASK_DATA][i];
+			if(mode == MODE_DIFFERENCE)
+			{
+				m_R[i] = (data & dataMask) | (m_R[i] & ~dataMask);
+			}
+			dst.nV[i] = (data & dataMask) | (m_R[i] & colMaskOps[MASK_ROW][i]) |
+			            (m_C[col] & colMaskOps[MASK_COL][i]) | (dst.nV[i] & colMaskOps[MASK_MASK][i]);
+		}
+#endif
+	}
+
+	//Unpacks elements that can be read in place from the stream. Skipping and filling follow the same
+	//rules as the generic path, but lane selection for masked writes uses precomputed masks.
+	template <uint8 dataType, bool clGreaterEqualWl, bool useMask, uint8 mode, bool usn>
+	void Unpack_Direct(StreamType& stream, uint8* vuMem, uint32 vuMemSize, uint32& dstAddr, uint32& currentNum, uint32 cl, uint32 wl)
+	{
+		constexpr uint32 elementSize = Unpack_GetElementSize(dataType);
+		uint32 readableSize = stream.GetDirectReadableBytes();
+		if(readableSize == 0) return;
+
+		const auto& maskOps = GetUnpackMaskOps();
+		const uint8* src = stream.GetDirectPointer();
+		uint32 readSize = 0;
+
+		while(currentNum != 0)
+		{
+			bool mustRead = clGreaterEqualWl ? (m_readTick < wl) : (m_writeTick < cl);
+			bool mustWrite = !clGreaterEqualWl || mustRead;
+
+			uint128 writeValue;
+			memset(&writeValue, 0, sizeof(writeValue));
+
+			if(mustRead)
+			{
+				if((readableSize - readSize) < elementSize) break;
+				Unpack_ConvertElement<dataType, usn>(src + readSize, writeValue);
+				readSize += elementSize;
+			}
+
+			if(mustWrite)
+			{
+				uint32 col = (m_writeTick > 3) ? 3 : m_writeTick;
+				Unpack_WriteElement<useMask, mode>(*reinterpret_cast<uint128*>(vuMem + dstAddr), writeValue, col, maskOps);
+				currentNum--;
+			}
+
+			m_writeTick = std::min<uint32>(m_writeTick + 1, wl);
+			m_readTick = std::min<uint32>(m_readTick + 1, cl);
+
+			if(clGreaterEqualWl ? (m_readTick == cl) : (m_writeTick == wl))
+			{
+				m_writeTick = 0;
+				m_readTick = 0;
+			}
+
+			dstAddr += 0x10;
+			dstAddr &= (vuMemSize - 1);
+		}
+
+		stream.Skip(readSize);
+	}
+
 	template <uint8 dataType, bool usn>
 	bool Unpack_ReadValue(StreamType& stream, uint128& writeValue)
 	{
@@ -559,6 +875,30 @@ protected:
 		assert(nDstAddr < vuMemSize);
 		nDstAddr &= (vuMemSize - 1);
 
+		constexpr uint32 elementSize = Unpack_GetElementSize(dataType);
+		if((elementSize != 0) && (useMask || (cl != wl)))
+		{
+			Unpack_Direct<dataType, clGreaterEqualWl, useMask, mode, usn>(stream, vuMem, vuMemSize, nDstAddr, currentNum, cl, wl);
+		}
+		else if(elementSize != 0)
+		{
+			//Every element is read and written to consecutive locations, convert all
+			//elements available in memory at once. Leftovers go through the generic path.
+			uint32 bulkNum = std::min<uint32>(currentNum, stream.GetDirectReadableBytes() / elementSize);
+			m_readTick = (m_readTick + bulkNum) % cl;
+			m_writeTick = m_readTick;
+			currentNum -= bulkNum;
+			while(bulkNum != 0)
+			{
+				uint32 runNum = std::min<uint32>(bulkNum, (vuMemSize - nDstAddr) / 0x10);
+				Unpack_Bulk<dataType, mode, usn>(stream.GetDirectPointer(), reinterpret_cast<uint128*>(vuMem + nDstAddr), runNum);
+				stream.Skip(runNum * elementSize);
+				nDstAddr += runNum * 0x10;
+				nDstAddr &= (vuMemSize - 1);
+				bulkNum -= runNum;
+			}
+		}
+
 		while(currentNum != 0)
 		{
 			bool mustWrite = false;
@@ -719,6 +1059,9 @@ protected:
 	alignas(16) uint32 m_R[4];
 	uint32 m_C[4];
 	uint32 m_MASK;
+	UNPACK_MASKOPS m_unpackMaskOps;
+	uint32 m_unpackMaskOpsKey = 0;
+	bool m_unpackMaskOpsValid = false;
 	uint32 m_MARK;
 	uint32 m_ITOP;
 	uint32 m_ITOPS;
@@ -230,17 +230,34 @@ void CVpu::ProcessXgKick(uint32 address)
 	address &= 0x3FF;
 	address *= 0x10;
 
-	CGsPacketMetadata metadata;
-	metadata.pathIndex = 1;
 #ifdef DEBUGGER_INCLUDED
-	metadata.vuMemPacketAddress = address;
-	metadata.vpu1Top = GetVuTopMiniState();
-	metadata.vpu1Itop = GetVuItopMiniState();
-	memcpy(&metadata.vu1State, &GetVuMiniState(), sizeof(MIPSSTATE));
-	memcpy(metadata.vuMem1, GetVuMemoryMiniState(), PS2::VUMEM1SIZE);
-	memcpy(metadata.microMem1, GetMicroMemoryMiniState(), PS2::MICROMEM1SIZE);
+	//Snapshotting VU1 state is costly, only do it when packets are being captured
+	if(m_gif.GetGsHandler()->IsFrameDumpActive())
+	{
+		CGsPacketMetadata metadata(1);
+		metadata.vuMemPacketAddress = address;
+		metadata.vpu1Top = GetVuTopMiniState();
+		metadata.vpu1Itop = GetVuItopMiniState();
+		memcpy(&metadata.vu1State, &GetVuMiniState(), sizeof(MIPSSTATE));
+		memcpy(metadata.vuMem1, GetVuMemoryMiniState(), PS2::VUMEM1SIZE);
+		memcpy(metadata.microMem1, GetMicroMemoryMiniState(), PS2::MICROMEM1SIZE);
+		ProcessXgKickPacket(address, metadata);
+	}
+	else
+#endif
+	{
+		static const CGsPacketMetadata metadata(1);
+		ProcessXgKickPacket(address, metadata);
+	}
+
+#ifdef DEBUGGER_INCLUDED
+	SaveMiniState();
 #endif
+}
 
+void CVpu::ProcessXgKickPacket(uint32 address, const CGsPacketMetadata& metadata)
+{
+	//GIF tags and data are read in place from VU1 memory
 	address += m_gif.ProcessSinglePacket(GetVuMemory(), PS2::VUMEM1SIZE, address, PS2::VUMEM1SIZE, metadata);
 	if((address == PS2::VUMEM1SIZE) && (m_gif.GetActivePath() == 1))
 	{
@@ -248,8 +265,4 @@ void CVpu::ProcessXgKick(uint32 address)
 		address += m_gif.ProcessSinglePacket(GetVuMemory(), PS2::VUMEM1SIZE, address, PS2::VUMEM1SIZE, metadata);
 	}
 	assert(m_gif.GetActivePath() == 0);
-
-#ifdef DEBUGGER_INCLUDED
-	SaveMiniState();
-#endif
 }
@@ -10,6 +10,7 @@
 class CVif;
 class CGIF;
 class CINTC;
+class CGsPacketMetadata;
 
 class CVpu
 {
@@ -113,6 +114,8 @@ protected:
 
 	typedef std::unique_ptr<CVif> VifPtr;
 
+	void ProcessXgKickPacket(uint32, const CGsPacketMetadata&);
+
 	unsigned int m_number = 0;
 	VifPtr m_vif;
 	uint8* m_microMem = nullptr;
@@ -60,6 +60,8 @@ CGSH_Direct3D9::TEXTURE_INFO CGSH_Direct3D9::LoadTexture(const TEX0& tex0, uint3
 	auto texture = m_textureCache.Search(tex0);
 	if(!texture)
 	{
+		m_stats.textureCacheMisses++;
+
 		uint32 width = tex0.GetWidth();
 		uint32 height = tex0.GetHeight();
 
@@ -98,6 +100,10 @@ CGSH_Direct3D9::TEXTURE_INFO CGSH_Direct3D9::LoadTexture(const TEX0& tex0, uint3
 		texture = m_textureCache.Search(tex0);
 		texture->m_cachedArea.Invalidate(0, RAMSIZE);
 	}
+	else
+	{
+		m_stats.textureCacheHits++;
+	}
 
 	auto& cachedArea = texture->m_cachedArea;
 
@@ -21,6 +21,8 @@
 
 #define NUM_SAMPLES 8
 #define FRAMEBUFFER_HEIGHT 1024
+#define FENCE_WAIT_TIMEOUT 1000000000ULL
+#define DEFAULT_RENDERTARGET_BUDGET_MB 512
 
 // clang-format off
 const GLenum CGSH_OpenGL::g_nativeClampModes[CGSHandler::CLAMP_MODE_MAX] =
@@ -95,7 +97,9 @@ void CGSH_OpenGL::ReleaseImpl()
 	ResetImpl();
 
 	m_paletteCache.clear();
+	SaveShaderCache();
 	m_shaders.clear();
+	m_pendingShaders.clear();
 	m_presentProgram.reset();
 	m_presentVertexBuffer.Reset();
 	m_presentVertexArray.Reset();
@@ -107,6 +111,8 @@ void CGSH_OpenGL::ReleaseImpl()
 	m_primVertexArray.Reset();
 	m_vertexParamsBuffer.Reset();
 	m_fragmentParamsBuffer.Reset();
+	m_textureUploadBuffer.Reset();
+	m_readbackBuffer.Reset();
 }
 
 void CGSH_OpenGL::ResetImpl()
@@ -114,8 +120,7 @@ void CGSH_OpenGL::ResetImpl()
 	LoadPreferences();
 	m_textureCache.Flush();
 	PalCache_Flush();
-	m_framebuffers.clear();
-	m_depthbuffers.clear();
+	ClearRenderTargets();
 	m_vertexBuffer.clear();
 	m_renderState.isValid = false;
 	m_validGlState = 0;
@@ -124,6 +129,7 @@ void CGSH_OpenGL::ResetImpl()
 	m_primitiveType = PRIM_INVALID;
 	m_pendingPrim = false;
 	m_pendingPrimValue = 0;
+	DiscardPendingReadback();
 }
 
 void CGSH_OpenGL::FlipImpl(const DISPLAY_INFO& dispInfo)
@@ -154,13 +160,14 @@ void CGSH_OpenGL::FlipImpl(const DISPLAY_INFO& dispInfo)
 		if(!framebuffer && (dispLayer.bufWidth != 0))
 		{
 			framebuffer = FramebufferPtr(new CFramebuffer(dispLayer.bufPtr, dispLayer.bufWidth, FRAMEBUFFER_HEIGHT, dispLayer.psm, m_fbScale, m_multisampleEnabled));
-			m_framebuffers.push_back(framebuffer);
+			AddFramebuffer(framebuffer);
 			PopulateFramebuffer(framebuffer);
 		}
 	}
 
 	if(framebuffer)
 	{
+		framebuffer->m_lastUsedFrame = m_renderTargetFrame;
 		CommitFramebufferDirtyPages(framebuffer, 0, dispLayer.height);
 		if(m_multisampleEnabled)
 		{
@@ -234,6 +241,11 @@ void CGSH_OpenGL::FlipImpl(const DISPLAY_INFO& dispInfo)
 	}
 
 	PresentBackbuffer();
+
+	//Render state was invalidated above, it's safe to get rid of targets here
+	EvictRenderTargets();
+	m_renderTargetFrame++;
+
 	CGSHandler::FlipImpl(dispInfo);
 }
 
@@ -251,6 +263,8 @@ void CGSH_OpenGL::RegisterPreferences()
 	CGSHandler::RegisterPreferences();
 	CAppConfig::GetInstance().RegisterPreferenceInteger(PREF_CGSH_OPENGL_RESOLUTION_FACTOR, 1);
 	CAppConfig::GetInstance().RegisterPreferenceBoolean(PREF_CGSH_OPENGL_FORCEBILINEARTEXTURES, false);
+	CAppConfig::GetInstance().RegisterPreferenceBoolean(PREF_CGSH_OPENGL_ASYNCSHADERCOMPILATION, false);
+	CAppConfig::GetInstance().RegisterPreferenceInteger(PREF_CGSH_OPENGL_RENDERTARGETBUDGET, DEFAULT_RENDERTARGET_BUDGET_MB);
 }
 
 void CGSH_OpenGL::NotifyPreferencesChangedImpl()
@@ -258,8 +272,7 @@ void CGSH_OpenGL::NotifyPreferencesChangedImpl()
 	LoadPreferences();
 	m_textureCache.Flush();
 	PalCache_Flush();
-	m_framebuffers.clear();
-	m_depthbuffers.clear();
+	ClearRenderTargets();
 	CGSHandler::NotifyPreferencesChangedImpl();
 }
 
@@ -267,6 +280,8 @@ void CGSH_OpenGL::LoadPreferences()
 {
 	m_fbScale = CAppConfig::GetInstance().GetPreferenceInteger(PREF_CGSH_OPENGL_RESOLUTION_FACTOR);
 	m_forceBilinearTextures = CAppConfig::GetInstance().GetPreferenceBoolean(PREF_CGSH_OPENGL_FORCEBILINEARTEXTURES);
+	m_asyncShaderCompilation = CAppConfig::GetInstance().GetPreferenceBoolean(PREF_CGSH_OPENGL_ASYNCSHADERCOMPILATION);
+	m_renderTargetBudget = static_cast<uint64>(CAppConfig::GetInstance().GetPreferenceInteger(PREF_CGSH_OPENGL_RENDERTARGETBUDGET)) * 0x100000;
 }
 
 void CGSH_OpenGL::InitializeRC()
@@ -277,6 +292,7 @@ void CGSH_OpenGL::InitializeRC()
 
 	CheckExtensions();
 	SetupTextureUpdaters();
+	LoadShaderCache();
 
 	m_presentProgram = GeneratePresentProgram();
 	m_presentVertexBuffer = GeneratePresentVertexBuffer();
@@ -291,11 +307,13 @@ void CGSH_OpenGL::InitializeRC()
 	m_copyToFbSrcPositionUniform = glGetUniformLocation(*m_copyToFbProgram, "g_srcPosition");
 	m_copyToFbSrcSizeUniform = glGetUniformLocation(*m_copyToFbProgram, "g_srcSize");
 
-	m_primBuffer = Framework::OpenGl::CBuffer::Create();
+	m_primBuffer.Create(GL_ARRAY_BUFFER, VERTEX_STREAM_SEGMENT_SIZE, m_hasBufferStorageExtension);
 	m_primVertexArray = GeneratePrimVertexArray();
 
-	m_vertexParamsBuffer = GenerateUniformBlockBuffer(sizeof(VERTEXPARAMS));
-	m_fragmentParamsBuffer = GenerateUniformBlockBuffer(sizeof(FRAGMENTPARAMS));
+	m_vertexParamsBuffer.Create(GL_UNIFORM_BUFFER, UNIFORM_STREAM_SEGMENT_SIZE, m_hasBufferStorageExtension);
+	m_fragmentParamsBuffer.Create(GL_UNIFORM_BUFFER, UNIFORM_STREAM_SEGMENT_SIZE, m_hasBufferStorageExtension);
+	m_textureUploadBuffer.Create(GL_PIXEL_UNPACK_BUFFER, TEXTURE_UPLOAD_SEGMENT_SIZE, m_hasBufferStorageExtension);
+	m_readbackBuffer = Framework::OpenGl::CBuffer::Create();
 
 	PresentBackbuffer();
 
@@ -313,7 +331,38 @@ void CGSH_OpenGL::CheckExtensions()
 		{
 			m_hasFramebufferFetchExtension = true;
 		}
+#ifdef USE_PERSISTENT_BUFFERS
+		if(!strcmp(extensionName, "GL_ARB_buffer_storage"))
+		{
+			m_hasBufferStorageExtension = true;
+		}
+#endif
+		if(!strcmp(extensionName, "GL_ARB_get_program_binary"))
+		{
+			m_hasProgramBinarySupport = true;
+		}
+		if(!strcmp(extensionName, "GL_KHR_parallel_shader_compile") || !strcmp(extensionName, "GL_ARB_parallel_shader_compile"))
+		{
+			m_hasParallelShaderCompileExtension = true;
+		}
+	}
+
+#ifdef GLES_COMPATIBILITY
+	//Program binaries are part of GLES 3.0
+	m_hasProgramBinarySupport = true;
+#endif
+
+	if(m_hasProgramBinarySupport)
+	{
+		//Some drivers expose the functionality without supporting any binary format
+		GLint programBinaryFormatCount = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &programBinaryFormatCount);
+		m_hasProgramBinarySupport = (programBinaryFormatCount != 0);
 	}
+
+	GLint uniformBufferOffsetAlignment = 1;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformBufferOffsetAlignment);
+	m_uniformBufferOffsetAlignment = std::max<GLint>(uniformBufferOffsetAlignment, 1);
 }
 
 Framework::OpenGl::CBuffer CGSH_OpenGL::GeneratePresentVertexBuffer()
@@ -417,7 +466,7 @@ Framework::OpenGl::CVertexArray CGSH_OpenGL::GeneratePrimVertexArray()
 
 	glBindVertexArray(vertexArray);
 
-	glBindBuffer(GL_ARRAY_BUFFER, m_primBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, m_primBuffer.GetBuffer());
 
 	glEnableVertexAttribArray(static_cast<GLuint>(PRIM_VERTEX_ATTRIB::POSITION));
 	glVertexAttribPointer(static_cast<GLuint>(PRIM_VERTEX_ATTRIB::POSITION), 2, GL_FLOAT,
@@ -446,17 +495,6 @@ Framework::OpenGl::CVertexArray CGSH_OpenGL::GeneratePrimVertexArray()
 	return vertexArray;
 }
 
-Framework::OpenGl::CBuffer CGSH_OpenGL::GenerateUniformBlockBuffer(size_t blockSize)
-{
-	auto uniformBlockBuffer = Framework::OpenGl::CBuffer::Create();
-
-	glBindBuffer(GL_UNIFORM_BUFFER, uniformBlockBuffer);
-	glBufferData(GL_UNIFORM_BUFFER, blockSize, nullptr, GL_STREAM_DRAW);
-	CHECKGLERROR();
-
-	return uniformBlockBuffer;
-}
-
 void CGSH_OpenGL::MakeLinearZOrtho(float* matrix, float left, float right, float bottom, float top)
 {
 	matrix[0] = 2.0f / (right - left);
@@ -487,43 +525,106 @@ void CGSH_OpenGL::MakeLinearZOrtho(float* matrix, float left, float right, float
 Framework::OpenGl::ProgramPtr CGSH_OpenGL::GetShaderFromCaps(const SHADERCAPS& shaderCaps)
 {
 	auto shaderIterator = m_shaders.find(shaderCaps);
-	if(shaderIterator == m_shaders.end())
+	if(shaderIterator != m_shaders.end())
 	{
-		auto shader = GenerateShader(shaderCaps);
+		return shaderIterator->second;
+	}
 
-		glUseProgram(*shader);
-		m_validGlState &= ~GLSTATE_PROGRAM;
+	if(!m_asyncShaderCompilation || !m_hasParallelShaderCompileExtension)
+	{
+		auto shader = GenerateShader(shaderCaps, false);
+		RegisterShader(shaderCaps, shader);
+		return shader;
+	}
 
-		auto textureUniform = glGetUniformLocation(*shader, "g_texture");
-		if(textureUniform != -1)
-		{
-			glUniform1i(textureUniform, 0);
-		}
+	auto pendingShaderIterator = m_pendingShaders.find(shaderCaps);
+	if(pendingShaderIterator == m_pendingShaders.end())
+	{
+		auto shader = GenerateShader(shaderCaps, true);
+		pendingShaderIterator = m_pendingShaders.insert(std::make_pair(shaderCaps, shader)).first;
+	}
 
-		auto paletteUniform = glGetUniformLocation(*shader, "g_palette");
-		if(paletteUniform != -1)
+	auto shader = pendingShaderIterator->second;
+	GLint completionStatus = GL_FALSE;
+	glGetProgramiv(*shader, GL_COMPLETION_STATUS_KHR, &completionStatus);
+	if(completionStatus == GL_FALSE)
+	{
+		if(auto fallbackShader = GetFallbackShader(shaderCaps))
 		{
-			glUniform1i(paletteUniform, 1);
+			return fallbackShader;
 		}
+		//No fallback, querying the link status below will wait for the compilation to complete
+	}
 
-		auto vertexParamsUniformBlock = glGetUniformBlockIndex(*shader, "VertexParams");
-		if(vertexParamsUniformBlock != GL_INVALID_INDEX)
-		{
-			glUniformBlockBinding(*shader, vertexParamsUniformBlock, 0);
-		}
+	m_pendingShaders.erase(pendingShaderIterator);
 
-		auto fragmentParamsUniformBlock = glGetUniformBlockIndex(*shader, "FragmentParams");
-		if(fragmentParamsUniformBlock != GL_INVALID_INDEX)
-		{
-			glUniformBlockBinding(*shader, fragmentParamsUniformBlock, 1);
-		}
+	GLint linkStatus = GL_FALSE;
+	glGetProgramiv(*shader, GL_LINK_STATUS, &linkStatus);
+	if(linkStatus == GL_FALSE)
+	{
+		//Shouldn't happen, but try again synchronously to get the usual diagnostics
+		shader = GenerateShader(shaderCaps, false);
+	}
 
-		CHECKGLERROR();
+	RegisterShader(shaderCaps, shader);
+	return shader;
+}
+
+Framework::OpenGl::ProgramPtr CGSH_OpenGL::GetFallbackShader(const SHADERCAPS& shaderCaps)
+{
+	//Use an already compiled variant without fog while the real one is being compiled.
+	//Only fog can be dropped, everything else (alpha testing and its fail method included)
+	//changes which pixels get written and must match the requested program.
+	if(!shaderCaps.hasFog)
+	{
+		return Framework::OpenGl::ProgramPtr();
+	}
 
-		m_shaders.insert(std::make_pair(shaderCaps, shader));
-		shaderIterator = m_shaders.find(shaderCaps);
+	auto fallbackCaps = shaderCaps;
+	fallbackCaps.hasFog = 0;
+
+	auto shaderIterator = m_shaders.find(fallbackCaps);
+	if(shaderIterator != m_shaders.end())
+	{
+		return shaderIterator->second;
 	}
-	return shaderIterator->second;
+
+	return Framework::OpenGl::ProgramPtr();
+}
+
+void CGSH_OpenGL::RegisterShader(const SHADERCAPS& shaderCaps, const Framework::OpenGl::ProgramPtr& shader)
+{
+	glUseProgram(*shader);
+	m_validGlState &= ~GLSTATE_PROGRAM;
+
+	auto textureUniform = glGetUniformLocation(*shader, "g_texture");
+	if(textureUniform != -1)
+	{
+		glUniform1i(textureUniform, 0);
+	}
+
+	auto paletteUniform = glGetUniformLocation(*shader, "g_palette");
+	if(paletteUniform != -1)
+	{
+		glUniform1i(paletteUniform, 1);
+	}
+
+	auto vertexParamsUniformBlock = glGetUniformBlockIndex(*shader, "VertexParams");
+	if(vertexParamsUniformBlock != GL_INVALID_INDEX)
+	{
+		glUniformBlockBinding(*shader, vertexParamsUniformBlock, 0);
+	}
+
+	auto fragmentParamsUniformBlock = glGetUniformBlockIndex(*shader, "FragmentParams");
+	if(fragmentParamsUniformBlock != GL_INVALID_INDEX)
+	{
+		glUniformBlockBinding(*shader, fragmentParamsUniformBlock, 1);
+	}
+
+	CHECKGLERROR();
+
+	m_shaders.insert(std::make_pair(shaderCaps, shader));
+	AddProgramBinary(shaderCaps, shader);
 }
 
 void CGSH_OpenGL::SetRenderingContext(uint64 primReg)
@@ -985,7 +1086,7 @@ void CGSH_OpenGL::SetupFramebuffer(uint64 frameReg, uint64 zbufReg, uint64 sciss
 	if(!framebuffer)
 	{
 		framebuffer = FramebufferPtr(new CFramebuffer(frame.GetBasePtr(), frame.GetWidth(), FRAMEBUFFER_HEIGHT, frame.nPsm, m_fbScale, m_multisampleEnabled));
-		m_framebuffers.push_back(framebuffer);
+		AddFramebuffer(framebuffer);
 		PopulateFramebuffer(framebuffer);
 	}
 
@@ -995,7 +1096,7 @@ void CGSH_OpenGL::SetupFramebuffer(uint64 frameReg, uint64 zbufReg, uint64 sciss
 	if(!depthbuffer)
 	{
 		depthbuffer = DepthbufferPtr(new CDepthbuffer(zbuf.GetBasePtr(), frame.GetWidth(), FRAMEBUFFER_HEIGHT, zbuf.nPsm, m_fbScale, m_multisampleEnabled));
-		m_depthbuffers.push_back(depthbuffer);
+		AddDepthbuffer(depthbuffer);
 	}
 
 	assert(framebuffer->m_width == depthbuffer->m_width);
@@ -1014,6 +1115,17 @@ void CGSH_OpenGL::SetupFramebuffer(uint64 frameReg, uint64 zbufReg, uint64 sciss
 	//to resolve samples at some point if multisampling is enabled
 	framebuffer->m_resolveNeeded = true;
 
+	//Rendering results only live on the GPU, they need to be written back to RAM before the targets are evicted
+	{
+		uint32 dirtyX1 = std::min<uint32>(scissor.scax1 + 1, framebuffer->m_width);
+		uint32 dirtyY1 = std::min<uint32>(scissor.scay1 + 1, framebuffer->m_height);
+		framebuffer->m_gpuDirtyRect.Add(scissor.scax0, scissor.scay0, dirtyX1, dirtyY1);
+		if(!zbuf.nMask)
+		{
+			depthbuffer->m_gpuDirtyRect.Add(scissor.scax0, scissor.scay0, dirtyX1, dirtyY1);
+		}
+	}
+
 	{
 		GLenum drawBufferId = GL_COLOR_ATTACHMENT0;
 		glDrawBuffers(1, &drawBufferId);
@@ -1314,26 +1426,332 @@ void CGSH_OpenGL::SetupTexture(uint64 primReg, uint64 tex0Reg, uint64 tex1Reg, u
 	m_validGlState &= ~GLSTATE_FRAGMENT_PARAMS;
 }
 
-CGSH_OpenGL::FramebufferPtr CGSH_OpenGL::FindFramebuffer(const FRAME& frame) const
+CGSH_OpenGL::RenderTargetKey CGSH_OpenGL::MakeRenderTargetKey(uint32 basePtr, uint32 width, uint32 psm)
 {
-	auto framebufferIterator = std::find_if(std::begin(m_framebuffers), std::end(m_framebuffers),
-	                                        [&](const FramebufferPtr& framebuffer) {
-		                                        return (framebuffer->m_basePtr == frame.GetBasePtr()) &&
-		                                               IsCompatibleFramebufferPSM(framebuffer->m_psm, frame.nPsm) &&
-		                                               (framebuffer->m_width == frame.GetWidth());
-	                                        });
+	//PSMCT32 and PSMCT24 framebuffers are interchangeable (see IsCompatibleFramebufferPSM)
+	if(psm == PSMCT24) psm = PSMCT32;
+	return static_cast<uint64>(basePtr) | (static_cast<uint64>(width) << 32) | (static_cast<uint64>(psm) << 48);
+}
 
-	return (framebufferIterator != std::end(m_framebuffers)) ? *(framebufferIterator) : FramebufferPtr();
+CGSH_OpenGL::FramebufferPtr CGSH_OpenGL::FindFramebuffer(const FRAME& frame)
+{
+	auto framebufferIterator = m_framebufferIndex.find(MakeRenderTargetKey(frame.GetBasePtr(), frame.GetWidth(), frame.nPsm));
+	if(framebufferIterator == std::end(m_framebufferIndex)) return FramebufferPtr();
+
+	const auto& framebuffer = framebufferIterator->second;
+	assert(IsCompatibleFramebufferPSM(framebuffer->m_psm, frame.nPsm));
+	framebuffer->m_lastUsedFrame = m_renderTargetFrame;
+	return framebuffer;
 }
 
-CGSH_OpenGL::DepthbufferPtr CGSH_OpenGL::FindDepthbuffer(const ZBUF& zbuf, const FRAME& frame) const
+CGSH_OpenGL::DepthbufferPtr CGSH_OpenGL::FindDepthbuffer(const ZBUF& zbuf, const FRAME& frame)
 {
-	auto depthbufferIterator = std::find_if(std::begin(m_depthbuffers), std::end(m_depthbuffers),
-	                                        [&](const DepthbufferPtr& depthbuffer) {
-		                                        return (depthbuffer->m_basePtr == zbuf.GetBasePtr()) && (depthbuffer->m_width == frame.GetWidth());
-	                                        });
+	auto depthbufferIterator = m_depthbufferIndex.find(MakeRenderTargetKey(zbuf.GetBasePtr(), frame.GetWidth(), 0));
+	if(depthbufferIterator == std::end(m_depthbufferIndex)) return DepthbufferPtr();
+
+	const auto& depthbuffer = depthbufferIterator->second;
+	depthbuffer->m_lastUsedFrame = m_renderTargetFrame;
+	return depthbuffer;
+}
 
-	return (depthbufferIterator != std::end(m_depthbuffers)) ? *(depthbufferIterator) : DepthbufferPtr();
+void CGSH_OpenGL::AddFramebuffer(const FramebufferPtr& framebuffer)
+{
+	auto key = MakeRenderTargetKey(framebuffer->m_basePtr, framebuffer->m_width, framebuffer->m_psm);
+	assert(m_framebufferIndex.find(key) == std::end(m_framebufferIndex));
+	framebuffer->m_lastUsedFrame = m_renderTargetFrame;
+	m_framebuffers.push_back(framebuffer);
+	m_framebufferIndex.insert(std::make_pair(key, framebuffer));
+	m_renderTargetMemorySize += framebuffer->m_memorySize;
+	UpdateRenderTargetStats();
+}
+
+void CGSH_OpenGL::AddDepthbuffer(const DepthbufferPtr& depthbuffer)
+{
+	auto key = MakeRenderTargetKey(depthbuffer->m_basePtr, depthbuffer->m_width, 0);
+	assert(m_depthbufferIndex.find(key) == std::end(m_depthbufferIndex));
+	depthbuffer->m_lastUsedFrame = m_renderTargetFrame;
+	m_depthbuffers.push_back(depthbuffer);
+	m_depthbufferIndex.insert(std::make_pair(key, depthbuffer));
+	m_renderTargetMemorySize += depthbuffer->m_memorySize;
+	UpdateRenderTargetStats();
+}
+
+void CGSH_OpenGL::ClearRenderTargets()
+{
+	m_framebuffers.clear();
+	m_depthbuffers.clear();
+	m_framebufferIndex.clear();
+	m_depthbufferIndex.clear();
+	m_renderTargetMemorySize = 0;
+	UpdateRenderTargetStats();
+}
+
+void CGSH_OpenGL::EvictRenderTargets()
+{
+	if(m_renderTargetMemorySize <= m_renderTargetBudget) return;
+
+	//We get rid of targets that haven't been used for a while, least recently used first, until we're
+	//within budget. What has been drawn to them is written back to RAM first, they will be rebuilt
+	//from it if they're needed again.
+	struct CANDIDATE
+	{
+		uint32 lastUsedFrame;
+		FramebufferPtr framebuffer;
+		DepthbufferPtr depthbuffer;
+	};
+
+	std::vector<CANDIDATE> candidates;
+	for(const auto& framebuffer : m_framebuffers)
+	{
+		if((m_renderTargetFrame - framebuffer->m_lastUsedFrame) < RENDERTARGET_MIN_IDLE_FRAMES) continue;
+		candidates.push_back({framebuffer->m_lastUsedFrame, framebuffer, DepthbufferPtr()});
+	}
+	for(const auto& depthbuffer : m_depthbuffers)
+	{
+#ifdef GLES_COMPATIBILITY
+		//Depth can't be read back, keep buffers holding values that aren't in RAM
+		if(!depthbuffer->m_gpuDirtyRect.IsEmpty()) continue;
+#endif
+		if((m_renderTargetFrame - depthbuffer->m_lastUsedFrame) < RENDERTARGET_MIN_IDLE_FRAMES) continue;
+		candidates.push_back({depthbuffer->m_lastUsedFrame, FramebufferPtr(), depthbuffer});
+	}
+
+	if(candidates.empty()) return;
+
+	std::stable_sort(candidates.begin(), candidates.end(),
+	                 [](const CANDIDATE& lhs, const CANDIDATE& rhs) { return lhs.lastUsedFrame < rhs.lastUsedFrame; });
+
+	for(const auto& candidate : candidates)
+	{
+		if(m_renderTargetMemorySize <= m_renderTargetBudget) break;
+		if(candidate.framebuffer)
+		{
+			const auto& framebuffer = candidate.framebuffer;
+			WriteBackFramebuffer(framebuffer);
+			m_framebufferIndex.erase(MakeRenderTargetKey(framebuffer->m_basePtr, framebuffer->m_width, framebuffer->m_psm));
+			m_framebuffers.erase(std::find(m_framebuffers.begin(), m_framebuffers.end(), framebuffer));
+			m_renderTargetMemorySize -= framebuffer->m_memorySize;
+		}
+		else
+		{
+			const auto& depthbuffer = candidate.depthbuffer;
+			WriteBackDepthbuffer(depthbuffer);
+			m_depthbufferIndex.erase(MakeRenderTargetKey(depthbuffer->m_basePtr, depthbuffer->m_width, 0));
+			m_depthbuffers.erase(std::find(m_depthbuffers.begin(), m_depthbuffers.end(), depthbuffer));
+			m_renderTargetMemorySize -= depthbuffer->m_memorySize;
+		}
+		m_stats.renderTargetEvictions++;
+	}
+
+	UpdateRenderTargetStats();
+}
+
+std::pair<uint32, uint32> CGSH_OpenGL::GetRenderTargetRange(uint32 basePtr, uint32 width, uint32 height, uint32 psm)
+{
+	auto pageSize = CGsPixelFormats::GetPsmPageSize(psm);
+	uint32 pageCountX = std::max<uint32>((width + pageSize.first - 1) / pageSize.first, 1);
+	uint32 pageCountY = (height + pageSize.second - 1) / pageSize.second;
+	uint32 size = std::min<uint32>(pageCountX * pageCountY * RAMPAGESIZE, RAMSIZE - basePtr);
+	return std::make_pair(basePtr, size);
+}
+
+void CGSH_OpenGL::WriteBackFramebuffer(const FramebufferPtr& framebuffer)
+{
+	auto& dirtyRect = framebuffer->m_gpuDirtyRect;
+	if(dirtyRect.IsEmpty()) return;
+
+	//Pending readback data goes to RAM as well, make sure it doesn't land over ours
+	CompletePendingReadback();
+	ResolveFramebufferMultisample(framebuffer, m_fbScale);
+
+	uint32 width = dirtyRect.x1 - dirtyRect.x0;
+	uint32 height = dirtyRect.y1 - dirtyRect.y0;
+	uint32 scaledWidth = width * m_fbScale;
+	std::vector<uint32> pixels(scaledWidth * height * m_fbScale);
+
+	GLuint readFramebuffer = (framebuffer->m_resolveFramebuffer != 0) ? framebuffer->m_resolveFramebuffer : framebuffer->m_framebuffer;
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer);
+	glReadPixels(dirtyRect.x0 * m_fbScale, dirtyRect.y0 * m_fbScale, scaledWidth, height * m_fbScale, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	CHECKGLERROR();
+
+	//Take one sample per PS2 pixel when rendering is upscaled
+	auto getPixel = [&](uint32 x, uint32 y) { return pixels[(x * m_fbScale) + (y * m_fbScale * scaledWidth)]; };
+	auto writePixels16 =
+	    [&](auto indexor) {
+		    for(uint32 y = 0; y < height; y++)
+		    {
+			    for(uint32 x = 0; x < width; x++)
+			    {
+				    uint32 pixel = getPixel(x, y);
+				    auto cvtPixel =
+				        ((pixel >> 3) & 0x001F) |         //R
+				        (((pixel >> 11) & 0x1F) << 5) |   //G
+				        (((pixel >> 19) & 0x1F) << 10) |  //B
+				        ((pixel & 0x80000000) ? 0x8000 : 0); //A
+				    indexor.SetPixel(dirtyRect.x0 + x, dirtyRect.y0 + y, static_cast<uint16>(cvtPixel));
+			    }
+		    }
+	    };
+
+	uint32 bufWidth = framebuffer->m_width / 64;
+	switch(framebuffer->m_psm)
+	{
+	case PSMCT32:
+	case PSMCT24:
+	case PSMCT32_UNK:
+	case PSMCT24_UNK:
+	{
+		//Alpha isn't part of 24-bit framebuffers, leave what's in RAM
+		bool is24Bits = (framebuffer->m_psm == PSMCT24) || (framebuffer->m_psm == PSMCT24_UNK);
+		CGsPixelFormats::CPixelIndexorPSMCT32 indexor(m_pRAM, framebuffer->m_basePtr, bufWidth);
+		for(uint32 y = 0; y < height; y++)
+		{
+			for(uint32 x = 0; x < width; x++)
+			{
+				uint32 pixel = getPixel(x, y);
+				if(is24Bits)
+				{
+					pixel = (pixel & 0x00FFFFFF) | (indexor.GetPixel(dirtyRect.x0 + x, dirtyRect.y0 + y) & 0xFF000000);
+				}
+				indexor.SetPixel(dirtyRect.x0 + x, dirtyRect.y0 + y, pixel);
+			}
+		}
+	}
+	break;
+	case PSMCT16:
+		writePixels16(CGsPixelFormats::CPixelIndexorPSMCT16(m_pRAM, framebuffer->m_basePtr, bufWidth));
+		break;
+	case PSMCT16S:
+		writePixels16(CGsPixelFormats::CPixelIndexorPSMCT16S(m_pRAM, framebuffer->m_basePtr, bufWidth));
+		break;
+	default:
+		assert(false);
+		break;
+	}
+
+	auto [address, size] = GetRenderTargetRange(framebuffer->m_basePtr, framebuffer->m_width, dirtyRect.y1, framebuffer->m_psm);
+	IncrementRamPageVersions(address, size);
+	m_textureCache.InvalidateRange(address, size);
+	m_renderState.isTextureStateValid = false;
+
+	dirtyRect = GPU_DIRTY_RECT();
+}
+
+void CGSH_OpenGL::WriteBackDepthbuffer(const DepthbufferPtr& depthbuffer)
+{
+	auto& dirtyRect = depthbuffer->m_gpuDirtyRect;
+	if(dirtyRect.IsEmpty()) return;
+
+#ifndef GLES_COMPATIBILITY
+	CompletePendingReadback();
+
+	uint32 width = dirtyRect.x1 - dirtyRect.x0;
+	uint32 height = dirtyRect.y1 - dirtyRect.y0;
+	uint32 scaledWidth = width * m_fbScale;
+	uint32 scaledHeight = height * m_fbScale;
+
+	//Depth buffer might be multisampled, resolve the area we need in a single sampled buffer before reading it
+	GLuint resolveDepthBuffer = 0;
+	glGenRenderbuffers(1, &resolveDepthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, resolveDepthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT32F, scaledWidth, scaledHeight);
+
+	GLuint framebuffers[2] = {};
+	glGenFramebuffers(2, framebuffers);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffers[0]);
+	glFramebufferRenderbuffer(GL_READ_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthbuffer->m_depthBuffer);
+	glReadBuffer(GL_NONE);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffers[1]);
+	glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, resolveDepthBuffer);
+	glDrawBuffer(GL_NONE);
+
+	m_validGlState &= ~(GLSTATE_SCISSOR | GLSTATE_FRAMEBUFFER);
+	glDisable(GL_SCISSOR_TEST);
+	glBlitFramebuffer(
+	    dirtyRect.x0 * m_fbScale, dirtyRect.y0 * m_fbScale, dirtyRect.x1 * m_fbScale, dirtyRect.y1 * m_fbScale,
+	    0, 0, scaledWidth, scaledHeight,
+	    GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+	std::vector<float> depths(scaledWidth * scaledHeight);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffers[1]);
+	glReadPixels(0, 0, scaledWidth, scaledHeight, GL_DEPTH_COMPONENT, GL_FLOAT, depths.data());
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(2, framebuffers);
+	glDeleteRenderbuffers(1, &resolveDepthBuffer);
+	CHECKGLERROR();
+
+	//Inverse of the mapping done in the vertex shader
+	auto getDepth =
+	    [&](uint32 x, uint32 y) {
+		    double depth = depths[(x * m_fbScale) + (y * m_fbScale * scaledWidth)];
+		    return static_cast<uint32>(std::clamp(depth * 4294967296.0, 0.0, 4294967295.0));
+	    };
+
+	uint32 bufWidth = depthbuffer->m_width / 64;
+	uint32 psm = depthbuffer->m_psm | 0x30;
+	switch(psm)
+	{
+	case PSMZ32:
+	case PSMZ24:
+	{
+		//Upper bits aren't part of 24-bit depth buffers, leave what's in RAM
+		uint32 depthMask = (psm == PSMZ24) ? 0x00FFFFFF : 0xFFFFFFFF;
+		CGsPixelFormats::CPixelIndexorPSMZ32 indexor(m_pRAM, depthbuffer->m_basePtr, bufWidth);
+		for(uint32 y = 0; y < height; y++)
+		{
+			for(uint32 x = 0; x < width; x++)
+			{
+				uint32 depth = std::min(getDepth(x, y), depthMask);
+				uint32 prevDepth = indexor.GetPixel(dirtyRect.x0 + x, dirtyRect.y0 + y);
+				indexor.SetPixel(dirtyRect.x0 + x, dirtyRect.y0 + y, (depth & depthMask) | (prevDepth & ~depthMask));
+			}
+		}
+	}
+	break;
+	case PSMZ16:
+	case PSMZ16S:
+	{
+		auto writeDepths16 =
+		    [&](auto indexor) {
+			    for(uint32 y = 0; y < height; y++)
+			    {
+				    for(uint32 x = 0; x < width; x++)
+				    {
+					    uint32 depth = std::min<uint32>(getDepth(x, y), 0xFFFF);
+					    indexor.SetPixel(dirtyRect.x0 + x, dirtyRect.y0 + y, static_cast<uint16>(depth));
+				    }
+			    }
+		    };
+		if(psm == PSMZ16)
+		{
+			writeDepths16(CGsPixelFormats::CPixelIndexor<CGsPixelFormats::STORAGEPSMZ16>(m_pRAM, depthbuffer->m_basePtr, bufWidth));
+		}
+		else
+		{
+			writeDepths16(CGsPixelFormats::CPixelIndexorPSMZ16S(m_pRAM, depthbuffer->m_basePtr, bufWidth));
+		}
+	}
+	break;
+	default:
+		assert(false);
+		break;
+	}
+
+	auto [address, size] = GetRenderTargetRange(depthbuffer->m_basePtr, depthbuffer->m_width, dirtyRect.y1, psm);
+	IncrementRamPageVersions(address, size);
+	m_textureCache.InvalidateRange(address, size);
+	m_renderState.isTextureStateValid = false;
+#endif
+
+	dirtyRect = GPU_DIRTY_RECT();
+}
+
+void CGSH_OpenGL::UpdateRenderTargetStats()
+{
+	m_stats.renderTargetCount = static_cast<uint32>(m_framebuffers.size() + m_depthbuffers.size());
+	m_stats.renderTargetBytes = m_renderTargetMemorySize;
 }
 
 /////////////////////////////////////////////////////////////
@@ -1662,16 +2080,14 @@ void CGSH_OpenGL::DoRenderPass()
 {
 	if((m_validGlState & GLSTATE_VERTEX_PARAMS) == 0)
 	{
-		glBindBuffer(GL_UNIFORM_BUFFER, m_vertexParamsBuffer);
-		glBufferData(GL_UNIFORM_BUFFER, sizeof(VERTEXPARAMS), &m_vertexParams, GL_STREAM_DRAW);
+		m_vertexParamsOffset = m_vertexParamsBuffer.Write(&m_vertexParams, sizeof(VERTEXPARAMS), m_uniformBufferOffsetAlignment);
 		CHECKGLERROR();
 		m_validGlState |= GLSTATE_VERTEX_PARAMS;
 	}
 
 	if((m_validGlState & GLSTATE_FRAGMENT_PARAMS) == 0)
 	{
-		glBindBuffer(GL_UNIFORM_BUFFER, m_fragmentParamsBuffer);
-		glBufferData(GL_UNIFORM_BUFFER, sizeof(FRAGMENTPARAMS), &m_fragmentParams, GL_STREAM_DRAW);
+		m_fragmentParamsOffset = m_fragmentParamsBuffer.Write(&m_fragmentParams, sizeof(FRAGMENTPARAMS), m_uniformBufferOffsetAlignment);
 		CHECKGLERROR();
 		m_validGlState |= GLSTATE_FRAGMENT_PARAMS;
 	}
@@ -1748,11 +2164,10 @@ void CGSH_OpenGL::DoRenderPass()
 		m_validGlState |= GLSTATE_FRAMEBUFFER;
 	}
 
-	glBindBufferBase(GL_UNIFORM_BUFFER, 0, m_vertexParamsBuffer);
-	glBindBufferBase(GL_UNIFORM_BUFFER, 1, m_fragmentParamsBuffer);
+	glBindBufferRange(GL_UNIFORM_BUFFER, 0, m_vertexParamsBuffer.GetBuffer(), m_vertexParamsOffset, sizeof(VERTEXPARAMS));
+	glBindBufferRange(GL_UNIFORM_BUFFER, 1, m_fragmentParamsBuffer.GetBuffer(), m_fragmentParamsOffset, sizeof(FRAGMENTPARAMS));
 
-	glBindBuffer(GL_ARRAY_BUFFER, m_primBuffer);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(PRIM_VERTEX) * m_vertexBuffer.size(), m_vertexBuffer.data(), GL_STREAM_DRAW);
+	uint32 vertexBufferOffset = m_primBuffer.Write(m_vertexBuffer.data(), sizeof(PRIM_VERTEX) * m_vertexBuffer.size(), sizeof(PRIM_VERTEX));
 
 	glBindVertexArray(m_primVertexArray);
 
@@ -1777,7 +2192,7 @@ void CGSH_OpenGL::DoRenderPass()
 		break;
 	}
 
-	glDrawArrays(primitiveMode, 0, m_vertexBuffer.size());
+	glDrawArrays(primitiveMode, vertexBufferOffset / sizeof(PRIM_VERTEX), m_vertexBuffer.size());
 
 	m_drawCallCount++;
 }
@@ -1868,6 +2283,23 @@ void CGSH_OpenGL::CopyToFb(
 
 void CGSH_OpenGL::WriteRegisterImpl(uint8 nRegister, uint64 nData)
 {
+	//Readback data needs to be in RAM before a CLUT load or a transfer uses RAM
+	switch(nRegister)
+	{
+	case GS_REG_TEX0_1:
+	case GS_REG_TEX0_2:
+	case GS_REG_TEX2_1:
+	case GS_REG_TEX2_2:
+		if(make_convertible<TEX0>(nData).nCLD != 0)
+		{
+			CompletePendingReadback();
+		}
+		break;
+	case GS_REG_TRXDIR:
+		CompletePendingReadback();
+		break;
+	}
+
 	CGSHandler::WriteRegisterImpl(nRegister, nData);
 
 	switch(nRegister)
@@ -2004,6 +2436,12 @@ void CGSH_OpenGL::VertexKick(uint8 nRegister, uint64 nValue)
 		{
 			DrawToDepth(m_primitiveType, m_PrimitiveMode);
 		}
+
+		//Keep batches within the size of a stream buffer segment
+		if(m_vertexBuffer.size() >= VERTEX_BUFFER_SIZE)
+		{
+			FlushVertexBuffer();
+		}
 	}
 }
 
@@ -2058,26 +2496,81 @@ void CGSH_OpenGL::ProcessLocalToHostTransfer()
 	FlushVertexBuffer();
 	m_renderState.isValid = false;
 
-	auto pixels = new uint32[trxReg.nRRW * trxReg.nRRH];
+	//Readback buffer is about to be reused
+	CompletePendingReadback();
 
 	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer->m_framebuffer);
-	glReadPixels(trxPos.nSSAX, trxPos.nSSAY, trxReg.nRRW, trxReg.nRRH, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, m_readbackBuffer);
+	glBufferData(GL_PIXEL_PACK_BUFFER, trxReg.nRRW * trxReg.nRRH * sizeof(uint32), nullptr, GL_STREAM_READ);
+	glReadPixels(trxPos.nSSAX, trxPos.nSSAY, trxReg.nRRW, trxReg.nRRH, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	CHECKGLERROR();
+
+	//Data is written back to RAM when it's actually read (SyncTransferRead)
+	m_pendingReadback.bltBuf = bltBuf;
+	m_pendingReadback.trxPos = trxPos;
+	m_pendingReadback.trxReg = trxReg;
+	m_pendingReadback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void CGSH_OpenGL::SyncTransferRead()
+{
+	CompletePendingReadback();
+}
+
+void CGSH_OpenGL::SyncMemoryCache()
+{
+	CompletePendingReadback();
+}
+
+void CGSH_OpenGL::CompletePendingReadback()
+{
+	if(!m_pendingReadback.fence) return;
+
+	while(glClientWaitSync(m_pendingReadback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_WAIT_TIMEOUT) == GL_TIMEOUT_EXPIRED)
+	{
+	}
+	glDeleteSync(m_pendingReadback.fence);
+	m_pendingReadback.fence = nullptr;
+
+	const auto& bltBuf = m_pendingReadback.bltBuf;
+	const auto& trxPos = m_pendingReadback.trxPos;
+	const auto& trxReg = m_pendingReadback.trxReg;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, m_readbackBuffer);
+	auto pixels = reinterpret_cast<const uint32*>(
+	    glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, trxReg.nRRW * trxReg.nRRH * sizeof(uint32), GL_MAP_READ_BIT));
 	CHECKGLERROR();
 
 	//Write back to RAM
+	if(pixels)
 	{
 		CGsPixelFormats::CPixelIndexorPSMCT32 indexor(m_pRAM, bltBuf.GetSrcPtr(), bltBuf.nSrcWidth);
-		for(uint32 y = trxPos.nSSAY; y < (trxPos.nSSAY + trxReg.nRRH); y++)
+		for(uint32 y = 0; y < trxReg.nRRH; y++)
 		{
-			for(uint32 x = trxPos.nSSAX; x < (trxPos.nSSAX + trxReg.nRRH); x++)
+			for(uint32 x = 0; x < trxReg.nRRW; x++)
 			{
 				uint32 pixel = pixels[x + (y * trxReg.nRRW)];
-				indexor.SetPixel(x, y, pixel);
+				indexor.SetPixel(trxPos.nSSAX + x, trxPos.nSSAY + y, pixel);
 			}
 		}
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
 	}
 
-	delete[] pixels;
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	//RAM changed after the transfer started, anything cached from it is stale
+	auto [transferAddress, transferSize] = GsTransfer::GetSrcRange(bltBuf, trxReg, trxPos);
+	IncrementRamPageVersions(transferAddress, transferSize);
+	m_textureCache.InvalidateRange(transferAddress, transferSize);
+	m_renderState.isTextureStateValid = false;
+}
+
+void CGSH_OpenGL::DiscardPendingReadback()
+{
+	if(!m_pendingReadback.fence) return;
+	glDeleteSync(m_pendingReadback.fence);
+	m_pendingReadback.fence = nullptr;
 }
 
 void CGSH_OpenGL::ProcessLocalToLocalTransfer()
@@ -2116,6 +2609,12 @@ void CGSH_OpenGL::ProcessLocalToLocalTransfer()
 		CHECKGLERROR();
 
 		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+		//Parts of the source that came from the GPU are now in the destination as well
+		const auto& srcDirtyRect = srcFramebuffer->m_gpuDirtyRect;
+		dstFramebuffer->m_gpuDirtyRect.Add(
+		    std::min(srcDirtyRect.x0, dstFramebuffer->m_width), std::min(srcDirtyRect.y0, dstFramebuffer->m_height),
+		    std::min(srcDirtyRect.x1, dstFramebuffer->m_width), std::min(srcDirtyRect.y1, dstFramebuffer->m_height));
 	}
 	else if(foundSrc && !foundDest)
 	{
@@ -2354,6 +2853,12 @@ CGSH_OpenGL::CFramebuffer::CFramebuffer(uint32 basePtr, uint32 width, uint32 hei
 {
 	m_cachedArea.SetArea(psm, basePtr, width, height);
 
+	m_memorySize = static_cast<uint64>(m_width * scale) * static_cast<uint64>(m_height * scale) * sizeof(uint32);
+	if(multisampled)
+	{
+		m_memorySize *= (NUM_SAMPLES + 1);
+	}
+
 	//Build color attachment
 	glGenTextures(1, &m_texture);
 	glBindTexture(GL_TEXTURE_2D, m_texture);
@@ -2555,6 +3060,12 @@ CGSH_OpenGL::CDepthbuffer::CDepthbuffer(uint32 basePtr, uint32 width, uint32 hei
     , m_psm(psm)
     , m_depthBuffer(0)
 {
+	m_memorySize = static_cast<uint64>(m_width * scale) * static_cast<uint64>(m_height * scale) * sizeof(float);
+	if(multisampled)
+	{
+		m_memorySize *= NUM_SAMPLES;
+	}
+
 	//Build depth attachment
 	glGenRenderbuffers(1, &m_depthBuffer);
 	glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
@@ -2576,3 +3087,122 @@ CGSH_OpenGL::CDepthbuffer::~CDepthbuffer()
 		glDeleteRenderbuffers(1, &m_depthBuffer);
 	}
 }
+
+/////////////////////////////////////////////////////////////
+// Stream Buffer
+/////////////////////////////////////////////////////////////
+
+void CGSH_OpenGL::CStreamBuffer::Create(GLenum target, uint32 segmentSize, bool persistent)
+{
+	Reset();
+
+	m_target = target;
+	m_segmentSize = segmentSize;
+	m_buffer = Framework::OpenGl::CBuffer::Create();
+
+#ifdef USE_PERSISTENT_BUFFERS
+	if(persistent)
+	{
+		static const GLbitfield mapFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		uint32 bufferSize = m_segmentSize * SEGMENT_COUNT;
+		glBindBuffer(m_target, m_buffer);
+		glBufferStorage(m_target, bufferSize, nullptr, mapFlags);
+		m_mappedBuffer = reinterpret_cast<uint8*>(glMapBufferRange(m_target, 0, bufferSize, mapFlags));
+		glBindBuffer(m_target, 0);
+		CHECKGLERROR();
+		if(!m_mappedBuffer)
+		{
+			//Storage is immutable, start over with a new buffer that will be orphaned on writes
+			m_buffer = Framework::OpenGl::CBuffer::Create();
+		}
+	}
+#endif
+}
+
+void CGSH_OpenGL::CStreamBuffer::Reset()
+{
+	for(auto& fence : m_segmentFences)
+	{
+		if(fence)
+		{
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+	}
+	//Deleting the buffer also unmaps it
+	m_buffer.Reset();
+	m_mappedBuffer = nullptr;
+	m_offset = 0;
+	m_currentSegment = 0;
+}
+
+uint32 CGSH_OpenGL::CStreamBuffer::Write(const void* data, uint32 size, uint32 alignment)
+{
+	if(!m_mappedBuffer)
+	{
+		glBindBuffer(m_target, m_buffer);
+		glBufferData(m_target, size, data, GL_STREAM_DRAW);
+		return 0;
+	}
+
+	uint32 offset = Allocate(size, alignment);
+	memcpy(m_mappedBuffer + offset, data, size);
+	return offset;
+}
+
+uint32 CGSH_OpenGL::CStreamBuffer::Allocate(uint32 size, uint32 alignment)
+{
+	assert(m_mappedBuffer);
+	assert(size <= m_segmentSize);
+	uint32 offset = ((m_offset + alignment - 1) / alignment) * alignment;
+	if((offset + size) > (m_segmentSize * SEGMENT_COUNT))
+	{
+		offset = 0;
+	}
+
+	//Fence the segments we're leaving and make sure the GPU is done with the ones we're entering
+	uint32 endSegment = (offset + size - 1) / m_segmentSize;
+	while(m_currentSegment != endSegment)
+	{
+		assert(!m_segmentFences[m_currentSegment]);
+		m_segmentFences[m_currentSegment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		m_currentSegment = (m_currentSegment + 1) % SEGMENT_COUNT;
+		WaitForSegment(m_currentSegment);
+	}
+
+	m_offset = offset + size;
+	return offset;
+}
+
+GLuint CGSH_OpenGL::CStreamBuffer::GetBuffer() const
+{
+	return m_buffer;
+}
+
+uint8* CGSH_OpenGL::CStreamBuffer::GetMappedBuffer() const
+{
+	return m_mappedBuffer;
+}
+
+bool CGSH_OpenGL::CStreamBuffer::IsMapped() const
+{
+	return (m_mappedBuffer != nullptr);
+}
+
+uint32 CGSH_OpenGL::CStreamBuffer::GetSegmentSize() const
+{
+	return m_segmentSize;
+}
+
+void CGSH_OpenGL::CStreamBuffer::WaitForSegment(uint32 segment)
+{
+	auto& fence = m_segmentFences[segment];
+	if(!fence) return;
+	while(true)
+	{
+		GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_WAIT_TIMEOUT);
+		if(result != GL_TIMEOUT_EXPIRED) break;
+	}
+	glDeleteSync(fence);
+	fence = nullptr;
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <list>
+#include <algorithm>
 #include <unordered_map>
 #include "../GSHandler.h"
 #include "../GsDebuggerInterface.h"
@@ -13,6 +14,8 @@
 
 #define PREF_CGSH_OPENGL_RESOLUTION_FACTOR "renderer.opengl.resfactor"
 #define PREF_CGSH_OPENGL_FORCEBILINEARTEXTURES "renderer.opengl.forcebilineartextures"
+#define PREF_CGSH_OPENGL_ASYNCSHADERCOMPILATION "renderer.opengl.asyncshadercompilation"
+#define PREF_CGSH_OPENGL_RENDERTARGETBUDGET "renderer.opengl.rendertargetbudget"
 
 #if !defined(GLES_COMPATIBILITY) && !defined(__APPLE__)
 //- Dual source blending is disabled on macOS because it seems to be problematic on
@@ -20,6 +23,12 @@
 #define USE_DUALSOURCE_BLENDING
 #endif
 
+#if !defined(GLES_COMPATIBILITY) && !defined(__APPLE__)
+//- Persistently mapped buffers require GL 4.4 or ARB_buffer_storage, which
+//  are not available on GLES and macOS.
+#define USE_PERSISTENT_BUFFERS
+#endif
+
 class CGSH_OpenGL : public CGSHandler, public CGsDebuggerInterface
 {
 public:
@@ -62,6 +71,8 @@ protected:
 	void ResetImpl() override;
 	void NotifyPreferencesChangedImpl() override;
 	void FlipImpl(const DISPLAY_INFO&) override;
+	void SyncTransferRead() override;
+	void SyncMemoryCache() override;
 
 	GLuint m_presentFramebuffer = 0;
 
@@ -184,6 +195,19 @@ private:
 		CVTBUFFERSIZE = 0x800000,
 	};
 
+	enum
+	{
+		//Large enough for a 1024x1024 32-bit texture
+		TEXTURE_UPLOAD_SEGMENT_SIZE = 0x400000,
+		TEXTURE_UPLOAD_ALIGNMENT = 0x10,
+	};
+
+	enum
+	{
+		//Render targets not used for this many frames can be evicted when over budget
+		RENDERTARGET_MIN_IDLE_FRAMES = 4,
+	};
+
 	typedef void (CGSH_OpenGL::*TEXTUREUPDATER)(uint32, uint32, unsigned int, unsigned int, unsigned int, unsigned int);
 
 	enum
@@ -205,6 +229,13 @@ private:
 
 	typedef std::unordered_map<ShaderCapsInt, Framework::OpenGl::ProgramPtr> ShaderMap;
 
+	struct PROGRAM_BINARY
+	{
+		GLenum format = 0;
+		std::vector<uint8> data;
+	};
+	typedef std::unordered_map<ShaderCapsInt, PROGRAM_BINARY> ProgramBinaryMap;
+
 	class CPalette
 	{
 	public:
@@ -225,6 +256,39 @@ private:
 	typedef std::shared_ptr<CPalette> PalettePtr;
 	typedef std::list<PalettePtr> PaletteList;
 
+	//Area of a render target that has been drawn to by the GPU and isn't in RAM, in pixels
+	struct GPU_DIRTY_RECT
+	{
+		uint32 x0 = 0;
+		uint32 y0 = 0;
+		uint32 x1 = 0;
+		uint32 y1 = 0;
+
+		bool IsEmpty() const
+		{
+			return (x0 >= x1) || (y0 >= y1);
+		}
+
+		void Add(uint32 addX0, uint32 addY0, uint32 addX1, uint32 addY1)
+		{
+			if((addX0 >= addX1) || (addY0 >= addY1)) return;
+			if(IsEmpty())
+			{
+				x0 = addX0;
+				y0 = addY0;
+				x1 = addX1;
+				y1 = addY1;
+			}
+			else
+			{
+				x0 = std::min(x0, addX0);
+				y0 = std::min(y0, addY0);
+				x1 = std::max(x1, addX1);
+				y1 = std::max(y1, addY1);
+			}
+		}
+	};
+
 	class CFramebuffer
 	{
 	public:
@@ -244,6 +308,10 @@ private:
 		GLuint m_colorBufferMs = 0;
 
 		CGsCachedArea m_cachedArea;
+
+		uint64 m_memorySize = 0;
+		uint32 m_lastUsedFrame = 0;
+		GPU_DIRTY_RECT m_gpuDirtyRect;
 	};
 	typedef std::shared_ptr<CFramebuffer> FramebufferPtr;
 	typedef std::vector<FramebufferPtr> FramebufferList;
@@ -259,10 +327,56 @@ private:
 		uint32 m_height;
 		uint32 m_psm;
 		GLuint m_depthBuffer;
+
+		uint64 m_memorySize = 0;
+		uint32 m_lastUsedFrame = 0;
+		GPU_DIRTY_RECT m_gpuDirtyRect;
 	};
 	typedef std::shared_ptr<CDepthbuffer> DepthbufferPtr;
 	typedef std::vector<DepthbufferPtr> DepthbufferList;
 
+	//Render targets are indexed by base pointer, width and PSM compatibility class
+	typedef uint64 RenderTargetKey;
+	typedef std::unordered_map<RenderTargetKey, FramebufferPtr> FramebufferMap;
+	typedef std::unordered_map<RenderTargetKey, DepthbufferPtr> DepthbufferMap;
+
+	//Ring buffer used to stream draw data to the GPU. When persistent mapping is available,
+	//data is copied straight into the mapped buffer and fences make sure we don't overwrite
+	//a segment still in use by the GPU. Otherwise, the buffer is orphaned on every write.
+	class CStreamBuffer
+	{
+	public:
+		void Create(GLenum, uint32, bool);
+		void Reset();
+
+		//Returns the offset at which the data was written
+		uint32 Write(const void*, uint32, uint32);
+
+		//Reserves space in a mapped buffer, returns the offset of the reserved space
+		uint32 Allocate(uint32, uint32);
+
+		GLuint GetBuffer() const;
+		uint8* GetMappedBuffer() const;
+		bool IsMapped() const;
+		uint32 GetSegmentSize() const;
+
+	private:
+		enum
+		{
+			SEGMENT_COUNT = 4,
+		};
+
+		void WaitForSegment(uint32);
+
+		Framework::OpenGl::CBuffer m_buffer;
+		GLenum m_target = GL_NONE;
+		uint8* m_mappedBuffer = nullptr;
+		uint32 m_segmentSize = 0;
+		uint32 m_offset = 0;
+		uint32 m_currentSegment = 0;
+		GLsync m_segmentFences[SEGMENT_COUNT] = {};
+	};
+
 	struct TEXTURE_INFO
 	{
 		GLuint textureHandle = 0;
@@ -279,6 +393,15 @@ private:
 		GLenum type;
 	};
 
+	//Local to host transfer waiting for its data to be written back to RAM
+	struct PENDING_READBACK
+	{
+		BITBLTBUF bltBuf;
+		TRXPOS trxPos;
+		TRXREG trxReg;
+		GLsync fence = nullptr;
+	};
+
 	enum class PRIM_VERTEX_ATTRIB
 	{
 		POSITION = 1,
@@ -299,7 +422,14 @@ private:
 
 	enum VERTEX_BUFFER_SIZE
 	{
-		VERTEX_BUFFER_SIZE = 0x1000,
+		VERTEX_BUFFER_SIZE = 0x8000,
+	};
+
+	enum
+	{
+		//A batch can go over VERTEX_BUFFER_SIZE by a few vertices before being flushed
+		VERTEX_STREAM_SEGMENT_SIZE = VERTEX_BUFFER_SIZE * 2 * sizeof(PRIM_VERTEX),
+		UNIFORM_STREAM_SEGMENT_SIZE = 0x10000,
 	};
 
 	typedef std::vector<PRIM_VERTEX> VertexBuffer;
@@ -319,13 +449,19 @@ private:
 	void VertexKick(uint8, uint64);
 
 	Framework::OpenGl::ProgramPtr GetShaderFromCaps(const SHADERCAPS&);
-	Framework::OpenGl::ProgramPtr GenerateShader(const SHADERCAPS&);
-	Framework::OpenGl::CShader GenerateVertexShader(const SHADERCAPS&);
-	Framework::OpenGl::CShader GenerateFragmentShader(const SHADERCAPS&);
+	Framework::OpenGl::ProgramPtr GetFallbackShader(const SHADERCAPS&);
+	void RegisterShader(const SHADERCAPS&, const Framework::OpenGl::ProgramPtr&);
+	Framework::OpenGl::ProgramPtr GenerateShader(const SHADERCAPS&, bool);
+	Framework::OpenGl::CShader GenerateVertexShader(const SHADERCAPS&, bool);
+	Framework::OpenGl::CShader GenerateFragmentShader(const SHADERCAPS&, bool);
 	std::string GenerateTexCoordClampingSection(TEXTURE_CLAMP_MODE, const char*);
 	std::string GenerateAlphaTestSection(ALPHA_TEST_METHOD, ALPHA_TEST_FAIL_METHOD);
 	std::string GenerateAlphaBlendSection(ALPHABLEND_ABD, ALPHABLEND_ABD, ALPHABLEND_C, ALPHABLEND_ABD);
 
+	void LoadShaderCache();
+	void SaveShaderCache();
+	void AddProgramBinary(const SHADERCAPS&, const Framework::OpenGl::ProgramPtr&);
+
 	Framework::OpenGl::ProgramPtr GeneratePresentProgram();
 	Framework::OpenGl::CBuffer GeneratePresentVertexBuffer();
 	Framework::OpenGl::CVertexArray GeneratePresentVertexArray();
@@ -335,7 +471,6 @@ private:
 	Framework::OpenGl::CVertexArray GenerateCopyToFbVertexArray();
 
 	Framework::OpenGl::CVertexArray GeneratePrimVertexArray();
-	Framework::OpenGl::CBuffer GenerateUniformBlockBuffer(size_t);
 
 	void Prim_Point();
 	void Prim_Line();
@@ -364,14 +499,30 @@ private:
 	static uint32 GetFramebufferBitDepth(uint32);
 	static TEXTUREFORMAT_INFO GetTextureFormatInfo(uint32);
 
-	FramebufferPtr FindFramebuffer(const FRAME&) const;
-	DepthbufferPtr FindDepthbuffer(const ZBUF&, const FRAME&) const;
+	FramebufferPtr FindFramebuffer(const FRAME&);
+	DepthbufferPtr FindDepthbuffer(const ZBUF&, const FRAME&);
+	void AddFramebuffer(const FramebufferPtr&);
+	void AddDepthbuffer(const DepthbufferPtr&);
+	void ClearRenderTargets();
+	void EvictRenderTargets();
+	void WriteBackFramebuffer(const FramebufferPtr&);
+	void WriteBackDepthbuffer(const DepthbufferPtr&);
+	//Returns the range of RAM covered by a render target (base pointer, width, height, PSM)
+	static std::pair<uint32, uint32> GetRenderTargetRange(uint32, uint32, uint32, uint32);
+	void UpdateRenderTargetStats();
+	static RenderTargetKey MakeRenderTargetKey(uint32, uint32, uint32);
 
 	void DumpTexture(unsigned int, unsigned int, uint32);
 
 	Framework::CBitmap GetFramebufferImpl(uint64);
 	Framework::CBitmap GetTextureImpl(uint64, uint32, uint64, uint64, uint32);
 
+	uint8* BeginTextureUpload(uint32);
+	void EndTextureUpload(unsigned int, unsigned int, unsigned int, unsigned int, GLenum, GLenum);
+
+	void CompletePendingReadback();
+	void DiscardPendingReadback();
+
 	//Texture updaters
 	void TexUpdater_Invalid(uint32, uint32, unsigned int, unsigned int, unsigned int, unsigned int);
 
@@ -394,6 +545,10 @@ private:
 	uint32 m_nTexHeight;
 
 	bool m_forceBilinearTextures = false;
+	//Programs are compiled in the background, draws needing one that isn't ready yet
+	//use a fog-less variant if it's available or wait for the compilation otherwise
+	bool m_asyncShaderCompilation = false;
+	uint64 m_renderTargetBudget = 0;
 	unsigned int m_fbScale = 1;
 	bool m_multisampleEnabled = false;
 	bool m_depthTestingEnabled = true;
@@ -428,8 +583,12 @@ private:
 	PaletteList m_paletteCache;
 	FramebufferList m_framebuffers;
 	DepthbufferList m_depthbuffers;
+	FramebufferMap m_framebufferIndex;
+	DepthbufferMap m_depthbufferIndex;
+	uint32 m_renderTargetFrame = 0;
+	uint64 m_renderTargetMemorySize = 0;
 
-	Framework::OpenGl::CBuffer m_primBuffer;
+	CStreamBuffer m_primBuffer;
 	Framework::OpenGl::CVertexArray m_primVertexArray;
 
 	VERTEX m_VtxBuffer[3];
@@ -464,14 +623,42 @@ private:
 
 	ShaderMap m_shaders;
 	RENDERSTATE m_renderState;
+
+	//Programs that are being compiled by the driver in the background
+	ShaderMap m_pendingShaders;
+
+	//Program binaries retrieved from the driver, saved to disk on release
+	ProgramBinaryMap m_programBinaries;
+	bool m_programBinariesDirty = false;
+
 	uint32 m_validGlState = 0;
 	VERTEXPARAMS m_vertexParams;
 	FRAGMENTPARAMS m_fragmentParams;
-	Framework::OpenGl::CBuffer m_vertexParamsBuffer;
-	Framework::OpenGl::CBuffer m_fragmentParamsBuffer;
+	CStreamBuffer m_vertexParamsBuffer;
+	CStreamBuffer m_fragmentParamsBuffer;
+	uint32 m_vertexParamsOffset = 0;
+	uint32 m_fragmentParamsOffset = 0;
+	uint32 m_uniformBufferOffsetAlignment = 1;
+
+	//Converted texture data is written straight into this buffer when it can be mapped
+	CStreamBuffer m_textureUploadBuffer;
+	uint32 m_textureUploadOffset = 0;
+	bool m_textureUploadInBuffer = false;
+
+	Framework::OpenGl::CBuffer m_readbackBuffer;
+	PENDING_READBACK m_pendingReadback;
 	VertexBuffer m_vertexBuffer;
 
 	//If GPU has framebuffer fetch extension, some things will be done
 	//within the shader, such alpha blending
 	bool m_hasFramebufferFetchExtension = false;
+
+	//Allows streaming vertices and uniforms through persistently mapped buffers
+	bool m_hasBufferStorageExtension = false;
+
+	//Allows caching linked programs on disk
+	bool m_hasProgramBinarySupport = false;
+
+	//Allows compiling and linking programs without blocking the GS thread
+	bool m_hasParallelShaderCompileExtension = false;
 };
@@ -1,6 +1,10 @@
 #include "GSH_OpenGL.h"
 #include <assert.h>
 #include <sstream>
+#include "../../AppConfig.h"
+#include "../../Log.h"
+#include "PathUtils.h"
+#include "StdStreamUtils.h"
 
 #ifdef GLES_COMPATIBILITY
 #define GLSL_VERSION "#version 300 es"
@@ -8,6 +12,18 @@
 #define GLSL_VERSION "#version 150"
 #endif
 
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+#define LOG_NAME "gsh_opengl"
+
+#define SHADER_CACHE_DIRECTORY "shadercache"
+#define SHADER_CACHE_FILENAME "opengl_programs.bin"
+#define SHADER_CACHE_MAGIC 0x424C4750
+//Increment this when shader generation changes to invalidate existing caches
+#define SHADER_CACHE_VERSION 2
+
 static const char* s_andFunction =
     "float and(int a, int b)\r\n"
     "{\r\n"
@@ -54,10 +70,27 @@ static const char* s_orFunction =
     "	return float(r);\r\n"
     "}\r\n";
 
-Framework::OpenGl::ProgramPtr CGSH_OpenGL::GenerateShader(const SHADERCAPS& caps)
+static void CompileShader(Framework::OpenGl::CShader& shader, bool async)
+{
+	if(async)
+	{
+		//Querying the compilation status would wait for the driver to finish,
+		//it will be checked when the program's completion status is known.
+		glCompileShader(shader);
+	}
+	else
+	{
+		FRAMEWORK_MAYBE_UNUSED bool compilationResult = shader.Compile();
+		assert(compilationResult);
+	}
+
+	CHECKGLERROR();
+}
+
+Framework::OpenGl::ProgramPtr CGSH_OpenGL::GenerateShader(const SHADERCAPS& caps, bool async)
 {
-	auto vertexShader = GenerateVertexShader(caps);
-	auto fragmentShader = GenerateFragmentShader(caps);
+	auto vertexShader = GenerateVertexShader(caps, async);
+	auto fragmentShader = GenerateFragmentShader(caps, async);
 
 	auto result = std::make_shared<Framework::OpenGl::CProgram>();
 
@@ -75,15 +108,27 @@ Framework::OpenGl::ProgramPtr CGSH_OpenGL::GenerateShader(const SHADERCAPS& caps
 	glBindFragDataLocationIndexed(*result, 0, 1, "blendColor");
 #endif
 
-	FRAMEWORK_MAYBE_UNUSED bool linkResult = result->Link();
-	assert(linkResult);
+	if(m_hasProgramBinarySupport)
+	{
+		glProgramParameteri(*result, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+
+	if(async)
+	{
+		glLinkProgram(*result);
+	}
+	else
+	{
+		FRAMEWORK_MAYBE_UNUSED bool linkResult = result->Link();
+		assert(linkResult);
+	}
 
 	CHECKGLERROR();
 
 	return result;
 }
 
-Framework::OpenGl::CShader CGSH_OpenGL::GenerateVertexShader(const SHADERCAPS& caps)
+Framework::OpenGl::CShader CGSH_OpenGL::GenerateVertexShader(const SHADERCAPS& caps, bool async)
 {
 	std::stringstream shaderBuilder;
 	shaderBuilder << GLSL_VERSION << std::endl;
@@ -125,15 +170,12 @@ Framework::OpenGl::CShader CGSH_OpenGL::GenerateVertexShader(const SHADERCAPS& c
 
 	Framework::OpenGl::CShader result(GL_VERTEX_SHADER);
 	result.SetSource(shaderSource.c_str(), shaderSource.size());
-	FRAMEWORK_MAYBE_UNUSED bool compilationResult = result.Compile();
-	assert(compilationResult);
-
-	CHECKGLERROR();
+	CompileShader(result, async);
 
 	return result;
 }
 
-Framework::OpenGl::CShader CGSH_OpenGL::GenerateFragmentShader(const SHADERCAPS& caps)
+Framework::OpenGl::CShader CGSH_OpenGL::GenerateFragmentShader(const SHADERCAPS& caps, bool async)
 {
 	bool useFramebufferFetch = (caps.hasAlphaBlend || caps.hasAlphaTest || caps.hasDestAlphaTest) && m_hasFramebufferFetchExtension;
 
@@ -430,10 +472,7 @@ Framework::OpenGl::CShader CGSH_OpenGL::GenerateFragmentShader(const SHADERCAPS&
 
 	Framework::OpenGl::CShader result(GL_FRAGMENT_SHADER);
 	result.SetSource(shaderSource.c_str(), shaderSource.size());
-	FRAMEWORK_MAYBE_UNUSED bool compilationResult = result.Compile();
-	assert(compilationResult);
-
-	CHECKGLERROR();
+	CompileShader(result, async);
 
 	return result;
 }
@@ -724,3 +763,155 @@ Framework::OpenGl::ProgramPtr CGSH_OpenGL::GenerateCopyToFbProgram()
 
 	return program;
 }
+
+/////////////////////////////////////////////////////////////
+// Shader Cache
+/////////////////////////////////////////////////////////////
+
+static fs::path GetShaderCachePath()
+{
+	return CAppConfig::GetInstance().GetBasePath() / SHADER_CACHE_DIRECTORY / SHADER_CACHE_FILENAME;
+}
+
+static std::string GetDriverIdentity()
+{
+	//Program binaries are only valid for the driver that generated them
+	auto getString =
+	    [](GLenum name) {
+		    auto value = reinterpret_cast<const char*>(glGetString(name));
+		    return std::string(value ? value : "");
+	    };
+	return getString(GL_VENDOR) + "|" + getString(GL_RENDERER) + "|" + getString(GL_VERSION);
+}
+
+void CGSH_OpenGL::LoadShaderCache()
+{
+	m_programBinaries.clear();
+	m_programBinariesDirty = false;
+
+	if(!m_hasProgramBinarySupport) return;
+
+	auto cachePath = GetShaderCachePath();
+	if(!fs::exists(cachePath)) return;
+
+	try
+	{
+		auto stream = Framework::CreateInputStdStream(cachePath.native());
+		uint32 magic = stream.Read32();
+		uint32 version = stream.Read32();
+		if((magic != SHADER_CACHE_MAGIC) || (version != SHADER_CACHE_VERSION))
+		{
+			throw std::runtime_error("Unsupported shader cache version.");
+		}
+
+		uint32 identityLength = stream.Read32();
+		std::string identity(identityLength, 0);
+		stream.Read(identity.data(), identityLength);
+		if(identity != GetDriverIdentity())
+		{
+			throw std::runtime_error("Shader cache was created by a different driver.");
+		}
+
+		uint32 programCount = stream.Read32();
+		for(uint32 i = 0; i < programCount; i++)
+		{
+			ShaderCapsInt caps = stream.Read64();
+			PROGRAM_BINARY binary;
+			binary.format = stream.Read32();
+			binary.data.resize(stream.Read32());
+			stream.Read(binary.data.data(), binary.data.size());
+			if(stream.IsEOF())
+			{
+				throw std::runtime_error("Shader cache is truncated.");
+			}
+			m_programBinaries.insert(std::make_pair(caps, std::move(binary)));
+		}
+	}
+	catch(const std::exception& exception)
+	{
+		CLog::GetInstance().Warn(LOG_NAME, "Discarding shader cache: %s\r\n", exception.what());
+		m_programBinaries.clear();
+		m_programBinariesDirty = true;
+		return;
+	}
+
+	//Create all programs now to avoid doing it when they're first needed
+	for(auto programBinaryIterator = m_programBinaries.begin();
+	    programBinaryIterator != m_programBinaries.end();)
+	{
+		auto shaderCaps = make_convertible<SHADERCAPS>(programBinaryIterator->first);
+		const auto& binary = programBinaryIterator->second;
+
+		auto program = std::make_shared<Framework::OpenGl::CProgram>();
+		glProgramBinary(*program, binary.format, binary.data.data(), static_cast<GLsizei>(binary.data.size()));
+
+		GLint linkStatus = GL_FALSE;
+		glGetProgramiv(*program, GL_LINK_STATUS, &linkStatus);
+		if(linkStatus == GL_FALSE)
+		{
+			//Driver rejected the binary, program will be generated again when needed
+			programBinaryIterator = m_programBinaries.erase(programBinaryIterator);
+			m_programBinariesDirty = true;
+			continue;
+		}
+
+		RegisterShader(shaderCaps, program);
+		programBinaryIterator++;
+	}
+
+	CHECKGLERROR();
+}
+
+void CGSH_OpenGL::SaveShaderCache()
+{
+	if(!m_programBinariesDirty) return;
+
+	try
+	{
+		auto cachePath = GetShaderCachePath();
+		Framework::PathUtils::EnsurePathExists(cachePath.parent_path());
+
+		auto stream = Framework::CreateOutputStdStream(cachePath.native());
+		stream.Write32(SHADER_CACHE_MAGIC);
+		stream.Write32(SHADER_CACHE_VERSION);
+
+		auto identity = GetDriverIdentity();
+		stream.Write32(static_cast<uint32>(identity.size()));
+		stream.Write(identity.data(), identity.size());
+
+		stream.Write32(static_cast<uint32>(m_programBinaries.size()));
+		for(const auto& programBinaryPair : m_programBinaries)
+		{
+			const auto& binary = programBinaryPair.second;
+			stream.Write64(programBinaryPair.first);
+			stream.Write32(binary.format);
+			stream.Write32(static_cast<uint32>(binary.data.size()));
+			stream.Write(binary.data.data(), binary.data.size());
+		}
+
+		m_programBinariesDirty = false;
+	}
+	catch(const std::exception& exception)
+	{
+		CLog::GetInstance().Warn(LOG_NAME, "Failed to save shader cache: %s\r\n", exception.what());
+	}
+}
+
+void CGSH_OpenGL::AddProgramBinary(const SHADERCAPS& shaderCaps, const Framework::OpenGl::ProgramPtr& program)
+{
+	if(!m_hasProgramBinarySupport) return;
+	if(m_programBinaries.find(shaderCaps) != m_programBinaries.end()) return;
+
+	GLint binaryLength = 0;
+	glGetProgramiv(*program, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+	if(binaryLength == 0) return;
+
+	PROGRAM_BINARY binary;
+	binary.data.resize(binaryLength);
+	glGetProgramBinary(*program, binaryLength, nullptr, &binary.format, binary.data.data());
+
+	CHECKGLERROR();
+
+	m_programBinaries.insert(std::make_pair(static_cast<ShaderCapsInt>(shaderCaps), std::move(binary)));
+	m_programBinariesDirty = true;
+}
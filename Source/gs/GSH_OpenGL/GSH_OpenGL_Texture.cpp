@@ -163,6 +163,7 @@ CGSH_OpenGL::TEXTURE_INFO CGSH_OpenGL::SearchTextureFramebuffer(const TEX0& tex0
 
 	if(framebuffer)
 	{
+		framebuffer->m_lastUsedFrame = m_renderTargetFrame;
 		CommitFramebufferDirtyPages(framebuffer, 0, tex0.GetHeight());
 		if(m_multisampleEnabled)
 		{
@@ -194,6 +195,8 @@ CGSH_OpenGL::TEXTURE_INFO CGSH_OpenGL::PrepareTexture(const TEX0& tex0)
 	auto texture = m_textureCache.Search(tex0);
 	if(!texture)
 	{
+		m_stats.textureCacheMisses++;
+
 		//Validate texture dimensions to prevent problems
 		auto texWidth = tex0.GetWidth();
 		auto texHeight = tex0.GetHeight();
@@ -214,6 +217,10 @@ CGSH_OpenGL::TEXTURE_INFO CGSH_OpenGL::PrepareTexture(const TEX0& tex0)
 		texture = m_textureCache.Search(tex0);
 		texture->m_cachedArea.Invalidate(0, RAMSIZE);
 	}
+	else
+	{
+		m_stats.textureCacheHits++;
+	}
 
 	texInfo.textureHandle = texture->m_textureHandle;
 
@@ -222,6 +229,12 @@ CGSH_OpenGL::TEXTURE_INFO CGSH_OpenGL::PrepareTexture(const TEX0& tex0)
 	auto texturePageSize = CGsPixelFormats::GetPsmPageSize(tex0.nPsm);
 	auto areaRect = cachedArea.GetAreaPageRect();
 
+	if(cachedArea.HasDirtyPages())
+	{
+		//Texture is about to be updated from RAM
+		CompletePendingReadback();
+	}
+
 	while(cachedArea.HasDirtyPages())
 	{
 		auto dirtyRect = cachedArea.GetDirtyPageRect();
@@ -299,6 +312,38 @@ void CGSH_OpenGL::DumpTexture(unsigned int nWidth, unsigned int nHeight, uint32
 #endif
 }
 
+uint8* CGSH_OpenGL::BeginTextureUpload(uint32 size)
+{
+	//Convert directly into the upload buffer when possible, this lets the GPU copy of
+	//the previous texture overlap with the conversion of this one
+	m_textureUploadInBuffer = m_textureUploadBuffer.IsMapped() && (size <= m_textureUploadBuffer.GetSegmentSize());
+	if(m_textureUploadInBuffer)
+	{
+		m_textureUploadOffset = m_textureUploadBuffer.Allocate(size, TEXTURE_UPLOAD_ALIGNMENT);
+		return m_textureUploadBuffer.GetMappedBuffer() + m_textureUploadOffset;
+	}
+	else
+	{
+		assert(size <= CVTBUFFERSIZE);
+		return m_pCvtBuffer;
+	}
+}
+
+void CGSH_OpenGL::EndTextureUpload(unsigned int texX, unsigned int texY, unsigned int texWidth, unsigned int texHeight, GLenum format, GLenum type)
+{
+	if(m_textureUploadInBuffer)
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_textureUploadBuffer.GetBuffer());
+		glTexSubImage2D(GL_TEXTURE_2D, 0, texX, texY, texWidth, texHeight, format, type,
+		                reinterpret_cast<const GLvoid*>(static_cast<uintptr_t>(m_textureUploadOffset)));
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+	else
+	{
+		glTexSubImage2D(GL_TEXTURE_2D, 0, texX, texY, texWidth, texHeight, format, type, m_pCvtBuffer);
+	}
+}
+
 void CGSH_OpenGL::TexUpdater_Invalid(uint32 bufPtr, uint32 bufWidth, unsigned int texX, unsigned int texY, unsigned int texWidth, unsigned int texHeight)
 {
 	assert(0);
@@ -308,7 +353,7 @@ void CGSH_OpenGL::TexUpdater_Psm32(uint32 bufPtr, uint32 bufWidth, unsigned int
 {
 	CGsPixelFormats::CPixelIndexorPSMCT32 indexor(m_pRAM, bufPtr, bufWidth);
 
-	uint32* dst = reinterpret_cast<uint32*>(m_pCvtBuffer);
+	auto dst = reinterpret_cast<uint32*>(BeginTextureUpload(texWidth * texHeight * sizeof(uint32)));
 	for(unsigned int y = 0; y < texHeight; y++)
 	{
 		for(unsigned int x = 0; x < texWidth; x++)
@@ -319,7 +364,7 @@ void CGSH_OpenGL::TexUpdater_Psm32(uint32 bufPtr, uint32 bufWidth, unsigned int
 		dst += texWidth;
 	}
 
-	glTexSubImage2D(GL_TEXTURE_2D, 0, texX, texY, texWidth, texHeight, GL_RGBA, GL_UNSIGNED_BYTE, m_pCvtBuffer);
+	EndTextureUpload(texX, texY, texWidth, texHeight, GL_RGBA, GL_UNSIGNED_BYTE);
 	CHECKGLERROR();
 }
 
@@ -328,7 +373,7 @@ void CGSH_OpenGL::TexUpdater_Psm16(uint32 bufPtr, uint32 bufWidth, unsigned int
 {
 	IndexorType indexor(m_pRAM, bufPtr, bufWidth);
 
-	auto dst = reinterpret_cast<uint16*>(m_pCvtBuffer);
+	auto dst = reinterpret_cast<uint16*>(BeginTextureUpload(texWidth * texHeight * sizeof(uint16)));
 	for(unsigned int y = 0; y < texHeight; y++)
 	{
 		for(unsigned int x = 0; x < texWidth; x++)
@@ -345,7 +390,7 @@ void CGSH_OpenGL::TexUpdater_Psm16(uint32 bufPtr, uint32 bufWidth, unsigned int
 		dst += texWidth;
 	}
 
-	glTexSubImage2D(GL_TEXTURE_2D, 0, texX, texY, texWidth, texHeight, GL_RGBA, GL_UNSIGNED_SHORT_5_5_5_1, m_pCvtBuffer);
+	EndTextureUpload(texX, texY, texWidth, texHeight, GL_RGBA, GL_UNSIGNED_SHORT_5_5_5_1);
 	CHECKGLERROR();
 }
 
@@ -567,7 +612,8 @@ void CGSH_OpenGL::TexUpdater_Psm8(uint32 bufPtr, uint32 bufWidth, unsigned int t
 	}
 
 	CGsPixelFormats::CPixelIndexorPSMT8 indexor(m_pRAM, bufPtr, bufWidth);
-	uint8* dst = m_pCvtBuffer;
+	//Conversion works on whole 16 rows blocks
+	uint8* dst = BeginTextureUpload(texWidth * ((texHeight + 15) & ~15));
 	for(unsigned int y = 0; y < texHeight; y += 16)
 	{
 		for(unsigned int x = 0; x < texWidth; x += 16)
@@ -590,7 +636,7 @@ void CGSH_OpenGL::TexUpdater_Psm8(uint32 bufPtr, uint32 bufWidth, unsigned int t
 		dst += texWidth * 16;
 	}
 
-	glTexSubImage2D(GL_TEXTURE_2D, 0, texX, texY, texWidth, texHeight, GL_RED, GL_UNSIGNED_BYTE, m_pCvtBuffer);
+	EndTextureUpload(texX, texY, texWidth, texHeight, GL_RED, GL_UNSIGNED_BYTE);
 	CHECKGLERROR();
 }
 
@@ -607,7 +653,7 @@ void CGSH_OpenGL::TexUpdater_Psm4(unsigned int bufPtr, unsigned int bufWidth, un
 
 	CGsPixelFormats::CPixelIndexorPSMT4 indexor(m_pRAM, bufPtr, bufWidth);
 
-	uint8* dst = m_pCvtBuffer;
+	uint8* dst = BeginTextureUpload(texWidth * ((texHeight + 15) & ~15));
 	for(unsigned int y = 0; y < texHeight; y += 16)
 	{
 		for(unsigned int x = 0; x < texWidth; x += 32)
@@ -631,7 +677,7 @@ void CGSH_OpenGL::TexUpdater_Psm4(unsigned int bufPtr, unsigned int bufWidth, un
 
 		dst += texWidth * 16;
 	}
-	glTexSubImage2D(GL_TEXTURE_2D, 0, texX, texY, texWidth, texHeight, GL_RED, GL_UNSIGNED_BYTE, m_pCvtBuffer);
+	EndTextureUpload(texX, texY, texWidth, texHeight, GL_RED, GL_UNSIGNED_BYTE);
 	CHECKGLERROR();
 }
 
@@ -640,7 +686,7 @@ void CGSH_OpenGL::TexUpdater_Psm48(uint32 bufPtr, uint32 bufWidth, unsigned int
 {
 	IndexorType indexor(m_pRAM, bufPtr, bufWidth);
 
-	uint8* dst = m_pCvtBuffer;
+	uint8* dst = BeginTextureUpload(texWidth * texHeight);
 	for(unsigned int y = 0; y < texHeight; y++)
 	{
 		for(unsigned int x = 0; x < texWidth; x++)
@@ -652,7 +698,7 @@ void CGSH_OpenGL::TexUpdater_Psm48(uint32 bufPtr, uint32 bufWidth, unsigned int
 		dst += texWidth;
 	}
 
-	glTexSubImage2D(GL_TEXTURE_2D, 0, texX, texY, texWidth, texHeight, GL_RED, GL_UNSIGNED_BYTE, m_pCvtBuffer);
+	EndTextureUpload(texX, texY, texWidth, texHeight, GL_RED, GL_UNSIGNED_BYTE);
 	CHECKGLERROR();
 }
 
@@ -661,7 +707,7 @@ void CGSH_OpenGL::TexUpdater_Psm48H(uint32 bufPtr, uint32 bufWidth, unsigned int
 {
 	CGsPixelFormats::CPixelIndexorPSMCT32 indexor(m_pRAM, bufPtr, bufWidth);
 
-	uint8* dst = m_pCvtBuffer;
+	uint8* dst = BeginTextureUpload(texWidth * texHeight);
 	for(unsigned int y = 0; y < texHeight; y++)
 	{
 		for(unsigned int x = 0; x < texWidth; x++)
@@ -674,7 +720,7 @@ void CGSH_OpenGL::TexUpdater_Psm48H(uint32 bufPtr, uint32 bufWidth, unsigned int
 		dst += texWidth;
 	}
 
-	glTexSubImage2D(GL_TEXTURE_2D, 0, texX, texY, texWidth, texHeight, GL_RED, GL_UNSIGNED_BYTE, m_pCvtBuffer);
+	EndTextureUpload(texX, texY, texWidth, texHeight, GL_RED, GL_UNSIGNED_BYTE);
 	CHECKGLERROR();
 }
 
@@ -0,0 +1,2054 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include "GSH_Software.h"
+#include "GsPixelFormats.h"
+#include "SimdDefs.h"
+
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+#include <emmintrin.h>
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+#include <arm_neon.h>
+#endif
+
+//Edge function values for 4 horizontally adjacent pixels
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+
+typedef __m128i EdgeVector;
+
+static EdgeVector MakeEdgeVector(int32 value, int32 step)
+{
+	return _mm_add_epi32(_mm_set1_epi32(value), _mm_setr_epi32(0, step, step * 2, step * 3));
+}
+
+static EdgeVector AddEdgeVector(const EdgeVector& vector, int32 value)
+{
+	return _mm_add_epi32(vector, _mm_set1_epi32(value));
+}
+
+static uint32 GetCoverageMask(const EdgeVector* edges, uint32 edgeCount)
+{
+	auto mask = _mm_set1_epi32(-1);
+	auto minusOne = _mm_set1_epi32(-1);
+	for(uint32 i = 0; i < edgeCount; i++)
+	{
+		mask = _mm_and_si128(mask, _mm_cmpgt_epi32(edges[i], minusOne));
+	}
+	return _mm_movemask_ps(_mm_castsi128_ps(mask));
+}
+
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+
+typedef int32x4_t EdgeVector;
+
+static EdgeVector MakeEdgeVector(int32 value, int32 step)
+{
+	static const int32 laneIndices[4] = {0, 1, 2, 3};
+	return vmlaq_n_s32(vdupq_n_s32(value), vld1q_s32(laneIndices), step);
+}
+
+static EdgeVector AddEdgeVector(const EdgeVector& vector, int32 value)
+{
+	return vaddq_s32(vector, vdupq_n_s32(value));
+}
+
+static uint32 GetCoverageMask(const EdgeVector* edges, uint32 edgeCount)
+{
+	static const uint32 laneBits[4] = {1, 2, 4, 8};
+	auto mask = vdupq_n_u32(~0U);
+	auto zero = vdupq_n_s32(0);
+	for(uint32 i = 0; i < edgeCount; i++)
+	{
+		mask = vandq_u32(mask, vcgeq_s32(edges[i], zero));
+	}
+	auto bits = vandq_u32(mask, vld1q_u32(laneBits));
+	return vgetq_lane_u32(bits, 0) | vgetq_lane_u32(bits, 1) | vgetq_lane_u32(bits, 2) | vgetq_lane_u32(bits, 3);
+}
+
+#else
+
+struct EdgeVector
+{
+	int32 values[4];
+};
+
+static EdgeVector MakeEdgeVector(int32 value, int32 step)
+{
+	return EdgeVector{{value, value + step, value + step * 2, value + step * 3}};
+}
+
+static EdgeVector AddEdgeVector(const EdgeVector& vector, int32 value)
+{
+	return EdgeVector{{vector.values[0] + value, vector.values[1] + value, vector.values[2] + value, vector.values[3] + value}};
+}
+
+static uint32 GetCoverageMask(const EdgeVector* edges, uint32 edgeCount)
+{
+	uint32 mask = 0xF;
+	for(uint32 i = 0; i < edgeCount; i++)
+	{
+		for(uint32 lane = 0; lane < 4; lane++)
+		{
+			if(edges[i].values[lane] < 0) mask &= ~(1 << lane);
+		}
+	}
+	return mask;
+}
+
+#endif
+
+static int32 ClampColor(int32 value)
+{
+	return std::min<int32>(std::max<int32>(value, 0), 0xFF);
+}
+
+static uint32 ExpandColor16(uint16 color, const CGSHandler::TEXA& texA)
+{
+	uint32 r = (color & 0x001F) << 3;
+	uint32 g = ((color & 0x03E0) >> 5) << 3;
+	uint32 b = ((color & 0x7C00) >> 10) << 3;
+	uint32 rgb = r | (g << 8) | (b << 16);
+	uint32 a = 0;
+	if(color & 0x8000)
+	{
+		a = texA.nTA1;
+	}
+	else if(!texA.nAEM || (rgb != 0))
+	{
+		a = texA.nTA0;
+	}
+	return rgb | (a << 24);
+}
+
+static uint32 ExpandColor24(uint32 color, const CGSHandler::TEXA& texA)
+{
+	uint32 rgb = color & 0x00FFFFFF;
+	uint32 a = (texA.nAEM && (rgb == 0)) ? 0 : texA.nTA0;
+	return rgb | (a << 24);
+}
+
+static uint16 PackColor16(uint32 color)
+{
+	return static_cast<uint16>(
+	    ((color >> 3) & 0x001F) |
+	    (((color >> 11) & 0x1F) << 5) |
+	    (((color >> 19) & 0x1F) << 10) |
+	    ((color & 0x80000000) ? 0x8000 : 0));
+}
+
+static int32 WrapTexCoord(int32 coord, uint32 mode, int32 size, int32 minCoord, int32 maxCoord)
+{
+	switch(mode)
+	{
+	default:
+	case CGSHandler::CLAMP_MODE_REPEAT:
+		return coord & (size - 1);
+	case CGSHandler::CLAMP_MODE_CLAMP:
+		return std::min<int32>(std::max<int32>(coord, 0), size - 1);
+	case CGSHandler::CLAMP_MODE_REGION_CLAMP:
+		return std::min<int32>(std::max<int32>(coord, minCoord), maxCoord);
+	case CGSHandler::CLAMP_MODE_REGION_REPEAT:
+		return (coord & minCoord) | maxCoord;
+	}
+}
+
+//Reads and writes pixels of any format as raw values (indices for palettized formats)
+class CRawPixelAccessor
+{
+public:
+	CRawPixelAccessor(uint8* ram, uint32 bufPtr, uint32 bufWidth, uint32 psm)
+	    : m_psm(psm)
+	    , m_indexor32(ram, bufPtr, bufWidth)
+	    , m_indexor16(ram, bufPtr, bufWidth)
+	    , m_indexor16S(ram, bufPtr, bufWidth)
+	    , m_indexor8(ram, bufPtr, bufWidth)
+	    , m_indexor4(ram, bufPtr, bufWidth)
+	    , m_indexorZ32(ram, bufPtr, bufWidth)
+	    , m_indexorZ16(ram, bufPtr, bufWidth)
+	    , m_indexorZ16S(ram, bufPtr, bufWidth)
+	{
+	}
+
+	uint32 GetPixel(uint32 x, uint32 y)
+	{
+		switch(m_psm)
+		{
+		case CGSHandler::PSMCT32:
+		case CGSHandler::PSMCT32_UNK:
+			return m_indexor32.GetPixel(x, y);
+		case CGSHandler::PSMCT24:
+		case CGSHandler::PSMCT24_UNK:
+			return m_indexor32.GetPixel(x, y) & 0x00FFFFFF;
+		case CGSHandler::PSMCT16:
+			return m_indexor16.GetPixel(x, y);
+		case CGSHandler::PSMCT16S:
+			return m_indexor16S.GetPixel(x, y);
+		case CGSHandler::PSMT8:
+			return m_indexor8.GetPixel(x, y);
+		case CGSHandler::PSMT4:
+			return m_indexor4.GetPixel(x, y);
+		case CGSHandler::PSMT8H:
+			return m_indexor32.GetPixel(x, y) >> 24;
+		case CGSHandler::PSMT4HL:
+			return (m_indexor32.GetPixel(x, y) >> 24) & 0x0F;
+		case CGSHandler::PSMT4HH:
+			return m_indexor32.GetPixel(x, y) >> 28;
+		case CGSHandler::PSMZ32:
+			return m_indexorZ32.GetPixel(x, y);
+		case CGSHandler::PSMZ24:
+			return m_indexorZ32.GetPixel(x, y) & 0x00FFFFFF;
+		case CGSHandler::PSMZ16:
+			return m_indexorZ16.GetPixel(x, y);
+		case CGSHandler::PSMZ16S:
+			return m_indexorZ16S.GetPixel(x, y);
+		default:
+			assert(false);
+			return 0;
+		}
+	}
+
+	void SetPixel(uint32 x, uint32 y, uint32 value)
+	{
+		switch(m_psm)
+		{
+		case CGSHandler::PSMCT32:
+		case CGSHandler::PSMCT32_UNK:
+			m_indexor32.SetPixel(x, y, value);
+			break;
+		case CGSHandler::PSMCT24:
+		case CGSHandler::PSMCT24_UNK:
+			SetMasked(m_indexor32.GetPixelAddress(x, y), value, 0x00FFFFFF, 0);
+			break;
+		case CGSHandler::PSMCT16:
+			m_indexor16.SetPixel(x, y, static_cast<uint16>(value));
+			break;
+		case CGSHandler::PSMCT16S:
+			m_indexor16S.SetPixel(x, y, static_cast<uint16>(value));
+			break;
+		case CGSHandler::PSMT8:
+			m_indexor8.SetPixel(x, y, static_cast<uint8>(value));
+			break;
+		case CGSHandler::PSMT4:
+			m_indexor4.SetPixel(x, y, static_cast<uint8>(value & 0x0F));
+			break;
+		case CGSHandler::PSMT8H:
+			SetMasked(m_indexor32.GetPixelAddress(x, y), value, 0xFF000000, 24);
+			break;
+		case CGSHandler::PSMT4HL:
+			SetMasked(m_indexor32.GetPixelAddress(x, y), value, 0x0F000000, 24);
+			break;
+		case CGSHandler::PSMT4HH:
+			SetMasked(m_indexor32.GetPixelAddress(x, y), value, 0xF0000000, 28);
+			break;
+		case CGSHandler::PSMZ32:
+			m_indexorZ32.SetPixel(x, y, value);
+			break;
+		case CGSHandler::PSMZ24:
+			SetMasked(m_indexorZ32.GetPixelAddress(x, y), value, 0x00FFFFFF, 0);
+			break;
+		case CGSHandler::PSMZ16:
+			m_indexorZ16.SetPixel(x, y, static_cast<uint16>(value));
+			break;
+		case CGSHandler::PSMZ16S:
+			m_indexorZ16S.SetPixel(x, y, static_cast<uint16>(value));
+			break;
+		default:
+			assert(false);
+			break;
+		}
+	}
+
+private:
+	static void SetMasked(uint32* pixel, uint32 value, uint32 mask, uint32 shift)
+	{
+		(*pixel) = ((*pixel) & ~mask) | ((value << shift) & mask);
+	}
+
+	uint32 m_psm = 0;
+	CGsPixelFormats::CPixelIndexorPSMCT32 m_indexor32;
+	CGsPixelFormats::CPixelIndexorPSMCT16 m_indexor16;
+	CGsPixelFormats::CPixelIndexorPSMCT16S m_indexor16S;
+	CGsPixelFormats::CPixelIndexorPSMT8 m_indexor8;
+	CGsPixelFormats::CPixelIndexorPSMT4 m_indexor4;
+	CGsPixelFormats::CPixelIndexorPSMZ32 m_indexorZ32;
+	CGsPixelFormats::CPixelIndexor<CGsPixelFormats::STORAGEPSMZ16> m_indexorZ16;
+	CGsPixelFormats::CPixelIndexorPSMZ16S m_indexorZ16S;
+};
+
+//Indexors for one level of a texture (level 0 is the base texture, others are mipmaps)
+struct CGSH_Software::TEXTURELEVEL
+{
+	TEXTURELEVEL(uint8* ram, uint32 bufPtr, uint32 bufWidth, uint32 width, uint32 height)
+	    : tex32(ram, bufPtr, bufWidth)
+	    , tex16(ram, bufPtr, bufWidth)
+	    , tex16S(ram, bufPtr, bufWidth)
+	    , tex8(ram, bufPtr, bufWidth)
+	    , tex4(ram, bufPtr, bufWidth)
+	    , texZ32(ram, bufPtr, bufWidth)
+	    , texZ16(ram, bufPtr, bufWidth)
+	    , texZ16S(ram, bufPtr, bufWidth)
+	    , width(static_cast<int32>(width))
+	    , height(static_cast<int32>(height))
+	{
+	}
+
+	CGsPixelFormats::CPixelIndexorPSMCT32 tex32;
+	CGsPixelFormats::CPixelIndexorPSMCT16 tex16;
+	CGsPixelFormats::CPixelIndexorPSMCT16S tex16S;
+	CGsPixelFormats::CPixelIndexorPSMT8 tex8;
+	CGsPixelFormats::CPixelIndexorPSMT4 tex4;
+	CGsPixelFormats::CPixelIndexorPSMZ32 texZ32;
+	CGsPixelFormats::CPixelIndexor<CGsPixelFormats::STORAGEPSMZ16> texZ16;
+	CGsPixelFormats::CPixelIndexorPSMZ16S texZ16S;
+	int32 width = 1;
+	int32 height = 1;
+};
+
+//Holds everything needed to shade and write pixels of primitives sharing the same draw state
+struct CGSH_Software::PIXELPIPELINE
+{
+	PIXELPIPELINE(uint8* ram, const DRAWSTATE& state)
+	    : state(state)
+	    , prim(make_convertible<PRMODE>(state.prim))
+	    , frame(make_convertible<FRAME>(state.frame))
+	    , zbuf(make_convertible<ZBUF>(state.zbuf))
+	    , test(make_convertible<TEST>(state.test))
+	    , alpha(make_convertible<ALPHA>(state.alpha))
+	    , tex0(make_convertible<TEX0>(state.tex0))
+	    , tex1(make_convertible<TEX1>(state.tex1))
+	    , texA(make_convertible<TEXA>(state.texA))
+	    , clamp(make_convertible<CLAMP>(state.clamp))
+	    , fogCol(make_convertible<FOGCOL>(state.fogCol))
+	    , dimx(state.dimx)
+	    , frame32(ram, frame.GetBasePtr(), frame.nWidth)
+	    , frame16(ram, frame.GetBasePtr(), frame.nWidth)
+	    , frame16S(ram, frame.GetBasePtr(), frame.nWidth)
+	    , frameZ32(ram, frame.GetBasePtr(), frame.nWidth)
+	    , frameZ16(ram, frame.GetBasePtr(), frame.nWidth)
+	    , frameZ16S(ram, frame.GetBasePtr(), frame.nWidth)
+	    , depth32(ram, zbuf.GetBasePtr(), frame.nWidth)
+	    , depth16(ram, zbuf.GetBasePtr(), frame.nWidth)
+	    , depth16S(ram, zbuf.GetBasePtr(), frame.nWidth)
+	{
+		frameMask = frame.nMask;
+		frameHasAlpha = (frame.nPsm != PSMCT24) && (frame.nPsm != PSMCT24_UNK) && (frame.nPsm != PSMZ24);
+		if(!frameHasAlpha)
+		{
+			frameMask |= 0xFF000000;
+		}
+
+		depthPsm = zbuf.nPsm | 0x30;
+		depthTest = (test.nDepthEnabled != 0);
+		depthWrite = depthTest && (zbuf.nMask == 0);
+		switch(depthPsm)
+		{
+		case PSMZ24:
+			depthMax = 0x00FFFFFF;
+			break;
+		case PSMZ16:
+		case PSMZ16S:
+			depthMax = 0x0000FFFF;
+			break;
+		default:
+			depthMax = 0xFFFFFFFF;
+			break;
+		}
+
+		//Levels above MXL are never sampled
+		maxMipLevel = std::min<uint32>(tex1.nMaxMip, MAX_MIP_LEVEL);
+		bool hasMipLevels = (tex1.nMinFilter >= MIN_FILTER_NEAREST_MIP_NEAREST) && (tex1.nMinFilter <= MIN_FILTER_LINEAR_MIP_LINEAR);
+		if(!hasMipLevels)
+		{
+			maxMipLevel = 0;
+		}
+
+		auto texWidth = tex0.GetWidth();
+		auto texHeight = tex0.GetHeight();
+		auto miptbp1 = make_convertible<MIPTBP1>(state.miptbp1);
+		auto miptbp2 = make_convertible<MIPTBP2>(state.miptbp2);
+		textureLevels.reserve(maxMipLevel + 1);
+		textureLevels.emplace_back(ram, tex0.GetBufPtr(), static_cast<uint32>(tex0.nBufWidth), texWidth, texHeight);
+		for(uint32 level = 1; level <= maxMipLevel; level++)
+		{
+			uint32 bufPtr = 0, bufWidth = 0;
+			switch(level)
+			{
+			case 1:
+				bufPtr = miptbp1.GetTbp1();
+				bufWidth = miptbp1.tbw1;
+				break;
+			case 2:
+				bufPtr = miptbp1.GetTbp2();
+				bufWidth = miptbp1.tbw2;
+				break;
+			case 3:
+				bufPtr = miptbp1.GetTbp3();
+				bufWidth = miptbp1.tbw3;
+				break;
+			case 4:
+				bufPtr = miptbp2.GetTbp4();
+				bufWidth = miptbp2.tbw4;
+				break;
+			case 5:
+				bufPtr = miptbp2.GetTbp5();
+				bufWidth = miptbp2.tbw5;
+				break;
+			case 6:
+				bufPtr = miptbp2.GetTbp6();
+				bufWidth = miptbp2.tbw6;
+				break;
+			}
+			textureLevels.emplace_back(ram, bufPtr, bufWidth, std::max<uint32>(texWidth >> level, 1), std::max<uint32>(texHeight >> level, 1));
+		}
+
+		//Dithering only has a visible effect on 16-bit frame buffers
+		auto dthe = make_convertible<DTHE>(state.dthe);
+		dither = (dthe.nEnabled != 0) && ((frame.nPsm == PSMCT16) || (frame.nPsm == PSMCT16S) || (frame.nPsm == PSMZ16) || (frame.nPsm == PSMZ16S));
+	}
+
+	uint32 ReadFrame(int32 x, int32 y)
+	{
+		switch(frame.nPsm)
+		{
+		case PSMCT32:
+		case PSMCT24:
+		case PSMCT32_UNK:
+		case PSMCT24_UNK:
+			return frame32.GetPixel(x, y);
+		case PSMCT16:
+			return ExpandFrame16(frame16.GetPixel(x, y));
+		case PSMCT16S:
+			return ExpandFrame16(frame16S.GetPixel(x, y));
+		case PSMZ32:
+		case PSMZ24:
+			return frameZ32.GetPixel(x, y);
+		case PSMZ16:
+			return ExpandFrame16(frameZ16.GetPixel(x, y));
+		case PSMZ16S:
+			return ExpandFrame16(frameZ16S.GetPixel(x, y));
+		default:
+			return 0;
+		}
+	}
+
+	void WriteFrame(int32 x, int32 y, uint32 color, uint32 mask)
+	{
+		switch(frame.nPsm)
+		{
+		case PSMCT32:
+		case PSMCT24:
+		case PSMCT32_UNK:
+		case PSMCT24_UNK:
+			WriteFrame32(frame32.GetPixelAddress(x, y), color, mask);
+			break;
+		case PSMCT16:
+			WriteFrame16(frame16.GetPixelAddress(x, y), color, mask);
+			break;
+		case PSMCT16S:
+			WriteFrame16(frame16S.GetPixelAddress(x, y), color, mask);
+			break;
+		case PSMZ32:
+		case PSMZ24:
+			WriteFrame32(frameZ32.GetPixelAddress(x, y), color, mask);
+			break;
+		case PSMZ16:
+			WriteFrame16(frameZ16.GetPixelAddress(x, y), color, mask);
+			break;
+		case PSMZ16S:
+			WriteFrame16(frameZ16S.GetPixelAddress(x, y), color, mask);
+			break;
+		}
+	}
+
+	uint32 ReadDepth(int32 x, int32 y)
+	{
+		switch(depthPsm)
+		{
+		default:
+		case PSMZ32:
+			return depth32.GetPixel(x, y);
+		case PSMZ24:
+			return depth32.GetPixel(x, y) & 0x00FFFFFF;
+		case PSMZ16:
+			return depth16.GetPixel(x, y);
+		case PSMZ16S:
+			return depth16S.GetPixel(x, y);
+		}
+	}
+
+	void WriteDepth(int32 x, int32 y, uint32 z)
+	{
+		switch(depthPsm)
+		{
+		default:
+		case PSMZ32:
+			depth32.SetPixel(x, y, z);
+			break;
+		case PSMZ24:
+		{
+			auto pixel = depth32.GetPixelAddress(x, y);
+			(*pixel) = ((*pixel) & 0xFF000000) | z;
+		}
+		break;
+		case PSMZ16:
+			depth16.SetPixel(x, y, static_cast<uint16>(z));
+			break;
+		case PSMZ16S:
+			depth16S.SetPixel(x, y, static_cast<uint16>(z));
+			break;
+		}
+	}
+
+	uint32 FetchTexel(TEXTURELEVEL& level, uint32 levelIndex, int32 u, int32 v)
+	{
+		//Region clamp bounds are expressed in level 0 texels, region repeat masks are used as is
+		uint32 shiftU = (clamp.nWMS == CLAMP_MODE_REGION_CLAMP) ? levelIndex : 0;
+		uint32 shiftV = (clamp.nWMT == CLAMP_MODE_REGION_CLAMP) ? levelIndex : 0;
+		u = WrapTexCoord(u, clamp.nWMS, level.width, clamp.GetMinU() >> shiftU, clamp.GetMaxU() >> shiftU);
+		v = WrapTexCoord(v, clamp.nWMT, level.height, clamp.GetMinV() >> shiftV, clamp.GetMaxV() >> shiftV);
+		switch(tex0.nPsm)
+		{
+		case PSMCT32:
+		case PSMCT32_UNK:
+			return level.tex32.GetPixel(u, v);
+		case PSMCT24:
+		case PSMCT24_UNK:
+			return ExpandColor24(level.tex32.GetPixel(u, v), texA);
+		case PSMCT16:
+			return ExpandColor16(level.tex16.GetPixel(u, v), texA);
+		case PSMCT16S:
+			return ExpandColor16(level.tex16S.GetPixel(u, v), texA);
+		case PSMT8:
+			return state.clut[level.tex8.GetPixel(u, v)];
+		case PSMT4:
+			return state.clut[level.tex4.GetPixel(u, v)];
+		case PSMT8H:
+			return state.clut[level.tex32.GetPixel(u, v) >> 24];
+		case PSMT4HL:
+			return state.clut[(level.tex32.GetPixel(u, v) >> 24) & 0x0F];
+		case PSMT4HH:
+			return state.clut[level.tex32.GetPixel(u, v) >> 28];
+		case PSMZ32:
+			return level.texZ32.GetPixel(u, v);
+		case PSMZ24:
+			return ExpandColor24(level.texZ32.GetPixel(u, v), texA);
+		case PSMZ16:
+			return ExpandColor16(level.texZ16.GetPixel(u, v), texA);
+		case PSMZ16S:
+			return ExpandColor16(level.texZ16S.GetPixel(u, v), texA);
+		default:
+			return 0;
+		}
+	}
+
+	uint32 SampleLevel(uint32 levelIndex, float u, float v, bool bilinear)
+	{
+		auto& level = textureLevels[levelIndex];
+		if(levelIndex != 0)
+		{
+			float scale = 1.0f / static_cast<float>(1 << levelIndex);
+			u *= scale;
+			v *= scale;
+		}
+
+		if(!bilinear)
+		{
+			return FetchTexel(level, levelIndex, static_cast<int32>(std::floor(u)), static_cast<int32>(std::floor(v)));
+		}
+
+		u -= 0.5f;
+		v -= 0.5f;
+		float u0 = std::floor(u);
+		float v0 = std::floor(v);
+		auto fracU = static_cast<uint32>((u - u0) * 256.0f);
+		auto fracV = static_cast<uint32>((v - v0) * 256.0f);
+		auto iu = static_cast<int32>(u0);
+		auto iv = static_cast<int32>(v0);
+
+		uint32 texels[4] =
+		    {
+		        FetchTexel(level, levelIndex, iu + 0, iv + 0),
+		        FetchTexel(level, levelIndex, iu + 1, iv + 0),
+		        FetchTexel(level, levelIndex, iu + 0, iv + 1),
+		        FetchTexel(level, levelIndex, iu + 1, iv + 1),
+		    };
+
+		uint32 result = 0;
+		for(uint32 shift = 0; shift < 32; shift += 8)
+		{
+			uint32 c00 = (texels[0] >> shift) & 0xFF;
+			uint32 c10 = (texels[1] >> shift) & 0xFF;
+			uint32 c01 = (texels[2] >> shift) & 0xFF;
+			uint32 c11 = (texels[3] >> shift) & 0xFF;
+			uint32 top = (c00 * (256 - fracU)) + (c10 * fracU);
+			uint32 bottom = (c01 * (256 - fracU)) + (c11 * fracU);
+			uint32 value = ((top * (256 - fracV)) + (bottom * fracV)) >> 16;
+			result |= (value & 0xFF) << shift;
+		}
+		return result;
+	}
+
+	//u and v are in level 0 texels, q is used for the LOD computation
+	uint32 SampleTexture(float u, float v, float q)
+	{
+		float lod = tex1.GetK();
+		if(tex1.nLODMethod == LOD_CALC_DYNAMIC)
+		{
+			float absQ = std::fabs(q);
+			if(absQ == 0) absQ = std::numeric_limits<float>::min();
+			lod += -std::log2(absQ) * static_cast<float>(1 << tex1.nLODL);
+		}
+
+		if(lod <= 0)
+		{
+			return SampleLevel(0, u, v, tex1.nMagFilter == MAG_FILTER_LINEAR);
+		}
+
+		switch(tex1.nMinFilter)
+		{
+		default:
+		case MIN_FILTER_NEAREST:
+			return SampleLevel(0, u, v, false);
+		case MIN_FILTER_LINEAR:
+			return SampleLevel(0, u, v, true);
+		case MIN_FILTER_NEAREST_MIP_NEAREST:
+		case MIN_FILTER_LINEAR_MIP_NEAREST:
+		{
+			bool bilinear = (tex1.nMinFilter == MIN_FILTER_LINEAR_MIP_NEAREST);
+			auto level = std::min<uint32>(static_cast<uint32>(lod + 0.5f), maxMipLevel);
+			return SampleLevel(level, u, v, bilinear);
+		}
+		case MIN_FILTER_NEAREST_MIP_LINEAR:
+		case MIN_FILTER_LINEAR_MIP_LINEAR:
+		{
+			bool bilinear = (tex1.nMinFilter == MIN_FILTER_LINEAR_MIP_LINEAR);
+			auto level0 = std::min<uint32>(static_cast<uint32>(lod), maxMipLevel);
+			auto level1 = std::min<uint32>(level0 + 1, maxMipLevel);
+			uint32 texel0 = SampleLevel(level0, u, v, bilinear);
+			if(level0 == level1) return texel0;
+			uint32 texel1 = SampleLevel(level1, u, v, bilinear);
+			auto frac = static_cast<uint32>((lod - std::floor(lod)) * 256.0f);
+			uint32 result = 0;
+			for(uint32 shift = 0; shift < 32; shift += 8)
+			{
+				uint32 c0 = (texel0 >> shift) & 0xFF;
+				uint32 c1 = (texel1 >> shift) & 0xFF;
+				uint32 value = ((c0 * (256 - frac)) + (c1 * frac)) >> 8;
+				result |= (value & 0xFF) << shift;
+			}
+			return result;
+		}
+		}
+	}
+
+	void DrawPixel(int32 x, int32 y, double zValue, const float* attributes)
+	{
+		int32 r = ClampColor(static_cast<int32>(attributes[ATTRIBUTE_R]));
+		int32 g = ClampColor(static_cast<int32>(attributes[ATTRIBUTE_G]));
+		int32 b = ClampColor(static_cast<int32>(attributes[ATTRIBUTE_B]));
+		int32 a = ClampColor(static_cast<int32>(attributes[ATTRIBUTE_A]));
+
+		if(prim.nTexture)
+		{
+			float u = attributes[ATTRIBUTE_S];
+			float v = attributes[ATTRIBUTE_T];
+			float q = attributes[ATTRIBUTE_Q];
+			if(!prim.nUseUV)
+			{
+				if(q != 0)
+				{
+					u /= q;
+					v /= q;
+				}
+				u *= static_cast<float>(textureLevels[0].width);
+				v *= static_cast<float>(textureLevels[0].height);
+			}
+
+			uint32 texel = SampleTexture(u, v, q);
+			int32 tr = (texel >> 0) & 0xFF;
+			int32 tg = (texel >> 8) & 0xFF;
+			int32 tb = (texel >> 16) & 0xFF;
+			int32 ta = (texel >> 24) & 0xFF;
+
+			switch(tex0.nFunction)
+			{
+			case TEX0_FUNCTION_MODULATE:
+				r = ClampColor((r * tr) >> 7);
+				g = ClampColor((g * tg) >> 7);
+				b = ClampColor((b * tb) >> 7);
+				if(tex0.nColorComp) a = ClampColor((a * ta) >> 7);
+				break;
+			case TEX0_FUNCTION_DECAL:
+				r = tr;
+				g = tg;
+				b = tb;
+				if(tex0.nColorComp) a = ta;
+				break;
+			case TEX0_FUNCTION_HIGHLIGHT:
+				r = ClampColor(((r * tr) >> 7) + a);
+				g = ClampColor(((g * tg) >> 7) + a);
+				b = ClampColor(((b * tb) >> 7) + a);
+				if(tex0.nColorComp) a = ClampColor(ta + a);
+				break;
+			case TEX0_FUNCTION_HIGHLIGHT2:
+				r = ClampColor(((r * tr) >> 7) + a);
+				g = ClampColor(((g * tg) >> 7) + a);
+				b = ClampColor(((b * tb) >> 7) + a);
+				if(tex0.nColorComp) a = ta;
+				break;
+			}
+		}
+
+		if(prim.nFog)
+		{
+			int32 f = ClampColor(static_cast<int32>(attributes[ATTRIBUTE_F]));
+			r = ((r * f) + (fogCol.nFCR * (0xFF - f))) >> 8;
+			g = ((g * f) + (fogCol.nFCG * (0xFF - f))) >> 8;
+			b = ((b * f) + (fogCol.nFCB * (0xFF - f))) >> 8;
+		}
+
+		bool writeFrame = true;
+		bool writeDepth = depthWrite;
+		uint32 mask = frameMask;
+
+		if(test.nAlphaEnabled && !AlphaTest(a))
+		{
+			switch(test.nAlphaFail)
+			{
+			case ALPHA_TEST_FAIL_KEEP:
+				return;
+			case ALPHA_TEST_FAIL_FBONLY:
+				writeDepth = false;
+				break;
+			case ALPHA_TEST_FAIL_ZBONLY:
+				writeFrame = false;
+				break;
+			case ALPHA_TEST_FAIL_RGBONLY:
+				writeDepth = false;
+				mask |= 0xFF000000;
+				break;
+			}
+		}
+
+		uint32 dstColor = ReadFrame(x, y);
+
+		if(test.nDestAlphaEnabled && frameHasAlpha)
+		{
+			bool dstAlphaBit = (dstColor & 0x80000000) != 0;
+			if(dstAlphaBit != (test.nDestAlphaMode != 0)) return;
+		}
+
+		uint32 z = static_cast<uint32>(std::min<double>(std::max<double>(zValue, 0), static_cast<double>(depthMax)));
+		if(depthTest)
+		{
+			uint32 dstZ = ReadDepth(x, y);
+			bool passed = false;
+			switch(test.nDepthMethod)
+			{
+			case DEPTH_TEST_NEVER:
+				passed = false;
+				break;
+			case DEPTH_TEST_ALWAYS:
+				passed = true;
+				break;
+			case DEPTH_TEST_GEQUAL:
+				passed = (z >= dstZ);
+				break;
+			case DEPTH_TEST_GREATER:
+				passed = (z > dstZ);
+				break;
+			}
+			if(!passed) return;
+		}
+
+		if(writeFrame)
+		{
+			int32 dstA = frameHasAlpha ? ((dstColor >> 24) & 0xFF) : 0x80;
+			bool blend = (prim.nAlpha != 0);
+			if(state.pabe && ((a & 0x80) == 0))
+			{
+				blend = false;
+			}
+			int32 result[3] = {r, g, b};
+			if(blend)
+			{
+				int32 srcColor[3] = {r, g, b};
+				int32 dstColors[3] = {static_cast<int32>((dstColor >> 0) & 0xFF), static_cast<int32>((dstColor >> 8) & 0xFF), static_cast<int32>((dstColor >> 16) & 0xFF)};
+				int32 blendAlpha = (alpha.nC == ALPHABLEND_C_AS) ? a : (alpha.nC == ALPHABLEND_C_AD) ? dstA : static_cast<int32>(alpha.nFix);
+				for(uint32 i = 0; i < 3; i++)
+				{
+					auto select = [&](uint32 mode) {
+						return (mode == ALPHABLEND_ABD_CS) ? srcColor[i] : (mode == ALPHABLEND_ABD_CD) ? dstColors[i] : 0;
+					};
+					result[i] = (((select(alpha.nA) - select(alpha.nB)) * blendAlpha) >> 7) + select(alpha.nD);
+				}
+			}
+			if(dither)
+			{
+				//DIMX holds a 4x4 matrix of signed 3-bit values, one row every 16 bits
+				uint32 shift = ((y & 3) * 16) + ((x & 3) * 4);
+				int32 value = static_cast<int32>((dimx >> shift) & 0x7);
+				value = (value & 0x4) ? (value - 8) : value;
+				for(uint32 i = 0; i < 3; i++)
+				{
+					result[i] += value;
+				}
+			}
+			for(uint32 i = 0; i < 3; i++)
+			{
+				result[i] = (state.colClamp & 1) ? ClampColor(result[i]) : (result[i] & 0xFF);
+			}
+			r = result[0];
+			g = result[1];
+			b = result[2];
+
+			uint32 outA = a;
+			if(state.fba & 1)
+			{
+				outA |= 0x80;
+			}
+
+			uint32 color = r | (g << 8) | (b << 16) | (outA << 24);
+			WriteFrame(x, y, color, mask);
+		}
+
+		if(writeDepth)
+		{
+			WriteDepth(x, y, z);
+		}
+	}
+
+	bool AlphaTest(int32 a) const
+	{
+		int32 ref = test.nAlphaRef;
+		switch(test.nAlphaMethod)
+		{
+		case ALPHA_TEST_NEVER:
+			return false;
+		case ALPHA_TEST_ALWAYS:
+			return true;
+		case ALPHA_TEST_LESS:
+			return a < ref;
+		case ALPHA_TEST_LEQUAL:
+			return a <= ref;
+		case ALPHA_TEST_EQUAL:
+			return a == ref;
+		case ALPHA_TEST_GEQUAL:
+			return a >= ref;
+		case ALPHA_TEST_GREATER:
+			return a > ref;
+		case ALPHA_TEST_NOTEQUAL:
+			return a != ref;
+		default:
+			return true;
+		}
+	}
+
+	static uint32 ExpandFrame16(uint16 color)
+	{
+		uint32 r = (color & 0x001F) << 3;
+		uint32 g = ((color & 0x03E0) >> 5) << 3;
+		uint32 b = ((color & 0x7C00) >> 10) << 3;
+		uint32 a = (color & 0x8000) ? 0x80 : 0;
+		return r | (g << 8) | (b << 16) | (a << 24);
+	}
+
+	static void WriteFrame32(uint32* pixel, uint32 color, uint32 mask)
+	{
+		(*pixel) = ((*pixel) & mask) | (color & ~mask);
+	}
+
+	static void WriteFrame16(uint16* pixel, uint32 color, uint32 mask)
+	{
+		uint16 mask16 = PackColor16(mask);
+		(*pixel) = ((*pixel) & mask16) | (PackColor16(color) & ~mask16);
+	}
+
+	const DRAWSTATE& state;
+	PRMODE prim;
+	FRAME frame;
+	ZBUF zbuf;
+	TEST test;
+	ALPHA alpha;
+	TEX0 tex0;
+	TEX1 tex1;
+	TEXA texA;
+	CLAMP clamp;
+	FOGCOL fogCol;
+
+	CGsPixelFormats::CPixelIndexorPSMCT32 frame32;
+	CGsPixelFormats::CPixelIndexorPSMCT16 frame16;
+	CGsPixelFormats::CPixelIndexorPSMCT16S frame16S;
+	CGsPixelFormats::CPixelIndexorPSMZ32 frameZ32;
+	CGsPixelFormats::CPixelIndexor<CGsPixelFormats::STORAGEPSMZ16> frameZ16;
+	CGsPixelFormats::CPixelIndexorPSMZ16S frameZ16S;
+
+	CGsPixelFormats::CPixelIndexorPSMZ32 depth32;
+	CGsPixelFormats::CPixelIndexor<CGsPixelFormats::STORAGEPSMZ16> depth16;
+	CGsPixelFormats::CPixelIndexorPSMZ16S depth16S;
+
+	std::vector<TEXTURELEVEL> textureLevels;
+	uint32 maxMipLevel = 0;
+
+	uint32 frameMask = 0;
+	bool frameHasAlpha = true;
+	uint32 depthPsm = PSMZ32;
+	uint32 depthMax = 0;
+	bool depthTest = false;
+	bool depthWrite = false;
+	bool dither = false;
+	uint64 dimx = 0;
+};
+
+CGSH_Software::CGSH_Software(uint32 threadCount)
+    : m_threadCount(threadCount)
+{
+	if(m_threadCount == 0)
+	{
+		m_threadCount = std::max<uint32>(std::thread::hardware_concurrency(), 1);
+	}
+	m_primitiveMode <<= 0;
+}
+
+CGSHandler::FactoryFunction CGSH_Software::GetFactoryFunction(uint32 threadCount)
+{
+	return [threadCount]() { return new CGSH_Software(threadCount); };
+}
+
+void CGSH_Software::InitializeImpl()
+{
+	//Make sure swizzle tables are built before worker threads start using them
+	CGsPixelFormats::CPixelIndexorPSMCT32::GetPageOffsets();
+	CGsPixelFormats::CPixelIndexorPSMCT16::GetPageOffsets();
+	CGsPixelFormats::CPixelIndexorPSMCT16S::GetPageOffsets();
+	CGsPixelFormats::CPixelIndexorPSMT8::GetPageOffsets();
+	CGsPixelFormats::CPixelIndexorPSMT4::GetPageOffsets();
+	CGsPixelFormats::CPixelIndexorPSMZ32::GetPageOffsets();
+	CGsPixelFormats::CPixelIndexor<CGsPixelFormats::STORAGEPSMZ16>::GetPageOffsets();
+	CGsPixelFormats::CPixelIndexorPSMZ16S::GetPageOffsets();
+
+	m_tileBins.resize(TILE_COUNT);
+	m_primitives.reserve(MAX_BATCH_PRIMITIVES);
+
+	StartWorkers();
+}
+
+void CGSH_Software::ReleaseImpl()
+{
+	FlushPrimitives();
+	StopWorkers();
+}
+
+void CGSH_Software::ResetImpl()
+{
+	FlushPrimitives();
+	m_vtxCount = 0;
+	m_pendingPrim = false;
+	m_pendingPrimValue = 0;
+	m_primitiveMode <<= 0;
+	m_primitiveType = PRIM_INVALID;
+	m_clutDirty = true;
+}
+
+void CGSH_Software::FlipImpl(const DISPLAY_INFO& dispInfo)
+{
+	FlushPrimitives();
+	CGSHandler::FlipImpl(dispInfo);
+}
+
+void CGSH_Software::MarkNewFrame()
+{
+	FlushPrimitives();
+	CGSHandler::MarkNewFrame();
+}
+
+void CGSH_Software::WriteRegisterImpl(uint8 registerId, uint64 data)
+{
+	CGSHandler::WriteRegisterImpl(registerId, data);
+
+	switch(registerId)
+	{
+	case GS_REG_PRIM:
+		m_pendingPrim = true;
+		m_pendingPrimValue = data;
+		break;
+
+	case GS_REG_XYZ2:
+	case GS_REG_XYZ3:
+	case GS_REG_XYZF2:
+	case GS_REG_XYZF3:
+		VertexKick(registerId, data);
+		break;
+	}
+}
+
+void CGSH_Software::ProcessPrim(uint64 value)
+{
+	m_primitiveType = static_cast<uint32>(value & 0x07);
+	switch(m_primitiveType)
+	{
+	case PRIM_POINT:
+		m_vtxCount = 1;
+		break;
+	case PRIM_LINE:
+	case PRIM_LINESTRIP:
+		m_vtxCount = 2;
+		break;
+	case PRIM_TRIANGLE:
+	case PRIM_TRIANGLESTRIP:
+	case PRIM_TRIANGLEFAN:
+		m_vtxCount = 3;
+		break;
+	case PRIM_SPRITE:
+		m_vtxCount = 2;
+		break;
+	default:
+		m_vtxCount = 0;
+		break;
+	}
+}
+
+void CGSH_Software::VertexKick(uint8 registerId, uint64 value)
+{
+	if(m_pendingPrim)
+	{
+		m_pendingPrim = false;
+		ProcessPrim(m_pendingPrimValue);
+	}
+
+	if(m_vtxCount == 0) return;
+
+	bool drawingKick = (registerId == GS_REG_XYZ2) || (registerId == GS_REG_XYZF2);
+	bool fog = (registerId == GS_REG_XYZF2) || (registerId == GS_REG_XYZF3);
+
+	if(!m_drawEnabled) drawingKick = false;
+
+	auto& vertex = m_vtxBuffer[m_vtxCount - 1];
+	vertex.rgbaq = m_nReg[GS_REG_RGBAQ];
+	vertex.uv = m_nReg[GS_REG_UV];
+	vertex.st = m_nReg[GS_REG_ST];
+	if(fog)
+	{
+		vertex.position = value & 0x00FFFFFFFFFFFFFFULL;
+		vertex.fog = static_cast<uint8>(value >> 56);
+	}
+	else
+	{
+		vertex.position = value;
+		vertex.fog = static_cast<uint8>(m_nReg[GS_REG_FOG] >> 56);
+	}
+
+	m_vtxCount--;
+
+	if(m_vtxCount == 0)
+	{
+		if((m_nReg[GS_REG_PRMODECONT] & 1) != 0)
+		{
+			m_primitiveMode <<= m_nReg[GS_REG_PRIM];
+		}
+		else
+		{
+			m_primitiveMode <<= m_nReg[GS_REG_PRMODE];
+		}
+
+		switch(m_primitiveType)
+		{
+		case PRIM_POINT:
+			if(drawingKick) Prim_Point();
+			m_vtxCount = 1;
+			break;
+		case PRIM_LINE:
+			if(drawingKick) Prim_Line();
+			m_vtxCount = 2;
+			break;
+		case PRIM_LINESTRIP:
+			if(drawingKick) Prim_Line();
+			m_vtxBuffer[1] = m_vtxBuffer[0];
+			m_vtxCount = 1;
+			break;
+		case PRIM_TRIANGLE:
+			if(drawingKick) Prim_Triangle();
+			m_vtxCount = 3;
+			break;
+		case PRIM_TRIANGLESTRIP:
+			if(drawingKick) Prim_Triangle();
+			m_vtxBuffer[2] = m_vtxBuffer[1];
+			m_vtxBuffer[1] = m_vtxBuffer[0];
+			m_vtxCount = 1;
+			break;
+		case PRIM_TRIANGLEFAN:
+			if(drawingKick) Prim_Triangle();
+			m_vtxBuffer[1] = m_vtxBuffer[0];
+			m_vtxCount = 1;
+			break;
+		case PRIM_SPRITE:
+			if(drawingKick) Prim_Sprite();
+			m_vtxCount = 2;
+			break;
+		}
+	}
+}
+
+uint32 CGSH_Software::PrepareDrawState()
+{
+	unsigned int context = m_primitiveMode.nContext;
+
+	DRAWSTATE state;
+	state.prim = m_primitiveMode;
+	state.frame = m_nReg[GS_REG_FRAME_1 + context];
+	state.zbuf = m_nReg[GS_REG_ZBUF_1 + context];
+	state.test = m_nReg[GS_REG_TEST_1 + context];
+	state.alpha = m_nReg[GS_REG_ALPHA_1 + context];
+	state.tex0 = m_nReg[GS_REG_TEX0_1 + context];
+	state.tex1 = m_nReg[GS_REG_TEX1_1 + context];
+	state.texA = m_nReg[GS_REG_TEXA];
+	state.clamp = m_nReg[GS_REG_CLAMP_1 + context];
+	state.fogCol = m_nReg[GS_REG_FOGCOL];
+	state.scissor = m_nReg[GS_REG_SCISSOR_1 + context];
+	state.colClamp = m_nReg[GS_REG_COLCLAMP];
+	state.pabe = m_nReg[GS_REG_PABE];
+	state.fba = m_nReg[GS_REG_FBA_1 + context];
+	state.miptbp1 = m_nReg[GS_REG_MIPTBP1_1 + context];
+	state.miptbp2 = m_nReg[GS_REG_MIPTBP2_1 + context];
+	state.dimx = m_nReg[GS_REG_DIMX];
+	state.dthe = m_nReg[GS_REG_DTHE];
+
+	auto frame = make_convertible<FRAME>(state.frame);
+	auto zbuf = make_convertible<ZBUF>(state.zbuf);
+	auto test = make_convertible<TEST>(state.test);
+	auto tex0 = make_convertible<TEX0>(state.tex0);
+	auto scissor = make_convertible<SCISSOR>(state.scissor);
+
+	//Batches only contain primitives drawing to the same buffers, this ensures tiles
+	//never alias each other in GS RAM
+	if(!m_primitives.empty())
+	{
+		bool buffersChanged =
+		    ((state.frame ^ m_batchFrame) & 0xFFFFFFFFULL) ||
+		    ((state.zbuf ^ m_batchZbuf) & 0xFFFFFFFFULL);
+		if(buffersChanged || (m_primitives.size() >= MAX_BATCH_PRIMITIVES))
+		{
+			FlushPrimitives();
+		}
+	}
+
+	uint32 bufferHeight = scissor.scay1 + 1;
+	auto frameRange = GetBufferRange(frame.GetBasePtr(), frame.GetWidth(), frame.nPsm, bufferHeight);
+	std::pair<uint32, uint32> depthRange(0, 0);
+	if(test.nDepthEnabled)
+	{
+		depthRange = GetBufferRange(zbuf.GetBasePtr(), frame.GetWidth(), zbuf.nPsm | 0x30, bufferHeight);
+	}
+
+	bool serial = test.nDepthEnabled && RangesOverlap(frameRange, depthRange);
+
+	if(m_primitiveMode.nTexture)
+	{
+		//Texture (or one of its mipmaps) might be sampling what was drawn by this batch
+		std::vector<std::pair<uint32, uint32>> textureRanges;
+		textureRanges.push_back(GetBufferRange(tex0.GetBufPtr(), tex0.GetBufWidth(), tex0.nPsm, tex0.GetHeight()));
+		auto tex1 = make_convertible<TEX1>(state.tex1);
+		if(tex1.nMinFilter >= MIN_FILTER_NEAREST_MIP_NEAREST)
+		{
+			auto miptbp1 = make_convertible<MIPTBP1>(state.miptbp1);
+			auto miptbp2 = make_convertible<MIPTBP2>(state.miptbp2);
+			std::pair<uint32, uint32> levels[MAX_MIP_LEVEL] =
+			    {
+			        {miptbp1.GetTbp1(), miptbp1.GetTbw1()},
+			        {miptbp1.GetTbp2(), miptbp1.GetTbw2()},
+			        {miptbp1.GetTbp3(), miptbp1.GetTbw3()},
+			        {miptbp2.GetTbp4(), miptbp2.GetTbw4()},
+			        {miptbp2.GetTbp5(), miptbp2.GetTbw5()},
+			        {miptbp2.GetTbp6(), miptbp2.GetTbw6()},
+			    };
+			uint32 maxMipLevel = std::min<uint32>(tex1.nMaxMip, MAX_MIP_LEVEL);
+			for(uint32 level = 1; level <= maxMipLevel; level++)
+			{
+				const auto& levelInfo = levels[level - 1];
+				uint32 levelHeight = std::max<uint32>(tex0.GetHeight() >> level, 1);
+				textureRanges.push_back(GetBufferRange(levelInfo.first, levelInfo.second, tex0.nPsm, levelHeight));
+			}
+		}
+		auto batchRange = std::make_pair(m_batchWriteStart, m_batchWriteEnd - m_batchWriteStart);
+		for(const auto& textureRange : textureRanges)
+		{
+			if(!m_primitives.empty() && RangesOverlap(textureRange, batchRange))
+			{
+				FlushPrimitives();
+			}
+			serial |= RangesOverlap(textureRange, frameRange) || RangesOverlap(textureRange, depthRange);
+		}
+	}
+
+	if(m_primitives.empty())
+	{
+		m_batchFrame = state.frame;
+		m_batchZbuf = state.zbuf;
+		m_batchWriteStart = frameRange.first;
+		m_batchWriteEnd = frameRange.first + frameRange.second;
+	}
+	else
+	{
+		m_batchWriteStart = std::min(m_batchWriteStart, frameRange.first);
+		m_batchWriteEnd = std::max(m_batchWriteEnd, frameRange.first + frameRange.second);
+	}
+	if(depthRange.second != 0)
+	{
+		m_batchWriteStart = std::min(m_batchWriteStart, depthRange.first);
+		m_batchWriteEnd = std::max(m_batchWriteEnd, depthRange.first + depthRange.second);
+	}
+	m_batchSerial |= serial;
+
+	bool usesClut = m_primitiveMode.nTexture && CGsPixelFormats::IsPsmIDTEX(tex0.nPsm);
+	if(!m_drawStates.empty() && !(usesClut && m_clutDirty))
+	{
+		const auto& prevState = m_drawStates.back();
+		if(!memcmp(&prevState, &state, offsetof(DRAWSTATE, clut)))
+		{
+			return static_cast<uint32>(m_drawStates.size() - 1);
+		}
+	}
+
+	if(usesClut)
+	{
+		MakeLinearCLUT(tex0, state.clut);
+		if((tex0.nCPSM == PSMCT16) || (tex0.nCPSM == PSMCT16S))
+		{
+			//Linear CLUT uses a fixed alpha for 16-bit colors, apply TEXA instead
+			auto texA = make_convertible<TEXA>(state.texA);
+			for(auto& color : state.clut)
+			{
+				uint32 rgb = color & 0x00FFFFFF;
+				uint32 a = (color & 0xFF000000) ? texA.nTA1 : ((texA.nAEM && (rgb == 0)) ? 0 : texA.nTA0);
+				color = rgb | (a << 24);
+			}
+		}
+		m_clutDirty = false;
+	}
+
+	m_drawStates.push_back(state);
+	return static_cast<uint32>(m_drawStates.size() - 1);
+}
+
+CGSH_Software::RASTERVERTEX CGSH_Software::MakeRasterVertex(const VERTEX& vertex, const XYOFFSET& offset, bool useUV) const
+{
+	auto xyz = make_convertible<XYZ>(vertex.position);
+	auto rgbaq = make_convertible<RGBAQ>(vertex.rgbaq);
+
+	RASTERVERTEX result;
+	result.x = static_cast<int32>(xyz.nX) - static_cast<int32>(offset.nOffsetX);
+	result.y = static_cast<int32>(xyz.nY) - static_cast<int32>(offset.nOffsetY);
+	result.z = xyz.nZ;
+	result.attributes[ATTRIBUTE_R] = rgbaq.nR;
+	result.attributes[ATTRIBUTE_G] = rgbaq.nG;
+	result.attributes[ATTRIBUTE_B] = rgbaq.nB;
+	result.attributes[ATTRIBUTE_A] = rgbaq.nA;
+	if(useUV)
+	{
+		auto uv = make_convertible<UV>(vertex.uv);
+		result.attributes[ATTRIBUTE_S] = uv.GetU();
+		result.attributes[ATTRIBUTE_T] = uv.GetV();
+		result.attributes[ATTRIBUTE_Q] = 1.0f;
+	}
+	else
+	{
+		auto st = make_convertible<ST>(vertex.st);
+		result.attributes[ATTRIBUTE_S] = st.nS;
+		result.attributes[ATTRIBUTE_T] = st.nT;
+		result.attributes[ATTRIBUTE_Q] = rgbaq.nQ;
+	}
+	result.attributes[ATTRIBUTE_F] = vertex.fog;
+	return result;
+}
+
+void CGSH_Software::BinPrimitive(PRIMITIVE& primitive)
+{
+	const auto& state = m_drawStates[primitive.stateIndex];
+	auto scissor = make_convertible<SCISSOR>(state.scissor);
+
+	primitive.minX = std::max<int32>(primitive.minX, scissor.scax0);
+	primitive.minY = std::max<int32>(primitive.minY, scissor.scay0);
+	primitive.maxX = std::min<int32>(primitive.maxX, scissor.scax1);
+	primitive.maxY = std::min<int32>(primitive.maxY, scissor.scay1);
+
+	if((primitive.minX > primitive.maxX) || (primitive.minY > primitive.maxY))
+	{
+		return;
+	}
+
+	uint32 primitiveIndex = static_cast<uint32>(m_primitives.size());
+	m_primitives.push_back(primitive);
+
+	uint32 tileStartX = primitive.minX >> TILE_SIZE_LOG2;
+	uint32 tileStartY = primitive.minY >> TILE_SIZE_LOG2;
+	uint32 tileEndX = primitive.maxX >> TILE_SIZE_LOG2;
+	uint32 tileEndY = primitive.maxY >> TILE_SIZE_LOG2;
+	for(uint32 tileY = tileStartY; tileY <= tileEndY; tileY++)
+	{
+		for(uint32 tileX = tileStartX; tileX <= tileEndX; tileX++)
+		{
+			uint32 tileIndex = tileX + (tileY * TILE_COUNT_X);
+			auto& bin = m_tileBins[tileIndex];
+			if(bin.empty())
+			{
+				m_activeTiles.push_back(tileIndex);
+			}
+			bin.push_back(primitiveIndex);
+		}
+	}
+
+	if(m_batchSerial)
+	{
+		FlushPrimitives();
+	}
+}
+
+/////////////////////////////////////////////////////////////
+// Primitive setup
+/////////////////////////////////////////////////////////////
+
+void CGSH_Software::Prim_Point()
+{
+	uint32 stateIndex = PrepareDrawState();
+	auto offset = make_convertible<XYOFFSET>(m_nReg[GS_REG_XYOFFSET_1 + m_primitiveMode.nContext]);
+
+	PRIMITIVE primitive = {};
+	primitive.type = PRIM_POINT;
+	primitive.stateIndex = stateIndex;
+	primitive.vertices[0] = MakeRasterVertex(m_vtxBuffer[0], offset, m_primitiveMode.nUseUV);
+	primitive.minX = primitive.maxX = (primitive.vertices[0].x + 8) >> 4;
+	primitive.minY = primitive.maxY = (primitive.vertices[0].y + 8) >> 4;
+
+	BinPrimitive(primitive);
+}
+
+void CGSH_Software::Prim_Line()
+{
+	uint32 stateIndex = PrepareDrawState();
+	auto offset = make_convertible<XYOFFSET>(m_nReg[GS_REG_XYOFFSET_1 + m_primitiveMode.nContext]);
+
+	PRIMITIVE primitive = {};
+	primitive.type = PRIM_LINE;
+	primitive.stateIndex = stateIndex;
+	primitive.vertices[0] = MakeRasterVertex(m_vtxBuffer[1], offset, m_primitiveMode.nUseUV);
+	primitive.vertices[1] = MakeRasterVertex(m_vtxBuffer[0], offset, m_primitiveMode.nUseUV);
+
+	if(!m_primitiveMode.nShading)
+	{
+		std::copy(primitive.vertices[1].attributes + ATTRIBUTE_R, primitive.vertices[1].attributes + ATTRIBUTE_S,
+		          primitive.vertices[0].attributes + ATTRIBUTE_R);
+	}
+
+	int32 x0 = (primitive.vertices[0].x + 8) >> 4;
+	int32 y0 = (primitive.vertices[0].y + 8) >> 4;
+	int32 x1 = (primitive.vertices[1].x + 8) >> 4;
+	int32 y1 = (primitive.vertices[1].y + 8) >> 4;
+	primitive.minX = std::min(x0, x1);
+	primitive.minY = std::min(y0, y1);
+	primitive.maxX = std::max(x0, x1);
+	primitive.maxY = std::max(y0, y1);
+
+	BinPrimitive(primitive);
+}
+
+void CGSH_Software::Prim_Triangle()
+{
+	uint32 stateIndex = PrepareDrawState();
+	auto offset = make_convertible<XYOFFSET>(m_nReg[GS_REG_XYOFFSET_1 + m_primitiveMode.nContext]);
+
+	RASTERVERTEX v[3] =
+	    {
+	        MakeRasterVertex(m_vtxBuffer[2], offset, m_primitiveMode.nUseUV),
+	        MakeRasterVertex(m_vtxBuffer[1], offset, m_primitiveMode.nUseUV),
+	        MakeRasterVertex(m_vtxBuffer[0], offset, m_primitiveMode.nUseUV),
+	    };
+
+	if(!m_primitiveMode.nShading)
+	{
+		//Flat shading uses the color of the last vertex
+		for(uint32 i = 0; i < 2; i++)
+		{
+			std::copy(v[2].attributes + ATTRIBUTE_R, v[2].attributes + ATTRIBUTE_S, v[i].attributes + ATTRIBUTE_R);
+		}
+	}
+
+	int64 area = (static_cast<int64>(v[1].x - v[0].x) * (v[2].y - v[0].y)) - (static_cast<int64>(v[1].y - v[0].y) * (v[2].x - v[0].x));
+	if(area == 0) return;
+	if(area < 0)
+	{
+		std::swap(v[1], v[2]);
+		area = -area;
+	}
+
+	PRIMITIVE primitive = {};
+	primitive.type = PRIM_TRIANGLE;
+	primitive.stateIndex = stateIndex;
+
+	int32 minX = std::min(v[0].x, std::min(v[1].x, v[2].x));
+	int32 minY = std::min(v[0].y, std::min(v[1].y, v[2].y));
+	int32 maxX = std::max(v[0].x, std::max(v[1].x, v[2].x));
+	int32 maxY = std::max(v[0].y, std::max(v[1].y, v[2].y));
+
+	//Pixel centers lie on integer coordinates
+	primitive.minX = std::max<int32>((minX + 15) >> 4, 0);
+	primitive.minY = std::max<int32>((minY + 15) >> 4, 0);
+	primitive.maxX = maxX >> 4;
+	primitive.maxY = maxY >> 4;
+
+	for(uint32 i = 0; i < 3; i++)
+	{
+		const auto& vi = v[i];
+		const auto& vj = v[(i + 1) % 3];
+		int32 dx = vj.x - vi.x;
+		int32 dy = vj.y - vi.y;
+		primitive.edgeA[i] = -dy;
+		primitive.edgeB[i] = dx;
+		primitive.edgeC[i] = (static_cast<int64>(dy) * vi.x) - (static_cast<int64>(dx) * vi.y);
+		//Top-left fill rule: pixels lying exactly on other edges are excluded
+		bool topLeft = ((dy == 0) && (dx > 0)) || (dy < 0);
+		if(!topLeft) primitive.edgeC[i] -= 1;
+	}
+
+	double refX = static_cast<double>(primitive.minX * 16 - v[0].x);
+	double refY = static_cast<double>(primitive.minY * 16 - v[0].y);
+	double dx1 = v[1].x - v[0].x;
+	double dy1 = v[1].y - v[0].y;
+	double dx2 = v[2].x - v[0].x;
+	double dy2 = v[2].y - v[0].y;
+	double invArea = 1.0 / static_cast<double>(area);
+
+	auto computePlane = [&](double a0, double a1, double a2, double& ref, double& gradX, double& gradY) {
+		double da1 = a1 - a0;
+		double da2 = a2 - a0;
+		double dadx = ((da1 * dy2) - (da2 * dy1)) * invArea;
+		double dady = ((da2 * dx1) - (da1 * dx2)) * invArea;
+		ref = a0 + (dadx * refX) + (dady * refY);
+		gradX = dadx * 16.0;
+		gradY = dady * 16.0;
+	};
+
+	computePlane(v[0].z, v[1].z, v[2].z, primitive.zRef, primitive.zDx, primitive.zDy);
+	for(uint32 i = 0; i < ATTRIBUTE_COUNT; i++)
+	{
+		double ref = 0, gradX = 0, gradY = 0;
+		computePlane(v[0].attributes[i], v[1].attributes[i], v[2].attributes[i], ref, gradX, gradY);
+		primitive.planes[i].ref = static_cast<float>(ref);
+		primitive.planes[i].dx = static_cast<float>(gradX);
+		primitive.planes[i].dy = static_cast<float>(gradY);
+	}
+
+	BinPrimitive(primitive);
+}
+
+void CGSH_Software::Prim_Sprite()
+{
+	uint32 stateIndex = PrepareDrawState();
+	auto offset = make_convertible<XYOFFSET>(m_nReg[GS_REG_XYOFFSET_1 + m_primitiveMode.nContext]);
+
+	auto v0 = MakeRasterVertex(m_vtxBuffer[1], offset, m_primitiveMode.nUseUV);
+	auto v1 = MakeRasterVertex(m_vtxBuffer[0], offset, m_primitiveMode.nUseUV);
+
+	int32 x0 = v0.x, x1 = v1.x;
+	int32 y0 = v0.y, y1 = v1.y;
+	float s0 = v0.attributes[ATTRIBUTE_S], s1 = v1.attributes[ATTRIBUTE_S];
+	float t0 = v0.attributes[ATTRIBUTE_T], t1 = v1.attributes[ATTRIBUTE_T];
+	if(x0 > x1)
+	{
+		std::swap(x0, x1);
+		std::swap(s0, s1);
+	}
+	if(y0 > y1)
+	{
+		std::swap(y0, y1);
+		std::swap(t0, t1);
+	}
+	if((x0 == x1) || (y0 == y1)) return;
+
+	PRIMITIVE primitive = {};
+	primitive.type = PRIM_SPRITE;
+	primitive.stateIndex = stateIndex;
+
+	//Covers pixels where x0 <= x < x1 and y0 <= y < y1
+	primitive.minX = std::max<int32>((x0 + 15) >> 4, 0);
+	primitive.minY = std::max<int32>((y0 + 15) >> 4, 0);
+	primitive.maxX = ((x1 + 15) >> 4) - 1;
+	primitive.maxY = ((y1 + 15) >> 4) - 1;
+
+	//Sprites use the color, depth and fog of their second vertex
+	primitive.zRef = v1.z;
+	for(uint32 i = 0; i < ATTRIBUTE_COUNT; i++)
+	{
+		primitive.planes[i].ref = v1.attributes[i];
+	}
+
+	float dsdx = (s1 - s0) / static_cast<float>(x1 - x0);
+	float dtdy = (t1 - t0) / static_cast<float>(y1 - y0);
+	primitive.planes[ATTRIBUTE_S].ref = s0 + dsdx * static_cast<float>(primitive.minX * 16 - x0);
+	primitive.planes[ATTRIBUTE_S].dx = dsdx * 16.0f;
+	primitive.planes[ATTRIBUTE_T].ref = t0 + dtdy * static_cast<float>(primitive.minY * 16 - y0);
+	primitive.planes[ATTRIBUTE_T].dy = dtdy * 16.0f;
+
+	BinPrimitive(primitive);
+}
+
+/////////////////////////////////////////////////////////////
+// Rasterization
+/////////////////////////////////////////////////////////////
+
+void CGSH_Software::FlushPrimitives()
+{
+	if(m_primitives.empty()) return;
+
+	uint32 queueCount = static_cast<uint32>(m_workerThreads.size()) + 1;
+	if(m_batchSerial || (m_activeTiles.size() < 2))
+	{
+		queueCount = 1;
+	}
+
+	for(uint32 i = 0; i < queueCount; i++)
+	{
+		auto& queue = m_workQueues[i];
+		queue.tiles.clear();
+		queue.nextTile = 0;
+	}
+
+	//Deal tiles in a round robin fashion to spread neighbouring (and similarly loaded) tiles across threads
+	for(uint32 i = 0; i < m_activeTiles.size(); i++)
+	{
+		m_workQueues[i % queueCount].tiles.push_back(m_activeTiles[i]);
+	}
+
+	if(queueCount == 1)
+	{
+		ProcessWorkQueues(0, 1);
+	}
+	else
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_workerMutex);
+			m_workQueueCount = queueCount;
+			m_pendingWorkers = static_cast<uint32>(m_workerThreads.size());
+			m_workerGeneration++;
+		}
+		m_workerStartCondition.notify_all();
+
+		ProcessWorkQueues(0, queueCount);
+
+		std::unique_lock<std::mutex> lock(m_workerMutex);
+		m_workerDoneCondition.wait(lock, [this]() { return m_pendingWorkers == 0; });
+	}
+
+	//Lets the CLUT cache know that these pages can't be trusted anymore
+	IncrementRamPageVersions(m_batchWriteStart, m_batchWriteEnd - m_batchWriteStart);
+
+	for(auto tileIndex : m_activeTiles)
+	{
+		m_tileBins[tileIndex].clear();
+	}
+	m_activeTiles.clear();
+	m_primitives.clear();
+	m_drawStates.clear();
+	m_batchSerial = false;
+	m_drawCallCount++;
+}
+
+void CGSH_Software::ProcessWorkQueues(uint32 threadIndex, uint32 queueCount)
+{
+	//Drain our own queue first, then steal from the others
+	for(uint32 i = 0; i < queueCount; i++)
+	{
+		auto& queue = m_workQueues[(threadIndex + i) % queueCount];
+		uint32 tileCount = static_cast<uint32>(queue.tiles.size());
+		while(true)
+		{
+			uint32 index = queue.nextTile.fetch_add(1);
+			if(index >= tileCount) break;
+			RasterizeTile(queue.tiles[index]);
+		}
+	}
+}
+
+void CGSH_Software::RasterizeTile(uint32 tileIndex)
+{
+	int32 tileX0 = (tileIndex % TILE_COUNT_X) * TILE_SIZE;
+	int32 tileY0 = (tileIndex / TILE_COUNT_X) * TILE_SIZE;
+	int32 tileX1 = tileX0 + TILE_SIZE - 1;
+	int32 tileY1 = tileY0 + TILE_SIZE - 1;
+
+	std::optional<PIXELPIPELINE> pipeline;
+	uint32 pipelineStateIndex = ~0U;
+
+	for(auto primitiveIndex : m_tileBins[tileIndex])
+	{
+		const auto& primitive = m_primitives[primitiveIndex];
+		if(primitive.stateIndex != pipelineStateIndex)
+		{
+			pipeline.emplace(m_pRAM, m_drawStates[primitive.stateIndex]);
+			pipelineStateIndex = primitive.stateIndex;
+		}
+
+		int32 x0 = std::max(primitive.minX, tileX0);
+		int32 y0 = std::max(primitive.minY, tileY0);
+		int32 x1 = std::min(primitive.maxX, tileX1);
+		int32 y1 = std::min(primitive.maxY, tileY1);
+		if((x0 > x1) || (y0 > y1)) continue;
+
+		switch(primitive.type)
+		{
+		case PRIM_TRIANGLE:
+			RasterizeTriangle(primitive, *pipeline, x0, y0, x1, y1);
+			break;
+		case PRIM_SPRITE:
+			RasterizeSprite(primitive, *pipeline, x0, y0, x1, y1);
+			break;
+		case PRIM_LINE:
+			RasterizeLine(primitive, *pipeline, x0, y0, x1, y1);
+			break;
+		case PRIM_POINT:
+			RasterizePoint(primitive, *pipeline, x0, y0, x1, y1);
+			break;
+		}
+	}
+}
+
+void CGSH_Software::RasterizeTriangle(const PRIMITIVE& primitive, PIXELPIPELINE& pipeline, int32 x0, int32 y0, int32 x1, int32 y1)
+{
+	//Classify the rectangle against every edge. Edges that contain the whole rectangle don't need
+	//to be evaluated per pixel and the values of those that do are guaranteed to fit in 32 bits.
+	int32 rowValues[3];
+	int32 stepsX[3];
+	int32 stepsY[3];
+	uint32 edgeCount = 0;
+	for(uint32 i = 0; i < 3; i++)
+	{
+		int64 a = primitive.edgeA[i];
+		int64 b = primitive.edgeB[i];
+		int64 c = primitive.edgeC[i];
+		int64 e00 = (a * x0 * 16) + (b * y0 * 16) + c;
+		int64 e10 = (a * x1 * 16) + (b * y0 * 16) + c;
+		int64 e01 = (a * x0 * 16) + (b * y1 * 16) + c;
+		int64 e11 = (a * x1 * 16) + (b * y1 * 16) + c;
+		int64 minValue = std::min(std::min(e00, e10), std::min(e01, e11));
+		int64 maxValue = std::max(std::max(e00, e10), std::max(e01, e11));
+		if(maxValue < 0) return;
+		if(minValue >= 0) continue;
+		rowValues[edgeCount] = static_cast<int32>(e00);
+		stepsX[edgeCount] = static_cast<int32>(a * 16);
+		stepsY[edgeCount] = static_cast<int32>(b * 16);
+		edgeCount++;
+	}
+
+	float attributes[ATTRIBUTE_COUNT];
+	for(int32 y = y0; y <= y1; y++)
+	{
+		EdgeVector edges[3];
+		for(uint32 i = 0; i < edgeCount; i++)
+		{
+			edges[i] = MakeEdgeVector(rowValues[i], stepsX[i]);
+		}
+
+		float offsetY = static_cast<float>(y - primitive.minY);
+		for(int32 x = x0; x <= x1; x += 4)
+		{
+			uint32 mask = GetCoverageMask(edges, edgeCount);
+			int32 remaining = x1 - x + 1;
+			if(remaining < 4) mask &= (1 << remaining) - 1;
+
+			for(uint32 lane = 0; mask != 0; lane++, mask >>= 1)
+			{
+				if(!(mask & 1)) continue;
+				int32 px = x + lane;
+				float offsetX = static_cast<float>(px - primitive.minX);
+				for(uint32 i = 0; i < ATTRIBUTE_COUNT; i++)
+				{
+					const auto& plane = primitive.planes[i];
+					attributes[i] = plane.ref + (plane.dx * offsetX) + (plane.dy * offsetY);
+				}
+				double z = primitive.zRef + (primitive.zDx * offsetX) + (primitive.zDy * offsetY);
+				pipeline.DrawPixel(px, y, z, attributes);
+			}
+
+			for(uint32 i = 0; i < edgeCount; i++)
+			{
+				edges[i] = AddEdgeVector(edges[i], stepsX[i] * 4);
+			}
+		}
+
+		for(uint32 i = 0; i < edgeCount; i++)
+		{
+			rowValues[i] += stepsY[i];
+		}
+	}
+}
+
+void CGSH_Software::RasterizeSprite(const PRIMITIVE& primitive, PIXELPIPELINE& pipeline, int32 x0, int32 y0, int32 x1, int32 y1)
+{
+	float attributes[ATTRIBUTE_COUNT];
+	for(uint32 i = 0; i < ATTRIBUTE_COUNT; i++)
+	{
+		attributes[i] = primitive.planes[i].ref;
+	}
+
+	const auto& planeS = primitive.planes[ATTRIBUTE_S];
+	const auto& planeT = primitive.planes[ATTRIBUTE_T];
+	for(int32 y = y0; y <= y1; y++)
+	{
+		attributes[ATTRIBUTE_T] = planeT.ref + (planeT.dy * static_cast<float>(y - primitive.minY));
+		for(int32 x = x0; x <= x1; x++)
+		{
+			attributes[ATTRIBUTE_S] = planeS.ref + (planeS.dx * static_cast<float>(x - primitive.minX));
+			pipeline.DrawPixel(x, y, primitive.zRef, attributes);
+		}
+	}
+}
+
+void CGSH_Software::RasterizeLine(const PRIMITIVE& primitive, PIXELPIPELINE& pipeline, int32 x0, int32 y0, int32 x1, int32 y1)
+{
+	const auto& v0 = primitive.vertices[0];
+	const auto& v1 = primitive.vertices[1];
+	int32 startX = (v0.x + 8) >> 4;
+	int32 startY = (v0.y + 8) >> 4;
+	int32 deltaX = ((v1.x + 8) >> 4) - startX;
+	int32 deltaY = ((v1.y + 8) >> 4) - startY;
+	int32 stepCount = std::max(std::abs(deltaX), std::abs(deltaY));
+
+	float attributes[ATTRIBUTE_COUNT];
+	for(int32 step = 0; step <= stepCount; step++)
+	{
+		float t = (stepCount != 0) ? static_cast<float>(step) / static_cast<float>(stepCount) : 0.0f;
+		int32 x = startX + static_cast<int32>(std::lround(deltaX * t));
+		int32 y = startY + static_cast<int32>(std::lround(deltaY * t));
+		if((x < x0) || (x > x1) || (y < y0) || (y > y1)) continue;
+		for(uint32 i = 0; i < ATTRIBUTE_COUNT; i++)
+		{
+			attributes[i] = v0.attributes[i] + ((v1.attributes[i] - v0.attributes[i]) * t);
+		}
+		double z = static_cast<double>(v0.z) + ((static_cast<double>(v1.z) - static_cast<double>(v0.z)) * t);
+		pipeline.DrawPixel(x, y, z, attributes);
+	}
+}
+
+void CGSH_Software::RasterizePoint(const PRIMITIVE& primitive, PIXELPIPELINE& pipeline, int32 x0, int32 y0, int32, int32)
+{
+	const auto& vertex = primitive.vertices[0];
+	pipeline.DrawPixel(x0, y0, vertex.z, vertex.attributes);
+}
+
+/////////////////////////////////////////////////////////////
+// Worker threads
+/////////////////////////////////////////////////////////////
+
+void CGSH_Software::StartWorkers()
+{
+	uint32 workerCount = m_threadCount - 1;
+	m_workQueues = std::make_unique<WORKQUEUE[]>(workerCount + 1);
+	m_workersDone = false;
+	for(uint32 i = 0; i < workerCount; i++)
+	{
+		m_workerThreads.emplace_back([this, i]() { WorkerThreadProc(i + 1); });
+	}
+}
+
+void CGSH_Software::StopWorkers()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_workerMutex);
+		m_workersDone = true;
+	}
+	m_workerStartCondition.notify_all();
+	for(auto& workerThread : m_workerThreads)
+	{
+		workerThread.join();
+	}
+	m_workerThreads.clear();
+}
+
+void CGSH_Software::WorkerThreadProc(uint32 threadIndex)
+{
+	uint32 generation = 0;
+	while(true)
+	{
+		uint32 queueCount = 0;
+		{
+			std::unique_lock<std::mutex> lock(m_workerMutex);
+			m_workerStartCondition.wait(lock, [&]() { return m_workersDone || (m_workerGeneration != generation); });
+			if(m_workersDone) break;
+			generation = m_workerGeneration;
+			queueCount = m_workQueueCount;
+		}
+
+		ProcessWorkQueues(threadIndex, queueCount);
+
+		{
+			std::lock_guard<std::mutex> lock(m_workerMutex);
+			m_pendingWorkers--;
+		}
+		m_workerDoneCondition.notify_one();
+	}
+}
+
+/////////////////////////////////////////////////////////////
+// Memory synchronization
+/////////////////////////////////////////////////////////////
+
+void CGSH_Software::BeginTransferWrite()
+{
+	FlushPrimitives();
+	CGSHandler::BeginTransferWrite();
+}
+
+void CGSH_Software::SyncCLUT(const TEX0& tex0)
+{
+	if(tex0.nCLD != 0)
+	{
+		//CLUT might be loaded from something drawn by the current batch
+		auto texClut = make_convertible<TEXCLUT>(m_nReg[GS_REG_TEXCLUT]);
+		auto clutRange = GetClutRamRange(tex0, texClut);
+		auto batchRange = std::make_pair(m_batchWriteStart, m_batchWriteEnd - m_batchWriteStart);
+		if(!m_primitives.empty() && RangesOverlap(clutRange, batchRange))
+		{
+			FlushPrimitives();
+		}
+	}
+	CGSHandler::SyncCLUT(tex0);
+}
+
+void CGSH_Software::WriteBackMemoryCache()
+{
+	FlushPrimitives();
+}
+
+void CGSH_Software::SyncMemoryCache()
+{
+	FlushPrimitives();
+}
+
+void CGSH_Software::ProcessHostToLocalTransfer()
+{
+	//Data was written to RAM directly by the base class
+}
+
+void CGSH_Software::ProcessLocalToHostTransfer()
+{
+	FlushPrimitives();
+}
+
+void CGSH_Software::ProcessLocalToLocalTransfer()
+{
+	FlushPrimitives();
+
+	auto bltBuf = make_convertible<BITBLTBUF>(m_nReg[GS_REG_BITBLTBUF]);
+	auto trxPos = make_convertible<TRXPOS>(m_nReg[GS_REG_TRXPOS]);
+	auto trxReg = make_convertible<TRXREG>(m_nReg[GS_REG_TRXREG]);
+
+	if(bltBuf.nSrcPsm != bltBuf.nDstPsm)
+	{
+		TransferLocalToLocalConvert(bltBuf, trxPos, trxReg);
+		return;
+	}
+
+	switch(bltBuf.nDstPsm)
+	{
+	case PSMCT32:
+	case PSMCT24:
+	case PSMT8H:
+	case PSMT4HL:
+	case PSMT4HH:
+		TransferLocalToLocal<CGsPixelFormats::STORAGEPSMCT32>(bltBuf, trxPos, trxReg);
+		break;
+	case PSMCT16:
+		TransferLocalToLocal<CGsPixelFormats::STORAGEPSMCT16>(bltBuf, trxPos, trxReg);
+		break;
+	case PSMCT16S:
+		TransferLocalToLocal<CGsPixelFormats::STORAGEPSMCT16S>(bltBuf, trxPos, trxReg);
+		break;
+	case PSMT8:
+		TransferLocalToLocal<CGsPixelFormats::STORAGEPSMT8>(bltBuf, trxPos, trxReg);
+		break;
+	case PSMT4:
+		TransferLocalToLocal<CGsPixelFormats::STORAGEPSMT4>(bltBuf, trxPos, trxReg);
+		break;
+	case PSMZ32:
+	case PSMZ24:
+		TransferLocalToLocal<CGsPixelFormats::STORAGEPSMZ32>(bltBuf, trxPos, trxReg);
+		break;
+	case PSMZ16:
+		TransferLocalToLocal<CGsPixelFormats::STORAGEPSMZ16>(bltBuf, trxPos, trxReg);
+		break;
+	case PSMZ16S:
+		TransferLocalToLocal<CGsPixelFormats::STORAGEPSMZ16S>(bltBuf, trxPos, trxReg);
+		break;
+	default:
+		assert(false);
+		break;
+	}
+}
+
+template <typename Storage>
+void CGSH_Software::TransferLocalToLocal(const BITBLTBUF& bltBuf, const TRXPOS& trxPos, const TRXREG& trxReg)
+{
+	typedef CGsPixelFormats::CPixelIndexor<Storage> IndexorType;
+	IndexorType srcIndexor(m_pRAM, bltBuf.GetSrcPtr(), bltBuf.nSrcWidth);
+	IndexorType dstIndexor(m_pRAM, bltBuf.GetDstPtr(), bltBuf.nDstWidth);
+
+	uint32 mask = ~0U;
+	switch(bltBuf.nDstPsm)
+	{
+	case PSMCT24:
+	case PSMZ24:
+		mask = 0x00FFFFFF;
+		break;
+	case PSMT8H:
+		mask = 0xFF000000;
+		break;
+	case PSMT4HL:
+		mask = 0x0F000000;
+		break;
+	case PSMT4HH:
+		mask = 0xF0000000;
+		break;
+	}
+
+	//Transfer direction bits tell us in which order pixels need to be copied when areas overlap
+	bool reverseX = (trxPos.nDIR & 0x02) != 0;
+	bool reverseY = (trxPos.nDIR & 0x01) != 0;
+	for(uint32 j = 0; j < trxReg.nRRH; j++)
+	{
+		uint32 y = reverseY ? (trxReg.nRRH - 1 - j) : j;
+		for(uint32 i = 0; i < trxReg.nRRW; i++)
+		{
+			uint32 x = reverseX ? (trxReg.nRRW - 1 - i) : i;
+			uint32 srcX = (trxPos.nSSAX + x) % 2048;
+			uint32 srcY = (trxPos.nSSAY + y) % 2048;
+			uint32 dstX = (trxPos.nDSAX + x) % 2048;
+			uint32 dstY = (trxPos.nDSAY + y) % 2048;
+			auto pixel = srcIndexor.GetPixel(srcX, srcY);
+			if(mask != ~0U)
+			{
+				auto dstPixel = dstIndexor.GetPixel(dstX, dstY);
+				pixel = (dstPixel & ~mask) | (pixel & mask);
+			}
+			dstIndexor.SetPixel(dstX, dstY, pixel);
+		}
+	}
+}
+
+void CGSH_Software::TransferLocalToLocalConvert(const BITBLTBUF& bltBuf, const TRXPOS& trxPos, const TRXREG& trxReg)
+{
+	//Pixels are moved one at a time, the value read in the source format is truncated to
+	//the size of the destination format. Bits not covered by the destination format are kept.
+	CRawPixelAccessor srcAccessor(m_pRAM, bltBuf.GetSrcPtr(), bltBuf.nSrcWidth, bltBuf.nSrcPsm);
+	CRawPixelAccessor dstAccessor(m_pRAM, bltBuf.GetDstPtr(), bltBuf.nDstWidth, bltBuf.nDstPsm);
+
+	bool reverseX = (trxPos.nDIR & 0x02) != 0;
+	bool reverseY = (trxPos.nDIR & 0x01) != 0;
+	for(uint32 j = 0; j < trxReg.nRRH; j++)
+	{
+		uint32 y = reverseY ? (trxReg.nRRH - 1 - j) : j;
+		for(uint32 i = 0; i < trxReg.nRRW; i++)
+		{
+			uint32 x = reverseX ? (trxReg.nRRW - 1 - i) : i;
+			uint32 pixel = srcAccessor.GetPixel((trxPos.nSSAX + x) % 2048, (trxPos.nSSAY + y) % 2048);
+			dstAccessor.SetPixel((trxPos.nDSAX + x) % 2048, (trxPos.nDSAY + y) % 2048, pixel);
+		}
+	}
+}
+
+void CGSH_Software::ProcessClutTransfer(uint32, uint32)
+{
+	m_clutDirty = true;
+}
+
+/////////////////////////////////////////////////////////////
+// Other Functions
+/////////////////////////////////////////////////////////////
+
+Framework::CBitmap CGSH_Software::GetScreenshot()
+{
+	Framework::CBitmap result;
+	SendGSCall(
+	    [&]() {
+		    FlushPrimitives();
+
+		    auto dispInfo = GetCurrentDisplayInfo();
+		    const auto& layer = dispInfo.layers[0];
+		    if(!layer.enabled || (layer.width == 0) || (layer.height == 0)) return;
+
+		    result = Framework::CBitmap(layer.width, layer.height, 32);
+		    auto pixels = reinterpret_cast<uint32*>(result.GetPixels());
+		    CGsPixelFormats::CPixelIndexorPSMCT32 indexor32(m_pRAM, layer.bufPtr, layer.bufWidth / 64);
+		    CGsPixelFormats::CPixelIndexorPSMCT16 indexor16(m_pRAM, layer.bufPtr, layer.bufWidth / 64);
+		    CGsPixelFormats::CPixelIndexorPSMCT16S indexor16S(m_pRAM, layer.bufPtr, layer.bufWidth / 64);
+		    for(uint32 y = 0; y < layer.height; y++)
+		    {
+			    for(uint32 x = 0; x < layer.width; x++)
+			    {
+				    uint32 srcX = x + layer.offsetX;
+				    uint32 srcY = y + layer.offsetY;
+				    uint32 color = 0;
+				    switch(layer.psm)
+				    {
+				    case PSMCT32:
+				    case PSMCT24:
+					    color = indexor32.GetPixel(srcX, srcY);
+					    break;
+				    case PSMCT16:
+					    color = PIXELPIPELINE::ExpandFrame16(indexor16.GetPixel(srcX, srcY));
+					    break;
+				    case PSMCT16S:
+					    color = PIXELPIPELINE::ExpandFrame16(indexor16S.GetPixel(srcX, srcY));
+					    break;
+				    }
+				    uint32 r = (color >> 0) & 0xFF;
+				    uint32 g = (color >> 8) & 0xFF;
+				    uint32 b = (color >> 16) & 0xFF;
+				    (*pixels) = b | (g << 8) | (r << 16) | 0xFF000000;
+				    pixels++;
+			    }
+		    }
+	    },
+	    true);
+	return result;
+}
+
+std::pair<uint32, uint32> CGSH_Software::GetBufferRange(uint32 bufPtr, uint32 bufWidth, uint32 psm, uint32 height)
+{
+	switch(psm)
+	{
+	case PSMCT32:
+	case PSMCT24:
+	case PSMCT16:
+	case PSMCT16S:
+	case PSMCT32_UNK:
+	case PSMCT24_UNK:
+	case PSMT8:
+	case PSMT4:
+	case PSMT8H:
+	case PSMT4HL:
+	case PSMT4HH:
+	case PSMZ32:
+	case PSMZ24:
+	case PSMZ16:
+	case PSMZ16S:
+		break;
+	default:
+		//Unknown format, assume it can touch anything
+		return std::make_pair(0U, static_cast<uint32>(RAMSIZE));
+	}
+
+	auto pageSize = CGsPixelFormats::GetPsmPageSize(psm);
+	uint32 pagePitch = std::max<uint32>((bufWidth + pageSize.first - 1) / pageSize.first, 1);
+	uint32 pageRows = std::max<uint32>((height + pageSize.second - 1) / pageSize.second, 1);
+	//Buffers only need to be block aligned, account for an extra page
+	uint32 size = ((pagePitch * pageRows) + 1) * CGsPixelFormats::PAGESIZE;
+	return std::make_pair(bufPtr, std::min<uint32>(size, RAMSIZE));
+}
+
+bool CGSH_Software::RangesOverlap(const std::pair<uint32, uint32>& range1, const std::pair<uint32, uint32>& range2)
+{
+	if((range1.second == 0) || (range2.second == 0)) return false;
+	return (range1.first < (range2.first + range2.second)) && (range2.first < (range1.first + range1.second));
+}
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+#include <array>
+#include <memory>
+#include "GSHandler.h"
+
+//CPU rasterizer that draws primitives directly into GS RAM.
+//Primitives are binned into screen tiles and tiles are rasterized in parallel by a pool of
+//worker threads. Every tile is owned by a single thread while it's being processed, which
+//preserves primitive ordering within a tile.
+class CGSH_Software : public CGSHandler
+{
+public:
+	//Thread count includes the GS thread itself, 0 means one thread per hardware thread
+	CGSH_Software(uint32 = 0);
+	virtual ~CGSH_Software() = default;
+
+	void ProcessHostToLocalTransfer() override;
+	void ProcessLocalToHostTransfer() override;
+	void ProcessLocalToLocalTransfer() override;
+	void ProcessClutTransfer(uint32, uint32) override;
+
+	Framework::CBitmap GetScreenshot() override;
+
+	static FactoryFunction GetFactoryFunction(uint32 = 0);
+
+private:
+	enum
+	{
+		TILE_SIZE_LOG2 = 5,
+		TILE_SIZE = (1 << TILE_SIZE_LOG2),
+		TILE_COUNT_X = (2048 / TILE_SIZE),
+		TILE_COUNT_Y = (2048 / TILE_SIZE),
+		TILE_COUNT = (TILE_COUNT_X * TILE_COUNT_Y),
+	};
+
+	enum
+	{
+		MAX_BATCH_PRIMITIVES = 0x4000,
+	};
+
+	enum
+	{
+		MAX_MIP_LEVEL = 6,
+	};
+
+	enum ATTRIBUTE
+	{
+		ATTRIBUTE_R,
+		ATTRIBUTE_G,
+		ATTRIBUTE_B,
+		ATTRIBUTE_A,
+		ATTRIBUTE_S,
+		ATTRIBUTE_T,
+		ATTRIBUTE_Q,
+		ATTRIBUTE_F,
+		ATTRIBUTE_COUNT
+	};
+
+	struct RASTERVERTEX
+	{
+		//Position is in 12.4 fixed point, relative to the primitive's XYOFFSET
+		int32 x;
+		int32 y;
+		uint32 z;
+		float attributes[ATTRIBUTE_COUNT];
+	};
+
+	//Attribute value at the primitive's top-left pixel and its per pixel increments
+	struct PLANE
+	{
+		float ref;
+		float dx;
+		float dy;
+	};
+
+	struct PRIMITIVE
+	{
+		uint32 type;
+		uint32 stateIndex;
+
+		//Inclusive bounds in pixels, clipped to the scissor rectangle
+		int32 minX;
+		int32 minY;
+		int32 maxX;
+		int32 maxY;
+
+		//Triangle edge functions: E = a * x + b * y + c (x and y in 12.4 fixed point)
+		int64 edgeA[3];
+		int64 edgeB[3];
+		int64 edgeC[3];
+
+		double zRef;
+		double zDx;
+		double zDy;
+		PLANE planes[ATTRIBUTE_COUNT];
+
+		//Lines and points are rasterized from their vertices
+		RASTERVERTEX vertices[2];
+	};
+
+	struct DRAWSTATE
+	{
+		uint64 prim;
+		uint64 frame;
+		uint64 zbuf;
+		uint64 test;
+		uint64 alpha;
+		uint64 tex0;
+		uint64 tex1;
+		uint64 texA;
+		uint64 clamp;
+		uint64 fogCol;
+		uint64 scissor;
+		uint64 colClamp;
+		uint64 pabe;
+		uint64 fba;
+		uint64 miptbp1;
+		uint64 miptbp2;
+		uint64 dimx;
+		uint64 dthe;
+		std::array<uint32, 256> clut;
+	};
+
+	struct WORKQUEUE
+	{
+		std::vector<uint32> tiles;
+		std::atomic<uint32> nextTile = 0;
+	};
+
+	struct TEXTURELEVEL;
+	struct PIXELPIPELINE;
+
+	void InitializeImpl() override;
+	void ReleaseImpl() override;
+	void ResetImpl() override;
+	void FlipImpl(const DISPLAY_INFO&) override;
+	void MarkNewFrame() override;
+	void WriteRegisterImpl(uint8, uint64) override;
+
+	void BeginTransferWrite() override;
+	void SyncCLUT(const TEX0&) override;
+	void WriteBackMemoryCache() override;
+	void SyncMemoryCache() override;
+
+	void ProcessPrim(uint64);
+	void VertexKick(uint8, uint64);
+
+	uint32 PrepareDrawState();
+	RASTERVERTEX MakeRasterVertex(const VERTEX&, const XYOFFSET&, bool) const;
+	void BinPrimitive(PRIMITIVE&);
+
+	void Prim_Point();
+	void Prim_Line();
+	void Prim_Triangle();
+	void Prim_Sprite();
+
+	void FlushPrimitives();
+	void ProcessWorkQueues(uint32, uint32);
+	void RasterizeTile(uint32);
+	static void RasterizeTriangle(const PRIMITIVE&, PIXELPIPELINE&, int32, int32, int32, int32);
+	static void RasterizeSprite(const PRIMITIVE&, PIXELPIPELINE&, int32, int32, int32, int32);
+	static void RasterizeLine(const PRIMITIVE&, PIXELPIPELINE&, int32, int32, int32, int32);
+	static void RasterizePoint(const PRIMITIVE&, PIXELPIPELINE&, int32, int32, int32, int32);
+
+	void StartWorkers();
+	void StopWorkers();
+	void WorkerThreadProc(uint32);
+
+	template <typename Storage>
+	void TransferLocalToLocal(const BITBLTBUF&, const TRXPOS&, const TRXREG&);
+	void TransferLocalToLocalConvert(const BITBLTBUF&, const TRXPOS&, const TRXREG&);
+
+	static std::pair<uint32, uint32> GetBufferRange(uint32, uint32, uint32, uint32);
+	static bool RangesOverlap(const std::pair<uint32, uint32>&, const std::pair<uint32, uint32>&);
+
+	uint32 m_threadCount = 0;
+
+	VERTEX m_vtxBuffer[3];
+	uint32 m_vtxCount = 0;
+	bool m_pendingPrim = false;
+	uint64 m_pendingPrimValue = 0;
+	PRMODE m_primitiveMode;
+	uint32 m_primitiveType = PRIM_INVALID;
+
+	//Current batch of binned primitives
+	std::vector<PRIMITIVE> m_primitives;
+	std::vector<DRAWSTATE> m_drawStates;
+	std::vector<std::vector<uint32>> m_tileBins;
+	std::vector<uint32> m_activeTiles;
+	uint64 m_batchFrame = 0;
+	uint64 m_batchZbuf = 0;
+	uint32 m_batchWriteStart = 0;
+	uint32 m_batchWriteEnd = 0;
+	bool m_batchSerial = false;
+	bool m_clutDirty = true;
+
+	std::vector<std::thread> m_workerThreads;
+	std::unique_ptr<WORKQUEUE[]> m_workQueues;
+	uint32 m_workQueueCount = 0;
+	std::mutex m_workerMutex;
+	std::condition_variable m_workerStartCondition;
+	std::condition_variable m_workerDoneCondition;
+	uint32 m_workerGeneration = 0;
+	uint32 m_pendingWorkers = 0;
+	bool m_workersDone = false;
+};
@@ -1,5 +1,7 @@
 #include "GSH_Vulkan.h"
 #include <cstring>
+#include <chrono>
+#include <unordered_set>
 #include "std_experimental_map.h"
 #include "../GsPixelFormats.h"
 #include "../GsTransferRange.h"
@@ -13,9 +15,19 @@
 #include "vulkan/StructDefs.h"
 #include "vulkan/StructChain.h"
 #include "vulkan/Utils.h"
+#include "PathUtils.h"
+#include "StdStreamUtils.h"
 
 #define LOG_NAME ("gsh_vulkan")
 
+#define PIPELINE_CACHE_DIRECTORY "shadercache"
+#define PIPELINE_CAPS_LIST_FILENAME "vulkan_pipelines.bin"
+#define PIPELINE_CAPS_LIST_MAGIC 0x4C504B56
+//Increment this when pipeline caps layout changes to invalidate existing lists
+#define PIPELINE_CAPS_LIST_VERSION 1
+//The list is shared between titles, pipelines that haven't been used recently are dropped
+#define PIPELINE_CAPS_LIST_MAX_SIZE 2048
+
 using namespace GSH_Vulkan;
 
 static uint32 MakeColor(uint8 r, uint8 g, uint8 b, uint8 a)
@@ -148,6 +160,7 @@ void CGSH_Vulkan::InitializeImpl()
 	m_context->commandBufferPool = Framework::Vulkan::CCommandBufferPool(m_context->device, renderQueueFamily);
 
 	CreateDescriptorPool();
+	CreatePipelineCache();
 	CreateMemoryBuffer();
 	CreateClutBuffer();
 
@@ -203,6 +216,10 @@ void CGSH_Vulkan::InitializeImpl()
 	m_transferHost = std::make_shared<CTransferHost>(m_context, m_frameCommandBuffer);
 	m_transferLocal = std::make_shared<CTransferLocal>(m_context, m_frameCommandBuffer);
 
+	//Build pipelines we've encountered in previous sessions, this goes on while the game starts
+	m_pipelineCapsList = LoadPipelineCapsList();
+	m_draw->PrecompilePipelines(m_pipelineCapsList);
+
 	m_frameCommandBuffer->RegisterWriter(m_draw.get());
 	m_frameCommandBuffer->RegisterWriter(m_transferHost.get());
 	m_frameCommandBuffer->BeginFrame();
@@ -215,6 +232,10 @@ void CGSH_Vulkan::ReleaseImpl()
 	//Flush any pending rendering commands
 	m_context->device.vkQueueWaitIdle(m_context->queue);
 
+	m_draw->StopPrecompilingPipelines();
+	SavePipelineCapsList();
+	SavePipelineCache();
+
 	m_clutLoad.reset();
 	m_draw.reset();
 	m_present.reset();
@@ -241,6 +262,8 @@ void CGSH_Vulkan::ReleaseImpl()
 	m_swizzleTablePSMZ16S.Reset();
 
 	m_context->device.vkDestroyDescriptorPool(m_context->device, m_context->descriptorPool, nullptr);
+	m_context->device.vkDestroyPipelineCache(m_context->device, m_context->pipelineCache, nullptr);
+	m_context->pipelineCache = VK_NULL_HANDLE;
 	m_context->clutBuffer.Reset();
 	m_context->memoryBuffer.Reset();
 	m_context->memoryBufferCopy.Reset();
@@ -260,6 +283,7 @@ void CGSH_Vulkan::ResetImpl()
 	m_pendingPrimValue = 0;
 	m_regState.isValid = false;
 	memset(&m_clutStates, 0, sizeof(m_clutStates));
+	m_pendingReadback = PENDING_READBACK();
 	memset(m_memoryCache, 0, RAMSIZE);
 	WriteBackMemoryCache();
 }
@@ -545,6 +569,162 @@ void CGSH_Vulkan::CreateDescriptorPool()
 	CHECKVULKANERROR(result);
 }
 
+static fs::path GetPipelineCacheDirectoryPath()
+{
+	return CAppConfig::GetInstance().GetBasePath() / PIPELINE_CACHE_DIRECTORY;
+}
+
+static fs::path GetPipelineCachePath(const VkPhysicalDeviceProperties& deviceProperties)
+{
+	//Pipeline cache data is only valid for the device/driver that generated it
+	std::string fileName = "vulkan_";
+	for(uint32 i = 0; i < VK_UUID_SIZE; i++)
+	{
+		char digits[3];
+		snprintf(digits, sizeof(digits), "%02x", deviceProperties.pipelineCacheUUID[i]);
+		fileName += digits;
+	}
+	fileName += ".bin";
+	return GetPipelineCacheDirectoryPath() / fileName;
+}
+
+void CGSH_Vulkan::CreatePipelineCache()
+{
+	assert(m_context->pipelineCache == VK_NULL_HANDLE);
+
+	VkPhysicalDeviceProperties deviceProperties = {};
+	m_instance.vkGetPhysicalDeviceProperties(m_context->physicalDevice, &deviceProperties);
+
+	std::vector<uint8> cacheData;
+	try
+	{
+		auto cachePath = GetPipelineCachePath(deviceProperties);
+		if(fs::exists(cachePath))
+		{
+			auto stream = Framework::CreateInputStdStream(cachePath.native());
+			cacheData.resize(stream.GetLength());
+			stream.Read(cacheData.data(), cacheData.size());
+		}
+	}
+	catch(const std::exception& exception)
+	{
+		CLog::GetInstance().Warn(LOG_NAME, "Failed to read pipeline cache: %s\r\n", exception.what());
+		cacheData.clear();
+	}
+
+	//Driver validates the header and ignores data it doesn't recognize
+	VkPipelineCacheCreateInfo pipelineCacheCreateInfo = {VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
+	pipelineCacheCreateInfo.initialDataSize = cacheData.size();
+	pipelineCacheCreateInfo.pInitialData = cacheData.empty() ? nullptr : cacheData.data();
+
+	auto result = m_context->device.vkCreatePipelineCache(m_context->device, &pipelineCacheCreateInfo, nullptr, &m_context->pipelineCache);
+	if(result != VK_SUCCESS)
+	{
+		//Try again without initial data in case it was rejected
+		pipelineCacheCreateInfo.initialDataSize = 0;
+		pipelineCacheCreateInfo.pInitialData = nullptr;
+		result = m_context->device.vkCreatePipelineCache(m_context->device, &pipelineCacheCreateInfo, nullptr, &m_context->pipelineCache);
+	}
+	CHECKVULKANERROR(result);
+}
+
+void CGSH_Vulkan::SavePipelineCache()
+{
+	if(m_context->pipelineCache == VK_NULL_HANDLE) return;
+
+	try
+	{
+		size_t cacheDataSize = 0;
+		auto result = m_context->device.vkGetPipelineCacheData(m_context->device, m_context->pipelineCache, &cacheDataSize, nullptr);
+		CHECKVULKANERROR(result);
+
+		std::vector<uint8> cacheData(cacheDataSize);
+		result = m_context->device.vkGetPipelineCacheData(m_context->device, m_context->pipelineCache, &cacheDataSize, cacheData.data());
+		CHECKVULKANERROR(result);
+
+		VkPhysicalDeviceProperties deviceProperties = {};
+		m_instance.vkGetPhysicalDeviceProperties(m_context->physicalDevice, &deviceProperties);
+
+		Framework::PathUtils::EnsurePathExists(GetPipelineCacheDirectoryPath());
+		auto stream = Framework::CreateOutputStdStream(GetPipelineCachePath(deviceProperties).native());
+		stream.Write(cacheData.data(), cacheDataSize);
+	}
+	catch(const std::exception& exception)
+	{
+		CLog::GetInstance().Warn(LOG_NAME, "Failed to save pipeline cache: %s\r\n", exception.what());
+	}
+}
+
+std::vector<CDraw::PipelineCapsInt> CGSH_Vulkan::LoadPipelineCapsList()
+{
+	std::vector<CDraw::PipelineCapsInt> capsList;
+
+	auto listPath = GetPipelineCacheDirectoryPath() / PIPELINE_CAPS_LIST_FILENAME;
+	if(!fs::exists(listPath)) return capsList;
+
+	try
+	{
+		auto stream = Framework::CreateInputStdStream(listPath.native());
+		uint32 magic = stream.Read32();
+		uint32 version = stream.Read32();
+		if((magic != PIPELINE_CAPS_LIST_MAGIC) || (version != PIPELINE_CAPS_LIST_VERSION))
+		{
+			throw std::runtime_error("Unsupported pipeline caps list version.");
+		}
+		uint32 capsCount = stream.Read32();
+		if(capsCount > PIPELINE_CAPS_LIST_MAX_SIZE)
+		{
+			throw std::runtime_error("Pipeline caps list is too large.");
+		}
+		capsList.resize(capsCount);
+		stream.Read(capsList.data(), capsCount * sizeof(CDraw::PipelineCapsInt));
+		if(stream.IsEOF())
+		{
+			throw std::runtime_error("Pipeline caps list is truncated.");
+		}
+	}
+	catch(const std::exception& exception)
+	{
+		CLog::GetInstance().Warn(LOG_NAME, "Discarding pipeline caps list: %s\r\n", exception.what());
+		capsList.clear();
+	}
+
+	return capsList;
+}
+
+void CGSH_Vulkan::SavePipelineCapsList()
+{
+	//Pipelines used in this session come first, followed by the ones from previous sessions,
+	//most recently used first. Older pipelines are dropped once the list is full.
+	auto capsList = m_draw->GetPipelineCapsList();
+	std::unordered_set<CDraw::PipelineCapsInt> usedCaps(capsList.begin(), capsList.end());
+	for(const auto& caps : m_pipelineCapsList)
+	{
+		if(capsList.size() >= PIPELINE_CAPS_LIST_MAX_SIZE) break;
+		if(usedCaps.count(caps) != 0) continue;
+		capsList.push_back(caps);
+	}
+	if(capsList.size() > PIPELINE_CAPS_LIST_MAX_SIZE)
+	{
+		capsList.resize(PIPELINE_CAPS_LIST_MAX_SIZE);
+	}
+	if(capsList.empty()) return;
+
+	try
+	{
+		Framework::PathUtils::EnsurePathExists(GetPipelineCacheDirectoryPath());
+		auto stream = Framework::CreateOutputStdStream((GetPipelineCacheDirectoryPath() / PIPELINE_CAPS_LIST_FILENAME).native());
+		stream.Write32(PIPELINE_CAPS_LIST_MAGIC);
+		stream.Write32(PIPELINE_CAPS_LIST_VERSION);
+		stream.Write32(static_cast<uint32>(capsList.size()));
+		stream.Write(capsList.data(), capsList.size() * sizeof(CDraw::PipelineCapsInt));
+	}
+	catch(const std::exception& exception)
+	{
+		CLog::GetInstance().Warn(LOG_NAME, "Failed to save pipeline caps list: %s\r\n", exception.what());
+	}
+}
+
 void CGSH_Vulkan::CreateMemoryBuffer()
 {
 	assert(m_context->memoryBuffer.IsEmpty());
@@ -666,6 +846,7 @@ void CGSH_Vulkan::VertexKick(uint8 registerId, uint64 data)
 
 		if(drawingKick)
 		{
+			m_transferHost->FlushTransfers();
 			SetRenderingContext(m_primitiveMode);
 		}
 
@@ -1422,8 +1603,10 @@ void CGSH_Vulkan::ProcessHostToLocalTransfer()
 	auto pipelineCaps = make_convertible<CTransferHost::PIPELINE_CAPS>(0);
 	pipelineCaps.dstFormat = bltBuf.nDstPsm;
 
+	auto [transferAddress, transferSize] = GsTransfer::GetDstRange(bltBuf, trxReg, trxPos);
+
 	m_transferHost->SetPipelineCaps(pipelineCaps);
-	m_transferHost->DoTransfer(m_xferBuffer);
+	m_transferHost->DoTransfer(m_xferBuffer, transferAddress, transferSize);
 
 	m_xferBuffer.clear();
 }
@@ -1434,6 +1617,7 @@ void CGSH_Vulkan::ProcessLocalToHostTransfer()
 	if(readsEnabled)
 	{
 		m_draw->FlushRenderPass();
+		m_transferHost->FlushTransfers();
 
 		auto bltBuf = make_convertible<BITBLTBUF>(m_nReg[GS_REG_BITBLTBUF]);
 		auto trxReg = make_convertible<TRXREG>(m_nReg[GS_REG_TRXREG]);
@@ -1457,42 +1641,96 @@ void CGSH_Vulkan::ProcessLocalToHostTransfer()
 			copySize = RAMSIZE - copyBase;
 		}
 
-		auto& srcBuffer = m_context->memoryBuffer;
-		auto& dstBuffer = m_context->memoryBufferTransfer;
+		//Transfer buffer is about to be overwritten
+		CompletePendingReadback();
 
-		auto commandBuffer = m_frameCommandBuffer->GetCommandBuffer();
+		RecordReadbackCopy(copyBase, copySize);
 
+		if(transfer->second.IsRecurring())
 		{
-			auto memoryBarrier = Framework::Vulkan::MemoryBarrier();
-			memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-			memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-
-			m_context->device.vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT, VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT,
-			                                       0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+			//Use data from the previous readback of this area, it will be updated when the frame is submitted
+			CopyReadbackToMemoryCache(copyBase, copySize);
 		}
-
-		{
-			VkBufferCopy bufferCopy = {};
-			bufferCopy.size = copySize;
-			bufferCopy.dstOffset = copyBase;
-			bufferCopy.srcOffset = copyBase;
-			m_context->device.vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &bufferCopy);
-		}
-
-		if(!transfer->second.IsRecurring())
+		else
 		{
+			//Submit the copy now, but only wait for it when the data is actually read (SyncTransferRead)
+			m_pendingReadback.pending = true;
+			m_pendingReadback.address = copyBase;
+			m_pendingReadback.size = copySize;
+			m_pendingReadback.submitIndex = m_frameCommandBuffer->GetSubmitIndex();
 			m_frameCommandBuffer->Flush();
-			m_context->device.vkQueueWaitIdle(m_context->queue);
 		}
+	}
+}
 
-		void* bufferPtr = nullptr;
-		auto result = m_context->device.vkMapMemory(m_context->device, dstBuffer.GetMemory(), copyBase, copySize, 0, &bufferPtr);
-		CHECKVULKANERROR(result);
+void CGSH_Vulkan::RecordReadbackCopy(uint32 address, uint32 size)
+{
+	auto& srcBuffer = m_context->memoryBuffer;
+	auto& dstBuffer = m_context->memoryBufferTransfer;
 
-		memcpy(m_memoryCache + copyBase, bufferPtr, copySize);
+	auto commandBuffer = m_frameCommandBuffer->GetCommandBuffer();
 
-		m_context->device.vkUnmapMemory(m_context->device, dstBuffer.GetMemory());
+	{
+		auto memoryBarrier = Framework::Vulkan::MemoryBarrier();
+		memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+		m_context->device.vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		                                       0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
 	}
+
+	{
+		VkBufferCopy bufferCopy = {};
+		bufferCopy.size = size;
+		bufferCopy.dstOffset = address;
+		bufferCopy.srcOffset = address;
+		m_context->device.vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &bufferCopy);
+	}
+
+	//Make copied data visible to the host once the submission completes
+	{
+		auto memoryBarrier = Framework::Vulkan::MemoryBarrier();
+		memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+
+		m_context->device.vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+		                                       0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+	}
+}
+
+void CGSH_Vulkan::CopyReadbackToMemoryCache(uint32 address, uint32 size)
+{
+	auto& transferBuffer = m_context->memoryBufferTransfer;
+
+	void* bufferPtr = nullptr;
+	auto result = m_context->device.vkMapMemory(m_context->device, transferBuffer.GetMemory(), address, size, 0, &bufferPtr);
+	CHECKVULKANERROR(result);
+
+	memcpy(m_memoryCache + address, bufferPtr, size);
+
+	m_context->device.vkUnmapMemory(m_context->device, transferBuffer.GetMemory());
+}
+
+void CGSH_Vulkan::CompletePendingReadback()
+{
+	if(!m_pendingReadback.pending) return;
+	m_pendingReadback.pending = false;
+
+	auto waitStartTime = std::chrono::steady_clock::now();
+	bool stalled = m_frameCommandBuffer->WaitForSubmit(m_pendingReadback.submitIndex);
+	if(stalled)
+	{
+		auto waitEndTime = std::chrono::steady_clock::now();
+		m_stats.readbackStalls++;
+		m_stats.readbackStallTime += std::chrono::duration_cast<std::chrono::microseconds>(waitEndTime - waitStartTime).count();
+	}
+
+	CopyReadbackToMemoryCache(m_pendingReadback.address, m_pendingReadback.size);
+}
+
+void CGSH_Vulkan::SyncTransferRead()
+{
+	CompletePendingReadback();
 }
 
 void CGSH_Vulkan::ProcessLocalToLocalTransfer()
@@ -1500,6 +1738,7 @@ void CGSH_Vulkan::ProcessLocalToLocalTransfer()
 	//Flush previous cached info
 	memset(&m_clutStates, 0, sizeof(m_clutStates));
 	m_draw->FlushRenderPass();
+	m_transferHost->FlushTransfers();
 
 	auto bltBuf = make_convertible<BITBLTBUF>(m_nReg[GS_REG_BITBLTBUF]);
 	auto trxReg = make_convertible<TRXREG>(m_nReg[GS_REG_TRXREG]);
@@ -1563,6 +1802,7 @@ void CGSH_Vulkan::TransferWrite(const uint8* imageData, uint32 length)
 
 void CGSH_Vulkan::WriteBackMemoryCache()
 {
+	CompletePendingReadback();
 	m_frameCommandBuffer->Flush();
 	m_context->device.vkQueueWaitIdle(m_context->queue);
 
@@ -1572,11 +1812,22 @@ void CGSH_Vulkan::WriteBackMemoryCache()
 
 void CGSH_Vulkan::SyncMemoryCache()
 {
+	//Read the whole memory through the transfer buffer and only wait on this submission
+	CompletePendingReadback();
+
+	//Pending draws and uploads need to be recorded before the copy, which can't be done inside a render pass
+	m_draw->FlushRenderPass();
+	m_transferHost->FlushTransfers();
+
+	RecordReadbackCopy(0, RAMSIZE);
+
+	m_pendingReadback.pending = true;
+	m_pendingReadback.address = 0;
+	m_pendingReadback.size = RAMSIZE;
+	m_pendingReadback.submitIndex = m_frameCommandBuffer->GetSubmitIndex();
 	m_frameCommandBuffer->Flush();
-	m_context->device.vkQueueWaitIdle(m_context->queue);
 
-	m_context->memoryBuffer.Read(m_context->queue, m_context->commandBufferPool,
-	                             m_context->physicalDeviceMemoryProperties, m_memoryCache);
+	CompletePendingReadback();
 }
 
 void CGSH_Vulkan::SyncCLUT(const TEX0& tex0)
@@ -1590,14 +1841,20 @@ void CGSH_Vulkan::SyncCLUT(const TEX0& tex0)
 	int32 clutCacheIndex = FindCachedClut(clutKey);
 	if(clutCacheIndex == -1)
 	{
+		m_stats.clutCacheMisses++;
 		clutCacheIndex = m_nextClutCacheIndex++;
 		m_nextClutCacheIndex %= CLUT_CACHE_SIZE;
 		m_clutStates[clutCacheIndex] = clutKey;
 
 		m_draw->FlushRenderPass();
+		m_transferHost->FlushTransfers();
 		uint32 clutBufferOffset = sizeof(uint32) * CLUTENTRYCOUNT * clutCacheIndex;
 		m_clutLoad->DoClutLoad(clutBufferOffset, tex0, texClut);
 	}
+	else
+	{
+		m_stats.clutCacheHits++;
+	}
 
 	uint32 clutBufferOffset = sizeof(uint32) * CLUTENTRYCOUNT * clutCacheIndex;
 	m_draw->SetClutBufferOffset(clutBufferOffset);
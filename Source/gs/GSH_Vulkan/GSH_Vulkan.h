@@ -63,6 +63,7 @@ protected:
 	void FlipImpl(const DISPLAY_INFO&) override;
 	void BeginTransferWrite() override;
 	void TransferWrite(const uint8*, uint32) override;
+	void SyncTransferRead() override;
 	void WriteBackMemoryCache() override;
 	void SyncMemoryCache() override;
 	void SyncCLUT(const TEX0&) override;
@@ -98,6 +99,14 @@ private:
 		uint64 miptbp2 = 0;
 	};
 
+	struct PENDING_READBACK
+	{
+		bool pending = false;
+		uint32 address = 0;
+		uint32 size = 0;
+		uint64 submitIndex = 0;
+	};
+
 	struct LOCAL_TO_HOST_XFER_HISTORY
 	{
 		static constexpr int MAX_FRAME_COUNT = 16;
@@ -149,6 +158,15 @@ private:
 	void CreateMemoryBuffer();
 	void CreateClutBuffer();
 
+	void RecordReadbackCopy(uint32, uint32);
+	void CopyReadbackToMemoryCache(uint32, uint32);
+	void CompletePendingReadback();
+
+	void CreatePipelineCache();
+	void SavePipelineCache();
+	std::vector<GSH_Vulkan::CDraw::PipelineCapsInt> LoadPipelineCapsList();
+	void SavePipelineCapsList();
+
 	void ProcessPrim(uint64);
 	void VertexKick(uint8, uint64);
 	void SetRenderingContext(uint64);
@@ -235,6 +253,9 @@ private:
 	GSH_Vulkan::TransferHostPtr m_transferHost;
 	GSH_Vulkan::TransferLocalPtr m_transferLocal;
 
+	//Caps of the pipelines loaded at initialization
+	std::vector<GSH_Vulkan::CDraw::PipelineCapsInt> m_pipelineCapsList;
+
 	uint8* m_memoryCache = nullptr;
 
 	//Draw context
@@ -254,6 +275,7 @@ private:
 	uint32 m_nextClutCacheIndex = 0;
 	std::vector<uint8> m_xferBuffer;
 	std::map<uint64, LOCAL_TO_HOST_XFER_HISTORY> m_xferHistory;
+	PENDING_READBACK m_pendingReadback;
 
 	//Optimization for Virtua Fighter 2, Sega Rally 95
 	float m_lastLineU = 0;
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <set>
 #include "GSH_VulkanDraw.h"
 #include "GSH_VulkanMemoryUtils.h"
 #include "MemStream.h"
@@ -49,6 +51,8 @@ CDraw::CDraw(const ContextPtr& context, const FrameCommandBufferPtr& frameComman
 
 CDraw::~CDraw()
 {
+	//Workers use the derived class' pipeline creation functions, they need to be stopped before getting here
+	assert(m_precompileWorkers.empty());
 	for(auto& frame : m_frames)
 	{
 		m_context->device.vkUnmapMemory(m_context->device, frame.vertexBuffer.GetMemory());
@@ -267,6 +271,105 @@ void CDraw::PostFlushFrameCommandBuffer()
 	m_mipParamsIndex = 0;
 }
 
+std::vector<CDraw::PipelineCapsInt> CDraw::GetPipelineCapsList() const
+{
+	return m_pipelineCache.GetKeys();
+}
+
+void CDraw::PrecompilePipelines(const std::vector<PipelineCapsInt>& capsList)
+{
+	assert(m_precompileWorkers.empty());
+
+	std::set<PrecompiledPipelineKey> pendingKeys;
+	std::vector<PRECOMPILE_TASK> tasks;
+	for(const auto& caps : capsList)
+	{
+		AddPrecompileTasks(tasks, make_convertible<PIPELINE_CAPS>(caps));
+	}
+	for(auto& task : tasks)
+	{
+		if(task.pipelineCache->TryGetPipeline(task.caps)) continue;
+		if(!pendingKeys.insert(std::make_pair(task.pipelineCache, task.caps)).second) continue;
+		m_precompileTasks.push_back(std::move(task));
+	}
+
+	if(m_precompileTasks.empty()) return;
+
+	//Pipeline creation only touches immutable state and the device, which is thread safe.
+	//Leave some cores to the emulation threads, the game starts while this is going on.
+	uint32 workerCount = std::max<uint32>(std::thread::hardware_concurrency() / 2, 1);
+	workerCount = std::min<uint32>(workerCount, static_cast<uint32>(m_precompileTasks.size()));
+
+	m_nextPrecompileTaskIndex = 0;
+	m_precompileCancelled = false;
+	for(uint32 i = 0; i < workerCount; i++)
+	{
+		m_precompileWorkers.emplace_back([this]() { PrecompileWorkerProc(); });
+	}
+}
+
+void CDraw::StopPrecompilingPipelines()
+{
+	m_precompileCancelled = true;
+	for(auto& worker : m_precompileWorkers)
+	{
+		worker.join();
+	}
+	m_precompileWorkers.clear();
+	m_precompileTasks.clear();
+
+	//Drop pipelines that haven't been needed
+	for(const auto& precompiledPipelinePair : m_precompiledPipelines)
+	{
+		const auto& pipeline = precompiledPipelinePair.second;
+		m_context->device.vkDestroyPipeline(m_context->device, pipeline.pipeline, nullptr);
+		m_context->device.vkDestroyPipelineLayout(m_context->device, pipeline.pipelineLayout, nullptr);
+		m_context->device.vkDestroyDescriptorSetLayout(m_context->device, pipeline.descriptorSetLayout, nullptr);
+	}
+	m_precompiledPipelines.clear();
+}
+
+void CDraw::AddPrecompileTasks(std::vector<PRECOMPILE_TASK>& tasks, const PIPELINE_CAPS& caps)
+{
+	PRECOMPILE_TASK task;
+	task.pipelineCache = &m_pipelineCache;
+	task.caps = static_cast<PipelineCapsInt>(caps);
+	task.createPipeline = [this, caps]() { return CreateDrawPipeline(caps); };
+	tasks.push_back(std::move(task));
+}
+
+bool CDraw::TakePrecompiledPipeline(const PipelineCache& pipelineCache, const PIPELINE_CAPS& caps, PIPELINE& pipeline)
+{
+	//Only called when a pipeline isn't in the cache, when a worker is still building it, we build our own.
+	//The worker's copy then stays unused until StopPrecompilingPipelines.
+	std::lock_guard<std::mutex> precompiledPipelinesLock(m_precompiledPipelinesMutex);
+	auto pipelineIterator = m_precompiledPipelines.find(std::make_pair(&pipelineCache, static_cast<PipelineCapsInt>(caps)));
+	if(pipelineIterator == std::end(m_precompiledPipelines)) return false;
+	pipeline = pipelineIterator->second;
+	m_precompiledPipelines.erase(pipelineIterator);
+	return true;
+}
+
+void CDraw::PrecompileWorkerProc()
+{
+	while(!m_precompileCancelled)
+	{
+		uint32 taskIndex = m_nextPrecompileTaskIndex++;
+		if(taskIndex >= m_precompileTasks.size()) break;
+		const auto& task = m_precompileTasks[taskIndex];
+		try
+		{
+			auto pipeline = task.createPipeline();
+			std::lock_guard<std::mutex> precompiledPipelinesLock(m_precompiledPipelinesMutex);
+			m_precompiledPipelines.insert(std::make_pair(std::make_pair(task.pipelineCache, task.caps), pipeline));
+		}
+		catch(...)
+		{
+			//Pipeline will be created when it's needed
+		}
+	}
+}
+
 std::vector<VkVertexInputAttributeDescription> CDraw::GetVertexAttributes()
 {
 	std::vector<VkVertexInputAttributeDescription> vertexAttributes;
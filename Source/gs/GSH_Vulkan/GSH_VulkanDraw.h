@@ -1,6 +1,11 @@
 #pragma once
 
 #include <memory>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <functional>
 #include "GSH_VulkanContext.h"
 #include "GSH_VulkanFrameCommandBuffer.h"
 #include "GSH_VulkanPipelineCache.h"
@@ -107,6 +112,13 @@ namespace GSH_Vulkan
 		void PreFlushFrameCommandBuffer() override;
 		void PostFlushFrameCommandBuffer() override;
 
+		//Returns caps of pipelines that have been used for drawing
+		std::vector<PipelineCapsInt> GetPipelineCapsList() const;
+
+		//Builds pipelines on worker threads, they are picked up when draws need them
+		void PrecompilePipelines(const std::vector<PipelineCapsInt>&);
+		void StopPrecompilingPipelines();
+
 	protected:
 		enum
 		{
@@ -195,6 +207,21 @@ namespace GSH_Vulkan
 			DRAW_PIPELINE_MIPPARAMS_UNIFORMS* mipParamsBufferPtr = nullptr;
 		};
 
+		struct PRECOMPILE_TASK
+		{
+			const PipelineCache* pipelineCache = nullptr;
+			PipelineCapsInt caps = 0;
+			std::function<PIPELINE()> createPipeline;
+		};
+		typedef std::pair<const PipelineCache*, PipelineCapsInt> PrecompiledPipelineKey;
+		typedef std::map<PrecompiledPipelineKey, PIPELINE> PrecompiledPipelineMap;
+
+		virtual PIPELINE CreateDrawPipeline(const PIPELINE_CAPS&) = 0;
+
+		virtual void AddPrecompileTasks(std::vector<PRECOMPILE_TASK>&, const PIPELINE_CAPS&);
+		bool TakePrecompiledPipeline(const PipelineCache&, const PIPELINE_CAPS&, PIPELINE&);
+		void PrecompileWorkerProc();
+
 		static std::vector<VkVertexInputAttributeDescription> GetVertexAttributes();
 		Framework::Vulkan::CShaderModule CreateVertexShader(const PIPELINE_CAPS&);
 
@@ -224,6 +251,13 @@ namespace GSH_Vulkan
 		uint32 m_memoryCopySize = 0;
 
 		CGsSpriteRegion m_memoryCopyRegion;
+
+		std::vector<PRECOMPILE_TASK> m_precompileTasks;
+		std::atomic<uint32> m_nextPrecompileTaskIndex = 0;
+		std::atomic<bool> m_precompileCancelled = false;
+		std::vector<std::thread> m_precompileWorkers;
+		std::mutex m_precompiledPipelinesMutex;
+		PrecompiledPipelineMap m_precompiledPipelines;
 	};
 
 	typedef std::shared_ptr<CDraw> DrawPtr;
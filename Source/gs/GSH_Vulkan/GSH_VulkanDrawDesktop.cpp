@@ -301,7 +301,7 @@ PIPELINE CDrawDesktop::CreateDrawPipeline(const PIPELINE_CAPS& caps)
 	pipelineCreateInfo.renderPass = m_renderPass;
 	pipelineCreateInfo.layout = drawPipeline.pipelineLayout;
 
-	result = m_context->device.vkCreateGraphicsPipelines(m_context->device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &drawPipeline.pipeline);
+	result = m_context->device.vkCreateGraphicsPipelines(m_context->device, m_context->pipelineCache, 1, &pipelineCreateInfo, nullptr, &drawPipeline.pipeline);
 	CHECKVULKANERROR(result);
 
 	return drawPipeline;
@@ -973,7 +973,12 @@ void CDrawDesktop::FlushVertices()
 	auto drawPipeline = m_pipelineCache.TryGetPipeline(m_pipelineCaps);
 	if(!drawPipeline)
 	{
-		drawPipeline = m_pipelineCache.RegisterPipeline(m_pipelineCaps, CreateDrawPipeline(m_pipelineCaps));
+		PIPELINE pipeline;
+		if(!TakePrecompiledPipeline(m_pipelineCache, m_pipelineCaps, pipeline))
+		{
+			pipeline = CreateDrawPipeline(m_pipelineCaps);
+		}
+		drawPipeline = m_pipelineCache.RegisterPipeline(m_pipelineCaps, pipeline);
 	}
 
 	{
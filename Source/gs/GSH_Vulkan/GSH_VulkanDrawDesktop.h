@@ -18,7 +18,7 @@ namespace GSH_Vulkan
 		void CreateFramebuffer();
 		void CreateDrawImage();
 
-		PIPELINE CreateDrawPipeline(const PIPELINE_CAPS&);
+		PIPELINE CreateDrawPipeline(const PIPELINE_CAPS&) override;
 		VkDescriptorSet PrepareDescriptorSet(VkDescriptorSetLayout, const DESCRIPTORSET_CAPS&);
 		Framework::Vulkan::CShaderModule CreateFragmentShader(const PIPELINE_CAPS&);
 
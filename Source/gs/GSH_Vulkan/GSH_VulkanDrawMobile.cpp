@@ -166,7 +166,12 @@ void CDrawMobile::FlushVertices()
 		auto loadPipeline = m_loadPipelineCache.TryGetPipeline(strippedCaps);
 		if(!loadPipeline)
 		{
-			loadPipeline = m_loadPipelineCache.RegisterPipeline(strippedCaps, CreateLoadPipeline(strippedCaps));
+			PIPELINE pipeline;
+			if(!TakePrecompiledPipeline(m_loadPipelineCache, strippedCaps, pipeline))
+			{
+				pipeline = CreateLoadPipeline(strippedCaps);
+			}
+			loadPipeline = m_loadPipelineCache.RegisterPipeline(strippedCaps, pipeline);
 		}
 
 		auto descriptorSetCaps = make_convertible<DESCRIPTORSET_CAPS>(0);
@@ -191,7 +196,12 @@ void CDrawMobile::FlushVertices()
 	auto drawPipeline = m_pipelineCache.TryGetPipeline(m_pipelineCaps);
 	if(!drawPipeline)
 	{
-		drawPipeline = m_pipelineCache.RegisterPipeline(m_pipelineCaps, CreateDrawPipeline(m_pipelineCaps));
+		PIPELINE pipeline;
+		if(!TakePrecompiledPipeline(m_pipelineCache, m_pipelineCaps, pipeline))
+		{
+			pipeline = CreateDrawPipeline(m_pipelineCaps);
+		}
+		drawPipeline = m_pipelineCache.RegisterPipeline(m_pipelineCaps, pipeline);
 	}
 
 	{
@@ -262,7 +272,12 @@ void CDrawMobile::FlushRenderPass()
 		auto storePipeline = m_storePipelineCache.TryGetPipeline(strippedCaps);
 		if(!storePipeline)
 		{
-			storePipeline = m_storePipelineCache.RegisterPipeline(strippedCaps, CreateStorePipeline(strippedCaps));
+			PIPELINE pipeline;
+			if(!TakePrecompiledPipeline(m_storePipelineCache, strippedCaps, pipeline))
+			{
+				pipeline = CreateStorePipeline(strippedCaps);
+			}
+			storePipeline = m_storePipelineCache.RegisterPipeline(strippedCaps, pipeline);
 		}
 
 		auto descriptorSetCaps = make_convertible<DESCRIPTORSET_CAPS>(0);
@@ -287,6 +302,28 @@ void CDrawMobile::FlushRenderPass()
 	m_renderPassMaxY = -FLT_MAX;
 }
 
+void CDrawMobile::AddPrecompileTasks(std::vector<PRECOMPILE_TASK>& tasks, const PIPELINE_CAPS& caps)
+{
+	CDraw::AddPrecompileTasks(tasks, caps);
+
+	//Load/store pipelines only depend on a few caps, duplicates are skipped by the caller
+	auto strippedCaps = MakeLoadStorePipelineCaps(caps);
+	{
+		PRECOMPILE_TASK task;
+		task.pipelineCache = &m_loadPipelineCache;
+		task.caps = static_cast<PipelineCapsInt>(strippedCaps);
+		task.createPipeline = [this, strippedCaps]() { return CreateLoadPipeline(strippedCaps); };
+		tasks.push_back(std::move(task));
+	}
+	{
+		PRECOMPILE_TASK task;
+		task.pipelineCache = &m_storePipelineCache;
+		task.caps = static_cast<PipelineCapsInt>(strippedCaps);
+		task.createPipeline = [this, strippedCaps]() { return CreateStorePipeline(strippedCaps); };
+		tasks.push_back(std::move(task));
+	}
+}
+
 VkDescriptorSet CDrawMobile::PrepareDescriptorSet(VkDescriptorSetLayout descriptorSetLayout, const DESCRIPTORSET_CAPS& caps)
 {
 	auto descriptorSetIterator = m_descriptorSetCache.find(caps);
@@ -830,7 +867,7 @@ PIPELINE CDrawMobile::CreateDrawPipeline(const PIPELINE_CAPS& caps)
 	pipelineCreateInfo.renderPass = m_renderPass;
 	pipelineCreateInfo.layout = drawPipeline.pipelineLayout;
 
-	result = m_context->device.vkCreateGraphicsPipelines(m_context->device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &drawPipeline.pipeline);
+	result = m_context->device.vkCreateGraphicsPipelines(m_context->device, m_context->pipelineCache, 1, &pipelineCreateInfo, nullptr, &drawPipeline.pipeline);
 	CHECKVULKANERROR(result);
 
 	return drawPipeline;
@@ -1387,7 +1424,7 @@ PIPELINE CDrawMobile::CreateLoadPipeline(const PIPELINE_CAPS& caps)
 	pipelineCreateInfo.renderPass = m_renderPass;
 	pipelineCreateInfo.layout = loadPipeline.pipelineLayout;
 
-	result = m_context->device.vkCreateGraphicsPipelines(m_context->device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &loadPipeline.pipeline);
+	result = m_context->device.vkCreateGraphicsPipelines(m_context->device, m_context->pipelineCache, 1, &pipelineCreateInfo, nullptr, &loadPipeline.pipeline);
 	CHECKVULKANERROR(result);
 
 	return loadPipeline;
@@ -1546,7 +1583,7 @@ PIPELINE CDrawMobile::CreateStorePipeline(const PIPELINE_CAPS& caps)
 	pipelineCreateInfo.renderPass = m_renderPass;
 	pipelineCreateInfo.layout = storePipeline.pipelineLayout;
 
-	result = m_context->device.vkCreateGraphicsPipelines(m_context->device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &storePipeline.pipeline);
+	result = m_context->device.vkCreateGraphicsPipelines(m_context->device, m_context->pipelineCache, 1, &pipelineCreateInfo, nullptr, &storePipeline.pipeline);
 	CHECKVULKANERROR(result);
 
 	return storePipeline;
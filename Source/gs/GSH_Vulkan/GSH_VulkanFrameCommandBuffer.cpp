@@ -36,7 +36,7 @@ void CFrameCommandBuffer::RegisterWriter(IFrameCommandBufferWriter* writer)
 
 void CFrameCommandBuffer::BeginFrame()
 {
-	const auto& frame = m_frames[m_currentFrame];
+	auto& frame = m_frames[m_currentFrame];
 
 	auto result = VK_SUCCESS;
 
@@ -46,6 +46,8 @@ void CFrameCommandBuffer::BeginFrame()
 	result = m_context->device.vkResetFences(m_context->device, 1, &frame.execCompleteFence);
 	CHECKVULKANERROR(result);
 
+	frame.pendingSubmitIndex = INVALID_SUBMIT_INDEX;
+
 	result = m_context->device.vkResetCommandBuffer(frame.commandBuffer, VK_COMMAND_BUFFER_RESET_RELEASE_RESOURCES_BIT);
 	CHECKVULKANERROR(result);
 
@@ -63,7 +65,7 @@ void CFrameCommandBuffer::EndFrame()
 	}
 
 	auto result = VK_SUCCESS;
-	const auto& frame = m_frames[m_currentFrame];
+	auto& frame = m_frames[m_currentFrame];
 
 	result = m_context->device.vkEndCommandBuffer(frame.commandBuffer);
 	CHECKVULKANERROR(result);
@@ -77,6 +79,8 @@ void CFrameCommandBuffer::EndFrame()
 		CHECKVULKANERROR(result);
 	}
 
+	frame.pendingSubmitIndex = m_submitIndex++;
+
 	for(const auto& writer : m_writers)
 	{
 		writer->PostFlushFrameCommandBuffer();
@@ -103,6 +107,30 @@ void CFrameCommandBuffer::ResetFlushCount()
 	m_flushCount = 0;
 }
 
+uint64 CFrameCommandBuffer::GetSubmitIndex() const
+{
+	return m_submitIndex;
+}
+
+bool CFrameCommandBuffer::WaitForSubmit(uint64 submitIndex)
+{
+	assert(submitIndex < m_submitIndex);
+	for(const auto& frame : m_frames)
+	{
+		if(frame.pendingSubmitIndex != submitIndex) continue;
+
+		auto result = m_context->device.vkWaitForFences(m_context->device, 1, &frame.execCompleteFence, VK_TRUE, 0);
+		if(result == VK_SUCCESS) return false;
+		if(result != VK_TIMEOUT) CHECKVULKANERROR(result);
+
+		result = m_context->device.vkWaitForFences(m_context->device, 1, &frame.execCompleteFence, VK_TRUE, UINT64_MAX);
+		CHECKVULKANERROR(result);
+		return true;
+	}
+	//Frame has already been recycled by BeginFrame, which waited for its completion
+	return false;
+}
+
 VkCommandBuffer CFrameCommandBuffer::GetCommandBuffer()
 {
 	const auto& frame = m_frames[m_currentFrame];
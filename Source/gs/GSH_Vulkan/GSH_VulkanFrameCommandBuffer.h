@@ -32,14 +32,23 @@ namespace GSH_Vulkan
 		uint32 GetFlushCount() const;
 		void ResetFlushCount();
 
+		//Index that will be assigned to the next submission of the command buffer
+		uint64 GetSubmitIndex() const;
+		//Blocks until the submission with the specified index has completed execution,
+		//returns false if it was already complete and no wait was needed
+		bool WaitForSubmit(uint64);
+
 		VkCommandBuffer GetCommandBuffer();
 		uint32 GetCurrentFrame() const;
 
 	private:
+		static constexpr uint64 INVALID_SUBMIT_INDEX = ~0ULL;
+
 		struct FRAMECONTEXT
 		{
 			VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
 			VkFence execCompleteFence = VK_NULL_HANDLE;
+			uint64 pendingSubmitIndex = INVALID_SUBMIT_INDEX;
 		};
 
 		ContextPtr m_context;
@@ -50,6 +59,7 @@ namespace GSH_Vulkan
 		uint32 m_currentFrame = 0;
 
 		uint32 m_flushCount = 0;
+		uint64 m_submitIndex = 0;
 	};
 
 	typedef std::shared_ptr<CFrameCommandBuffer> FrameCommandBufferPtr;
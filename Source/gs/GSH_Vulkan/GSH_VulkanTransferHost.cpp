@@ -1,4 +1,5 @@
 #include "GSH_VulkanTransferHost.h"
+#include <algorithm>
 #include "GSH_VulkanMemoryUtils.h"
 #include "GSH_VulkanPlatformDefs.h"
 #include "MemStream.h"
@@ -53,13 +54,12 @@ void CTransferHost::SetPipelineCaps(const PIPELINE_CAPS& pipelineCaps)
 	m_pipelineCaps = pipelineCaps;
 }
 
-void CTransferHost::DoTransfer(const XferBuffer& inputData)
+void CTransferHost::DoTransfer(const XferBuffer& inputData, uint32 dstAddress, uint32 dstSize)
 {
-	auto result = VK_SUCCESS;
-
 	uint32 xferBufferRemainSize = XFER_BUFFER_SIZE - m_xferBufferOffset;
 	if(xferBufferRemainSize < inputData.size())
 	{
+		//Pending transfers will be dispatched before the command buffer is submitted
 		m_frameCommandBuffer->Flush();
 		assert((XFER_BUFFER_SIZE - m_xferBufferOffset) >= inputData.size());
 	}
@@ -71,13 +71,6 @@ void CTransferHost::DoTransfer(const XferBuffer& inputData)
 	assert((m_xferBufferOffset & 0x03) == 0);
 	Params.xferBufferOffset = m_xferBufferOffset / 4;
 
-	//Find pipeline and create it if we've never encountered it before
-	auto xferPipeline = m_pipelineCache.TryGetPipeline(m_pipelineCaps);
-	if(!xferPipeline)
-	{
-		xferPipeline = m_pipelineCache.RegisterPipeline(m_pipelineCaps, CreateXferPipeline(m_pipelineCaps));
-	}
-
 	uint32 pixelCount = 0;
 	switch(m_pipelineCaps.dstFormat)
 	{
@@ -108,32 +101,95 @@ void CTransferHost::DoTransfer(const XferBuffer& inputData)
 	}
 
 	Params.pixelCount = pixelCount;
-	uint32 workUnits = (pixelCount + m_localSize - 1) / m_localSize;
 
-	auto descriptorSetCaps = make_convertible<DESCRIPTORSET_CAPS>(0);
-	descriptorSetCaps.dstPsm = m_pipelineCaps.dstFormat;
-	descriptorSetCaps.frameIdx = m_frameCommandBuffer->GetCurrentFrame();
+	PENDING_XFER xfer;
+	xfer.pipelineCaps = m_pipelineCaps;
+	xfer.params = Params;
+	xfer.workUnits = (pixelCount + m_localSize - 1) / m_localSize;
+	xfer.dstStart = dstAddress;
+	xfer.dstEnd = dstAddress + dstSize;
+	if(xfer.dstEnd > CGSHandler::RAMSIZE)
+	{
+		//Transfer wraps around, consider it touches all of GS memory
+		xfer.dstStart = 0;
+		xfer.dstEnd = CGSHandler::RAMSIZE;
+	}
+	m_pendingXfers.push_back(xfer);
+
+	m_xferBufferOffset += inputData.size();
+	m_xferBufferOffset = (m_xferBufferOffset + (m_context->storageBufferAlignment - 1)) & -m_context->storageBufferAlignment;
+}
+
+void CTransferHost::FlushTransfers()
+{
+	if(m_pendingXfers.empty()) return;
 
-	auto descriptorSet = PrepareDescriptorSet(xferPipeline->descriptorSetLayout, descriptorSetCaps);
 	auto commandBuffer = m_frameCommandBuffer->GetCommandBuffer();
 
-	//Add a barrier to ensure reads are complete before writing to GS memory
+	//Transfers are split in batches where no two transfers write to overlapping areas. Those
+	//can run concurrently, so they are grouped by pipeline and dispatched without barriers.
+	auto batchBegin = m_pendingXfers.begin();
+	while(batchBegin != m_pendingXfers.end())
 	{
-		auto memoryBarrier = Framework::Vulkan::MemoryBarrier();
-		memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
-		memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		auto batchEnd = batchBegin + 1;
+		for(; batchEnd != m_pendingXfers.end(); batchEnd++)
+		{
+			const auto& nextXfer = *batchEnd;
+			bool overlaps = std::any_of(batchBegin, batchEnd,
+			                            [&](const PENDING_XFER& xfer) {
+				                            return (xfer.dstStart < nextXfer.dstEnd) && (nextXfer.dstStart < xfer.dstEnd);
+			                            });
+			if(overlaps) break;
+		}
 
-		m_context->device.vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-		                                       0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
-	}
+		std::stable_sort(batchBegin, batchEnd,
+		                 [](const PENDING_XFER& lhs, const PENDING_XFER& rhs) {
+			                 return static_cast<PipelineCapsInt>(lhs.pipelineCaps) < static_cast<PipelineCapsInt>(rhs.pipelineCaps);
+		                 });
 
-	m_context->device.vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, xferPipeline->pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
-	m_context->device.vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, xferPipeline->pipeline);
-	m_context->device.vkCmdPushConstants(commandBuffer, xferPipeline->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(XFERPARAMS), &Params);
-	m_context->device.vkCmdDispatch(commandBuffer, workUnits, 1, 1);
+		//Add a barrier to ensure previous accesses are complete before writing to GS memory
+		{
+			auto memoryBarrier = Framework::Vulkan::MemoryBarrier();
+			memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+			memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
 
-	m_xferBufferOffset += inputData.size();
-	m_xferBufferOffset = (m_xferBufferOffset + (m_context->storageBufferAlignment - 1)) & -m_context->storageBufferAlignment;
+			m_context->device.vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			                                       0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+		}
+
+		const PIPELINE* xferPipeline = nullptr;
+		PipelineCapsInt boundPipelineCaps = 0;
+		for(auto xferIterator = batchBegin; xferIterator != batchEnd; xferIterator++)
+		{
+			const auto& xfer = *xferIterator;
+			if(!xferPipeline || (boundPipelineCaps != static_cast<PipelineCapsInt>(xfer.pipelineCaps)))
+			{
+				//Find pipeline and create it if we've never encountered it before
+				xferPipeline = m_pipelineCache.TryGetPipeline(xfer.pipelineCaps);
+				if(!xferPipeline)
+				{
+					xferPipeline = m_pipelineCache.RegisterPipeline(xfer.pipelineCaps, CreateXferPipeline(xfer.pipelineCaps));
+				}
+				boundPipelineCaps = xfer.pipelineCaps;
+
+				auto descriptorSetCaps = make_convertible<DESCRIPTORSET_CAPS>(0);
+				descriptorSetCaps.dstPsm = xfer.pipelineCaps.dstFormat;
+				descriptorSetCaps.frameIdx = m_frameCommandBuffer->GetCurrentFrame();
+
+				auto descriptorSet = PrepareDescriptorSet(xferPipeline->descriptorSetLayout, descriptorSetCaps);
+
+				m_context->device.vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, xferPipeline->pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+				m_context->device.vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, xferPipeline->pipeline);
+			}
+
+			m_context->device.vkCmdPushConstants(commandBuffer, xferPipeline->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(XFERPARAMS), &xfer.params);
+			m_context->device.vkCmdDispatch(commandBuffer, xfer.workUnits, 1, 1);
+		}
+
+		batchBegin = batchEnd;
+	}
+
+	m_pendingXfers.clear();
 }
 
 VkDescriptorSet CTransferHost::PrepareDescriptorSet(VkDescriptorSetLayout descriptorSetLayout, const DESCRIPTORSET_CAPS& caps)
@@ -241,6 +297,7 @@ VkDescriptorSet CTransferHost::PrepareDescriptorSet(VkDescriptorSetLayout descri
 
 void CTransferHost::PreFlushFrameCommandBuffer()
 {
+	FlushTransfers();
 }
 
 void CTransferHost::PostFlushFrameCommandBuffer()
@@ -520,7 +577,7 @@ PIPELINE CTransferHost::CreateXferPipeline(const PIPELINE_CAPS& caps)
 		createInfo.stage.module = xferShader;
 		createInfo.layout = xferPipeline.pipelineLayout;
 
-		result = m_context->device.vkCreateComputePipelines(m_context->device, VK_NULL_HANDLE, 1, &createInfo, nullptr, &xferPipeline.pipeline);
+		result = m_context->device.vkCreateComputePipelines(m_context->device, m_context->pipelineCache, 1, &createInfo, nullptr, &xferPipeline.pipeline);
 		CHECKVULKANERROR(result);
 	}
 
@@ -44,7 +44,9 @@ namespace GSH_Vulkan
 
 		void SetPipelineCaps(const PIPELINE_CAPS&);
 
-		void DoTransfer(const XferBuffer&);
+		//Transfers are batched, FlushTransfers needs to be called before anything else uses GS memory
+		void DoTransfer(const XferBuffer&, uint32, uint32);
+		void FlushTransfers();
 
 		void PreFlushFrameCommandBuffer() override;
 		void PostFlushFrameCommandBuffer() override;
@@ -58,6 +60,16 @@ namespace GSH_Vulkan
 			uint8* xferBufferPtr = nullptr;
 		};
 
+		struct PENDING_XFER
+		{
+			PIPELINE_CAPS pipelineCaps;
+			XFERPARAMS params;
+			uint32 workUnits = 0;
+			uint32 dstStart = 0;
+			uint32 dstEnd = 0;
+		};
+		typedef std::vector<PENDING_XFER> PendingXferList;
+
 		typedef CPipelineCache<PipelineCapsInt> PipelineCache;
 
 		typedef uint32 DescriptorSetCapsInt;
@@ -90,6 +102,7 @@ namespace GSH_Vulkan
 		FRAMECONTEXT m_frames[MAX_FRAMES];
 
 		uint32 m_xferBufferOffset = 0;
+		PendingXferList m_pendingXfers;
 
 		PIPELINE_CAPS m_pipelineCaps;
 	};
@@ -6,9 +6,12 @@
 #include "../states/MemoryStateFile.h"
 #include "../states/RegisterStateFile.h"
 #include "../FrameDump.h"
+#include "../FrameDumpStream.h"
+#include "../FrameDumpRing.h"
 #include "../ee/INTC.h"
 #include "GSHandler.h"
 #include "GsPixelFormats.h"
+#include "GsTransferRange.h"
 #include "string_format.h"
 #include "ThreadUtils.h"
 
@@ -67,6 +70,7 @@ CGSHandler::CGSHandler(bool gsThreaded)
 	m_presentationParams.mode = static_cast<PRESENTATION_MODE>(CAppConfig::GetInstance().GetPreferenceInteger(PREF_CGSHANDLER_PRESENTATION_MODE));
 	m_presentationParams.windowWidth = 512;
 	m_presentationParams.windowHeight = 384;
+	m_writeCoalescingEnabled = CAppConfig::GetInstance().GetPreferenceBoolean(PREF_CGSHANDLER_WRITE_COALESCING_ENABLED);
 
 	m_pRAM = new uint8[RAMSIZE];
 	m_pCLUT = new uint16[CLUTENTRYCOUNT];
@@ -113,9 +117,21 @@ CGSHandler::~CGSHandler()
 {
 	if(m_gsThreaded)
 	{
-		SendGSCall([this]() { m_threadDone = true; });
+		SendGSCall(
+		    [this]() {
+			    FinishFrameDumpStream();
+			    m_threadDone = true;
+		    });
 		m_thread.join();
 	}
+	else
+	{
+		FinishFrameDumpStream();
+	}
+	if(m_frameDumpRingSaveFuture.valid())
+	{
+		m_frameDumpRingSaveFuture.wait();
+	}
 	delete[] m_pRAM;
 	delete[] m_pCLUT;
 	for(int i = 0; i < MAX_INFLIGHT_FRAMES; i++)
@@ -129,10 +145,12 @@ void CGSHandler::RegisterPreferences()
 	CAppConfig::GetInstance().RegisterPreferenceInteger(PREF_CGSHANDLER_PRESENTATION_MODE, CGSHandler::PRESENTATION_MODE_FIT);
 	CAppConfig::GetInstance().RegisterPreferenceBoolean(PREF_CGSHANDLER_GS_RAM_READS_ENABLED, true);
 	CAppConfig::GetInstance().RegisterPreferenceBoolean(PREF_CGSHANDLER_WIDESCREEN, false);
+	CAppConfig::GetInstance().RegisterPreferenceBoolean(PREF_CGSHANDLER_WRITE_COALESCING_ENABLED, true);
 }
 
 void CGSHandler::NotifyPreferencesChanged()
 {
+	SetWriteCoalescingEnabled(CAppConfig::GetInstance().GetPreferenceBoolean(PREF_CGSHANDLER_WRITE_COALESCING_ENABLED));
 	SendGSCall([this]() { NotifyPreferencesChangedImpl(); });
 }
 
@@ -143,6 +161,8 @@ void CGSHandler::SetIntc(CINTC* intc)
 
 void CGSHandler::Reset()
 {
+	//Close any streamed dump before its initial state becomes meaningless
+	SendGSCall([this]() { FinishFrameDumpStream(); }, true);
 	ResetBase();
 	SendGSCall(std::bind(&CGSHandler::ResetImpl, this), true);
 }
@@ -170,6 +190,7 @@ void CGSHandler::ResetBase()
 	m_crtMode = CRT_MODE_NTSC;
 	m_nCBP0 = 0;
 	m_nCBP1 = 0;
+	ResetClutCache();
 #ifdef _DEBUG
 	m_transferCount = 0;
 #endif
@@ -179,6 +200,7 @@ void CGSHandler::ResetBase()
 	m_writeBufferSubmitIndex = 0;
 	m_writeBufferIndex = 0;
 	m_currentWriteBuffer = m_writeBuffers[m_writeBufferIndex];
+	ResetWriteCoalescing();
 }
 
 void CGSHandler::ResetImpl()
@@ -306,7 +328,8 @@ void CGSHandler::LoadState(Framework::CZipArchiveReader& archive)
 		m_nCBP1 = registerFile.GetRegister32(STATE_REG_CBP1);
 	}
 
-	SendGSCall([&]() { WriteBackMemoryCache(); });
+	ResetWriteCoalescing();
+	SendGSCall([&]() { ResetClutCache(); WriteBackMemoryCache(); });
 }
 
 void CGSHandler::Copy(CGSHandler* source)
@@ -333,23 +356,188 @@ void CGSHandler::Copy(CGSHandler* source)
 		m_nCBP1 = source->m_nCBP1;
 	}
 
-	SendGSCall([&]() { WriteBackMemoryCache(); });
+	ResetWriteCoalescing();
+	SendGSCall([&]() { ResetClutCache(); WriteBackMemoryCache(); });
 }
 
 void CGSHandler::TriggerFrameDump(const FrameDumpCallback& frameDumpCallback)
 {
 #ifdef DEBUGGER_INCLUDED
+	//Packets sent before the capture starts on the GS thread might belong to the captured frame
+	m_frameDumpPendingCount++;
 	m_mailBox.SendCall(
 	    [=]() {
+		    m_frameDumpActive = true;
+		    m_frameDumpPendingCount--;
 		    if(m_frameDumpCallback) return;
 		    m_frameDumpCallback = frameDumpCallback;
 	    });
 #endif
 }
 
+void CGSHandler::TriggerFrameDumpStream(const std::shared_ptr<Framework::CStream>& stream, uint32 frameCount, const FrameDumpStreamCallback& callback)
+{
+#ifdef DEBUGGER_INCLUDED
+	assert(frameCount != 0);
+	m_frameDumpPendingCount++;
+	m_mailBox.SendCall(
+	    [=]() {
+		    m_frameDumpActive = true;
+		    m_frameDumpPendingCount--;
+		    if(m_frameDumpStream)
+		    {
+			    if(callback) callback(false, "A frame dump is already in progress.");
+			    return;
+		    }
+		    m_frameDumpStream = stream;
+		    m_frameDumpStreamFrameCount = frameCount;
+		    m_frameDumpStreamCallback = callback;
+	    });
+#endif
+}
+
+void CGSHandler::SetFrameDumpRingParams(uint32 frameCount, uint64 maxMemorySize)
+{
+#ifdef DEBUGGER_INCLUDED
+	m_frameDumpPendingCount++;
+	m_mailBox.SendCall(
+	    [=]() {
+		    if(frameCount == 0)
+		    {
+			    m_frameDumpRing.reset();
+			    m_frameDumpRingSaveCallbacks.clear();
+			    m_frameDumpPendingCount--;
+			    return;
+		    }
+		    m_frameDumpActive = true;
+		    m_frameDumpPendingCount--;
+		    m_frameDumpRing = std::make_unique<CFrameDumpRing>(frameCount, maxMemorySize);
+		    m_frameDumpRingFrameTime = std::chrono::steady_clock::now();
+		    m_frameDumpRingSpikeCooldown = 0;
+	    });
+#endif
+}
+
+void CGSHandler::SaveFrameDumpRing(const FrameDumpRingCallback& callback)
+{
+#ifdef DEBUGGER_INCLUDED
+	m_mailBox.SendCall(
+	    [=]() {
+		    if(!m_frameDumpRing) return;
+		    //Saved at the end of the current frame, see UpdateFrameDumpState
+		    m_frameDumpRingSaveCallbacks.push_back(callback);
+	    });
+#endif
+}
+
+void CGSHandler::SetFrameDumpRingSpikeCallback(uint32 threshold, const FrameDumpRingCallback& callback)
+{
+#ifdef DEBUGGER_INCLUDED
+	m_mailBox.SendCall(
+	    [=]() {
+		    m_frameDumpRingSpikeThreshold = threshold;
+		    m_frameDumpRingSpikeCallback = callback;
+	    });
+#endif
+}
+
+void CGSHandler::SaveFrameDumpRingSnapshot(const std::shared_ptr<CFrameDumpRing>& snapshot, const FrameDumpRingCallback& callback)
+{
+#ifdef DEBUGGER_INCLUDED
+	//Writing a whole ring takes a while, hand the snapshot to a worker thread instead of stalling the GS thread.
+	//Each save waits for the previous one to complete, so only one is written at a time.
+	m_frameDumpRingSaveFuture = std::async(std::launch::async,
+	                                       [snapshot, callback, previousSave = std::move(m_frameDumpRingSaveFuture)]() {
+		                                       if(previousSave.valid())
+		                                       {
+			                                       previousSave.wait();
+		                                       }
+		                                       callback(*snapshot);
+	                                       });
+#endif
+}
+
 void CGSHandler::UpdateFrameDumpState()
 {
 #ifdef DEBUGGER_INCLUDED
+	if(m_frameDumpRing)
+	{
+		auto currentTime = std::chrono::steady_clock::now();
+		auto frameTime = std::chrono::duration_cast<std::chrono::milliseconds>(currentTime - m_frameDumpRingFrameTime).count();
+		m_frameDumpRingFrameTime = currentTime;
+
+		auto saveCallbacks = std::move(m_frameDumpRingSaveCallbacks);
+		m_frameDumpRingSaveCallbacks.clear();
+
+		if(m_frameDumpRingSpikeCooldown != 0)
+		{
+			m_frameDumpRingSpikeCooldown--;
+		}
+		else if((m_frameDumpRingSpikeThreshold != 0) && m_frameDumpRingSpikeCallback && (frameTime > m_frameDumpRingSpikeThreshold))
+		{
+			saveCallbacks.push_back(m_frameDumpRingSpikeCallback);
+			//Wait for the ring to be filled with new frames before saving again
+			m_frameDumpRingSpikeCooldown = m_frameDumpRing->GetMaxFrameCount();
+		}
+
+		//Snapshots are only taken at frame boundaries: the current segment ends with this frame
+		//and recording goes on in a new segment, so no packets are lost in between
+		if(m_frameDumpRing->NextFrame(!saveCallbacks.empty()))
+		{
+			if(!saveCallbacks.empty())
+			{
+				std::shared_ptr<CFrameDumpRing> snapshot = m_frameDumpRing->CreateSnapshot();
+				for(const auto& saveCallback : saveCallbacks)
+				{
+					SaveFrameDumpRingSnapshot(snapshot, saveCallback);
+				}
+			}
+
+			//This is expected to be called from the GS thread
+			SyncMemoryCache();
+			m_frameDumpRing->BeginSegment(GetRam(), GetRegisters(), GetSMODE2());
+		}
+	}
+
+	if(m_frameDumpWriter)
+	{
+		//Don't count frames until something has been captured
+		if(m_frameDumpWriter->GetPacketCount() != 0)
+		{
+			assert(m_frameDumpStreamFrameCount != 0);
+			m_frameDumpStreamFrameCount--;
+		}
+		if(m_frameDumpStreamFrameCount == 0)
+		{
+			FinishFrameDumpStream();
+		}
+		else
+		{
+			try
+			{
+				m_frameDumpWriter->MarkFrame();
+			}
+			catch(const std::exception& exception)
+			{
+				AbortFrameDumpStream(exception.what());
+			}
+		}
+	}
+	else if(m_frameDumpStream)
+	{
+		//This is expected to be called from the GS thread
+		SyncMemoryCache();
+
+		try
+		{
+			m_frameDumpWriter = std::make_unique<CFrameDumpWriter>(*m_frameDumpStream, GetRam(), GetRegisters(), GetSMODE2());
+		}
+		catch(const std::exception& exception)
+		{
+			AbortFrameDumpStream(exception.what());
+		}
+	}
+
 	if(m_frameDump && !m_frameDump->GetPackets().empty())
 	{
 		m_frameDumpCallback(*m_frameDump.get());
@@ -367,9 +555,67 @@ void CGSHandler::UpdateFrameDumpState()
 		memcpy(m_frameDump->GetInitialGsRegisters(), GetRegisters(), CGSHandler::REGISTER_MAX * sizeof(uint64));
 		m_frameDump->SetInitialSMODE2(GetSMODE2());
 	}
+
+	//Pending captures count as active since they start with the packets of the next frame
+	m_frameDumpActive = m_frameDump || m_frameDumpCallback || m_frameDumpWriter || m_frameDumpStream || m_frameDumpRing;
+#endif
+}
+
+void CGSHandler::FinishFrameDumpStream()
+{
+#ifdef DEBUGGER_INCLUDED
+	//This is expected to be called from the GS thread, also used to close the file
+	//when the capture is interrupted (reset, shutdown) so that it stays readable
+	if(m_frameDumpWriter)
+	{
+		bool hasPackets = (m_frameDumpWriter->GetPacketCount() != 0);
+		try
+		{
+			m_frameDumpWriter->Finish();
+		}
+		catch(const std::exception& exception)
+		{
+			AbortFrameDumpStream(exception.what());
+			return;
+		}
+		m_frameDumpWriter.reset();
+		m_frameDumpStream.reset();
+		m_frameDumpStreamFrameCount = 0;
+		auto callback = std::move(m_frameDumpStreamCallback);
+		m_frameDumpStreamCallback = FrameDumpStreamCallback();
+		if(callback)
+		{
+			callback(hasPackets, hasPackets ? std::string() : std::string("Capture stopped before any packet was recorded."));
+		}
+	}
+	else if(m_frameDumpStream)
+	{
+		AbortFrameDumpStream("Capture stopped before any packet was recorded.");
+	}
 #endif
 }
 
+void CGSHandler::AbortFrameDumpStream(const std::string& message)
+{
+#ifdef DEBUGGER_INCLUDED
+	//The file is left incomplete, but the emulation keeps going
+	m_frameDumpWriter.reset();
+	m_frameDumpStream.reset();
+	m_frameDumpStreamFrameCount = 0;
+	auto callback = std::move(m_frameDumpStreamCallback);
+	m_frameDumpStreamCallback = FrameDumpStreamCallback();
+	if(callback)
+	{
+		callback(false, message);
+	}
+#endif
+}
+
+bool CGSHandler::IsFrameDumpActive() const
+{
+	return m_frameDumpActive || (m_frameDumpPendingCount != 0);
+}
+
 void CGSHandler::InitFromFrameDump(CFrameDump* frameDump)
 {
 	//This is expected to be called from outside the GS thread
@@ -378,7 +624,8 @@ void CGSHandler::InitFromFrameDump(CFrameDump* frameDump)
 	memcpy(GetRegisters(), frameDump->GetInitialGsRegisters(), CGSHandler::REGISTER_MAX * sizeof(uint64));
 	SetSMODE2(frameDump->GetInitialSMODE2());
 
-	SendGSCall([&]() { WriteBackMemoryCache(); });
+	ResetWriteCoalescing();
+	SendGSCall([&]() { ResetClutCache(); WriteBackMemoryCache(); });
 }
 
 bool CGSHandler::GetDrawEnabled() const
@@ -391,6 +638,44 @@ void CGSHandler::SetDrawEnabled(bool drawEnabled)
 	m_drawEnabled = drawEnabled;
 }
 
+CGSHandler::STATS CGSHandler::GetStats()
+{
+	//Stats are owned by the GS thread, read them from there
+	STATS stats;
+	if(m_gsThreaded)
+	{
+		SendGSCall([&]() { stats = m_stats; }, true);
+	}
+	else
+	{
+		stats = m_stats;
+	}
+	return stats;
+}
+
+void CGSHandler::ResetStats()
+{
+	SendGSCall(
+	    [this]() {
+		    auto stats = STATS();
+		    stats.renderTargetCount = m_stats.renderTargetCount;
+		    stats.renderTargetBytes = m_stats.renderTargetBytes;
+		    m_stats = stats;
+	    },
+	    true);
+}
+
+bool CGSHandler::GetWriteCoalescingEnabled() const
+{
+	return m_writeCoalescingEnabled;
+}
+
+void CGSHandler::SetWriteCoalescingEnabled(bool writeCoalescingEnabled)
+{
+	//Takes effect when the next packet is processed
+	m_writeCoalescingEnabled = writeCoalescingEnabled;
+}
+
 void CGSHandler::SetHBlank()
 {
 	std::lock_guard registerMutexLock(m_registerMutex);
@@ -544,7 +829,12 @@ void CGSHandler::Initialize()
 
 void CGSHandler::Release()
 {
-	SendGSCall(std::bind(&CGSHandler::ReleaseImpl, this), true);
+	SendGSCall(
+	    [this]() {
+		    FinishFrameDumpStream();
+		    ReleaseImpl();
+	    },
+	    true);
 }
 
 void CGSHandler::Finish(bool forceWait)
@@ -640,6 +930,21 @@ void CGSHandler::FeedImageData(const void* data, uint32 length)
 		    {
 			    m_frameDump->AddImagePacket(imageData, length);
 		    }
+		    if(m_frameDumpWriter)
+		    {
+			    try
+			    {
+				    m_frameDumpWriter->AddImagePacket(imageData, length);
+			    }
+			    catch(const std::exception& exception)
+			    {
+				    AbortFrameDumpStream(exception.what());
+			    }
+		    }
+		    if(m_frameDumpRing)
+		    {
+			    m_frameDumpRing->AddImagePacket(imageData, length);
+		    }
 #endif
 		    FeedImageDataImpl(imageData, length);
 		    delete[] imageData;
@@ -658,20 +963,48 @@ void CGSHandler::ProcessWriteBuffer(const CGsPacketMetadata* metadata)
 	assert(m_writeBufferProcessIndex <= m_writeBufferSize);
 	assert(m_writeBufferSubmitIndex <= m_writeBufferProcessIndex);
 #ifdef DEBUGGER_INCLUDED
-	if(uint32 packetSize = m_writeBufferSize - m_writeBufferProcessIndex; packetSize != 0)
+	//Packets are captured as the game sent them, before coalescing, so that dumps can be replayed with or without it.
+	//Coalescing rewrites the buffer in place, the packet needs to be copied.
+	//Copying metadata is expensive (it contains VU1 memory), skip it if nothing is capturing packets
+	if(uint32 packetSize = m_writeBufferSize - m_writeBufferProcessIndex; (packetSize != 0) && IsFrameDumpActive())
 	{
 		SendGSCall(
 		    [this,
-		     packet = m_currentWriteBuffer + m_writeBufferProcessIndex,
-		     packetSize,
+		     packet = RegisterWriteList(m_currentWriteBuffer + m_writeBufferProcessIndex, m_currentWriteBuffer + m_writeBufferSize),
 		     metadata = metadata ? *metadata : CGsPacketMetadata()]() {
+			    uint32 packetSize = static_cast<uint32>(packet.size());
 			    if(m_frameDump)
 			    {
-				    m_frameDump->AddRegisterPacket(packet, packetSize, &metadata);
+				    m_frameDump->AddRegisterPacket(packet.data(), packetSize, &metadata);
+			    }
+			    if(m_frameDumpWriter)
+			    {
+				    try
+				    {
+					    m_frameDumpWriter->AddRegisterPacket(packet.data(), packetSize, &metadata);
+				    }
+				    catch(const std::exception& exception)
+				    {
+					    AbortFrameDumpStream(exception.what());
+				    }
+			    }
+			    if(m_frameDumpRing)
+			    {
+				    m_frameDumpRing->AddRegisterPacket(packet.data(), packetSize, &metadata);
 			    }
 		    });
 	}
 #endif
+	//The setting can be changed from any thread, it's applied here since the coalescing state is owned by this thread
+	if(bool writeCoalescingEnabled = m_writeCoalescingEnabled; writeCoalescingEnabled != m_writeCoalescingApplied)
+	{
+		m_writeCoalescingApplied = writeCoalescingEnabled;
+		ResetWriteCoalescing();
+	}
+	if(m_writeCoalescingApplied)
+	{
+		CoalesceWriteBuffer();
+	}
 	for(uint32 writeIndex = m_writeBufferProcessIndex; writeIndex < m_writeBufferSize; writeIndex++)
 	{
 		const auto& write = m_currentWriteBuffer[writeIndex];
@@ -747,6 +1080,135 @@ void CGSHandler::FlushWriteBuffer()
 	//Nothing should be written to the buffer after that
 }
 
+void CGSHandler::CoalesceWriteBuffer()
+{
+	//Drops writes that have no observable effect: state register writes that are overwritten
+	//before anything uses them and writes that don't change a register's value. Writes are never reordered.
+	auto writeStart = m_currentWriteBuffer + m_writeBufferProcessIndex;
+	auto writeEnd = m_currentWriteBuffer + m_writeBufferSize;
+
+	//Backward pass: keep only the last write of each state register between barriers (kicks, transfers, etc.)
+	//Kept writes are moved towards the end of the range.
+	auto keptStart = writeEnd;
+	{
+		uint64 overwrittenRegs[REGISTER_MAX / 64] = {};
+		for(auto write = writeEnd; write != writeStart;)
+		{
+			write--;
+			uint8 registerId = write->first & (REGISTER_MAX - 1);
+			if(IsCoalescableRegister(registerId))
+			{
+				uint64& overwrittenMask = overwrittenRegs[registerId / 64];
+				uint64 registerBit = 1ULL << (registerId % 64);
+				if(overwrittenMask & registerBit) continue;
+				overwrittenMask |= registerBit;
+			}
+			else if(!IsVertexAttributeRegister(registerId))
+			{
+				memset(overwrittenRegs, 0, sizeof(overwrittenRegs));
+			}
+			(*--keptStart) = (*write);
+		}
+	}
+
+	//Forward pass: drop writes that don't change the value last sent to the GS thread
+	auto keptEnd = writeStart;
+	for(auto write = keptStart; write != writeEnd; write++)
+	{
+		uint8 registerId = write->first & (REGISTER_MAX - 1);
+		uint64 value = write->second;
+		if(IsCoalescableRegister(registerId))
+		{
+			if(m_coalescedRegsValid[registerId] && (m_coalescedRegs[registerId] == value)) continue;
+			m_coalescedRegsValid[registerId] = true;
+			m_coalescedRegs[registerId] = value;
+		}
+		else if((registerId == GS_REG_TEX0_1) || (registerId == GS_REG_TEX0_2))
+		{
+			//TEX0 writes are only side effect free if they don't load the CLUT and don't update MIPTBP1
+			unsigned int context = registerId - GS_REG_TEX0_1;
+			uint8 tex1RegisterId = GS_REG_TEX1_1 + context;
+			auto tex0 = make_convertible<TEX0>(value);
+			auto tex1 = make_convertible<TEX1>(m_coalescedRegs[tex1RegisterId]);
+			bool redundant =
+			    m_coalescedRegsValid[registerId] && (m_coalescedRegs[registerId] == value) &&
+			    (tex0.nCLD == 0) &&
+			    m_coalescedRegsValid[tex1RegisterId] && (tex1.nMipBaseAddr == 0);
+			if(redundant) continue;
+			m_coalescedRegsValid[registerId] = true;
+			m_coalescedRegs[registerId] = value;
+		}
+		else if((registerId == GS_REG_TEX2_1) || (registerId == GS_REG_TEX2_2))
+		{
+			//TEX2 modifies TEX0
+			unsigned int context = registerId - GS_REG_TEX2_1;
+			m_coalescedRegsValid[GS_REG_TEX0_1 + context] = false;
+		}
+		(*keptEnd++) = (*write);
+	}
+
+	m_writeBufferSize = static_cast<uint32>(keptEnd - m_currentWriteBuffer);
+}
+
+void CGSHandler::ResetWriteCoalescing()
+{
+	memset(m_coalescedRegsValid, 0, sizeof(m_coalescedRegsValid));
+}
+
+bool CGSHandler::IsCoalescableRegister(uint8 registerId)
+{
+	//Registers that only hold state and that are only used when a primitive is drawn
+	switch(registerId)
+	{
+	case GS_REG_CLAMP_1:
+	case GS_REG_CLAMP_2:
+	case GS_REG_TEX1_1:
+	case GS_REG_TEX1_2:
+	case GS_REG_XYOFFSET_1:
+	case GS_REG_XYOFFSET_2:
+	case GS_REG_PRMODECONT:
+	case GS_REG_PRMODE:
+	case GS_REG_TEXCLUT:
+	case GS_REG_SCANMSK:
+	case GS_REG_TEXA:
+	case GS_REG_FOGCOL:
+	case GS_REG_SCISSOR_1:
+	case GS_REG_SCISSOR_2:
+	case GS_REG_ALPHA_1:
+	case GS_REG_ALPHA_2:
+	case GS_REG_DIMX:
+	case GS_REG_DTHE:
+	case GS_REG_COLCLAMP:
+	case GS_REG_TEST_1:
+	case GS_REG_TEST_2:
+	case GS_REG_PABE:
+	case GS_REG_FBA_1:
+	case GS_REG_FBA_2:
+	case GS_REG_FRAME_1:
+	case GS_REG_FRAME_2:
+	case GS_REG_ZBUF_1:
+	case GS_REG_ZBUF_2:
+		return true;
+	default:
+		return false;
+	}
+}
+
+bool CGSHandler::IsVertexAttributeRegister(uint8 registerId)
+{
+	//Registers that don't use any state when written to
+	switch(registerId)
+	{
+	case GS_REG_RGBAQ:
+	case GS_REG_ST:
+	case GS_REG_UV:
+	case GS_REG_FOG:
+		return true;
+	default:
+		return false;
+	}
+}
+
 void CGSHandler::WriteRegisterImpl(uint8 nRegister, uint64 nData)
 {
 	nRegister &= REGISTER_MAX - 1;
@@ -838,10 +1300,12 @@ void CGSHandler::FeedImageDataImpl(const uint8* imageData, uint32 length)
 
 		TransferWrite(imageData, length);
 		m_trxCtx.nSize -= length;
+		m_stats.hostToLocalBytes += length;
 
 		if(m_trxCtx.nSize == 0)
 		{
 			ProcessHostToLocalTransfer();
+			m_stats.hostToLocalTransfers++;
 
 #ifdef _DEBUG
 			auto bltBuf = make_convertible<BITBLTBUF>(m_nReg[GS_REG_BITBLTBUF]);
@@ -860,6 +1324,7 @@ void CGSHandler::ReadImageDataImpl(void* ptr, uint32 size)
 {
 	assert(m_trxCtx.nSize != 0);
 	assert(m_trxCtx.nSize == size);
+	SyncTransferRead();
 	auto bltBuf = make_convertible<BITBLTBUF>(m_nReg[GS_REG_BITBLTBUF]);
 	FRAMEWORK_MAYBE_UNUSED auto trxPos = make_convertible<TRXPOS>(m_nReg[GS_REG_TRXPOS]);
 
@@ -940,6 +1405,11 @@ void CGSHandler::BeginTransfer()
 		else if(trxDir == 1)
 		{
 			ProcessLocalToHostTransfer();
+			m_stats.localToHostTransfers++;
+			//Some handlers write back the data they read to RAM
+			auto trxPos = make_convertible<TRXPOS>(m_nReg[GS_REG_TRXPOS]);
+			auto [transferAddress, transferSize] = GsTransfer::GetSrcRange(bltBuf, trxReg, trxPos);
+			IncrementRamPageVersions(transferAddress, transferSize);
 			CLog::GetInstance().Print(LOG_NAME, "Starting transfer from 0x%08X, buffer size %d, psm: %d, size (%dx%d)\r\n",
 			                          bltBuf.GetSrcPtr(), bltBuf.GetSrcWidth(), bltBuf.nSrcPsm, trxReg.nRRW, trxReg.nRRH);
 		}
@@ -948,6 +1418,13 @@ void CGSHandler::BeginTransfer()
 	{
 		//Local to Local
 		ProcessLocalToLocalTransfer();
+		m_stats.localToLocalTransfers++;
+
+		auto bltBuf = make_convertible<BITBLTBUF>(m_nReg[GS_REG_BITBLTBUF]);
+		auto trxReg = make_convertible<TRXREG>(m_nReg[GS_REG_TRXREG]);
+		auto trxPos = make_convertible<TRXPOS>(m_nReg[GS_REG_TRXPOS]);
+		auto [transferAddress, transferSize] = GsTransfer::GetDstRange(bltBuf, trxReg, trxPos);
+		IncrementRamPageVersions(transferAddress, transferSize);
 	}
 }
 
@@ -959,7 +1436,15 @@ void CGSHandler::BeginTransferWrite()
 void CGSHandler::TransferWrite(const uint8* imageData, uint32 length)
 {
 	auto bltBuf = make_convertible<BITBLTBUF>(m_nReg[GS_REG_BITBLTBUF]);
-	m_trxCtx.nDirty |= ((this)->*(m_transferWriteHandlers[bltBuf.nDstPsm]))(imageData, length);
+	bool dirty = ((this)->*(m_transferWriteHandlers[bltBuf.nDstPsm]))(imageData, length);
+	if(dirty)
+	{
+		auto trxReg = make_convertible<TRXREG>(m_nReg[GS_REG_TRXREG]);
+		auto trxPos = make_convertible<TRXPOS>(m_nReg[GS_REG_TRXPOS]);
+		auto [transferAddress, transferSize] = GsTransfer::GetDstRange(bltBuf, trxReg, trxPos);
+		IncrementRamPageVersions(transferAddress, transferSize);
+	}
+	m_trxCtx.nDirty |= dirty;
 }
 
 bool CGSHandler::TransferWriteHandlerInvalid(const void* pData, uint32 nLength)
@@ -1474,6 +1959,20 @@ void CGSHandler::SyncCLUT(const TEX0& tex0)
 	if(!ProcessCLD(tex0)) return;
 
 	//assert(IsPsmIDTEX(tex0.nPsm));
+	if(!CGsPixelFormats::IsPsmIDTEX(tex0.nPsm)) return;
+
+	auto texClut = make_convertible<TEXCLUT>(m_nReg[GS_REG_TEXCLUT]);
+	uint64 clutKey = MakeClutCacheKey(tex0, texClut);
+	if(auto cacheEntry = FindClutCacheEntry(clutKey))
+	{
+		m_stats.clutCacheHits++;
+		if(LoadClutCacheEntry(*cacheEntry))
+		{
+			ProcessClutTransfer(tex0.nCSA, 0);
+		}
+		return;
+	}
+
 	switch(tex0.nPsm)
 	{
 	case PSMT8:
@@ -1486,6 +1985,146 @@ void CGSHandler::SyncCLUT(const TEX0& tex0)
 		ReadCLUT4(tex0);
 		break;
 	}
+
+	m_stats.clutCacheMisses++;
+	StoreClutCacheEntry(clutKey, tex0, texClut);
+}
+
+CGSHandler::CLUTCACHEKEY CGSHandler::MakeClutCacheKey(const TEX0& tex0, const TEXCLUT& texClut)
+{
+	auto clutKey = make_convertible<CLUTCACHEKEY>(0);
+	clutKey.idx4 = CGsPixelFormats::IsPsmIDTEX4(tex0.nPsm);
+	clutKey.cbp = tex0.nCBP;
+	clutKey.cpsm = tex0.nCPSM;
+	clutKey.csm = tex0.nCSM;
+	clutKey.csa = tex0.nCSA;
+	//TEXCLUT is only used in CSM2 mode
+	if(tex0.nCSM != 0)
+	{
+		clutKey.cbw = texClut.nCBW;
+		clutKey.cou = texClut.nCOU;
+		clutKey.cov = texClut.nCOV;
+	}
+	return clutKey;
+}
+
+std::pair<uint32, uint32> CGSHandler::GetClutRamRange(const TEX0& tex0, const TEXCLUT& texClut)
+{
+	uint32 clutPtr = tex0.GetCLUTPtr();
+	if(tex0.nCSM == 0)
+	{
+		//CSM1 mode: CLUT is always contained in a page sized area starting at CBP
+		return std::make_pair(clutPtr, static_cast<uint32>(RAMPAGESIZE));
+	}
+	else
+	{
+		//CSM2 mode: CLUT is a single PSMCT16 line (pages are 64x64)
+		uint32 entryCount = CGsPixelFormats::IsPsmIDTEX4(tex0.nPsm) ? 0x10 : 0x100;
+		uint32 pageStartX = texClut.GetOffsetU() / 64;
+		uint32 pageEndX = (texClut.GetOffsetU() + entryCount - 1) / 64;
+		uint32 pageY = texClut.GetOffsetV() / 64;
+		uint32 pageOffset = (pageY * texClut.nCBW) + pageStartX;
+		uint32 pageCount = pageEndX - pageStartX + 1;
+		return std::make_pair(clutPtr + (pageOffset * RAMPAGESIZE), pageCount * RAMPAGESIZE);
+	}
+}
+
+CGSHandler::CLUTCACHEENTRY* CGSHandler::FindClutCacheEntry(uint64 key)
+{
+	for(auto& cacheEntry : m_clutCache)
+	{
+		if(!cacheEntry.isValid) continue;
+		if(cacheEntry.key != key) continue;
+
+		//Make sure the pages the CLUT was read from haven't been written to since
+		uint32 pageStart = cacheEntry.ramAddress / RAMPAGESIZE;
+		uint32 pageEnd = (cacheEntry.ramAddress + cacheEntry.ramSize - 1) / RAMPAGESIZE;
+		for(uint32 page = pageStart; page <= pageEnd; page++)
+		{
+			if(m_ramPageVersions[page % RAMPAGECOUNT] > cacheEntry.ramVersion)
+			{
+				cacheEntry.isValid = false;
+				break;
+			}
+		}
+
+		return cacheEntry.isValid ? &cacheEntry : nullptr;
+	}
+	return nullptr;
+}
+
+bool CGSHandler::LoadClutCacheEntry(const CLUTCACHEENTRY& cacheEntry)
+{
+	bool changed = false;
+	uint32 spanCount = cacheEntry.hasHiWords ? 2 : 1;
+	for(uint32 span = 0; span < spanCount; span++)
+	{
+		uint32 offset = cacheEntry.offset + (span * 0x100);
+		uint32 size = cacheEntry.count * sizeof(uint16);
+		if(memcmp(m_pCLUT + offset, cacheEntry.clut + offset, size))
+		{
+			memcpy(m_pCLUT + offset, cacheEntry.clut + offset, size);
+			changed = true;
+		}
+	}
+	return changed;
+}
+
+void CGSHandler::StoreClutCacheEntry(uint64 key, const TEX0& tex0, const TEXCLUT& texClut)
+{
+	auto& cacheEntry = m_clutCache[m_nextClutCacheIndex++];
+	m_nextClutCacheIndex %= CLUT_CACHE_SIZE;
+
+	//Figure out which parts of the CLUT buffer were updated by ReadCLUT4/ReadCLUT8
+	bool is32 = (tex0.nCSM == 0) && ((tex0.nCPSM == PSMCT32) || (tex0.nCPSM == PSMCT24));
+	if(CGsPixelFormats::IsPsmIDTEX4(tex0.nPsm))
+	{
+		if(tex0.nCSM != 0)
+		{
+			cacheEntry.offset = 0;
+		}
+		else
+		{
+			cacheEntry.offset = is32 ? ((tex0.nCSA & 0x0F) * 16) : (tex0.nCSA * 16);
+		}
+		cacheEntry.count = 0x10;
+	}
+	else
+	{
+		cacheEntry.offset = 0;
+		cacheEntry.count = 0x100;
+	}
+
+	auto [ramAddress, ramSize] = GetClutRamRange(tex0, texClut);
+
+	cacheEntry.isValid = true;
+	cacheEntry.key = key;
+	cacheEntry.ramAddress = ramAddress;
+	cacheEntry.ramSize = ramSize;
+	cacheEntry.ramVersion = m_ramVersion;
+	cacheEntry.hasHiWords = is32;
+	memcpy(cacheEntry.clut, m_pCLUT, CLUTSIZE);
+}
+
+void CGSHandler::ResetClutCache()
+{
+	for(auto& cacheEntry : m_clutCache)
+	{
+		cacheEntry.isValid = false;
+	}
+	m_nextClutCacheIndex = 0;
+}
+
+void CGSHandler::IncrementRamPageVersions(uint32 address, uint32 size)
+{
+	if(size == 0) return;
+	m_ramVersion++;
+	uint32 pageStart = address / RAMPAGESIZE;
+	uint32 pageEnd = (address + size - 1) / RAMPAGESIZE;
+	for(uint32 page = pageStart; page <= pageEnd; page++)
+	{
+		m_ramPageVersions[page % RAMPAGECOUNT] = m_ramVersion;
+	}
 }
 
 bool CGSHandler::ProcessCLD(const TEX0& tex0)
@@ -1987,6 +2626,12 @@ std::string CGSHandler::DisassembleWrite(uint8 registerId, uint64 data)
 		                       (registerId == GS_REG_SCISSOR_1) ? 1 : 2, scissor.scax0, scissor.scax1, scissor.scay0, scissor.scay1);
 	}
 	break;
+	case GS_REG_DIMX:
+		result = string_format("DIMX(0x%016llX)", data);
+		break;
+	case GS_REG_DTHE:
+		result = string_format("DTHE(DTHE: %d)", data & 1);
+		break;
 	case GS_REG_COLCLAMP:
 		result = string_format("COLCLAMP(CLAMP: %d)", data & 1);
 		break;
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <thread>
+#include <future>
 #include <vector>
+#include <chrono>
 #include <functional>
 #include <atomic>
 #include <array>
@@ -16,12 +18,15 @@
 #include "zip/ZipArchiveReader.h"
 
 class CFrameDump;
+class CFrameDumpWriter;
+class CFrameDumpRing;
 class CGsPacketMetadata;
 class CINTC;
 
 #define PREF_CGSHANDLER_PRESENTATION_MODE "renderer.presentationmode"
 #define PREF_CGSHANDLER_GS_RAM_READS_ENABLED "renderer.ramreads.enabled"
 #define PREF_CGSHANDLER_WIDESCREEN "renderer.widescreen"
+#define PREF_CGSHANDLER_WRITE_COALESCING_ENABLED "renderer.writecoalescing.enabled"
 
 enum GS_REGS
 {
@@ -59,6 +64,8 @@ enum GS_REGS
 	GS_REG_SCISSOR_2 = 0x41,
 	GS_REG_ALPHA_1 = 0x42,
 	GS_REG_ALPHA_2 = 0x43,
+	GS_REG_DIMX = 0x44,
+	GS_REG_DTHE = 0x45,
 	GS_REG_COLCLAMP = 0x46,
 	GS_REG_TEST_1 = 0x47,
 	GS_REG_TEST_2 = 0x48,
@@ -681,6 +688,15 @@ public:
 	};
 	static_assert(sizeof(ALPHA) == sizeof(uint64), "Size of ALPHA struct must be 8 bytes.");
 
+	//Reg 0x45
+	struct DTHE : public convertible<uint64>
+	{
+		unsigned int nEnabled : 1;
+		unsigned int nReserved0 : 31;
+		unsigned int nReserved1 : 32;
+	};
+	static_assert(sizeof(DTHE) == sizeof(uint64), "Size of DTHE struct must be 8 bytes.");
+
 	//Reg 0x47/0x48
 	struct TEST : public convertible<uint64>
 	{
@@ -814,10 +830,33 @@ public:
 	typedef std::function<CGSHandler*()> FactoryFunction;
 
 	typedef std::function<void(const CFrameDump&)> FrameDumpCallback;
+	typedef std::function<void(CFrameDumpRing&)> FrameDumpRingCallback;
+	//Called on the GS thread when a streamed dump is complete (succeeded, error message)
+	typedef std::function<void(bool, const std::string&)> FrameDumpStreamCallback;
 
 	typedef Framework::CSignal<void()> FlipCompleteEvent;
 	typedef Framework::CSignal<void(uint32)> NewFrameEvent;
 
+	//Counters accumulated on the GS thread, used for profiling
+	struct STATS
+	{
+		uint32 hostToLocalTransfers = 0;
+		uint32 hostToLocalBytes = 0;
+		uint32 localToHostTransfers = 0;
+		uint32 localToLocalTransfers = 0;
+		uint32 clutCacheHits = 0;
+		uint32 clutCacheMisses = 0;
+		uint32 textureCacheHits = 0;
+		uint32 textureCacheMisses = 0;
+		uint32 renderTargetEvictions = 0;
+		uint32 readbackStalls = 0;
+		uint64 readbackStallTime = 0; //In microseconds
+
+		//Current render target usage, kept by ResetStats
+		uint32 renderTargetCount = 0;
+		uint64 renderTargetBytes = 0;
+	};
+
 	CGSHandler(bool = true);
 	virtual ~CGSHandler();
 
@@ -834,12 +873,30 @@ public:
 	void Copy(CGSHandler*);
 
 	void TriggerFrameDump(const FrameDumpCallback&);
+	//Streams the next frames to the specified stream as they are produced
+	void TriggerFrameDumpStream(const std::shared_ptr<Framework::CStream>&, uint32, const FrameDumpStreamCallback& = FrameDumpStreamCallback());
+
+	//Keeps recording the GS traffic of the last frames (frame count, memory budget), 0 frames disables recording
+	void SetFrameDumpRingParams(uint32, uint64);
+	//Callbacks are called on a worker thread with a snapshot of the recorded frames, taken at the end of the
+	//current frame. Saves are done in order.
+	void SaveFrameDumpRing(const FrameDumpRingCallback&);
+	//Saves recorded frames when a frame takes longer than the threshold (in milliseconds), 0 disables
+	void SetFrameDumpRingSpikeCallback(uint32, const FrameDumpRingCallback&);
 
 	void InitFromFrameDump(CFrameDump*);
+	//Returns true if GS packets are being captured, packet metadata is only needed in that case
+	bool IsFrameDumpActive() const;
 
 	bool GetDrawEnabled() const;
 	void SetDrawEnabled(bool);
 
+	bool GetWriteCoalescingEnabled() const;
+	void SetWriteCoalescingEnabled(bool);
+
+	STATS GetStats();
+	void ResetStats();
+
 	void WritePrivRegister(uint32, uint32);
 	uint32 ReadPrivRegister(uint32);
 
@@ -860,6 +917,16 @@ public:
 		m_currentWriteBuffer[m_writeBufferSize++] = write;
 	}
 
+	//Reserves space for multiple register writes in the write buffer, returns nullptr if there's not enough space
+	inline RegisterWrite* ReserveRegisterWrites(uint32 count)
+	{
+		assert((m_writeBufferSize + count) <= REGISTERWRITEBUFFER_SIZE);
+		if((m_writeBufferSize + count) > REGISTERWRITEBUFFER_SIZE) return nullptr;
+		auto writes = m_currentWriteBuffer + m_writeBufferSize;
+		m_writeBufferSize += count;
+		return writes;
+	}
+
 	void ProcessWriteBuffer(const CGsPacketMetadata*);
 	void SubmitWriteBuffer();
 	void FlushWriteBuffer();
@@ -918,6 +985,44 @@ protected:
 		REGISTERWRITEBUFFER_SUBMIT_THRESHOLD = 0x100
 	};
 
+	enum
+	{
+		RAMPAGESIZE = 0x2000,
+		RAMPAGECOUNT = (RAMSIZE / RAMPAGESIZE),
+	};
+
+	enum
+	{
+		CLUT_CACHE_SIZE = 32,
+	};
+
+	struct CLUTCACHEKEY : public convertible<uint64>
+	{
+		uint32 idx4 : 1;
+		uint32 cbp : 14;
+		uint32 cpsm : 4;
+		uint32 csm : 1;
+		uint32 csa : 5;
+		uint32 cbw : 6;
+		uint32 cou : 6;
+		uint32 cov : 10;
+		uint32 reserved : 16;
+	};
+	static_assert(sizeof(CLUTCACHEKEY) == sizeof(uint64), "CLUTCACHEKEY too big for an uint64");
+
+	struct CLUTCACHEENTRY
+	{
+		bool isValid = false;
+		uint64 key = 0;
+		uint32 ramAddress = 0;
+		uint32 ramSize = 0;
+		uint32 ramVersion = 0;
+		uint16 offset = 0;
+		uint16 count = 0;
+		bool hasHiWords = false;
+		uint16 clut[CLUTENTRYCOUNT];
+	};
+
 	enum LOD_CALC
 	{
 		LOD_CALC_DYNAMIC = 0,
@@ -1043,12 +1148,23 @@ protected:
 	void ReadImageDataImpl(void*, uint32);
 	void SubmitWriteBufferImpl(const RegisterWrite*, const RegisterWrite*);
 
+	void CoalesceWriteBuffer();
+	void ResetWriteCoalescing();
+	static bool IsCoalescableRegister(uint8);
+	static bool IsVertexAttributeRegister(uint8);
+
 	void UpdateFrameDumpState();
+	void FinishFrameDumpStream();
+	void AbortFrameDumpStream(const std::string&);
+	void SaveFrameDumpRingSnapshot(const std::shared_ptr<CFrameDumpRing>&, const FrameDumpRingCallback&);
 
 	void BeginTransfer();
 
 	virtual void BeginTransferWrite();
 	virtual void TransferWrite(const uint8*, uint32);
+	//Called before local to host transfer data is read from RAM. Handlers doing the
+	//readback asynchronously must make sure the data has been written back to RAM.
+	virtual void SyncTransferRead(){};
 
 	virtual void WriteBackMemoryCache(){};
 	virtual void SyncMemoryCache(){};
@@ -1074,6 +1190,13 @@ protected:
 
 	virtual void SyncCLUT(const TEX0&);
 	bool ProcessCLD(const TEX0&);
+	static CLUTCACHEKEY MakeClutCacheKey(const TEX0&, const TEXCLUT&);
+	static std::pair<uint32, uint32> GetClutRamRange(const TEX0&, const TEXCLUT&);
+	CLUTCACHEENTRY* FindClutCacheEntry(uint64);
+	bool LoadClutCacheEntry(const CLUTCACHEENTRY&);
+	void StoreClutCacheEntry(uint64, const TEX0&, const TEXCLUT&);
+	void ResetClutCache();
+	void IncrementRamPageVersions(uint32, uint32);
 	template <typename Indexor>
 	bool ReadCLUT4_16(const TEX0&);
 	template <typename Indexor>
@@ -1108,7 +1231,15 @@ protected:
 	uint32 m_nCBP0;
 	uint32 m_nCBP1;
 
+	//Every page of GS RAM is stamped with the value of m_ramVersion when written to,
+	//allowing cached CLUTs to be validated against the pages they were read from.
+	uint32 m_ramVersion = 0;
+	uint32 m_ramPageVersions[RAMPAGECOUNT] = {};
+	CLUTCACHEENTRY m_clutCache[CLUT_CACHE_SIZE];
+	uint32 m_nextClutCacheIndex = 0;
+
 	uint32 m_drawCallCount = 0;
+	STATS m_stats;
 
 	static constexpr int MAX_INFLIGHT_FRAMES = 2;
 	RegisterWrite* m_writeBuffers[MAX_INFLIGHT_FRAMES] = {};
@@ -1119,6 +1250,12 @@ protected:
 	uint32 m_writeBufferProcessIndex = 0;
 	uint32 m_writeBufferSubmitIndex = 0;
 
+	//Last register values sent to the GS thread, used to drop redundant writes
+	std::atomic<bool> m_writeCoalescingEnabled = true;
+	bool m_writeCoalescingApplied = false;
+	uint64 m_coalescedRegs[REGISTER_MAX] = {};
+	bool m_coalescedRegsValid[REGISTER_MAX] = {};
+
 	CRT_MODE m_crtMode;
 	std::thread m_thread;
 	std::recursive_mutex m_registerMutex;
@@ -1129,6 +1266,19 @@ protected:
 	bool m_threadDone = false;
 	std::unique_ptr<CFrameDump> m_frameDump;
 	FrameDumpCallback m_frameDumpCallback;
+	std::shared_ptr<Framework::CStream> m_frameDumpStream;
+	std::unique_ptr<CFrameDumpWriter> m_frameDumpWriter;
+	uint32 m_frameDumpStreamFrameCount = 0;
+	FrameDumpStreamCallback m_frameDumpStreamCallback;
+	std::unique_ptr<CFrameDumpRing> m_frameDumpRing;
+	FrameDumpRingCallback m_frameDumpRingSpikeCallback;
+	std::vector<FrameDumpRingCallback> m_frameDumpRingSaveCallbacks;
+	uint32 m_frameDumpRingSpikeThreshold = 0;
+	uint32 m_frameDumpRingSpikeCooldown = 0;
+	std::chrono::steady_clock::time_point m_frameDumpRingFrameTime;
+	std::future<void> m_frameDumpRingSaveFuture;
+	std::atomic<bool> m_frameDumpActive = false;
+	std::atomic<uint32> m_frameDumpPendingCount = 0;
 	bool m_regsDirty = false;
 	bool m_drawEnabled = true;
 	CINTC* m_intc = nullptr;
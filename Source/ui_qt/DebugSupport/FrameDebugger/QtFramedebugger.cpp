@@ -144,6 +144,7 @@ void QtFramedebugger::CreateGsHandler()
 #endif
 	}
 	m_gs->SetLoggingEnabled(false);
+	m_gs->SetWriteCoalescingEnabled(ui->actionWrite_Coalescing_Enabled->isChecked());
 	m_gs->Initialize();
 	m_gs->Reset();
 }
@@ -442,7 +443,7 @@ void QtFramedebugger::on_actionLoad_Dump_triggered()
 {
 	QFileDialog dialog(this);
 	dialog.setFileMode(QFileDialog::ExistingFile);
-	dialog.setNameFilter(tr("Play! Frame Dumps (*.dmp.zip);;All files (*.*)"));
+	dialog.setNameFilter(tr("Play! Frame Dumps (*.dmp *.dmp.zip);;All files (*.*)"));
 	if(dialog.exec())
 	{
 		auto filePath = dialog.selectedFiles().first();
@@ -480,6 +481,14 @@ void QtFramedebugger::on_actionAlpha_Blend_Enabled_triggered(bool value)
 	}
 }
 
+void QtFramedebugger::on_actionWrite_Coalescing_Enabled_triggered(bool value)
+{
+	//Allows comparing output with and without coalescing of redundant register writes
+	m_gs->SetWriteCoalescingEnabled(value);
+	ui->actionWrite_Coalescing_Enabled->setChecked(value);
+	Redraw();
+}
+
 void QtFramedebugger::on_actionRaw_triggered(bool value)
 {
 	ui->actionRaw->setChecked(value);
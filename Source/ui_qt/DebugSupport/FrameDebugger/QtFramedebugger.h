@@ -33,6 +33,7 @@ private slots:
 	void on_actionAlpha_Blend_Enabled_triggered(bool);
 	void on_actionDepth_Test_Enabled_triggered(bool);
 	void on_actionAlpha_Test_Enabled_triggered(bool);
+	void on_actionWrite_Coalescing_Enabled_triggered(bool);
 	void on_actionGsHandlerOpenGL_triggered(bool);
 	void on_actionGsHandlerVulkan_triggered(bool);
 	void on_actionLoad_Dump_triggered();
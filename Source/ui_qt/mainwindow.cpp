@@ -44,6 +44,12 @@
 #include "DebugSupport/FrameDebugger/QtFramedebugger.h"
 #include "ui_debugdockmenu.h"
 #include "ui_debugmenu.h"
+#include "FrameDumpRing.h"
+
+//GS traces keep the last 5 seconds (at 60fps) and are saved automatically when a frame takes more than 100ms
+#define GS_TRACE_FRAME_COUNT 300
+#define GS_TRACE_MAX_MEMORY_SIZE (512ULL * 1024 * 1024)
+#define GS_TRACE_SPIKE_THRESHOLD 100
 #endif
 #include "input/PH_GenericInput.h"
 #include "DiskUtils.h"
@@ -565,6 +571,7 @@ void MainWindow::on_actionSettings_triggered()
 	{
 		m_virtualMachine->ReloadSpuBlockCount();
 		m_virtualMachine->ReloadFrameRateLimit();
+		m_virtualMachine->ReloadIpuSettings();
 		UpdateCpuUsageLabel();
 		auto new_gs_index = CAppConfig::GetInstance().GetPreferenceInteger(PREF_VIDEO_GS_HANDLER);
 		if(gs_index != new_gs_index)
@@ -993,30 +1000,96 @@ fs::path MainWindow::GetFrameDumpDirectoryPath()
 
 void MainWindow::DumpNextFrame()
 {
-	m_virtualMachine->m_ee->m_gs->TriggerFrameDump(
-	    [&](const CFrameDump& frameDump) {
-		    try
-		    {
-			    auto frameDumpDirectoryPath = GetFrameDumpDirectoryPath();
-			    Framework::PathUtils::EnsurePathExists(frameDumpDirectoryPath);
-			    for(unsigned int i = 0; i < UINT_MAX; i++)
-			    {
-				    auto frameDumpFileName = string_format("framedump_%08d.dmp.zip", i);
-				    auto frameDumpPath = frameDumpDirectoryPath / fs::path(frameDumpFileName);
-				    if(!fs::exists(frameDumpPath))
-				    {
-					    auto dumpStream = Framework::CreateOutputStdStream(frameDumpPath.native());
-					    frameDump.Write(dumpStream);
-					    m_msgLabel->setText(QString("Dumped frame to '%1'.").arg(frameDumpFileName.c_str()));
-					    return;
-				    }
-			    }
-		    }
-		    catch(...)
-		    {
-		    }
-		    m_msgLabel->setText(QString("Failed to dump frame."));
-	    });
+	try
+	{
+		auto frameDumpDirectoryPath = GetFrameDumpDirectoryPath();
+		Framework::PathUtils::EnsurePathExists(frameDumpDirectoryPath);
+		for(unsigned int i = 0; i < UINT_MAX; i++)
+		{
+			auto frameDumpFileName = string_format("framedump_%08d.dmp", i);
+			auto frameDumpPath = frameDumpDirectoryPath / fs::path(frameDumpFileName);
+			if(!fs::exists(frameDumpPath))
+			{
+				//Packets are written to the file as the frame is being processed
+				auto dumpStream = std::make_shared<Framework::CStdStream>(Framework::CreateOutputStdStream(frameDumpPath.native()));
+				m_virtualMachine->m_ee->m_gs->TriggerFrameDumpStream(dumpStream, 1,
+				                                                     [this, frameDumpFileName](bool succeeded, const std::string& message) {
+					                                                     //This is called from the GS thread
+					                                                     if(succeeded)
+					                                                     {
+						                                                     emit onStatusMessage(QString("Dumped frame to '%1'.").arg(frameDumpFileName.c_str()));
+					                                                     }
+					                                                     else
+					                                                     {
+						                                                     emit onStatusMessage(QString("Failed to dump frame to '%1': %2").arg(frameDumpFileName.c_str()).arg(QString::fromStdString(message)));
+					                                                     }
+				                                                     });
+				m_msgLabel->setText(QString("Dumping frame to '%1'.").arg(frameDumpFileName.c_str()));
+				return;
+			}
+		}
+	}
+	catch(...)
+	{
+	}
+	m_msgLabel->setText(QString("Failed to dump frame."));
+}
+
+void MainWindow::ToggleGsTraceRecording()
+{
+	auto gs = m_virtualMachine->GetGSHandler();
+	if(gs == nullptr) return;
+	bool recording = debugMenuUi->actionRecordGsTrace->isChecked();
+	if(recording)
+	{
+		gs->SetFrameDumpRingParams(GS_TRACE_FRAME_COUNT, GS_TRACE_MAX_MEMORY_SIZE);
+		gs->SetFrameDumpRingSpikeCallback(GS_TRACE_SPIKE_THRESHOLD, [this](CFrameDumpRing& ring) { WriteGsTrace(ring); });
+	}
+	else
+	{
+		gs->SetFrameDumpRingParams(0, 0);
+		gs->SetFrameDumpRingSpikeCallback(0, CGSHandler::FrameDumpRingCallback());
+	}
+	m_msgLabel->setText(recording ? QString("GS Trace Recording Enabled") : QString("GS Trace Recording Disabled"));
+}
+
+void MainWindow::SaveGsTrace()
+{
+	auto gs = m_virtualMachine->GetGSHandler();
+	if(gs == nullptr) return;
+	if(!debugMenuUi->actionRecordGsTrace->isChecked())
+	{
+		m_msgLabel->setText(QString("GS Trace Recording is not enabled."));
+		return;
+	}
+	gs->SaveFrameDumpRing([this](CFrameDumpRing& ring) { WriteGsTrace(ring); });
+}
+
+void MainWindow::WriteGsTrace(CFrameDumpRing& ring)
+{
+	//This is called from a worker thread
+	try
+	{
+		auto frameDumpDirectoryPath = GetFrameDumpDirectoryPath();
+		Framework::PathUtils::EnsurePathExists(frameDumpDirectoryPath);
+		for(unsigned int i = 0; i < UINT_MAX; i++)
+		{
+			auto traceFileName = string_format("gstrace_%08d.dmp", i);
+			auto tracePath = frameDumpDirectoryPath / fs::path(traceFileName);
+			if(!fs::exists(tracePath))
+			{
+				uint32 frameCount = ring.GetFrameCount();
+				auto traceStream = Framework::CreateOutputStdStream(tracePath.native());
+				ring.Write(traceStream);
+				emit onStatusMessage(QString("Saved %1 frames of GS trace to '%2'.").arg(frameCount).arg(traceFileName.c_str()));
+				return;
+			}
+		}
+	}
+	catch(...)
+	{
+	}
+	emit onStatusMessage(QString("Failed to save GS trace."));
 }
 
 void MainWindow::ToggleGsDraw()
@@ -1168,6 +1241,8 @@ void MainWindow::SetupDebugger()
 	m_debugger = std::make_unique<QtDebugger>(*m_virtualMachine);
 	m_frameDebugger = std::make_unique<QtFramedebugger>();
 
+	connect(this, &MainWindow::onStatusMessage, this, [this](QString message) { m_msgLabel->setText(message); }, Qt::QueuedConnection);
+
 	{
 		auto debugMenu = new QMenu(this);
 		debugMenuUi = new Ui::DebugMenu();
@@ -1178,6 +1253,8 @@ void MainWindow::SetupDebugger()
 		connect(debugMenuUi->actionShowFrameDebugger, &QAction::triggered, this, std::bind(&MainWindow::ShowFrameDebugger, this));
 		connect(debugMenuUi->actionDumpNextFrame, &QAction::triggered, this, std::bind(&MainWindow::DumpNextFrame, this));
 		connect(debugMenuUi->actionGsDrawEnabled, &QAction::triggered, this, std::bind(&MainWindow::ToggleGsDraw, this));
+		connect(debugMenuUi->actionRecordGsTrace, &QAction::triggered, this, std::bind(&MainWindow::ToggleGsTraceRecording, this));
+		connect(debugMenuUi->actionSaveGsTrace, &QAction::triggered, this, std::bind(&MainWindow::SaveGsTrace, this));
 	}
 
 #if defined(__APPLE__)
@@ -25,6 +25,7 @@ class OutputWindow;
 #ifdef DEBUGGER_INCLUDED
 class QtDebugger;
 class QtFramedebugger;
+class CFrameDumpRing;
 
 namespace Ui
 {
@@ -53,6 +54,9 @@ public:
 	void ShowFrameDebugger();
 	fs::path GetFrameDumpDirectoryPath();
 	void DumpNextFrame();
+	void ToggleGsTraceRecording();
+	void SaveGsTrace();
+	void WriteGsTrace(CFrameDumpRing&);
 	void ToggleGsDraw();
 #endif
 
@@ -134,6 +138,8 @@ protected:
 
 signals:
 	void onExecutableChange();
+	//Used to report the result of operations completed on other threads
+	void onStatusMessage(QString);
 
 public slots:
 	void outputWindow_resized();
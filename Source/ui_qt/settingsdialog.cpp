@@ -84,6 +84,8 @@ void SettingsDialog::LoadPreferences()
 {
 	ui->comboBox_system_language->setCurrentIndex(CAppConfig::GetInstance().GetPreferenceInteger(PREF_SYSTEM_LANGUAGE));
 	ui->checkBox_limitFrameRate->setChecked(CAppConfig::GetInstance().GetPreferenceBoolean(PREF_PS2_LIMIT_FRAMERATE));
+	ui->checkBox_referenceIdct->setChecked(CAppConfig::GetInstance().GetPreferenceBoolean(PREF_PS2_IPU_REFERENCE_IDCT));
+	ui->checkBox_asyncVideoDecoding->setChecked(CAppConfig::GetInstance().GetPreferenceBoolean(PREF_PS2_IPU_ASYNC_DECODE));
 	ui->checkBox_showEECPUUsage->setChecked(CAppConfig::GetInstance().GetPreferenceBoolean(PREF_UI_SHOWEECPUUSAGE));
 	ui->edit_arcadeRoms_dir->setText(PathToQString(CAppConfig::GetInstance().GetPreferencePath(PREF_PS2_ARCADEROMS_DIRECTORY)));
 	ui->checkBox_enableArcadeIOServer->setChecked(CAppConfig::GetInstance().GetPreferenceBoolean(PREF_PS2_ARCADE_IO_SERVER_ENABLED));
@@ -114,6 +116,16 @@ void SettingsDialog::on_checkBox_limitFrameRate_clicked(bool checked)
 	CAppConfig::GetInstance().SetPreferenceBoolean(PREF_PS2_LIMIT_FRAMERATE, checked);
 }
 
+void SettingsDialog::on_checkBox_referenceIdct_clicked(bool checked)
+{
+	CAppConfig::GetInstance().SetPreferenceBoolean(PREF_PS2_IPU_REFERENCE_IDCT, checked);
+}
+
+void SettingsDialog::on_checkBox_asyncVideoDecoding_clicked(bool checked)
+{
+	CAppConfig::GetInstance().SetPreferenceBoolean(PREF_PS2_IPU_ASYNC_DECODE, checked);
+}
+
 void SettingsDialog::on_checkBox_showEECPUUsage_clicked(bool checked)
 {
 	CAppConfig::GetInstance().SetPreferenceBoolean(PREF_UI_SHOWEECPUUSAGE, checked);
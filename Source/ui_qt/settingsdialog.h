@@ -34,6 +34,8 @@ private slots:
 	//General Page
 	void on_comboBox_system_language_currentIndexChanged(int index);
 	void on_checkBox_limitFrameRate_clicked(bool checked);
+	void on_checkBox_referenceIdct_clicked(bool checked);
+	void on_checkBox_asyncVideoDecoding_clicked(bool checked);
 	void on_checkBox_showEECPUUsage_clicked(bool checked);
 	void on_button_browseArcadeRomsDir_clicked();
 	void on_checkBox_enableArcadeIOServer_clicked(bool checked);
@@ -0,0 +1,220 @@
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+#include <memory>
+#include "filesystem_def.h"
+#include "StdStreamUtils.h"
+#include "FrameDump.h"
+#include "gs/GSH_Null.h"
+#include "gs/GSH_Software.h"
+#ifdef HAS_GSH_VULKAN
+#include "gs/GSH_Vulkan/GSH_VulkanOffscreen.h"
+#endif
+
+#define GS_HANDLER_NAME_NULL "null"
+#define GS_HANDLER_NAME_SOFTWARE "software"
+#define GS_HANDLER_NAME_VULKAN "vulkan"
+
+#define DEFAULT_GS_HANDLER_NAME GS_HANDLER_NAME_NULL
+#define DEFAULT_ITERATION_COUNT 10
+
+struct FRAME_RESULT
+{
+	double time = 0;
+	uint32 drawCalls = 0;
+	CGSHandler::STATS stats;
+};
+
+static CGSHandler::FactoryFunction GetGsHandlerFactoryFunction(const std::string& gsHandlerName, uint32 threadCount)
+{
+	if(gsHandlerName == GS_HANDLER_NAME_NULL)
+	{
+		return CGSH_Null::GetFactoryFunction();
+	}
+	else if(gsHandlerName == GS_HANDLER_NAME_SOFTWARE)
+	{
+		return CGSH_Software::GetFactoryFunction(threadCount);
+	}
+#ifdef HAS_GSH_VULKAN
+	else if(gsHandlerName == GS_HANDLER_NAME_VULKAN)
+	{
+		return []() { return new CGSH_VulkanOffscreen(); };
+	}
+#endif
+	else
+	{
+		throw std::runtime_error("Unknown GS handler name.");
+	}
+}
+
+static FRAME_RESULT ReplayFrameDump(CGSHandler* gs, CFrameDump& frameDump)
+{
+	//Setup is not accounted for, ResetStats waits for the GS thread to be idle
+	gs->Reset();
+	gs->InitFromFrameDump(&frameDump);
+	gs->ResetStats();
+
+	//Draw call count is reported by MarkNewFrame, called by Finish
+	uint32 drawCalls = 0;
+	auto newFrameConnection = gs->OnNewFrame.Connect([&drawCalls](uint32 drawCallCount) { drawCalls = drawCallCount; });
+
+	auto startTime = std::chrono::high_resolution_clock::now();
+
+	for(const auto& packet : frameDump.GetPackets())
+	{
+		if(packet.registerWrites.empty())
+		{
+			gs->ProcessWriteBuffer(nullptr);
+			gs->FeedImageData(packet.imageData.data(), packet.imageData.size());
+		}
+		else
+		{
+			for(const auto& registerWrite : packet.registerWrites)
+			{
+				gs->WriteRegister(registerWrite);
+			}
+		}
+	}
+
+	gs->ProcessWriteBuffer(nullptr);
+	gs->Finish(true);
+
+	auto endTime = std::chrono::high_resolution_clock::now();
+
+	FRAME_RESULT result;
+	result.time = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+	result.drawCalls = drawCalls;
+	result.stats = gs->GetStats();
+	return result;
+}
+
+static void PrintFrameResult(uint32 frameIndex, const FRAME_RESULT& result)
+{
+	const auto& stats = result.stats;
+	printf("frame %4d: %9.3fms, draws: %6d, h2l: %5d (%9d bytes), l2h: %4d (%d stalls, %.3fms), l2l: %4d, "
+	       "clut cache: %5d/%5d, tex cache: %5d/%5d, targets: %3d (%7.1fMB, %d evicted)\r\n",
+	       frameIndex, result.time, result.drawCalls,
+	       stats.hostToLocalTransfers, stats.hostToLocalBytes,
+	       stats.localToHostTransfers, stats.readbackStalls, static_cast<double>(stats.readbackStallTime) / 1000.0,
+	       stats.localToLocalTransfers,
+	       stats.clutCacheHits, stats.clutCacheHits + stats.clutCacheMisses,
+	       stats.textureCacheHits, stats.textureCacheHits + stats.textureCacheMisses,
+	       stats.renderTargetCount, static_cast<double>(stats.renderTargetBytes) / static_cast<double>(0x100000),
+	       stats.renderTargetEvictions);
+}
+
+int main(int argc, const char** argv)
+{
+	if(argc < 2)
+	{
+		printf("Usage: FrameDumpBench [options] frameDumpPath\r\n");
+		printf("Options: \r\n");
+		printf("\t --gshandler <%s|%s", GS_HANDLER_NAME_NULL, GS_HANDLER_NAME_SOFTWARE);
+#ifdef HAS_GSH_VULKAN
+		printf("|%s", GS_HANDLER_NAME_VULKAN);
+#endif
+		printf(">\tSelects which GS handler to replay with (default is '%s').\r\n", DEFAULT_GS_HANDLER_NAME);
+		printf("\t --iterations <count>\t Number of times the frame is replayed (default is %d).\r\n", DEFAULT_ITERATION_COUNT);
+		printf("\t --threads <count>\t Thread count used by the software handler (default is one per hardware thread).\r\n");
+		return -1;
+	}
+
+	fs::path frameDumpPath;
+	std::string gsHandlerName = DEFAULT_GS_HANDLER_NAME;
+	uint32 iterationCount = DEFAULT_ITERATION_COUNT;
+	uint32 threadCount = 0;
+
+	for(int i = 1; i < argc; i++)
+	{
+		bool hasValue = ((i + 1) < argc);
+		if(!strcmp(argv[i], "--gshandler"))
+		{
+			if(!hasValue)
+			{
+				printf("Error: GS handler name must be specified for --gshandler option.\r\n");
+				return -1;
+			}
+			gsHandlerName = argv[++i];
+		}
+		else if(!strcmp(argv[i], "--iterations"))
+		{
+			if(!hasValue)
+			{
+				printf("Error: Count must be specified for --iterations option.\r\n");
+				return -1;
+			}
+			iterationCount = std::max(atoi(argv[++i]), 1);
+		}
+		else if(!strcmp(argv[i], "--threads"))
+		{
+			if(!hasValue)
+			{
+				printf("Error: Count must be specified for --threads option.\r\n");
+				return -1;
+			}
+			threadCount = std::max(atoi(argv[++i]), 0);
+		}
+		else
+		{
+			frameDumpPath = argv[i];
+			break;
+		}
+	}
+
+	if(frameDumpPath.empty())
+	{
+		printf("Error: No frame dump specified.\r\n");
+		return -1;
+	}
+
+	try
+	{
+		CFrameDump frameDump;
+		{
+			auto inputStream = Framework::CreateInputStdStream(frameDumpPath.native());
+			frameDump.Read(inputStream);
+		}
+
+		CGSHandler::RegisterPreferences();
+
+		auto gsHandlerFactory = GetGsHandlerFactoryFunction(gsHandlerName, threadCount);
+		auto gs = std::unique_ptr<CGSHandler>(gsHandlerFactory());
+		gs->SetLoggingEnabled(false);
+		gs->Initialize();
+
+		printf("Replaying '%s' (%d packets) %d times with '%s' GS handler.\r\n",
+		       frameDumpPath.string().c_str(), static_cast<uint32>(frameDump.GetPackets().size()),
+		       iterationCount, gsHandlerName.c_str());
+
+		std::vector<double> frameTimes;
+		frameTimes.reserve(iterationCount);
+		for(uint32 i = 0; i < iterationCount; i++)
+		{
+			auto result = ReplayFrameDump(gs.get(), frameDump);
+			PrintFrameResult(i, result);
+			frameTimes.push_back(result.time);
+		}
+
+		gs->Release();
+
+		//First iteration is usually slower (shader compilation, cache warmup), report median as well
+		auto sortedFrameTimes = frameTimes;
+		std::sort(sortedFrameTimes.begin(), sortedFrameTimes.end());
+		double totalTime = 0;
+		for(auto frameTime : frameTimes)
+		{
+			totalTime += frameTime;
+		}
+		printf("min: %.3fms, median: %.3fms, avg: %.3fms, max: %.3fms\r\n",
+		       sortedFrameTimes.front(), sortedFrameTimes[sortedFrameTimes.size() / 2],
+		       totalTime / static_cast<double>(frameTimes.size()), sortedFrameTimes.back());
+	}
+	catch(const std::exception& exception)
+	{
+		printf("Error: Failed to replay frame dump: %s\r\n", exception.what());
+		return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,74 @@
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include "BdecCommandTest.h"
+#include "IntraMacroblock.h"
+#include "StreamWriter.h"
+#include "TestIpu.h"
+
+#define MACROBLOCK_COUNT (64)
+#define CTRL_IVF (0x00200000)
+
+//Peak error allowed by IEEE 1180 between the IPU's IDCT and the reference one
+#define MAX_PIXEL_ERROR (1)
+
+void CBdecCommandTest::Execute()
+{
+	CheckDecode(false, ~0U);
+	CheckDecode(true, ~0U);
+	//Input arriving one qword at a time
+	CheckDecode(false, 1);
+}
+
+void CBdecCommandTest::CheckDecode(bool useTable1, uint32 dma4TransferSize)
+{
+	std::mt19937 random(useTable1 ? 1 : 2);
+
+	CStreamWriter writer;
+	std::vector<int16> expected;
+
+	int16 dcPredictor[3];
+	IntraMacroblock::ResetDcPredictor(dcPredictor);
+
+	std::vector<uint32> commands;
+	for(unsigned int i = 0; i < MACROBLOCK_COUNT; i++)
+	{
+		uint32 qsc = (random() % 31) + 1;
+		auto macroblock = IntraMacroblock::Generate(random, qsc);
+		IntraMacroblock::WriteBlocks(writer, macroblock, dcPredictor, useTable1);
+
+		int16 raw16[IntraMacroblock::RAW_SIZE];
+		IntraMacroblock::DecodeRaw16(macroblock, qsc, raw16);
+		expected.insert(expected.end(), raw16, raw16 + IntraMacroblock::RAW_SIZE);
+
+		//Intra macroblock, DC predictor is only reset for the first one
+		uint32 command = (CTestIpu::CMD_BDEC << 28) | (1 << 27) | (qsc << 16);
+		if(i == 0)
+		{
+			command |= (1 << 26);
+		}
+		commands.push_back(command);
+	}
+
+	CTestIpu ipu;
+	ipu.Reset();
+	ipu.SetControl(useTable1 ? CTRL_IVF : 0);
+	ipu.SetInput(writer.GetBuffer());
+	ipu.SetTransferSizes(dma4TransferSize, ~0U);
+
+	for(auto command : commands)
+	{
+		TEST_VERIFY(ipu.ExecuteCommand(command));
+	}
+
+	const auto& output = ipu.GetOutput();
+	TEST_VERIFY(output.size() == (expected.size() * sizeof(int16)));
+	if(output.size() != (expected.size() * sizeof(int16))) return;
+
+	for(unsigned int i = 0; i < expected.size(); i++)
+	{
+		int16 value = 0;
+		memcpy(&value, output.data() + (i * sizeof(int16)), sizeof(int16));
+		TEST_VERIFY(std::abs(value - expected[i]) <= MAX_PIXEL_ERROR);
+	}
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "Test.h"
+#include "Types.h"
+
+class CBdecCommandTest : public CTest
+{
+public:
+	void Execute() override;
+
+private:
+	void CheckDecode(bool, uint32);
+};
@@ -0,0 +1,66 @@
+#include <cstring>
+#include <random>
+#include <vector>
+#include "CscCommandTest.h"
+#include "TestIpu.h"
+#include "ee/IPU_Csc.h"
+
+#define BLOCK_COUNT (16)
+#define ALPHA_TH0 (0x40)
+#define ALPHA_TH1 (0x100)
+
+void CCscCommandTest::Execute()
+{
+	CheckConvert(false, false, ~0U);
+	CheckConvert(true, false, ~0U);
+	CheckConvert(true, true, ~0U);
+	//Blocks spanning multiple transfers
+	CheckConvert(false, false, 1);
+}
+
+void CCscCommandTest::CheckConvert(bool rgba16, bool dither, uint32 dma4TransferSize)
+{
+	std::mt19937 random(BLOCK_COUNT);
+
+	std::vector<uint8> input(BLOCK_COUNT * IPU::Csc::BLOCK_SIZE);
+	for(auto& value : input)
+	{
+		value = static_cast<uint8>(random());
+	}
+
+	std::vector<uint8> expected;
+	for(unsigned int i = 0; i < BLOCK_COUNT; i++)
+	{
+		const uint8* block = input.data() + (i * IPU::Csc::BLOCK_SIZE);
+		if(rgba16)
+		{
+			uint16 pixels[IPU::Csc::PIXEL_COUNT];
+			IPU::Csc::ConvertRgba16Scalar(block, pixels, ALPHA_TH0, ALPHA_TH1, dither);
+			auto pixelBytes = reinterpret_cast<const uint8*>(pixels);
+			expected.insert(expected.end(), pixelBytes, pixelBytes + sizeof(pixels));
+		}
+		else
+		{
+			uint32 pixels[IPU::Csc::PIXEL_COUNT];
+			IPU::Csc::ConvertRgba32Scalar(block, pixels, ALPHA_TH0, ALPHA_TH1);
+			auto pixelBytes = reinterpret_cast<const uint8*>(pixels);
+			expected.insert(expected.end(), pixelBytes, pixelBytes + sizeof(pixels));
+		}
+	}
+
+	CTestIpu ipu;
+	ipu.Reset();
+	ipu.SetInput(input);
+	ipu.SetTransferSizes(dma4TransferSize, ~0U);
+
+	TEST_VERIFY(ipu.ExecuteCommand((CTestIpu::CMD_SETTH << 28) | (ALPHA_TH1 << 16) | ALPHA_TH0));
+
+	uint32 command = (CTestIpu::CMD_CSC << 28) | BLOCK_COUNT;
+	if(rgba16) command |= (1 << 27);
+	if(dither) command |= (1 << 26);
+	TEST_VERIFY(ipu.ExecuteCommand(command));
+
+	const auto& output = ipu.GetOutput();
+	TEST_VERIFY(output.size() == expected.size());
+	TEST_VERIFY(!memcmp(output.data(), expected.data(), output.size()));
+}
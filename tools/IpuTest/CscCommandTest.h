@@ -0,0 +1,13 @@
+#pragma once
+
+#include "Test.h"
+#include "Types.h"
+
+class CCscCommandTest : public CTest
+{
+public:
+	void Execute() override;
+
+private:
+	void CheckConvert(bool, bool, uint32);
+};
@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include "CscTest.h"
+#include "ee/IPU_Csc.h"
+
+#define SCALAR_MATCH_BLOCK_COUNT (10000)
+#define REFERENCE_BLOCK_COUNT (1000)
+
+void CCscTest::Execute()
+{
+	CheckGray();
+	CheckAlphaThresholds();
+	CheckDither();
+	CheckReference();
+	CheckScalarMatch();
+}
+
+void CCscTest::CheckGray()
+{
+	uint8 block[IPU::Csc::BLOCK_SIZE];
+	FillBlock(block, 0x80, 0x80, 0x80);
+
+	uint32 pixels[IPU::Csc::PIXEL_COUNT];
+	IPU::Csc::ConvertRgba32(block, pixels, 0, 0);
+	for(unsigned int i = 0; i < IPU::Csc::PIXEL_COUNT; i++)
+	{
+		TEST_VERIFY(pixels[i] == 0x80808080);
+	}
+
+	uint16 pixels16[IPU::Csc::PIXEL_COUNT];
+	IPU::Csc::ConvertRgba16(block, pixels16, 0, 0, false);
+	for(unsigned int i = 0; i < IPU::Csc::PIXEL_COUNT; i++)
+	{
+		TEST_VERIFY(pixels16[i] == 0xC210);
+	}
+}
+
+void CCscTest::CheckAlphaThresholds()
+{
+	uint8 block[IPU::Csc::BLOCK_SIZE];
+	FillBlock(block, 0x40, 0x80, 0x80);
+
+	uint32 pixels[IPU::Csc::PIXEL_COUNT];
+
+	//Below TH0
+	IPU::Csc::ConvertRgba32(block, pixels, 0x41, 0x100);
+	TEST_VERIFY(pixels[0] == 0x00404040);
+
+	//Between TH0 and TH1
+	IPU::Csc::ConvertRgba32(block, pixels, 0x40, 0x41);
+	TEST_VERIFY(pixels[0] == 0x40404040);
+
+	//Above TH1
+	IPU::Csc::ConvertRgba32(block, pixels, 0x40, 0x40);
+	TEST_VERIFY(pixels[0] == 0x80404040);
+
+	//Alpha is only kept as the top bit in RGBA16
+	uint16 pixels16[IPU::Csc::PIXEL_COUNT];
+	IPU::Csc::ConvertRgba16(block, pixels16, 0x40, 0x41, false);
+	TEST_VERIFY(pixels16[0] == 0x2108);
+	IPU::Csc::ConvertRgba16(block, pixels16, 0x40, 0x40, false);
+	TEST_VERIFY(pixels16[0] == 0xA108);
+}
+
+void CCscTest::CheckDither()
+{
+	uint8 block[IPU::Csc::BLOCK_SIZE];
+	FillBlock(block, 0x42, 0x80, 0x80);
+
+	uint16 pixels16[IPU::Csc::PIXEL_COUNT];
+	IPU::Csc::ConvertRgba16(block, pixels16, 0, 0, true);
+
+	//First pixel gets -4, which moves components down to the next 5-bit value
+	TEST_VERIFY(pixels16[0] == 0x9CE7);
+	//Second pixel gets 0
+	TEST_VERIFY(pixels16[1] == 0xA108);
+	//Pattern repeats every 4 pixels and every 4 lines
+	TEST_VERIFY(pixels16[4] == pixels16[0]);
+	TEST_VERIFY(pixels16[(4 * 16) + 1] == pixels16[1]);
+}
+
+void CCscTest::CheckReference()
+{
+	//Compares against the floating point formulas, R and B are expected to match exactly,
+	//G can be off by one because of the rounding of its coefficients
+	std::mt19937 generator(2);
+
+	for(unsigned int blockIndex = 0; blockIndex < REFERENCE_BLOCK_COUNT; blockIndex++)
+	{
+		uint8 block[IPU::Csc::BLOCK_SIZE];
+		for(unsigned int i = 0; i < IPU::Csc::BLOCK_SIZE; i++)
+		{
+			block[i] = static_cast<uint8>(generator());
+		}
+
+		uint32 pixels[IPU::Csc::PIXEL_COUNT];
+		IPU::Csc::ConvertRgba32Scalar(block, pixels, 0, 0);
+
+		for(unsigned int y = 0; y < 16; y++)
+		{
+			for(unsigned int x = 0; x < 16; x++)
+			{
+				unsigned int chromaIndex = ((y / 2) * 8) + (x / 2);
+				double luma = block[(y * 16) + x];
+				double cb = block[0x100 + chromaIndex] - 128.0;
+				double cr = block[0x140 + chromaIndex] - 128.0;
+				auto convert = [](double value) { return static_cast<int32>(std::clamp(std::floor(value), 0.0, 255.0)); };
+				int32 r = convert(luma + (1.402 * cr));
+				int32 g = convert(luma - (0.34414 * cb) - (0.71414 * cr));
+				int32 b = convert(luma + (1.772 * cb));
+
+				uint32 pixel = pixels[(y * 16) + x];
+				TEST_VERIFY(static_cast<int32>((pixel >> 0) & 0xFF) == r);
+				TEST_VERIFY(std::abs(static_cast<int32>((pixel >> 8) & 0xFF) - g) <= 1);
+				TEST_VERIFY(static_cast<int32>((pixel >> 16) & 0xFF) == b);
+			}
+		}
+	}
+}
+
+void CCscTest::CheckScalarMatch()
+{
+	std::mt19937 generator(1);
+
+	for(unsigned int blockIndex = 0; blockIndex < SCALAR_MATCH_BLOCK_COUNT; blockIndex++)
+	{
+		uint8 block[IPU::Csc::BLOCK_SIZE];
+		for(unsigned int i = 0; i < IPU::Csc::BLOCK_SIZE; i++)
+		{
+			block[i] = static_cast<uint8>(generator());
+		}
+		uint16 th0 = generator() & 0x1FF;
+		uint16 th1 = generator() & 0x1FF;
+		bool dither = (blockIndex & 1) != 0;
+
+		uint32 pixels[IPU::Csc::PIXEL_COUNT];
+		uint32 scalarPixels[IPU::Csc::PIXEL_COUNT];
+		IPU::Csc::ConvertRgba32(block, pixels, th0, th1);
+		IPU::Csc::ConvertRgba32Scalar(block, scalarPixels, th0, th1);
+		TEST_VERIFY(memcmp(pixels, scalarPixels, sizeof(pixels)) == 0);
+
+		uint16 pixels16[IPU::Csc::PIXEL_COUNT];
+		uint16 scalarPixels16[IPU::Csc::PIXEL_COUNT];
+		IPU::Csc::ConvertRgba16(block, pixels16, th0, th1, dither);
+		IPU::Csc::ConvertRgba16Scalar(block, scalarPixels16, th0, th1, dither);
+		TEST_VERIFY(memcmp(pixels16, scalarPixels16, sizeof(pixels16)) == 0);
+	}
+}
+
+void CCscTest::FillBlock(uint8* block, uint8 y, uint8 cb, uint8 cr)
+{
+	memset(block + 0x000, y, 0x100);
+	memset(block + 0x100, cb, 0x40);
+	memset(block + 0x140, cr, 0x40);
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "Test.h"
+#include "Types.h"
+
+class CCscTest : public CTest
+{
+public:
+	void Execute() override;
+
+private:
+	void CheckGray();
+	void CheckAlphaThresholds();
+	void CheckDither();
+	void CheckReference();
+	void CheckScalarMatch();
+
+	static void FillBlock(uint8*, uint8, uint8, uint8);
+};
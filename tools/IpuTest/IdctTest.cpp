@@ -0,0 +1,186 @@
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include "IdctTest.h"
+#include "ee/IPU_Idct.h"
+#include "idct/IEEE1180.h"
+
+//Checks the fixed-point IDCT against the IEEE 1180 accuracy requirements. Input blocks
+//are generated as described by the standard: random pixel blocks are transformed with a
+//double precision forward DCT, then both transforms are run on the resulting coefficients.
+
+#define BLOCK_COUNT (10000)
+
+#define MAX_PEAK_ERROR (1)
+#define MAX_PIXEL_MSE (0.06)
+#define MAX_OVERALL_MSE (0.02)
+#define MAX_PIXEL_MEAN_ERROR (0.015)
+#define MAX_OVERALL_MEAN_ERROR (0.0015)
+
+#define SCALAR_MATCH_BLOCK_COUNT (100000)
+
+void CIdctTest::Execute()
+{
+	CheckZeroBlock();
+
+	CheckAccuracy(256, 255, false);
+	CheckAccuracy(256, 255, true);
+	CheckAccuracy(5, 5, false);
+	CheckAccuracy(5, 5, true);
+	CheckAccuracy(300, 300, false);
+	CheckAccuracy(300, 300, true);
+
+	CheckScalarMatch();
+}
+
+void CIdctTest::CheckZeroBlock()
+{
+	int16 input[0x40] = {};
+	int16 output[0x40];
+	memset(output, 0xFF, sizeof(output));
+	IPU::Idct::Transform(input, output);
+	for(unsigned int i = 0; i < 0x40; i++)
+	{
+		TEST_VERIFY(output[i] == 0);
+	}
+}
+
+void CIdctTest::CheckAccuracy(int32 low, int32 high, bool negate)
+{
+	m_randomState = 1;
+
+	int32 peakError = 0;
+	double errorSum[0x40] = {};
+	double squaredErrorSum[0x40] = {};
+
+	for(unsigned int blockIndex = 0; blockIndex < BLOCK_COUNT; blockIndex++)
+	{
+		int16 pixels[0x40];
+		for(unsigned int i = 0; i < 0x40; i++)
+		{
+			pixels[i] = static_cast<int16>(GenerateRandom(low, high));
+		}
+
+		int16 coefficients[0x40];
+		ForwardDct(pixels, coefficients);
+		if(negate)
+		{
+			for(unsigned int i = 0; i < 0x40; i++)
+			{
+				coefficients[i] = -coefficients[i];
+			}
+		}
+
+		int16 referenceOutput[0x40];
+		int16 output[0x40];
+		IDCT::CIEEE1180::GetInstance()->Transform(coefficients, referenceOutput);
+		IPU::Idct::Transform(coefficients, output);
+
+		for(unsigned int i = 0; i < 0x40; i++)
+		{
+			int32 error = output[i] - referenceOutput[i];
+			peakError = std::max(peakError, std::abs(error));
+			errorSum[i] += error;
+			squaredErrorSum[i] += error * error;
+		}
+	}
+
+	double overallError = 0;
+	double overallSquaredError = 0;
+	for(unsigned int i = 0; i < 0x40; i++)
+	{
+		TEST_VERIFY((squaredErrorSum[i] / BLOCK_COUNT) <= MAX_PIXEL_MSE);
+		TEST_VERIFY(std::abs(errorSum[i] / BLOCK_COUNT) <= MAX_PIXEL_MEAN_ERROR);
+		overallError += errorSum[i];
+		overallSquaredError += squaredErrorSum[i];
+	}
+
+	TEST_VERIFY(peakError <= MAX_PEAK_ERROR);
+	TEST_VERIFY((overallSquaredError / (BLOCK_COUNT * 0x40)) <= MAX_OVERALL_MSE);
+	TEST_VERIFY(std::abs(overallError / (BLOCK_COUNT * 0x40)) <= MAX_OVERALL_MEAN_ERROR);
+}
+
+void CIdctTest::CheckScalarMatch()
+{
+	//SIMD and scalar versions must give the same results for any input, including
+	//coefficients outside of the range the IPU can produce
+	m_randomState = 1;
+
+	for(unsigned int blockIndex = 0; blockIndex < SCALAR_MATCH_BLOCK_COUNT; blockIndex++)
+	{
+		int16 coefficients[0x40];
+		for(unsigned int i = 0; i < 0x40; i++)
+		{
+			switch(blockIndex % 3)
+			{
+			case 0:
+				coefficients[i] = static_cast<int16>(GenerateRandom(2048, 2047));
+				break;
+			case 1:
+				coefficients[i] = static_cast<int16>(GenerateRandom(32768, 32767));
+				break;
+			case 2:
+				coefficients[i] = ((GenerateRandom(0, 7) == 0) ? static_cast<int16>(GenerateRandom(32768, 32767)) : 0);
+				break;
+			}
+		}
+
+		int16 output[0x40];
+		int16 scalarOutput[0x40];
+		IPU::Idct::Transform(coefficients, output);
+		IPU::Idct::TransformScalar(coefficients, scalarOutput);
+		TEST_VERIFY(memcmp(output, scalarOutput, sizeof(output)) == 0);
+	}
+}
+
+void CIdctTest::ForwardDct(const int16* input, int16* output)
+{
+	constexpr double pi = 3.14159265358979323846;
+	double basis[8][8];
+	for(unsigned int u = 0; u < 8; u++)
+	{
+		double scale = (u == 0) ? sqrt(0.125) : 0.5;
+		for(unsigned int x = 0; x < 8; x++)
+		{
+			basis[u][x] = scale * cos((pi / 8.0) * u * (x + 0.5));
+		}
+	}
+
+	double temp[0x40];
+	for(unsigned int y = 0; y < 8; y++)
+	{
+		for(unsigned int u = 0; u < 8; u++)
+		{
+			double sum = 0;
+			for(unsigned int x = 0; x < 8; x++)
+			{
+				sum += basis[u][x] * input[(y * 8) + x];
+			}
+			temp[(y * 8) + u] = sum;
+		}
+	}
+
+	for(unsigned int u = 0; u < 8; u++)
+	{
+		for(unsigned int v = 0; v < 8; v++)
+		{
+			double sum = 0;
+			for(unsigned int y = 0; y < 8; y++)
+			{
+				sum += basis[v][y] * temp[(y * 8) + u];
+			}
+			int32 value = static_cast<int32>(floor(sum + 0.5));
+			output[(v * 8) + u] = static_cast<int16>(std::clamp<int32>(value, -2048, 2047));
+		}
+	}
+}
+
+int32 CIdctTest::GenerateRandom(int32 low, int32 high)
+{
+	//Random number generator given by the IEEE 1180 standard
+	m_randomState = (m_randomState * 1103515245) + 12345;
+	double value = static_cast<double>(m_randomState & 0x7FFFFFFE) / static_cast<double>(0x7FFFFFFF);
+	value *= (low + high + 1);
+	return static_cast<int32>(value) - low;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "Test.h"
+#include "Types.h"
+
+class CIdctTest : public CTest
+{
+public:
+	void Execute() override;
+
+private:
+	void CheckZeroBlock();
+	void CheckAccuracy(int32, int32, bool);
+	void CheckScalarMatch();
+
+	static void ForwardDct(const int16*, int16*);
+	int32 GenerateRandom(int32, int32);
+
+	uint32 m_randomState = 1;
+};
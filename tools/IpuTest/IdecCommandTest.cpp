@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <random>
+#include "IdecCommandTest.h"
+#include "IntraMacroblock.h"
+#include "StreamWriter.h"
+#include "TestIpu.h"
+
+#define MACROBLOCK_COUNT (300)
+#define THROUGHPUT_MACROBLOCK_COUNT (1350 * 8)
+#define CTRL_IVF (0x00200000)
+#define SEQUENCE_HEADER_CODE (0xB3)
+
+//The expected output comes from floating point decoding, allow for the rounding errors of the IPU's
+//IDCT (1 per sample) going through color conversion and for the conversion's own rounding
+#define MAX_COMPONENT_ERROR (4)
+//Rounding differences are expected to be rare, a systematic error would affect most components
+#define MAX_MISMATCH_RATIO (16)
+
+void CIdecCommandTest::Execute()
+{
+	auto stream = GenerateStream(MACROBLOCK_COUNT, false);
+	auto stream1 = GenerateStream(MACROBLOCK_COUNT, true);
+
+	//Both streams contain the same macroblocks. Output must be exactly the same regardless of the
+	//coefficient table, how transfers are split or whether macroblocks are decoded ahead on the worker thread
+	auto output = CheckDecode(stream, false, false, ~0U, ~0U);
+	TEST_VERIFY(CheckDecode(stream1, true, false, ~0U, ~0U) == output);
+	TEST_VERIFY(CheckDecode(stream, false, false, 1, 0x10) == output);
+	TEST_VERIFY(CheckDecode(stream, false, true, ~0U, ~0U) == output);
+	TEST_VERIFY(CheckDecode(stream1, true, true, ~0U, 0x10) == output);
+	TEST_VERIFY(CheckDecode(stream, false, true, 1, 0x10) == output);
+
+	auto throughputStream = GenerateStream(THROUGHPUT_MACROBLOCK_COUNT, false);
+	MeasureThroughput(throughputStream, false);
+	MeasureThroughput(throughputStream, true);
+}
+
+CIdecCommandTest::STREAM CIdecCommandTest::GenerateStream(unsigned int macroblockCount, bool useTable1)
+{
+	std::mt19937 random(macroblockCount);
+
+	STREAM stream;
+	CStreamWriter writer;
+
+	int16 dcPredictor[3];
+	IntraMacroblock::ResetDcPredictor(dcPredictor);
+
+	uint32 qsc = (random() % 31) + 1;
+	stream.command = (CTestIpu::CMD_IDEC << 28) | (qsc << 16);
+
+	for(unsigned int i = 0; i < macroblockCount; i++)
+	{
+		//Macroblock address increment, IDEC doesn't expect one for the first macroblock
+		if(i != 0)
+		{
+			writer.WriteCode("1");
+		}
+
+		//Macroblock type, some macroblocks change the quantiser scale
+		if((random() % 4) == 0)
+		{
+			qsc = (random() % 31) + 1;
+			writer.WriteCode("01");
+			writer.WriteBits(qsc, 5);
+		}
+		else
+		{
+			writer.WriteCode("1");
+		}
+
+		auto macroblock = IntraMacroblock::Generate(random, qsc);
+		IntraMacroblock::WriteBlocks(writer, macroblock, dcPredictor, useTable1);
+
+		uint32 pixels[IntraMacroblock::PIXEL_COUNT];
+		IntraMacroblock::DecodeRgba32(macroblock, qsc, pixels);
+
+		auto pixelBytes = reinterpret_cast<const uint8*>(pixels);
+		stream.expectedOutput.insert(stream.expectedOutput.end(), pixelBytes, pixelBytes + sizeof(pixels));
+	}
+
+	writer.WriteStartCode(SEQUENCE_HEADER_CODE);
+	stream.data = writer.GetBuffer();
+	return stream;
+}
+
+std::vector<uint8> CIdecCommandTest::CheckDecode(const STREAM& stream, bool useTable1, bool asyncDecode, uint32 dma4TransferSize, uint32 dma3TransferSize)
+{
+	CTestIpu ipu;
+	ipu.Reset();
+	ipu.GetIpu().SetAsyncDecodeEnabled(asyncDecode);
+	ipu.SetControl(useTable1 ? CTRL_IVF : 0);
+	ipu.SetInput(stream.data);
+	ipu.SetTransferSizes(dma4TransferSize, dma3TransferSize);
+
+	TEST_VERIFY(ipu.ExecuteCommand(stream.command));
+
+	auto output = ipu.GetOutput();
+	TEST_VERIFY(output.size() == stream.expectedOutput.size());
+	uint32 mismatchCount = 0;
+	for(unsigned int i = 0; i < std::min(output.size(), stream.expectedOutput.size()); i++)
+	{
+		int32 error = std::abs(output[i] - stream.expectedOutput[i]);
+		TEST_VERIFY(error <= MAX_COMPONENT_ERROR);
+		mismatchCount += (error != 0) ? 1 : 0;
+	}
+	TEST_VERIFY(mismatchCount <= (output.size() / MAX_MISMATCH_RATIO));
+
+	//Decoding stops right before the start code
+	TEST_VERIFY(ipu.ExecuteCommand(CTestIpu::CMD_FDEC << 28));
+	TEST_VERIFY(ipu.GetCommandResult() == (0x100 | SEQUENCE_HEADER_CODE));
+
+	return output;
+}
+
+void CIdecCommandTest::MeasureThroughput(const STREAM& stream, bool asyncDecode)
+{
+	CTestIpu ipu;
+	ipu.Reset();
+	ipu.GetIpu().SetAsyncDecodeEnabled(asyncDecode);
+	ipu.SetInput(stream.data);
+
+	auto startTime = std::chrono::steady_clock::now();
+	TEST_VERIFY(ipu.ExecuteCommand(stream.command));
+	auto endTime = std::chrono::steady_clock::now();
+
+	TEST_VERIFY(ipu.GetOutput().size() == stream.expectedOutput.size());
+
+	double seconds = std::chrono::duration<double>(endTime - startTime).count();
+	unsigned int macroblockCount = static_cast<unsigned int>(stream.expectedOutput.size() / (IntraMacroblock::PIXEL_COUNT * sizeof(uint32)));
+	printf("IDEC (%s): %0.0f macroblocks per second.\n", asyncDecode ? "async" : "sync", macroblockCount / seconds);
+}
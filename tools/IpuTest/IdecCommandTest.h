@@ -0,0 +1,24 @@
+#pragma once
+
+#include <vector>
+#include "Test.h"
+#include "Types.h"
+
+class CIdecCommandTest : public CTest
+{
+public:
+	void Execute() override;
+
+private:
+	struct STREAM
+	{
+		std::vector<uint8> data;
+		std::vector<uint8> expectedOutput;
+		uint32 command = 0;
+	};
+
+	static STREAM GenerateStream(unsigned int, bool);
+
+	std::vector<uint8> CheckDecode(const STREAM&, bool, bool, uint32, uint32);
+	void MeasureThroughput(const STREAM&, bool);
+};
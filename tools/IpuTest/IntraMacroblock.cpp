@@ -0,0 +1,336 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <iterator>
+#include "IntraMacroblock.h"
+#include "idct/IEEE1180.h"
+
+using namespace IntraMacroblock;
+
+//Levels are kept small enough for dequantised values to fit in 16 bits before saturation
+#define MAX_LEVEL (100)
+
+//Limit on the sum of AC coefficient magnitudes in a block, keeps samples within 256 of the DC value,
+//which is about the input range the IDCT accuracy requirements are defined for
+#define MAX_AC_MAGNITUDE_SUM (1024)
+
+//Probabilities (in percent) used to get coefficient distributions similar to the ones of actual video
+#define NEXT_COEFFICIENT_PROBABILITY (80)
+#define RUN_INCREMENT_PROBABILITY (45)
+#define LEVEL_INCREMENT_PROBABILITY (40)
+
+struct VLCCODE
+{
+	uint8 run;
+	uint8 level;
+	const char* code;
+};
+
+// clang-format off
+static const char* g_dcSizeLuminanceCodes[12] =
+    {
+        "100", "00", "01", "101", "110", "1110", "11110", "111110",
+        "1111110", "11111110", "111111110", "111111111"};
+
+static const char* g_dcSizeChrominanceCodes[12] =
+    {
+        "00", "01", "10", "110", "1110", "11110", "111110", "1111110",
+        "11111110", "111111110", "1111111110", "1111111111"};
+
+//Table B.14, codes up to 12 bits (sign bit excluded), other pairs are escaped
+static const VLCCODE g_dctCoefficientCodes0[] =
+{
+	{  0,  1, "11"           }, {  0,  2, "0100"         }, {  0,  3, "00101"        }, {  0,  4, "0000110"      },
+	{  0,  5, "00100110"     }, {  0,  6, "00100001"     }, {  0,  7, "0000001010"   }, {  0,  8, "000000011101" },
+	{  0,  9, "000000011000" }, {  0, 10, "000000010011" }, {  0, 11, "000000010000" },
+	{  1,  1, "011"          }, {  1,  2, "000110"       }, {  1,  3, "00100101"     }, {  1,  4, "0000001100"   },
+	{  1,  5, "000000011011" },
+	{  2,  1, "0101"         }, {  2,  2, "0000100"      }, {  2,  3, "0000001011"   }, {  2,  4, "000000010100" },
+	{  3,  1, "00111"        }, {  3,  2, "00100100"     }, {  3,  3, "000000011100" },
+	{  4,  1, "00110"        }, {  4,  2, "0000001111"   }, {  4,  3, "000000010010" },
+	{  5,  1, "000111"       }, {  5,  2, "0000001001"   },
+	{  6,  1, "000101"       }, {  6,  2, "000000011110" },
+	{  7,  1, "000100"       }, {  7,  2, "000000010101" },
+	{  8,  1, "0000111"      }, {  8,  2, "000000010001" },
+	{  9,  1, "0000101"      }, { 10,  1, "00100111"     }, { 11,  1, "00100011"     }, { 12,  1, "00100010"     },
+	{ 13,  1, "00100000"     }, { 14,  1, "0000001110"   }, { 15,  1, "0000001101"   }, { 16,  1, "0000001000"   },
+	{ 17,  1, "000000011111" }, { 18,  1, "000000011010" }, { 19,  1, "000000011001" }, { 20,  1, "000000010111" },
+	{ 21,  1, "000000010110" },
+};
+
+//Table B.15, codes up to 12 bits (sign bit excluded), other pairs are escaped
+static const VLCCODE g_dctCoefficientCodes1[] =
+{
+	{  0,  1, "10"           }, {  0,  2, "110"          }, {  0,  3, "0111"         }, {  0,  4, "11100"        },
+	{  0,  5, "11101"        }, {  0,  6, "000101"       }, {  0,  7, "000100"       }, {  0,  8, "1111011"      },
+	{  0,  9, "1111100"      }, {  0, 10, "00100011"     }, {  0, 11, "00100010"     }, {  0, 12, "11111010"     },
+	{  0, 13, "11111011"     }, {  0, 14, "11111110"     }, {  0, 15, "11111111"     },
+	{  1,  1, "010"          }, {  1,  2, "00110"        }, {  1,  3, "1111001"      }, {  1,  4, "00100111"     },
+	{  1,  5, "00100000"     },
+	{  2,  1, "00101"        }, {  2,  2, "0000111"      }, {  2,  3, "11111100"     }, {  2,  4, "0000001100"   },
+	{  3,  1, "00111"        }, {  3,  2, "00100110"     }, {  3,  3, "000000011100" },
+	{  4,  1, "000110"       }, {  4,  2, "11111101"     }, {  4,  3, "000000010010" },
+	{  5,  1, "000111"       }, {  5,  2, "000000100"    },
+	{  6,  1, "0000110"      }, {  6,  2, "000000011110" },
+	{  7,  1, "0000100"      }, {  7,  2, "000000010101" },
+	{  8,  1, "0000101"      }, {  8,  2, "000000010001" },
+	{  9,  1, "1111000"      }, { 10,  1, "1111010"      }, { 11,  1, "00100001"     }, { 12,  1, "00100101"     },
+	{ 13,  1, "00100100"     }, { 14,  1, "000000101"    }, { 15,  1, "000000111"    }, { 16,  1, "0000001101"   },
+	{ 17,  1, "000000011111" }, { 18,  1, "000000011010" }, { 19,  1, "000000011001" }, { 20,  1, "000000010111" },
+	{ 21,  1, "000000010110" },
+};
+
+//Default intra matrix, the IPU indexes it with the position in the coefficient stream
+static const uint8 g_defaultIntraIq[0x40] =
+{
+	 8, 16, 19, 22, 26, 27, 29, 34,
+	16, 16, 22, 24, 27, 29, 34, 37,
+	19, 22, 26, 27, 29, 34, 34, 38,
+	22, 22, 26, 27, 29, 34, 37, 40,
+	22, 26, 27, 29, 32, 35, 40, 48,
+	26, 27, 29, 32, 35, 40, 48, 58,
+	26, 27, 29, 34, 38, 46, 56, 69,
+	27, 29, 35, 38, 46, 56, 69, 83,
+};
+
+static const uint8 g_zigzagScan[0x40] =
+{
+	 0,  1,  8, 16,  9,  2,  3, 10, 17, 24, 32, 25, 18, 11,  4,  5,
+	12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13,  6,  7, 14, 21, 28,
+	35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+	58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+};
+// clang-format on
+
+static unsigned int GetBlockChannel(unsigned int blockIndex)
+{
+	return (blockIndex < 4) ? 0 : (blockIndex - 3);
+}
+
+static void WriteDcDifferential(CStreamWriter& writer, int32 diff, unsigned int channel)
+{
+	unsigned int size = 0;
+	for(uint32 magnitude = std::abs(diff); magnitude != 0; magnitude >>= 1)
+	{
+		size++;
+	}
+	assert(size < 12);
+	writer.WriteCode((channel == 0) ? g_dcSizeLuminanceCodes[size] : g_dcSizeChrominanceCodes[size]);
+	if(size != 0)
+	{
+		uint32 bits = (diff > 0) ? diff : (diff + (1 << size) - 1);
+		writer.WriteBits(bits, size);
+	}
+}
+
+static void WriteCoefficient(CStreamWriter& writer, const COEFFICIENT& coefficient, bool useTable1)
+{
+	const auto* codesBegin = useTable1 ? std::begin(g_dctCoefficientCodes1) : std::begin(g_dctCoefficientCodes0);
+	const auto* codesEnd = useTable1 ? std::end(g_dctCoefficientCodes1) : std::end(g_dctCoefficientCodes0);
+	uint32 magnitude = std::abs(coefficient.level);
+	auto codeIterator = std::find_if(codesBegin, codesEnd,
+	                                 [&](const VLCCODE& code) { return (code.run == coefficient.run) && (code.level == magnitude); });
+	if(codeIterator != codesEnd)
+	{
+		writer.WriteCode(codeIterator->code);
+		writer.WriteBits((coefficient.level < 0) ? 1 : 0, 1);
+	}
+	else
+	{
+		writer.WriteCode("000001");
+		writer.WriteBits(coefficient.run, 6);
+		writer.WriteBits(coefficient.level & 0xFFF, 12);
+	}
+}
+
+static int16 DequantiseAc(int16 level, int32 iq, uint32 qsc)
+{
+	if(level == 0) return 0;
+	int32 quantScale = 2 * qsc;
+	int32 result = (level * iq * quantScale * 2) / 32;
+	if((result & 1) == 0)
+	{
+		int32 sign = (level > 0) ? 1 : -1;
+		result = (result - sign) | 1;
+	}
+	//Coefficients are saturated after dequantisation
+	return static_cast<int16>(std::min<int32>(std::max<int32>(result, -2048), 2047));
+}
+
+static uint8 GenerateRun(std::mt19937& random)
+{
+	//Mostly short runs, with the occasional long one
+	if((random() % 16) == 0)
+	{
+		return static_cast<uint8>(random() % 48);
+	}
+	uint8 run = 0;
+	while((run < 31) && ((random() % 100) < RUN_INCREMENT_PROBABILITY))
+	{
+		run++;
+	}
+	return run;
+}
+
+static int16 GenerateLevel(std::mt19937& random)
+{
+	//Mostly small levels, with the occasional large one
+	int16 level = 1;
+	if((random() % 32) == 0)
+	{
+		level = static_cast<int16>(random() % MAX_LEVEL) + 1;
+	}
+	else
+	{
+		while((level < MAX_LEVEL) && ((random() % 100) < LEVEL_INCREMENT_PROBABILITY))
+		{
+			level++;
+		}
+	}
+	return (random() & 1) ? level : -level;
+}
+
+MACROBLOCK IntraMacroblock::Generate(std::mt19937& random, uint32 qsc)
+{
+	MACROBLOCK macroblock;
+	for(auto& block : macroblock.blocks)
+	{
+		block.dc = static_cast<int16>(random() % 256);
+
+		//Position of the next coefficient in the stream, DC is at 0
+		unsigned int position = 1;
+		int32 magnitudeSum = 0;
+		auto addCoefficient =
+		    [&](const COEFFICIENT& coefficient) {
+			    unsigned int coefficientPosition = position + coefficient.run;
+			    int32 magnitude = std::abs(DequantiseAc(coefficient.level, g_defaultIntraIq[coefficientPosition], qsc));
+			    if((magnitudeSum + magnitude) > MAX_AC_MAGNITUDE_SUM) return;
+			    magnitudeSum += magnitude;
+			    position = coefficientPosition + 1;
+			    block.coefficients.push_back(coefficient);
+		    };
+		while((random() % 100) < NEXT_COEFFICIENT_PROBABILITY)
+		{
+			COEFFICIENT coefficient;
+			if((random() % 4) == 0)
+			{
+				//Make sure every short code shows up, regardless of its probability
+				const auto& code = (random() & 1) ? g_dctCoefficientCodes1[random() % std::size(g_dctCoefficientCodes1)]
+				                                  : g_dctCoefficientCodes0[random() % std::size(g_dctCoefficientCodes0)];
+				coefficient.run = code.run;
+				coefficient.level = (random() & 1) ? code.level : -code.level;
+			}
+			else
+			{
+				coefficient.run = GenerateRun(random);
+				coefficient.level = GenerateLevel(random);
+			}
+			if((position + coefficient.run) >= 0x40) break;
+			addCoefficient(coefficient);
+		}
+
+		//Last coefficient of the block
+		if((position < 0x40) && ((random() % 4) == 0))
+		{
+			COEFFICIENT coefficient;
+			coefficient.run = static_cast<uint8>(0x3F - position);
+			coefficient.level = GenerateLevel(random);
+			addCoefficient(coefficient);
+		}
+	}
+	return macroblock;
+}
+
+void IntraMacroblock::ResetDcPredictor(int16* dcPredictor)
+{
+	//Reset value for DC precision 0
+	dcPredictor[0] = 128;
+	dcPredictor[1] = 128;
+	dcPredictor[2] = 128;
+}
+
+void IntraMacroblock::WriteBlocks(CStreamWriter& writer, const MACROBLOCK& macroblock, int16* dcPredictor, bool useTable1)
+{
+	for(unsigned int i = 0; i < BLOCK_COUNT; i++)
+	{
+		const auto& block = macroblock.blocks[i];
+		unsigned int channel = GetBlockChannel(i);
+
+		WriteDcDifferential(writer, block.dc - dcPredictor[channel], channel);
+		dcPredictor[channel] = block.dc;
+
+		for(const auto& coefficient : block.coefficients)
+		{
+			WriteCoefficient(writer, coefficient, useTable1);
+		}
+
+		//End of block
+		writer.WriteCode(useTable1 ? "0110" : "10");
+	}
+}
+
+void IntraMacroblock::DecodeRaw16(const MACROBLOCK& macroblock, uint32 qsc, int16* output)
+{
+	int16 pixels[BLOCK_COUNT][0x40];
+	for(unsigned int i = 0; i < BLOCK_COUNT; i++)
+	{
+		const auto& block = macroblock.blocks[i];
+
+		int16 coefficients[0x40] = {};
+		coefficients[0] = block.dc * 8;
+		unsigned int position = 1;
+		for(const auto& coefficient : block.coefficients)
+		{
+			position += coefficient.run;
+			assert(position < 0x40);
+			coefficients[g_zigzagScan[position]] = DequantiseAc(coefficient.level, g_defaultIntraIq[position], qsc);
+			position++;
+		}
+
+		IDCT::CIEEE1180::GetInstance()->Transform(coefficients, pixels[i]);
+	}
+
+	//Luminance blocks are output as a 16x16 block, followed by both chrominance blocks
+	for(unsigned int y = 0; y < 16; y++)
+	{
+		const int16* left = pixels[(y < 8) ? 0 : 2] + ((y % 8) * 8);
+		const int16* right = pixels[(y < 8) ? 1 : 3] + ((y % 8) * 8);
+		std::copy(left, left + 8, output + (y * 16));
+		std::copy(right, right + 8, output + (y * 16) + 8);
+	}
+	std::copy(pixels[4], pixels[4] + 0x40, output + 0x100);
+	std::copy(pixels[5], pixels[5] + 0x40, output + 0x140);
+}
+
+void IntraMacroblock::DecodeRaw8(const MACROBLOCK& macroblock, uint32 qsc, uint8* output)
+{
+	int16 raw16[RAW_SIZE];
+	DecodeRaw16(macroblock, qsc, raw16);
+	for(unsigned int i = 0; i < RAW_SIZE; i++)
+	{
+		output[i] = static_cast<uint8>(std::min<int16>(std::max<int16>(raw16[i], 0), 255));
+	}
+}
+
+void IntraMacroblock::DecodeRgba32(const MACROBLOCK& macroblock, uint32 qsc, uint32* output)
+{
+	uint8 raw8[RAW_SIZE];
+	DecodeRaw8(macroblock, qsc, raw8);
+	for(unsigned int y = 0; y < 16; y++)
+	{
+		for(unsigned int x = 0; x < 16; x++)
+		{
+			unsigned int chromaIndex = ((y / 2) * 8) + (x / 2);
+			double luma = raw8[(y * 16) + x];
+			double cb = raw8[0x100 + chromaIndex] - 128.0;
+			double cr = raw8[0x140 + chromaIndex] - 128.0;
+			auto convert = [](double value) { return static_cast<uint32>(std::clamp(std::floor(value), 0.0, 255.0)); };
+			uint32 r = convert(luma + (1.402 * cr));
+			uint32 g = convert(luma - (0.34414 * cb) - (0.71414 * cr));
+			uint32 b = convert(luma + (1.772 * cb));
+			//With thresholds set to 0, every pixel is opaque
+			output[(y * 16) + x] = (0x80 << 24) | (b << 16) | (g << 8) | r;
+		}
+	}
+}
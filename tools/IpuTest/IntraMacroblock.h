@@ -0,0 +1,48 @@
+#pragma once
+
+#include <random>
+#include <vector>
+#include "Types.h"
+#include "StreamWriter.h"
+
+//Intra macroblocks made of a DC coefficient and a list of run/level pairs per block.
+//Blocks are written with the same syntax BDEC/IDEC expect, pairs use the short codes of
+//tables B.14/B.15 when there is one and escape codes otherwise. A straightforward reference
+//decoder gives the output the IPU should produce, it uses a double precision IDCT and color
+//conversion, so results can be off by the rounding errors allowed for the IPU's fixed-point versions.
+//Decoding assumes the IPU_CTRL defaults (MPEG-2, DC precision 0, linear quantiser scale,
+//zigzag scan), the default intra matrix and alpha thresholds set to 0.
+namespace IntraMacroblock
+{
+	enum
+	{
+		BLOCK_COUNT = 6,
+		RAW_SIZE = 0x180,
+		PIXEL_COUNT = 0x100,
+	};
+
+	struct COEFFICIENT
+	{
+		uint8 run = 0;
+		int16 level = 0;
+	};
+
+	struct BLOCK
+	{
+		int16 dc = 0;
+		std::vector<COEFFICIENT> coefficients;
+	};
+
+	struct MACROBLOCK
+	{
+		BLOCK blocks[BLOCK_COUNT];
+	};
+
+	MACROBLOCK Generate(std::mt19937&, uint32);
+	void ResetDcPredictor(int16*);
+	void WriteBlocks(CStreamWriter&, const MACROBLOCK&, int16*, bool);
+
+	void DecodeRaw16(const MACROBLOCK&, uint32, int16*);
+	void DecodeRaw8(const MACROBLOCK&, uint32, uint8*);
+	void DecodeRgba32(const MACROBLOCK&, uint32, uint32*);
+}
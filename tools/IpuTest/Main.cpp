@@ -0,0 +1,32 @@
+#include <functional>
+#include "BdecCommandTest.h"
+#include "CscCommandTest.h"
+#include "CscTest.h"
+#include "IdctTest.h"
+#include "IdecCommandTest.h"
+#include "VlcCommandTest.h"
+
+typedef std::function<CTest*()> TestFactoryFunction;
+
+// clang-format off
+static const TestFactoryFunction s_factories[] =
+{
+	[]() { return new CBdecCommandTest(); },
+	[]() { return new CCscCommandTest(); },
+	[]() { return new CCscTest(); },
+	[]() { return new CIdctTest(); },
+	[]() { return new CIdecCommandTest(); },
+	[]() { return new CVlcCommandTest(); },
+};
+// clang-format on
+
+int main(int argc, const char** argv)
+{
+	for(const auto& factory : s_factories)
+	{
+		auto test = factory();
+		test->Execute();
+		delete test;
+	}
+	return 0;
+}
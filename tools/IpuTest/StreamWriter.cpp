@@ -0,0 +1,39 @@
+#include <cassert>
+#include "StreamWriter.h"
+
+void CStreamWriter::WriteBits(uint32 value, unsigned int size)
+{
+	assert(size <= 32);
+	for(unsigned int i = 0; i < size; i++)
+	{
+		if((m_bitPosition % 8) == 0)
+		{
+			m_buffer.push_back(0);
+		}
+		uint32 bit = (value >> (size - i - 1)) & 1;
+		m_buffer.back() |= static_cast<uint8>(bit << (7 - (m_bitPosition % 8)));
+		m_bitPosition++;
+	}
+}
+
+void CStreamWriter::WriteCode(const char* code)
+{
+	for(; *code != 0; code++)
+	{
+		assert((*code == '0') || (*code == '1'));
+		WriteBits((*code == '1') ? 1 : 0, 1);
+	}
+}
+
+void CStreamWriter::WriteStartCode(uint8 code)
+{
+	//Pad with zeroes up to the next byte boundary
+	m_bitPosition = static_cast<unsigned int>(m_buffer.size() * 8);
+	WriteBits(0x000001, 24);
+	WriteBits(code, 8);
+}
+
+const std::vector<uint8>& CStreamWriter::GetBuffer() const
+{
+	return m_buffer;
+}
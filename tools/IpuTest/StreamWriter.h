@@ -0,0 +1,19 @@
+#pragma once
+
+#include <vector>
+#include "Types.h"
+
+//Builds MSB first bit streams as consumed by the IPU
+class CStreamWriter
+{
+public:
+	void WriteBits(uint32, unsigned int);
+	void WriteCode(const char*);
+	void WriteStartCode(uint8);
+
+	const std::vector<uint8>& GetBuffer() const;
+
+private:
+	std::vector<uint8> m_buffer;
+	unsigned int m_bitPosition = 0;
+};
@@ -0,0 +1,110 @@
+#include <algorithm>
+#include "TestIpu.h"
+
+CTestIpu::CTestIpu()
+    : m_ipu(m_intc)
+{
+	m_ipu.SetDMA3ReceiveHandler(
+	    [this](const void* data, uint32 qwc) {
+		    return ReceiveOutput(data, qwc);
+	    });
+}
+
+void CTestIpu::Reset()
+{
+	m_intc.Reset();
+	m_ipu.Reset();
+	m_input.clear();
+	m_inputPosition = 0;
+	m_output.clear();
+}
+
+void CTestIpu::SetControl(uint32 value)
+{
+	m_ipu.SetRegister(CIPU::IPU_CTRL, value);
+}
+
+void CTestIpu::SetInput(const std::vector<uint8>& input)
+{
+	//DMA transfers whole qwords
+	m_input = input;
+	m_input.resize((m_input.size() + 0xF) & ~0xF);
+	m_inputPosition = 0;
+}
+
+void CTestIpu::SetTransferSizes(uint32 dma4TransferSize, uint32 dma3TransferSize)
+{
+	m_dma4TransferSize = dma4TransferSize;
+	m_dma3TransferSize = dma3TransferSize;
+}
+
+bool CTestIpu::ExecuteCommand(uint32 command)
+{
+	m_ipu.SetRegister(CIPU::IPU_CMD, command);
+	for(unsigned int step = 0; m_ipu.WillExecuteCommand(); step++)
+	{
+		if(step == MAX_STEPS)
+		{
+			return false;
+		}
+		m_ipu.CountTicks(STEP_TICKS);
+		SendInput();
+		m_dma3Remaining = m_dma3TransferSize;
+		m_ipu.ExecuteCommand();
+		if(m_ipu.HasPendingOUTFIFOData())
+		{
+			m_dma3Remaining = m_dma3TransferSize;
+			m_ipu.FlushOUTFIFOData();
+		}
+	}
+	m_dma3Remaining = m_dma3TransferSize;
+	while(m_ipu.HasPendingOUTFIFOData())
+	{
+		m_ipu.FlushOUTFIFOData();
+		m_dma3Remaining = m_dma3TransferSize;
+	}
+	return true;
+}
+
+uint32 CTestIpu::GetCommandResult()
+{
+	return m_ipu.GetRegister(CIPU::IPU_CMD);
+}
+
+uint32 CTestIpu::GetControl()
+{
+	return m_ipu.GetRegister(CIPU::IPU_CTRL);
+}
+
+const std::vector<uint8>& CTestIpu::GetOutput() const
+{
+	return m_output;
+}
+
+void CTestIpu::ClearOutput()
+{
+	m_output.clear();
+}
+
+CIPU& CTestIpu::GetIpu()
+{
+	return m_ipu;
+}
+
+void CTestIpu::SendInput()
+{
+	uint32 remainingQwc = static_cast<uint32>(m_input.size() - m_inputPosition) / 0x10;
+	uint32 qwc = std::min<uint32>(remainingQwc, m_dma4TransferSize);
+	if(qwc == 0) return;
+	uint32 sentQwc = m_ipu.ReceiveDMA4(m_inputPosition, qwc, false, m_input.data(), nullptr);
+	m_inputPosition += sentQwc * 0x10;
+}
+
+uint32 CTestIpu::ReceiveOutput(const void* data, uint32 qwc)
+{
+	qwc = std::min<uint32>(qwc, m_dma3Remaining);
+	auto bytes = reinterpret_cast<const uint8*>(data);
+	m_output.insert(m_output.end(), bytes, bytes + (qwc * 0x10));
+	m_dma3Remaining -= qwc;
+	return qwc;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vector>
+#include "ee/INTC.h"
+#include "ee/IPU.h"
+
+//Runs IPU commands in isolation. Input is transferred to the IN FIFO the same way DMA4
+//would and output is collected from the OUT FIFO the same way DMA3 would, both with
+//configurable transfer sizes to exercise the stall paths.
+class CTestIpu
+{
+public:
+	enum
+	{
+		CMD_BCLR = 0,
+		CMD_IDEC = 1,
+		CMD_BDEC = 2,
+		CMD_VDEC = 3,
+		CMD_FDEC = 4,
+		CMD_CSC = 7,
+		CMD_SETTH = 9,
+	};
+
+	CTestIpu();
+	virtual ~CTestIpu() = default;
+
+	void Reset();
+	void SetControl(uint32);
+	void SetInput(const std::vector<uint8>&);
+	void SetTransferSizes(uint32, uint32);
+
+	bool ExecuteCommand(uint32);
+	uint32 GetCommandResult();
+	uint32 GetControl();
+
+	const std::vector<uint8>& GetOutput() const;
+	void ClearOutput();
+
+	CIPU& GetIpu();
+
+private:
+	enum
+	{
+		MAX_STEPS = 1000000,
+		STEP_TICKS = 100,
+	};
+
+	void SendInput();
+	uint32 ReceiveOutput(const void*, uint32);
+
+	CINTC m_intc;
+	CIPU m_ipu;
+
+	std::vector<uint8> m_input;
+	uint32 m_inputPosition = 0;
+	std::vector<uint8> m_output;
+
+	uint32 m_dma4TransferSize = ~0U;
+	uint32 m_dma3TransferSize = ~0U;
+	uint32 m_dma3Remaining = ~0U;
+};
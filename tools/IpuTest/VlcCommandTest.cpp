@@ -0,0 +1,81 @@
+#include <cstring>
+#include "VlcCommandTest.h"
+#include "StreamWriter.h"
+#include "TestIpu.h"
+
+#define PICTURE_TYPE_I (1 << 24)
+
+void CVlcCommandTest::Execute()
+{
+	CheckMacroblockAddressIncrement();
+	CheckMacroblockType();
+	CheckFdec();
+}
+
+void CVlcCommandTest::CheckMacroblockAddressIncrement()
+{
+	static const char* codes[] = {"1", "011", "010", "0011", "0010", "00011", "00010"};
+
+	CStreamWriter writer;
+	for(auto code : codes)
+	{
+		writer.WriteCode(code);
+	}
+
+	CTestIpu ipu;
+	ipu.Reset();
+	ipu.SetInput(writer.GetBuffer());
+
+	uint32 increment = 1;
+	for(auto code : codes)
+	{
+		TEST_VERIFY(ipu.ExecuteCommand(CTestIpu::CMD_VDEC << 28));
+		//Symbol length is returned in the upper half
+		uint32 length = static_cast<uint32>(strlen(code));
+		TEST_VERIFY(ipu.GetCommandResult() == ((length << 16) | increment));
+		increment++;
+	}
+}
+
+void CVlcCommandTest::CheckMacroblockType()
+{
+	CStreamWriter writer;
+	writer.WriteCode("1");
+	writer.WriteCode("01");
+
+	CTestIpu ipu;
+	ipu.Reset();
+	ipu.SetControl(PICTURE_TYPE_I);
+	ipu.SetInput(writer.GetBuffer());
+
+	uint32 command = (CTestIpu::CMD_VDEC << 28) | (1 << 26);
+
+	//Intra
+	TEST_VERIFY(ipu.ExecuteCommand(command));
+	TEST_VERIFY(ipu.GetCommandResult() == 0x00010001);
+
+	//Intra with quantiser scale
+	TEST_VERIFY(ipu.ExecuteCommand(command));
+	TEST_VERIFY(ipu.GetCommandResult() == 0x00020011);
+}
+
+void CVlcCommandTest::CheckFdec()
+{
+	CStreamWriter writer;
+	writer.WriteBits(0x12345678, 32);
+	writer.WriteBits(0x9ABCDEF0, 32);
+
+	CTestIpu ipu;
+	ipu.Reset();
+	ipu.SetInput(writer.GetBuffer());
+
+	//FDEC peeks without consuming, only the forward bits are skipped
+	TEST_VERIFY(ipu.ExecuteCommand(CTestIpu::CMD_FDEC << 28));
+	TEST_VERIFY(ipu.GetCommandResult() == 0x12345678);
+
+	TEST_VERIFY(ipu.ExecuteCommand((CTestIpu::CMD_FDEC << 28) | 4));
+	TEST_VERIFY(ipu.GetCommandResult() == 0x23456789);
+
+	TEST_VERIFY(ipu.ExecuteCommand((CTestIpu::CMD_FDEC << 28) | 28));
+	TEST_VERIFY(ipu.GetCommandResult() == 0x9ABCDEF0);
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "Test.h"
+#include "Types.h"
+
+class CVlcCommandTest : public CTest
+{
+public:
+	void Execute() override;
+
+private:
+	void CheckMacroblockAddressIncrement();
+	void CheckMacroblockType();
+	void CheckFdec();
+};
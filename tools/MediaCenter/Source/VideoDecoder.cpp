@@ -2,11 +2,20 @@
 #include "StreamBitStream.h"
 #include "StdStream.h"
 #include "MemStream.h"
+#include "PtrStream.h"
 #include "ProgramStreamDecoder.h"
 #include "VideoStream_Decoder.h"
 #include "RawMpeg2Container.h"
+#include "SimdDefs.h"
+#include <algorithm>
 #include <assert.h>
 
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+#include <emmintrin.h>
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+#include <arm_neon.h>
+#endif
+
 #if 0
 
 #include "XaSoundStreamDecoder.h"
@@ -134,12 +143,14 @@ void CVideoDecoder::DecoderThreadProc(std::string path)
 		container = rawMpeg2Container;
 	}
 
+	StartSliceWorkers();
+
 	MPEG_VIDEO_STATE videoState;
 	VideoStream::Decoder videoStreamDecoder;
 	videoStreamDecoder.InitializeState(&videoState);
 	videoStreamDecoder.Reset();
-	videoStreamDecoder.RegisterOnMacroblockDecodedHandler([&](MPEG_VIDEO_STATE* state) { OnMacroblockDecoded(state); });
-	videoStreamDecoder.RegisterOnPictureDecodedHandler([&](MPEG_VIDEO_STATE* state) { OnPictureDecoded(state); });
+	videoStreamDecoder.RegisterOnSliceReadHandler([&](MPEG_VIDEO_STATE* state, uint8 sliceStartCode, const std::vector<uint8>& sliceData) { OnSliceRead(state, sliceStartCode, sliceData); });
+	videoStreamDecoder.RegisterOnPictureReadHandler([&](MPEG_VIDEO_STATE* state) { OnPictureRead(state); });
 
 	while(!m_threadDone)
 	{
@@ -184,18 +195,86 @@ void CVideoDecoder::DecoderThreadProc(std::string path)
 		{
 		}
 	}
+
+	//The last picture isn't followed by another start code if the stream was cut
+	if(m_pictureSlicesPending && !m_threadDone)
+	{
+		OnPictureRead(&videoState);
+	}
+
+	StopSliceWorkers();
 }
 
-void CVideoDecoder::OnMacroblockDecoded(MPEG_VIDEO_STATE* state)
+void CVideoDecoder::StartSliceWorkers()
 {
-	const int blockWidth = 16;
-	const int blockHeight = 16;
+	uint32 workerCount = std::max<uint32>(std::thread::hardware_concurrency(), 1);
+	m_sliceWorkersDone = false;
+	for(uint32 i = 0; i < workerCount; i++)
+	{
+		m_sliceWorkerThreads.emplace_back([this]() { SliceWorkerThreadProc(); });
+	}
+}
 
-	MACROBLOCK& macroblock(state->macroblock);
-	PICTURE_HEADER& pictureHeader(state->pictureHeader);
-	SEQUENCE_HEADER& sequenceHeader(state->sequenceHeader);
-	BLOCK_DECODER_STATE& decoderState(state->blockDecoderState);
+void CVideoDecoder::StopSliceWorkers()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_sliceMutex);
+		m_sliceWorkersDone = true;
+	}
+	m_sliceAvailableCondition.notify_all();
+	for(auto& workerThread : m_sliceWorkerThreads)
+	{
+		workerThread.join();
+	}
+	m_sliceWorkerThreads.clear();
+	m_pendingSlices.clear();
+}
+
+void CVideoDecoder::SliceWorkerThreadProc()
+{
+	VideoStream::ReadSlice sliceReader;
+	sliceReader.RegisterOnMacroblockDecodedHandler([this](MPEG_VIDEO_STATE* state) { OnMacroblockDecoded(state); });
+
+	while(true)
+	{
+		std::unique_ptr<SLICE> slice;
+		{
+			std::unique_lock<std::mutex> lock(m_sliceMutex);
+			m_sliceAvailableCondition.wait(lock, [&]() { return m_sliceWorkersDone || !m_pendingSlices.empty(); });
+			if(m_sliceWorkersDone) break;
+			slice = std::move(m_pendingSlices.front());
+			m_pendingSlices.pop_front();
+			m_busySliceWorkers++;
+		}
+
+		try
+		{
+			Framework::CPtrStream sliceStream(slice->data.data(), slice->data.size());
+			Framework::CStreamBitStream sliceBitStream(sliceStream);
+			sliceReader.Reset();
+			sliceReader.Execute(&slice->state, sliceBitStream);
+		}
+		catch(const Framework::CBitStream::CBitStreamException&)
+		{
+			//Slice was truncated, keep the macroblocks that were decoded
+		}
 
+		{
+			std::lock_guard<std::mutex> lock(m_sliceMutex);
+			m_busySliceWorkers--;
+		}
+		m_sliceDoneCondition.notify_one();
+	}
+}
+
+void CVideoDecoder::WaitForSlices()
+{
+	std::unique_lock<std::mutex> lock(m_sliceMutex);
+	m_sliceDoneCondition.wait(lock, [&]() { return m_pendingSlices.empty() && (m_busySliceWorkers == 0); });
+}
+
+void CVideoDecoder::PrepareFrame(const SEQUENCE_HEADER& sequenceHeader)
+{
 	if(
 	    (m_currentFrame.IsEmpty()) ||
 	    (m_currentFrame.GetWidth() != sequenceHeader.horizontalSize) ||
@@ -203,6 +282,51 @@ void CVideoDecoder::OnMacroblockDecoded(MPEG_VIDEO_STATE* state)
 	{
 		m_currentFrame = FRAME(sequenceHeader.horizontalSize, sequenceHeader.verticalSize);
 	}
+}
+
+void CVideoDecoder::OnSliceRead(MPEG_VIDEO_STATE* state, uint8 sliceStartCode, const std::vector<uint8>& sliceData)
+{
+	//Frame needs to be ready before workers start writing macroblocks to it
+	if(!m_pictureSlicesPending)
+	{
+		PrepareFrame(state->sequenceHeader);
+		m_pictureSlicesPending = true;
+	}
+
+	auto slice = std::make_unique<SLICE>();
+	slice->state = *state;
+
+	//Slice start code gives the macroblock row the slice begins on
+	slice->state.blockDecoderState.currentMbAddress = (sliceStartCode - 1) * state->sequenceHeader.macroblockWidth;
+
+	//Terminate with a start code for the slice reader to know where the slice ends
+	slice->data.reserve(sliceData.size() + 4);
+	slice->data.assign(sliceData.begin(), sliceData.end());
+	slice->data.insert(slice->data.end(), {0x00, 0x00, 0x01, 0x00});
+
+	{
+		std::lock_guard<std::mutex> lock(m_sliceMutex);
+		m_pendingSlices.push_back(std::move(slice));
+	}
+	m_sliceAvailableCondition.notify_one();
+}
+
+void CVideoDecoder::OnPictureRead(MPEG_VIDEO_STATE* state)
+{
+	WaitForSlices();
+	m_pictureSlicesPending = false;
+	OnPictureDecoded(state);
+}
+
+void CVideoDecoder::OnMacroblockDecoded(MPEG_VIDEO_STATE* state)
+{
+	const int blockWidth = 16;
+	const int blockHeight = 16;
+
+	MACROBLOCK& macroblock(state->macroblock);
+	PICTURE_HEADER& pictureHeader(state->pictureHeader);
+	SEQUENCE_HEADER& sequenceHeader(state->sequenceHeader);
+	BLOCK_DECODER_STATE& decoderState(state->blockDecoderState);
 
 	unsigned int macroblockX = decoderState.currentMbAddress % sequenceHeader.macroblockWidth;
 	unsigned int macroblockY = decoderState.currentMbAddress / sequenceHeader.macroblockWidth;
@@ -253,17 +377,7 @@ void CVideoDecoder::OnMacroblockDecoded(MPEG_VIDEO_STATE* state)
 		for(unsigned int i = 0; i < 6; i++)
 		{
 			if(!(decoderState.codedBlockPattern & (1 << (5 - i)))) continue;
-
-			int16* dstBlock = prevBlocks[i];
-			int16* srcBlock = currBlocks[i];
-
-			for(unsigned int y = 0; y < 8; y++)
-			{
-				for(unsigned int x = 0; x < 8; x++)
-				{
-					dstBlock[x + (y * 8)] += srcBlock[x + (y * 8)];
-				}
-			}
+			AddBlock8x8(prevBlocks[i], currBlocks[i]);
 		}
 
 		CopyBlock8x8(m_currentFrame.y, (macroblockX * 16) + 0, (macroblockY * 16) + 0, prevBlockY[0]);
@@ -347,6 +461,67 @@ void CVideoDecoder::OnPictureDecoded(MPEG_VIDEO_STATE* state)
 	NewFrame(m_frame);
 }
 
+static int16 ClampPixel(int16 pixel)
+{
+	return std::min<int16>(std::max<int16>(pixel, 0), 255);
+}
+
+#if defined(FRAMEWORK_SIMD_USE_SSE) || defined(FRAMEWORK_SIMD_USE_NEON)
+
+//Source block (including the extra row/column used for half-pel interpolation) must
+//be inside the plane. Reference pixels are always between 0 and 255.
+static void PredictBlock8x8(int16* dstPixels, const int16* srcPixels, unsigned int srcPitch, bool halfX, bool halfY)
+{
+	for(unsigned int j = 0; j < 8; j++)
+	{
+		const int16* srcRow0 = srcPixels + (j * srcPitch);
+		const int16* srcRow1 = srcRow0 + srcPitch;
+		int16* dstRow = dstPixels + (j * 8);
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+		__m128i pixel0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcRow0));
+		__m128i result = pixel0;
+		if(halfX && halfY)
+		{
+			__m128i pixel1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcRow0 + 1));
+			__m128i pixel2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcRow1));
+			__m128i pixel3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcRow1 + 1));
+			__m128i sum = _mm_add_epi16(_mm_add_epi16(pixel0, pixel1), _mm_add_epi16(pixel2, pixel3));
+			result = _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+		}
+		else if(halfX)
+		{
+			result = _mm_avg_epu16(pixel0, _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcRow0 + 1)));
+		}
+		else if(halfY)
+		{
+			result = _mm_avg_epu16(pixel0, _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcRow1)));
+		}
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dstRow), result);
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+		uint16x8_t pixel0 = vreinterpretq_u16_s16(vld1q_s16(srcRow0));
+		uint16x8_t result = pixel0;
+		if(halfX && halfY)
+		{
+			uint16x8_t pixel1 = vreinterpretq_u16_s16(vld1q_s16(srcRow0 + 1));
+			uint16x8_t pixel2 = vreinterpretq_u16_s16(vld1q_s16(srcRow1));
+			uint16x8_t pixel3 = vreinterpretq_u16_s16(vld1q_s16(srcRow1 + 1));
+			result = vrshrq_n_u16(vaddq_u16(vaddq_u16(pixel0, pixel1), vaddq_u16(pixel2, pixel3)), 2);
+		}
+		else if(halfX)
+		{
+			result = vrhaddq_u16(pixel0, vreinterpretq_u16_s16(vld1q_s16(srcRow0 + 1)));
+		}
+		else if(halfY)
+		{
+			result = vrhaddq_u16(pixel0, vreinterpretq_u16_s16(vld1q_s16(srcRow1)));
+		}
+		vst1q_s16(dstRow, vreinterpretq_s16_u16(result));
+#endif
+	}
+}
+
+#endif
+
 void CVideoDecoder::CopyBlock8x8(Framework::CBitmap& dst, unsigned int x, unsigned int y, const int16* srcPixels)
 {
 	const int blockWidth = 8;
@@ -354,6 +529,31 @@ void CVideoDecoder::CopyBlock8x8(Framework::CBitmap& dst, unsigned int x, unsign
 
 	auto dstPixels = reinterpret_cast<int16*>(dst.GetPixels());
 
+	//Reconstructed pixels are saturated, reference frames rely on this
+	if(((x + blockWidth) <= dst.GetWidth()) && ((y + blockHeight) <= dst.GetHeight()))
+	{
+		for(unsigned int j = 0; j < blockHeight; j++)
+		{
+			int16* dstRow = dstPixels + x + ((y + j) * dst.GetWidth());
+			const int16* srcRow = srcPixels + (j * blockWidth);
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+			__m128i row = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcRow));
+			row = _mm_min_epi16(_mm_max_epi16(row, _mm_setzero_si128()), _mm_set1_epi16(255));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dstRow), row);
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+			int16x8_t row = vld1q_s16(srcRow);
+			row = vminq_s16(vmaxq_s16(row, vdupq_n_s16(0)), vdupq_n_s16(255));
+			vst1q_s16(dstRow, row);
+#else
+			for(unsigned int i = 0; i < blockWidth; i++)
+			{
+				dstRow[i] = ClampPixel(srcRow[i]);
+			}
+#endif
+		}
+		return;
+	}
+
 	for(unsigned int j = 0; j < blockHeight; j++)
 	{
 		for(unsigned int i = 0; i < blockWidth; i++)
@@ -364,7 +564,7 @@ void CVideoDecoder::CopyBlock8x8(Framework::CBitmap& dst, unsigned int x, unsign
 			if(dstX >= dst.GetWidth()) continue;
 			if(dstY >= dst.GetHeight()) continue;
 
-			dstPixels[dstX + (dstY * dst.GetWidth())] = srcPixels[i + (j * blockWidth)];
+			dstPixels[dstX + (dstY * dst.GetWidth())] = ClampPixel(srcPixels[i + (j * blockWidth)]);
 		}
 	}
 }
@@ -382,6 +582,18 @@ void CVideoDecoder::CopyBlock8x8(int16* dstPixels, unsigned int x, unsigned int
 
 	auto srcPixels = reinterpret_cast<int16*>(src.GetPixels());
 
+#if defined(FRAMEWORK_SIMD_USE_SSE) || defined(FRAMEWORK_SIMD_USE_NEON)
+	int srcLeft = static_cast<int>(x) + baseX;
+	int srcTop = static_cast<int>(y) + baseY;
+	int srcRight = srcLeft + blockWidth + (halfX ? 1 : 0);
+	int srcBottom = srcTop + blockHeight + (halfY ? 1 : 0);
+	if((srcLeft >= 0) && (srcTop >= 0) && (srcRight <= static_cast<int>(src.GetWidth())) && (srcBottom <= static_cast<int>(src.GetHeight())))
+	{
+		PredictBlock8x8(dstPixels, srcPixels + srcLeft + (srcTop * src.GetWidth()), src.GetWidth(), halfX, halfY);
+		return;
+	}
+#endif
+
 	if(!halfX && !halfY)
 	{
 		for(unsigned int j = 0; j < blockHeight; j++)
@@ -459,6 +671,28 @@ void CVideoDecoder::CopyBlock8x8(int16* dstPixels, unsigned int x, unsigned int
 	}
 }
 
+void CVideoDecoder::AddBlock8x8(int16* dstPixels, const int16* srcPixels)
+{
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+	for(unsigned int i = 0; i < 64; i += 8)
+	{
+		__m128i dst = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dstPixels + i));
+		__m128i src = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcPixels + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dstPixels + i), _mm_add_epi16(dst, src));
+	}
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+	for(unsigned int i = 0; i < 64; i += 8)
+	{
+		vst1q_s16(dstPixels + i, vaddq_s16(vld1q_s16(dstPixels + i), vld1q_s16(srcPixels + i)));
+	}
+#else
+	for(unsigned int i = 0; i < 64; i++)
+	{
+		dstPixels[i] += srcPixels[i];
+	}
+#endif
+}
+
 void CVideoDecoder::CopyMacroblock(Framework::CBitmap& dst, unsigned int x, unsigned int y, const uint32* srcPixels)
 {
 	const int blockWidth = 16;
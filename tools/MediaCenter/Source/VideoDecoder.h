@@ -3,7 +3,12 @@
 #include "MpegVideoState.h"
 #include "bitmap/Bitmap.h"
 #include "signal/Signal.h"
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <thread>
+#include <vector>
 
 class CVideoDecoder
 {
@@ -38,6 +43,12 @@ private:
 		Framework::CBitmap cb;
 	};
 
+	struct SLICE
+	{
+		MPEG_VIDEO_STATE state;
+		std::vector<uint8> data;
+	};
+
 	CVideoDecoder(CVideoDecoder&&)
 	{
 	}
@@ -46,15 +57,34 @@ private:
 	}
 
 	void DecoderThreadProc(std::string);
+	void StartSliceWorkers();
+	void StopSliceWorkers();
+	void SliceWorkerThreadProc();
+	void WaitForSlices();
+	void PrepareFrame(const SEQUENCE_HEADER&);
+	void OnSliceRead(MPEG_VIDEO_STATE*, uint8, const std::vector<uint8>&);
+	void OnPictureRead(MPEG_VIDEO_STATE*);
 	void OnMacroblockDecoded(MPEG_VIDEO_STATE*);
 	void OnPictureDecoded(MPEG_VIDEO_STATE*);
 	static void CopyBlock8x8(Framework::CBitmap&, unsigned int, unsigned int, const int16*);
 	static void CopyBlock8x8(int16*, unsigned int, unsigned int, int16, int16, const Framework::CBitmap&);
+	static void AddBlock8x8(int16*, const int16*);
 	static void CopyMacroblock(Framework::CBitmap&, unsigned int, unsigned int, const uint32*);
 
 	std::thread m_decoderThread;
 	bool m_threadDone;
 
+	//Slices of the current picture are decoded by a pool of workers, each slice
+	//writes to its own macroblocks of the current frame
+	std::vector<std::thread> m_sliceWorkerThreads;
+	std::mutex m_sliceMutex;
+	std::condition_variable m_sliceAvailableCondition;
+	std::condition_variable m_sliceDoneCondition;
+	std::deque<std::unique_ptr<SLICE>> m_pendingSlices;
+	unsigned int m_busySliceWorkers = 0;
+	bool m_sliceWorkersDone = false;
+	bool m_pictureSlicesPending = false;
+
 	FRAME m_previousFrame;
 	FRAME m_currentFrame;
 
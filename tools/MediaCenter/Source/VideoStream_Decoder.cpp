@@ -16,6 +16,8 @@ static const uint8 g_defaultIntraQuantizerMatrix[0x40] =
         27, 29, 35, 38, 46, 56, 69, 83};
 
 Decoder::Decoder()
+    : m_readSlicesOnly(false)
+    , m_pictureDataPending(false)
 {
 }
 
@@ -49,10 +51,22 @@ void Decoder::RegisterOnPictureDecodedHandler(const OnPictureDecodedHandler& han
 	m_readSliceProgram.RegisterOnPictureDecodedHandler(handler);
 }
 
+void Decoder::RegisterOnSliceReadHandler(const OnSliceReadHandler& handler)
+{
+	m_readSliceDataProgram.RegisterOnSliceReadHandler(handler);
+	m_readSlicesOnly = true;
+}
+
+void Decoder::RegisterOnPictureReadHandler(const OnPictureReadHandler& handler)
+{
+	m_OnPictureReadHandler = handler;
+}
+
 void Decoder::Reset()
 {
 	m_programState = STATE_GETMARKER;
 	m_subProgram = NULL;
+	m_pictureDataPending = false;
 }
 
 void Decoder::Execute(void* context, CBitStream& stream)
@@ -99,9 +113,27 @@ void Decoder::Execute(void* context, CBitStream& stream)
 
 	Label_GetCommand:
 		m_commandType = static_cast<uint8>(stream.GetBits_MSBF(8));
+		if(m_pictureDataPending && !(m_commandType >= 0x01 && m_commandType <= 0xAF))
+		{
+			//Any other start code ends the picture's slices
+			m_pictureDataPending = false;
+			if(m_OnPictureReadHandler)
+			{
+				m_OnPictureReadHandler(state);
+			}
+		}
 		if(m_commandType >= 0x01 && m_commandType <= 0xAF)
 		{
-			m_subProgram = &m_readSliceProgram;
+			if(m_readSlicesOnly)
+			{
+				m_readSliceDataProgram.SetSliceStartCode(m_commandType);
+				m_subProgram = &m_readSliceDataProgram;
+				m_pictureDataPending = true;
+			}
+			else
+			{
+				m_subProgram = &m_readSliceProgram;
+			}
 		}
 		else if(m_commandType == 0xB5)
 		{
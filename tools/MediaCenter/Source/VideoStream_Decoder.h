@@ -8,6 +8,7 @@
 #include "VideoStream_ReadSequenceExtension.h"
 #include "VideoStream_ReadGroupOfPicturesHeader.h"
 #include "VideoStream_ReadSlice.h"
+#include "VideoStream_ReadSliceData.h"
 #include "MpegVideoState.h"
 
 namespace VideoStream
@@ -17,6 +18,8 @@ namespace VideoStream
 	public:
 		typedef ReadSlice::OnMacroblockDecodedHandler OnMacroblockDecodedHandler;
 		typedef ReadSlice::OnPictureDecodedHandler OnPictureDecodedHandler;
+		typedef ReadSliceData::OnSliceReadHandler OnSliceReadHandler;
+		typedef std::function<void(MPEG_VIDEO_STATE*)> OnPictureReadHandler;
 
 		Decoder();
 		virtual ~Decoder();
@@ -29,6 +32,11 @@ namespace VideoStream
 		void RegisterOnMacroblockDecodedHandler(const OnMacroblockDecodedHandler&);
 		void RegisterOnPictureDecodedHandler(const OnPictureDecodedHandler&);
 
+		//When these are registered, slices are handed out as is instead of being decoded
+		//and the picture read handler is called once all slices of a picture were read
+		void RegisterOnSliceReadHandler(const OnSliceReadHandler&);
+		void RegisterOnPictureReadHandler(const OnPictureReadHandler&);
+
 	private:
 		enum PROGRAM_STATE
 		{
@@ -45,6 +53,8 @@ namespace VideoStream
 		uint32 m_marker;
 		uint8 m_commandType;
 		uint8 m_extensionType;
+		bool m_readSlicesOnly;
+		bool m_pictureDataPending;
 
 		Program* m_subProgram;
 
@@ -54,6 +64,8 @@ namespace VideoStream
 		ReadSequenceHeader m_readSequenceHeaderProgram;
 		ReadGroupOfPicturesHeader m_readGroupOfPicturesHeaderProgram;
 		ReadSlice m_readSliceProgram;
+		ReadSliceData m_readSliceDataProgram;
+		OnPictureReadHandler m_OnPictureReadHandler;
 	};
 }
 
@@ -0,0 +1,43 @@
+#include "VideoStream_ReadSliceData.h"
+
+using namespace VideoStream;
+
+ReadSliceData::ReadSliceData()
+    : m_sliceStartCode(0)
+{
+}
+
+ReadSliceData::~ReadSliceData()
+{
+}
+
+void ReadSliceData::RegisterOnSliceReadHandler(const OnSliceReadHandler& handler)
+{
+	m_OnSliceReadHandler = handler;
+}
+
+void ReadSliceData::Reset()
+{
+	m_sliceData.clear();
+}
+
+void ReadSliceData::SetSliceStartCode(uint8 sliceStartCode)
+{
+	m_sliceStartCode = sliceStartCode;
+}
+
+void ReadSliceData::Execute(void* context, Framework::CBitStream& stream)
+{
+	MPEG_VIDEO_STATE* state(reinterpret_cast<MPEG_VIDEO_STATE*>(context));
+
+	//Slice start codes are byte aligned, slice data ends where the next start code begins
+	while(stream.PeekBits_MSBF(24) != 0x000001)
+	{
+		m_sliceData.push_back(static_cast<uint8>(stream.GetBits_MSBF(8)));
+	}
+
+	if(m_OnSliceReadHandler)
+	{
+		m_OnSliceReadHandler(state, m_sliceStartCode, m_sliceData);
+	}
+}
@@ -0,0 +1,34 @@
+#ifndef _VIDEOSTREAM_READSLICEDATA_H_
+#define _VIDEOSTREAM_READSLICEDATA_H_
+
+#include <functional>
+#include <vector>
+#include "MpegVideoState.h"
+#include "VideoStream_Program.h"
+
+namespace VideoStream
+{
+	//Gathers the bytes of a slice without decoding them. Slices are independent
+	//within a picture, so they can be decoded later on by ReadSlice in any order.
+	class ReadSliceData : public Program
+	{
+	public:
+		typedef std::function<void(MPEG_VIDEO_STATE*, uint8, const std::vector<uint8>&)> OnSliceReadHandler;
+
+		ReadSliceData();
+		virtual ~ReadSliceData();
+
+		void Reset();
+		void SetSliceStartCode(uint8);
+		void Execute(void*, Framework::CBitStream&);
+
+		void RegisterOnSliceReadHandler(const OnSliceReadHandler&);
+
+	private:
+		uint8 m_sliceStartCode;
+		std::vector<uint8> m_sliceData;
+		OnSliceReadHandler m_OnSliceReadHandler;
+	};
+}
+
+#endif